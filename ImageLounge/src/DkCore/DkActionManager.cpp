@@ -578,6 +578,7 @@ QMenu *DkActionManager::createToolsMenu(QWidget *parent /* = 0 */)
 #endif
     mToolsMenu->addAction(mToolsActions[menu_tools_batch]);
     mToolsMenu->addAction(mToolsActions[menu_tools_thumbs]);
+    mToolsMenu->addAction(mToolsActions[menu_tools_find_duplicates]);
     mToolsMenu->addAction(mToolsActions[menu_tools_train_format]);
 
     return mToolsMenu;
@@ -940,44 +941,45 @@ void DkActionManager::init()
 
 void DkActionManager::createIcons()
 {
+    // svgs are rendered when an icon is shown first - this keeps them off the start-up path
     mFileIcons.resize(icon_file_end);
-    mFileIcons[icon_file_dir] = DkImage::loadIcon(":/nomacs/img/dir.svg");
-    mFileIcons[icon_file_open] = DkImage::loadIcon(":/nomacs/img/open.svg");
-    mFileIcons[icon_file_save] = DkImage::loadIcon(":/nomacs/img/save.svg");
-    mFileIcons[icon_file_print] = DkImage::loadIcon(":/nomacs/img/print.svg");
+    mFileIcons[icon_file_dir] = DkImage::loadDeferredIcon(":/nomacs/img/dir.svg");
+    mFileIcons[icon_file_open] = DkImage::loadDeferredIcon(":/nomacs/img/open.svg");
+    mFileIcons[icon_file_save] = DkImage::loadDeferredIcon(":/nomacs/img/save.svg");
+    mFileIcons[icon_file_print] = DkImage::loadDeferredIcon(":/nomacs/img/print.svg");
     mFileIcons[icon_file_open_large] = QIcon(":/nomacs/img/open.svg");
     mFileIcons[icon_file_dir_large] = QIcon(":/nomacs/img/dir.svg");
-    mFileIcons[icon_file_prev] = DkImage::loadIcon(":/nomacs/img/previous.svg");
-    mFileIcons[icon_file_next] = DkImage::loadIcon(":/nomacs/img/next.svg");
+    mFileIcons[icon_file_prev] = DkImage::loadDeferredIcon(":/nomacs/img/previous.svg");
+    mFileIcons[icon_file_next] = DkImage::loadDeferredIcon(":/nomacs/img/next.svg");
     mFileIcons[icon_file_filter] = DkImage::loadIcon();
     mFileIcons[icon_file_filter].addPixmap(DkImage::loadIcon(":/nomacs/img/filter.svg"), QIcon::Normal, QIcon::On);
     mFileIcons[icon_file_filter].addPixmap(DkImage::loadIcon(":/nomacs/img/filter-disabled.svg"), QIcon::Normal, QIcon::Off);
-    mFileIcons[icon_file_find] = DkImage::loadIcon(":/nomacs/img/find.svg");
+    mFileIcons[icon_file_find] = DkImage::loadDeferredIcon(":/nomacs/img/find.svg");
 
     mEditIcons.resize(icon_edit_end);
-    mEditIcons[icon_edit_image] = DkImage::loadIcon(":/nomacs/img/sliders.svg");
-    mEditIcons[icon_edit_rotate_cw] = DkImage::loadIcon(":/nomacs/img/rotate-cw.svg");
-    mEditIcons[icon_edit_rotate_ccw] = DkImage::loadIcon(":/nomacs/img/rotate-cc.svg");
-    mEditIcons[icon_edit_crop] = DkImage::loadIcon(":/nomacs/img/crop.svg");
-    mEditIcons[icon_edit_resize] = DkImage::loadIcon(":/nomacs/img/resize.svg");
-    mEditIcons[icon_edit_orientation] = DkImage::loadIcon(":/nomacs/img/orientation.svg");
-    mEditIcons[icon_edit_copy] = DkImage::loadIcon(":/nomacs/img/copy.svg");
-    mEditIcons[icon_edit_paste] = DkImage::loadIcon(":/nomacs/img/paste.svg");
-    mEditIcons[icon_edit_delete] = DkImage::loadIcon(":/nomacs/img/trash.svg");
+    mEditIcons[icon_edit_image] = DkImage::loadDeferredIcon(":/nomacs/img/sliders.svg");
+    mEditIcons[icon_edit_rotate_cw] = DkImage::loadDeferredIcon(":/nomacs/img/rotate-cw.svg");
+    mEditIcons[icon_edit_rotate_ccw] = DkImage::loadDeferredIcon(":/nomacs/img/rotate-cc.svg");
+    mEditIcons[icon_edit_crop] = DkImage::loadDeferredIcon(":/nomacs/img/crop.svg");
+    mEditIcons[icon_edit_resize] = DkImage::loadDeferredIcon(":/nomacs/img/resize.svg");
+    mEditIcons[icon_edit_orientation] = DkImage::loadDeferredIcon(":/nomacs/img/orientation.svg");
+    mEditIcons[icon_edit_copy] = DkImage::loadDeferredIcon(":/nomacs/img/copy.svg");
+    mEditIcons[icon_edit_paste] = DkImage::loadDeferredIcon(":/nomacs/img/paste.svg");
+    mEditIcons[icon_edit_delete] = DkImage::loadDeferredIcon(":/nomacs/img/trash.svg");
 
     mViewIcons.resize(icon_view_end);
-    mViewIcons[icon_view_fullscreen] = DkImage::loadIcon(":/nomacs/img/fullscreen.svg");
-    mViewIcons[icon_view_reset] = DkImage::loadIcon(":/nomacs/img/zoom-reset.svg");
-    mViewIcons[icon_view_100] = DkImage::loadIcon(":/nomacs/img/zoom-100.svg");
-    mViewIcons[icon_view_gps] = DkImage::loadIcon(":/nomacs/img/location.svg");
-    mViewIcons[icon_view_zoom_in] = DkImage::loadIcon(":/nomacs/img/zoom-in.svg");
-    mViewIcons[icon_view_zoom_out] = DkImage::loadIcon(":/nomacs/img/zoom-out.svg");
+    mViewIcons[icon_view_fullscreen] = DkImage::loadDeferredIcon(":/nomacs/img/fullscreen.svg");
+    mViewIcons[icon_view_reset] = DkImage::loadDeferredIcon(":/nomacs/img/zoom-reset.svg");
+    mViewIcons[icon_view_100] = DkImage::loadDeferredIcon(":/nomacs/img/zoom-100.svg");
+    mViewIcons[icon_view_gps] = DkImage::loadDeferredIcon(":/nomacs/img/location.svg");
+    mViewIcons[icon_view_zoom_in] = DkImage::loadDeferredIcon(":/nomacs/img/zoom-in.svg");
+    mViewIcons[icon_view_zoom_out] = DkImage::loadDeferredIcon(":/nomacs/img/zoom-out.svg");
 
     mViewIcons[icon_view_movie_play] = DkImage::loadIcon(":/nomacs/img/play.svg");
     mViewIcons[icon_view_movie_play].addPixmap(DkImage::loadIcon(":/nomacs/img/play.svg"), QIcon::Normal, QIcon::On);
     mViewIcons[icon_view_movie_play].addPixmap(DkImage::loadIcon(":/nomacs/img/pause.svg"), QIcon::Normal, QIcon::Off);
-    mViewIcons[icon_view_movie_prev] = DkImage::loadIcon(":/nomacs/img/previous.svg");
-    mViewIcons[icon_view_movie_next] = DkImage::loadIcon(":/nomacs/img/next.svg");
+    mViewIcons[icon_view_movie_prev] = DkImage::loadDeferredIcon(":/nomacs/img/previous.svg");
+    mViewIcons[icon_view_movie_next] = DkImage::loadDeferredIcon(":/nomacs/img/next.svg");
 }
 
 void DkActionManager::createActions(QWidget *parent)
@@ -1440,6 +1442,10 @@ void DkActionManager::createActions(QWidget *parent)
     mToolsActions[menu_tools_train_format] = new QAction(QObject::tr("Add Image Format"), parent);
     mToolsActions[menu_tools_train_format]->setStatusTip(QObject::tr("Add a new image format to nomacs"));
 
+    mToolsActions[menu_tools_find_duplicates] = new QAction(QObject::tr("Find &Duplicates"), parent);
+    mToolsActions[menu_tools_find_duplicates]->setStatusTip(QObject::tr("find duplicates and near-duplicates in the current folder"));
+    mToolsActions[menu_tools_find_duplicates]->setEnabled(false);
+
     // help menu
     mHelpActions.resize(menu_help_end);
     mHelpActions[menu_help_about] = new QAction(QObject::tr("&About Nomacs"), parent);
@@ -1755,6 +1761,7 @@ void DkActionManager::enableImageActions(bool enable) const
 
     action(DkActionManager::menu_tools_wallpaper)->setEnabled(enable);
     action(DkActionManager::menu_tools_thumbs)->setEnabled(enable);
+    action(DkActionManager::menu_tools_find_duplicates)->setEnabled(enable);
 
     // hidden actions
     action(DkActionManager::sc_skip_prev)->setEnabled(enable);
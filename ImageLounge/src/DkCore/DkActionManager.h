@@ -181,6 +181,7 @@ public:
         menu_tools_batch,
         menu_tools_wallpaper,
         menu_tools_train_format,
+        menu_tools_find_duplicates,
 
         menu_tools_end,
     };
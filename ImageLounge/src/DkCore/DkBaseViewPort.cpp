@@ -520,10 +520,9 @@ void DkBaseViewPort::draw(QPainter &painter, double opacity)
     }
 
     QRect displayRect = mWorldMatrix.mapRect(mImgViewRect).toRect();
-    QImage img = mImgStorage.image(displayRect.size());
 
     // opacity == 1.0f -> do not show pattern if we crossfade two images
-    if (DkSettingsManager::param().display().tpPattern && img.hasAlphaChannel() && opacity == 1.0)
+    if (DkSettingsManager::param().display().tpPattern && mImgStorage.imageConst().hasAlphaChannel() && opacity == 1.0)
         drawPattern(painter);
 
     double oldOp = painter.opacity();
@@ -534,8 +533,16 @@ void DkBaseViewPort::draw(QPainter &painter, double opacity)
     } else if (mMovie && mMovie->isValid()) {
         painter.drawPixmap(mImgViewRect, mMovie->currentPixmap(), mMovie->frameRect());
     } else {
-        // if we have the exact level cached: render it directly
-        if (displayRect.width() == img.width() && displayRect.height() == img.height()) {
+        QPixmap pm = mImgStorage.pixmap(displayRect.size());
+        QImage img = pm.isNull() ? mImgStorage.displayImage(displayRect.size()) : QImage();
+
+        // if we have the exact level cached: blit it
+        if (!pm.isNull()) {
+            painter.setWorldMatrixEnabled(false);
+            painter.setRenderHint(QPainter::SmoothPixmapTransform, false);
+            painter.drawPixmap(displayRect, pm, pm.rect());
+            painter.setWorldMatrixEnabled(true);
+        } else if (displayRect.width() == img.width() && displayRect.height() == img.height()) {
             painter.setWorldMatrixEnabled(false);
             painter.setRenderHint(QPainter::SmoothPixmapTransform, false);
             painter.drawImage(displayRect, img, img.rect());
@@ -27,11 +27,16 @@
 
 #include "DkBasicLoader.h"
 
+#include "DkCacheManager.h"
+#include "DkFileReadCache.h"
+#include "DkFormatRegistry.h"
 #include "DkImageContainer.h"
 #include "DkImageStorage.h"
 #include "DkMath.h"
 #include "DkMetaData.h"
 #include "DkSettings.h"
+#include "DkThumbs.h"
+#include "DkTiffReader.h"
 #include "DkTimer.h"
 #include "DkUtils.h" // just needed for qInfo() #ifdef
 
@@ -48,7 +53,9 @@
 #include <QObject>
 #include <QPixmap>
 #include <QRegularExpression>
+#include <QThread>
 #include <QtConcurrentRun>
+#include <QtEndian>
 
 #include <assert.h>
 #include <qmath.h>
@@ -142,6 +149,22 @@ int DkEditImage::size() const
     return qRound(DkImage::getBufferSizeFloat(mImg.size(), mImg.depth()));
 }
 
+void DkEditImage::setLosslessTransform(const DkJpegTransform &transform)
+{
+    mTransform = transform;
+    mLossless = transform.isValid();
+}
+
+bool DkEditImage::isLossless() const
+{
+    return mLossless;
+}
+
+DkJpegTransform DkEditImage::losslessTransform() const
+{
+    return mTransform;
+}
+
 // Basic loader and image edit class --------------------------------------------------------------------
 DkBasicLoader::DkBasicLoader(int mode)
 {
@@ -211,6 +234,15 @@ bool DkBasicLoader::loadGeneral(const QString &filePath, QSharedPointer<QByteArr
             mLoader = qt_loader;
     }
 
+    // Qt decodes tiffs on a single thread - large ones are decoded in parallel (strips & tiles)
+    bool isTiff = newSuffix.contains(QRegularExpression("(tif|tiff)", QRegularExpression::CaseInsensitiveOption));
+    if (!imgLoaded && isTiff && DkTiffReader::isLarge(mFile, ba)) {
+        imgLoaded = loadTIFFile(mFile, img, ba, fast);
+
+        if (imgLoaded)
+            mLoader = tif_loader;
+    }
+
     // load large icons
     if (!imgLoaded && suf == "ico") {
         QIcon icon(mFile);
@@ -234,9 +266,9 @@ bool DkBasicLoader::loadGeneral(const QString &filePath, QSharedPointer<QByteArr
             mLoader = qt_loader;
     }
 
-    // OpenCV Tiff loader - supports jpg compressed tiffs
-    if (!imgLoaded && newSuffix.contains(QRegularExpression("(tif|tiff)", QRegularExpression::CaseInsensitiveOption))) {
-        imgLoaded = loadTIFFile(mFile, img, ba);
+    // libtiff loader - supports jpg compressed tiffs
+    if (!imgLoaded && isTiff) {
+        imgLoaded = loadTIFFile(mFile, img, ba, fast);
 
         if (imgLoaded)
             mLoader = tif_loader;
@@ -317,13 +349,11 @@ bool DkBasicLoader::loadGeneral(const QString &filePath, QSharedPointer<QByteArr
     if (imgLoaded && loadMetaData && mMetaData) {
         try {
             mMetaData->setQtValues(img);
-            int orientation = mMetaData->getOrientationDegree();
-
-            if (orientation != -1 && orientation != 0
-                    && !mMetaData->isTiff() && !mMetaData->isAVIF() && !mMetaData->isHEIF() && !mMetaData->isJXL()
-                    && !DkSettingsManager::param().metaData().ignoreExifOrientation) {
+            int orientation = loadOrientation();
 
+            if (orientation != 0) {
                 img = DkImage::rotateImage(img, orientation);
+                mLoadedOrientation = orientation;
             }
 
         } catch (...) {
@@ -332,9 +362,13 @@ bool DkBasicLoader::loadGeneral(const QString &filePath, QSharedPointer<QByteArr
         qDebug() << "metaData is NULL!";
     }
 
-    if (imgLoaded)
+    if (imgLoaded) {
         setEditImage(img, tr("Original Image"));
 
+        // rotations & flips of the original can be saved without re-encoding (jpgs only)
+        mImages[mImageIndex].setLosslessTransform(DkJpegTransform());
+    }
+
     if (imgLoaded)
         qInfo() << "[Basic Loader]" << filePath << "loaded in" << dt;
     else
@@ -343,6 +377,178 @@ bool DkBasicLoader::loadGeneral(const QString &filePath, QSharedPointer<QByteArr
     return imgLoaded;
 }
 
+/**
+ * Takes an image that a peer decoded (see DkSharedImage) instead of decoding filePath.
+ * The peer rotated the pixels already - everything else is set up as in loadGeneral().
+ * @param filePath the image's file path
+ * @param img the shared image
+ * @param ba the file buffer (can be empty)
+ * @return bool true if img is valid
+ **/
+bool DkBasicLoader::loadShared(const QString &filePath, const QImage &img, const QSharedPointer<QByteArray> ba)
+{
+    if (img.isNull())
+        return false;
+
+    mFile = DkUtils::resolveSymLink(filePath);
+    release();
+
+    try {
+        mMetaData->readMetaData(filePath, ba);
+
+        // the Qt values are not shared: read them from the header
+        QBuffer buffer;
+        QImageReader reader;
+
+        if (ba && !ba->isEmpty()) {
+            buffer.setData(*ba);
+            buffer.open(QIODevice::ReadOnly);
+            reader.setDevice(&buffer);
+        } else
+            reader.setFileName(mFile);
+
+        mMetaData->setQtValues(reader);
+        mLoadedOrientation = loadOrientation();
+    } catch (...) {
+    } // ignore if we cannot read the metadata
+
+    if (!mPageIdxDirty)
+        indexPages(mFile, ba);
+    mPageIdxDirty = false;
+
+    setEditImage(img, tr("Original Image"));
+
+    // rotations & flips of the original can be saved without re-encoding (jpgs only)
+    mImages[mImageIndex].setLosslessTransform(DkJpegTransform());
+
+    return true;
+}
+
+/**
+ * Returns the exif rotation that is applied to the pixels when loading.
+ * @return int the rotation in degrees or 0
+ **/
+int DkBasicLoader::loadOrientation() const
+{
+    if (!mMetaData)
+        return 0;
+
+    int orientation = mMetaData->getOrientationDegree();
+
+    if (orientation != -1 && orientation != 0 && !mMetaData->isTiff() && !mMetaData->isAVIF() && !mMetaData->isHEIF() && !mMetaData->isJXL()
+        && !DkSettingsManager::param().metaData().ignoreExifOrientation)
+        return orientation;
+
+    return 0;
+}
+
+/**
+ * Loads a reduced version of an image which is much faster than decoding the full image.
+ * jpgs are decoded with DCT scaling, tiffs use their reduced images (SubIFDs)
+ * and RAW files their embedded preview. Other formats are not supported.
+ * @param filePath the file to be loaded
+ * @param ba the file buffer (can be empty)
+ * @param maxSize the size the preview should fit into (e.g. the screen size)
+ * @param img the preview
+ * @param fullSize the size of the full resolution image (already oriented)
+ * @return bool true if a preview was loaded
+ **/
+bool DkBasicLoader::loadPreview(const QString &filePath, QSharedPointer<QByteArray> ba, const QSize &maxSize, QImage &img, QSize &fullSize)
+{
+    DkTimer dt;
+    QString suf = QFileInfo(filePath).suffix().toLower();
+    bool ignoreOrientation = DkSettingsManager::param().metaData().ignoreExifOrientation;
+
+    if (suf == "jpg" || suf == "jpeg" || suf == "jpe") {
+        QBuffer buffer;
+        QImageReader reader;
+
+        if (ba && !ba->isEmpty()) {
+            buffer.setData(*ba);
+            buffer.open(QIODevice::ReadOnly);
+            reader.setDevice(&buffer);
+            reader.setFormat("jpg");
+        } else
+            reader.setFileName(filePath);
+
+        fullSize = reader.size();
+        QSize s = fullSize.scaled(maxSize, Qt::KeepAspectRatio);
+
+        // the full decode is fast enough for small images
+        if (fullSize.isEmpty() || s.width() * 2 > fullSize.width())
+            return false;
+
+        // the Qt jpg handler scales in the DCT domain (1/2, 1/4, 1/8)
+        reader.setScaledSize(s);
+        reader.setAutoTransform(!ignoreOrientation);
+
+        if (!reader.read(&img))
+            return false;
+
+        if (!ignoreOrientation && reader.transformation() & QImageIOHandler::TransformationRotate90)
+            fullSize.transpose();
+    } else if (suf == "tif" || suf == "tiff") {
+        DkTiffReader reader(filePath, ba);
+        fullSize = reader.size();
+
+        if (fullSize.isEmpty() || !reader.readPreview(img, fullSize.scaled(maxSize, Qt::KeepAspectRatio)))
+            return false;
+    } else if (DkFormatRegistry::instance().hasCapability(filePath, DkFormatRegistry::cap_raw)) {
+        DkMetaDataT metaData;
+
+        try {
+            metaData.readMetaData(filePath, ba);
+            img = metaData.getPreviewImage();
+        } catch (...) {
+            return false;
+        }
+
+        if (img.isNull())
+            return false;
+
+        fullSize = metaData.getImageSize();
+        int orientation = metaData.getOrientationDegree();
+
+        if (orientation != -1 && orientation != 0 && !ignoreOrientation) {
+            img = DkImage::rotateImage(img, orientation);
+
+            if (orientation == 90 || orientation == 270 || orientation == -90)
+                fullSize.transpose();
+        }
+
+        // the exif dimensions are not always set
+        if (fullSize.isEmpty() || qAbs((double)fullSize.width() / fullSize.height() - (double)img.width() / img.height()) > 0.05)
+            fullSize = img.size();
+    } else
+        return false;
+
+    qInfo() << "[Basic Loader] preview" << img.size() << "of" << fullSize << "loaded in" << dt;
+
+    return !img.isNull();
+}
+
+/**
+ * Reads the image size from the file's header (without decoding the image).
+ * The exif orientation is not applied.
+ * @param filePath the image's file path
+ * @param ba the file buffer (can be empty)
+ * @return QSize the image size or an invalid size if Qt cannot read the header
+ **/
+QSize DkBasicLoader::imageSize(const QString &filePath, QSharedPointer<QByteArray> ba)
+{
+    QBuffer buffer;
+    QImageReader reader;
+
+    if (ba && !ba->isEmpty()) {
+        buffer.setData(*ba);
+        buffer.open(QIODevice::ReadOnly);
+        reader.setDevice(&buffer);
+    } else
+        reader.setFileName(filePath);
+
+    return reader.size();
+}
+
 /**
  * Loads special RAW files that are generated by the Hamamatsu camera.
  * @param fileName the filename of the file to be loaded.
@@ -482,70 +688,38 @@ bool DkBasicLoader::loadPSDFile(const QString &filePath, QImage &img, QSharedPoi
 }
 
 #ifndef WITH_LIBTIFF
-bool DkBasicLoader::loadTIFFile(const QString &, QImage &, QSharedPointer<QByteArray>) const
+bool DkBasicLoader::loadTIFFile(const QString &, QImage &, QSharedPointer<QByteArray>, bool) const
 {
 #else
-bool DkBasicLoader::loadTIFFile(const QString &filePath, QImage &img, QSharedPointer<QByteArray> ba) const
+bool DkBasicLoader::loadTIFFile(const QString &filePath, QImage &img, QSharedPointer<QByteArray> ba, bool fast) const
 {
-    bool success = false;
-
     // first turn off nasty warning/error dialogs - (we do the GUI : )
     TIFFErrorHandler oldErrorHandler, oldWarningHandler;
     oldWarningHandler = TIFFSetWarningHandler(NULL);
     oldErrorHandler = TIFFSetErrorHandler(NULL);
 
-    DkTimer dt;
-    TIFF *tiff = 0;
-
-// TODO: currently TIFFStreamOpen can only be linked on Windows?!
-#if defined(Q_OS_WIN)
-
-    std::istringstream is(ba ? ba->toStdString() : "");
-
-    if (ba)
-        tiff = TIFFStreamOpen("MemTIFF", &is);
-
-    // fallback to direct loading
-    if (!tiff)
-        tiff = TIFFOpen(filePath.toLatin1(), "r");
-
-    // loading from buffer allows us to load files with non-latin names
-    QSharedPointer<QByteArray> bal;
-    if (!tiff)
-        bal = loadFileToBuffer(filePath);
-
-    std::istringstream isl(bal ? bal->toStdString() : "");
-
-    if (bal)
-        tiff = TIFFStreamOpen("MemTIFF", &isl);
-#else
-    tiff = TIFFOpen(filePath.toLatin1(), "r");
-#endif
-
-    if (!tiff)
-        return success;
-
-    uint32_t width = 0;
-    uint32_t height = 0;
-
-    TIFFGetField(tiff, TIFFTAG_IMAGEWIDTH, &width);
-    TIFFGetField(tiff, TIFFTAG_IMAGELENGTH, &height);
-
-    // init the qImage
-    img = QImage(width, height, QImage::Format_ARGB32);
-
-    const int stopOnError = 1;
-    success = TIFFReadRGBAImageOriented(tiff, width, height, reinterpret_cast<uint32_t *>(img.bits()), ORIENTATION_TOPLEFT, stopOnError) != 0;
+    DkTiffReader reader(filePath, ba);
+    bool success = false;
 
-    if (success) {
-        for (uint32_t y = 0; y < height; ++y)
-            convert32BitOrder(img.scanLine(y), width);
+    if (reader.isOpen()) {
+        // previews (e.g. thumbnails) use reduced-resolution images if the tiff has any
+        if (fast)
+            success = reader.readPreview(img, QSize(max_thumb_size, max_thumb_size));
+
+        if (!success) {
+            // stream the strips/tiles decoded so far (progressive display)
+            if (!fast && DkSettingsManager::param().resources().progressiveLoading) {
+                QSize size = reader.size();
+                reader.setPreviewCallback([this, size](const QImage &preview) {
+                    emit previewSignal(preview, size);
+                });
+            }
+            success = reader.read(img);
+        }
     }
 
-    TIFFClose(tiff);
-
     TIFFSetWarningHandler(oldWarningHandler);
-    TIFFSetWarningHandler(oldErrorHandler);
+    TIFFSetErrorHandler(oldErrorHandler);
 
     return success;
 
@@ -714,6 +888,22 @@ void DkBasicLoader::setImage(const QImage &img, const QString &editName, const Q
     setEditImage(img, editName);
 }
 
+/**
+ * Replaces the pixels of the current edit with an identical copy
+ * that is shared with other instances (see DkSharedImage).
+ * @param img the shared copy of image()
+ **/
+void DkBasicLoader::setSharedImage(const QImage &img)
+{
+    if (img.isNull() || mImageIndex < 0 || mImageIndex >= mImages.size())
+        return;
+
+    if (mImages[mImageIndex].image().size() != img.size() || mImages[mImageIndex].image().format() != img.format())
+        return;
+
+    mImages[mImageIndex].setImage(img);
+}
+
 void DkBasicLoader::pruneEditHistory()
 {
     // delete all hidden edit states
@@ -755,7 +945,7 @@ void DkBasicLoader::setEditImage(const QImage &img, const QString &editName)
     if (needReplace) {
         mImages[mImageIndex] = newImg;
     } else {
-        if (historySize + newImg.size() > DkSettingsManager::param().resources().historyMemory && mImages.size() > mMinHistorySize) {
+        if (historySize + newImg.size() > DkCacheManager::historyBudget() && mImages.size() > mMinHistorySize) {
             mImages.removeAt(1);
             qWarning() << "removing history image because it's too large:" << historySize + newImg.size() << "MB";
         }
@@ -819,6 +1009,17 @@ QSharedPointer<DkMetaDataT> DkBasicLoader::getMetaData() const
     return metaData;
 };
 
+/**
+ * @brief Replaces the metadata, e.g. with a copy of another loader's metadata.
+ *
+ * @param metaData the new metadata object
+ */
+void DkBasicLoader::setMetaData(QSharedPointer<DkMetaDataT> metaData)
+{
+    if (metaData)
+        mMetaData = metaData;
+}
+
 bool DkBasicLoader::isImageEdited() const
 {
     return mImages.size() > 1;
@@ -864,11 +1065,46 @@ DkEditImage DkBasicLoader::lastEdit() const
     return mImages[mImageIndex];
 }
 
+/**
+ * @brief Marks the current edit as a lossless transform of the previous one.
+ *
+ * @param img the edited image (the edit is only marked if it is still the current one)
+ * @param transform the transform that was applied to the previous edit
+ */
+void DkBasicLoader::setLosslessEdit(const QImage &img, const DkJpegTransform &transform)
+{
+    if (mImageIndex < 1 || mImageIndex >= mImages.size() || mImages[mImageIndex].image().cacheKey() != img.cacheKey())
+        return;
+
+    const DkEditImage &prev = mImages[mImageIndex - 1];
+    if (!prev.isLossless())
+        return;
+
+    DkJpegTransform t = prev.losslessTransform();
+    t.append(transform);
+    mImages[mImageIndex].setLosslessTransform(t);
+}
+
 int DkBasicLoader::historyIndex() const
 {
     return mImageIndex;
 }
 
+/**
+ * Returns the memory used by all edits but the current image in MB.
+ **/
+float DkBasicLoader::historyMemoryUsage() const
+{
+    float mem = 0;
+
+    for (int idx = 0; idx < mImages.size(); idx++) {
+        if (idx != mImageIndex)
+            mem += mImages[idx].size();
+    }
+
+    return mem;
+}
+
 void DkBasicLoader::setMinHistorySize(int size)
 {
     mMinHistorySize = size;
@@ -1053,50 +1289,18 @@ bool DkBasicLoader::loadPageAt(int pageIdx)
     oldWarningHandler = TIFFSetWarningHandler(NULL);
     oldErrorHandler = TIFFSetErrorHandler(NULL);
 
-    DkTimer dt;
-    TIFF *tiff = TIFFOpen(mFile.toLatin1(), "r");
-
-#if defined(Q_OS_WIN)
-
-    // loading from buffer allows us to load files with non-latin names
-    QSharedPointer<QByteArray> ba;
-    if (!tiff)
-        ba = loadFileToBuffer(mFile);
-
-    std::istringstream is(ba ? ba->toStdString() : "");
-    if (ba)
-        tiff = TIFFStreamOpen("MemTIFF", &is);
-#endif
-
-    if (!tiff)
-        return imgLoaded;
-
-    uint32_t width = 0;
-    uint32_t height = 0;
-
-    // go to current directory
-    for (int idx = 1; idx < pageIdx; idx++) {
-        if (!TIFFReadDirectory(tiff))
-            return false;
-    }
-    TIFFGetField(tiff, TIFFTAG_IMAGEWIDTH, &width);
-    TIFFGetField(tiff, TIFFTAG_IMAGELENGTH, &height);
-
-    // init the qImage
-    QImage img = QImage(width, height, QImage::Format_ARGB32);
-
-    const int stopOnError = 1;
-    imgLoaded = TIFFReadRGBAImageOriented(tiff, width, height, reinterpret_cast<uint32_t *>(img.bits()), ORIENTATION_TOPLEFT, stopOnError) != 0;
-
-    if (imgLoaded) {
-        for (uint32_t y = 0; y < height; ++y)
-            convert32BitOrder(img.scanLine(y), width);
-    }
+    // pages are decoded in parallel, too
+    DkTiffReader reader(mFile);
+    QImage img;
 
-    TIFFClose(tiff);
+    if (reader.setDirectory(pageIdx - 1))
+        imgLoaded = reader.read(img);
 
     TIFFSetWarningHandler(oldWarningHandler);
-    TIFFSetWarningHandler(oldErrorHandler);
+    TIFFSetErrorHandler(oldErrorHandler);
+
+    if (!imgLoaded)
+        return false;
 
     setEditImage(img, tr("Original Image"));
 #else
@@ -1130,22 +1334,6 @@ void DkBasicLoader::resetPageIdx()
     mPageIdx = 1;
 }
 
-void DkBasicLoader::convert32BitOrder(void *buffer, int width) const
-{
-#ifdef WITH_LIBTIFF
-    // code from Qt QTiffHandler
-    uint32_t *target = reinterpret_cast<uint32_t *>(buffer);
-    for (uint32_t x = 0; x < width; ++x) {
-        uint32_t p = target[x];
-        // convert between ARGB and ABGR
-        target[x] = (p & 0xff000000) | ((p & 0x00ff0000) >> 16) | (p & 0x0000ff00) | ((p & 0x000000ff) << 16);
-    }
-#else
-    Q_UNUSED(buffer);
-    Q_UNUSED(width);
-#endif
-}
-
 /**
  * @brief saves the image and its metadata to the specified file.
  *
@@ -1161,8 +1349,19 @@ QString DkBasicLoader::save(const QString &filePath, const QImage &img, int comp
     QSharedPointer<QByteArray> ba;
 
     DkTimer dt;
-    if (saveToBuffer(filePath, img, ba, compression) && ba) {
+    if ((saveLossless(filePath, img, ba) || saveToBuffer(filePath, img, ba, compression)) && ba) {
         if (writeBufferToFile(filePath, ba)) {
+            // the file changed: further lossless edits start from the saved edit
+            if (QFileInfo(filePath).absoluteFilePath() == QFileInfo(mFile).absoluteFilePath()) {
+                for (int idx = 0; idx < mImages.size(); idx++) {
+                    if (idx == mImageIndex)
+                        mImages[idx].setLosslessTransform(DkJpegTransform());
+                    else
+                        mImages[idx] = DkEditImage(mImages[idx].image(), mImages[idx].editName());
+                }
+                mLoadedOrientation = 0;
+            }
+
             qInfo() << "saved to" << filePath << "in" << dt;
             return filePath;
         }
@@ -1171,6 +1370,78 @@ QString DkBasicLoader::save(const QString &filePath, const QImage &img, int comp
     return QString();
 }
 
+/**
+ * @brief saveLossless() rotates/flips the original jpg without re-encoding it.
+ *
+ * This only works if img is the current edit and all edits since loading are
+ * rotations or flips (see setLosslessEdit()).
+ *
+ * @param filePath path to file to which this image will later be written
+ * @param img image to be written (must be the current edit)
+ * @param ba in-memory file buffer containing resulting file
+ * @return bool false if the image needs to be encoded
+ */
+bool DkBasicLoader::saveLossless(const QString &filePath, const QImage &img, QSharedPointer<QByteArray> &ba) const
+{
+    if (mImageIndex < 0 || mImageIndex >= mImages.size())
+        return false;
+
+    const DkEditImage &edit = mImages[mImageIndex];
+    if (!edit.isLossless() || edit.losslessTransform().isIdentity() || edit.image().cacheKey() != img.cacheKey())
+        return false;
+
+    if (!DkJpegTransform::isJpegSuffix(QFileInfo(filePath).suffix()))
+        return false;
+
+    QSharedPointer<QByteArray> src = DkFileReadCache::instance().read(mFile);
+    if (!src || !DkJpegTransform::isJpeg(*src))
+        return false;
+
+    // the exif rotation was applied when loading
+    DkJpegTransform transform;
+    transform.rotate(mLoadedOrientation);
+    transform.append(edit.losslessTransform());
+
+    QString error;
+    QSharedPointer<QByteArray> tba(new QByteArray(transform.apply(*src, &error)));
+
+    if (tba->isEmpty()) {
+        qInfo() << "[Basic Loader] cannot transform losslessly:" << error;
+        return false;
+    }
+
+    QSharedPointer<DkMetaDataT> metaData = mMetaData;
+
+    if (metaData && metaData->isLoaded()) {
+        try {
+            metaData->updateImageMetaData(img, false); // orientation was reset with the first edit
+            if (!metaData->saveMetaData(tba, true))
+                metaData->clearExifState();
+        } catch (...) {
+            metaData->clearExifState();
+        }
+    }
+
+    ba = tba;
+    qInfo() << "[Basic Loader]" << QFileInfo(filePath).fileName() << "transformed losslessly";
+
+    return true;
+}
+
+/**
+ * Sets the encoder preset used by save() and saveToBuffer().
+ * @param preset a DkImageEncoder::Preset
+ **/
+void DkBasicLoader::setSavePreset(int preset)
+{
+    mSavePreset = preset;
+}
+
+int DkBasicLoader::savePreset() const
+{
+    return mSavePreset;
+}
+
 /**
  * @brief saveToBuffer() writes the image matrix img to the file buffer.
  *
@@ -1220,21 +1491,27 @@ bool DkBasicLoader::saveToBuffer(const QString &filePath, const QImage &img, QSh
         QBuffer fileBuffer(ba.data());
         // size_t s = fileBuffer.size();
         fileBuffer.open(QIODevice::WriteOnly);
-        QImageWriter *imgWriter = new QImageWriter(&fileBuffer, fInfo.suffix().toStdString().c_str());
 
-        if (compression >= 0) { // -1 -> use Qt's default
-            imgWriter->setCompression(compression);
-            imgWriter->setQuality(compression);
-        }
-        if (compression == -1 && imgWriter->format() == "jpg") {
-            imgWriter->setQuality(DkSettingsManager::instance().settings().app().defaultJpgQuality);
-        }
+        if (DkImageEncoder::isStripEncoderSupported(fInfo.suffix(), sImg, mSavePreset)) {
+            saved = DkImageEncoder::writeTiff(sImg, &fileBuffer, mSavePreset);
+        } else {
+            QImageWriter *imgWriter = new QImageWriter(&fileBuffer, fInfo.suffix().toStdString().c_str());
+
+            if (compression >= 0) { // -1 -> use Qt's default
+                imgWriter->setCompression(compression);
+                imgWriter->setQuality(compression);
+            }
+            if (compression == -1 && imgWriter->format() == "jpg") {
+                imgWriter->setQuality(DkSettingsManager::instance().settings().app().defaultJpgQuality);
+            }
 
-        imgWriter->setOptimizedWrite(true); // this saves space TODO: user option here?
-        imgWriter->setProgressiveScanWrite(true);
+            imgWriter->setOptimizedWrite(true); // this saves space TODO: user option here?
+            imgWriter->setProgressiveScanWrite(true);
+            DkImageEncoder::applyPreset(*imgWriter, mSavePreset);
 
-        saved = imgWriter->write(sImg); // hint: release() might run now, resetting mMetaData which is used below [2022-08, pse]
-        delete imgWriter;
+            saved = imgWriter->write(sImg); // hint: release() might run now, resetting mMetaData which is used below [2022-08, pse]
+            delete imgWriter;
+        }
     }
 
     if (saved && metaData) {
@@ -1375,6 +1652,7 @@ void DkBasicLoader::release()
     mImages.clear(); // clear history
     mImageIndex = -1;
     mReferenceImageIndex = -1;
+    mLoadedOrientation = 0;
 
     // Unload metadata
     mMetaData = QSharedPointer<DkMetaDataT>(new DkMetaDataT());
@@ -1845,41 +2123,15 @@ QString DkZipContainer::decodeImageFile(const QString &encodedFileInfo)
 
 QSharedPointer<QByteArray> DkZipContainer::extractImage(const QString &zipFile, const QString &imageFile)
 {
-    QuaZip zip(zipFile);
-    if (!zip.open(QuaZip::mdUnzip))
-        return QSharedPointer<QByteArray>(new QByteArray());
-
-    qDebug() << "DkZip::extractImage filePath: " << zipFile;
-    qDebug() << "3.0 image file" << imageFile;
-
-    zip.setCurrentFile(imageFile);
-    QuaZipFile extractedFile(&zip);
-    if (!extractedFile.open(QIODevice::ReadOnly) || extractedFile.getZipError() != UNZ_OK)
-        return QSharedPointer<QByteArray>(new QByteArray());
-
-    QSharedPointer<QByteArray> ba(new QByteArray(extractedFile.readAll()));
-    extractedFile.close();
-
-    zip.close();
-
-    return ba;
+    return QSharedPointer<QByteArray>(new QByteArray(DkZipArchive::archive(zipFile)->extract(imageFile)));
 }
 
 void DkZipContainer::extractImage(const QString &zipFile, const QString &imageFile, QByteArray &ba)
 {
-    QuaZip zip(zipFile);
-    if (!zip.open(QuaZip::mdUnzip))
-        return;
+    QByteArray eba = DkZipArchive::archive(zipFile)->extract(imageFile);
 
-    zip.setCurrentFile(imageFile);
-    QuaZipFile extractedFile(&zip);
-    if (!extractedFile.open(QIODevice::ReadOnly) || extractedFile.getZipError() != UNZ_OK)
-        return;
-
-    ba = QByteArray(extractedFile.readAll());
-    extractedFile.close();
-
-    zip.close();
+    if (!eba.isEmpty())
+        ba = eba;
 }
 
 bool DkZipContainer::isZip() const
@@ -1907,6 +2159,285 @@ QString DkZipContainer::zipMarker()
     return mZipMarker;
 }
 
+// DkZipArchive --------------------------------------------------------------------
+namespace
+{
+QMutex zipArchiveMutex;
+QHash<QString, QSharedPointer<DkZipArchive>> zipArchives;
+QStringList zipArchiveOrder; // least recently used first
+const int maxZipArchives = 4;
+}
+
+DkZipArchive::DkZipArchive(const QString &zipFile)
+    : mFile(zipFile)
+{
+    QFileInfo fi(zipFile);
+    mZipFile = fi.absoluteFilePath();
+    mFileSize = fi.size();
+    mLastModified = fi.lastModified();
+
+    indexCentralDirectory();
+}
+
+DkZipArchive::~DkZipArchive()
+{
+    for (QuaZip *zip : mHandles) {
+        zip->close();
+        delete zip;
+    }
+
+    if (mMap)
+        mFile.unmap(const_cast<uchar *>(mMap));
+    mFile.close();
+}
+
+/**
+ * Returns the shared archive of a zip file.
+ * The last few archives are kept open, so browsing an archive
+ * does not open it for every single image.
+ * @param zipFile the zip file's path
+ * @return QSharedPointer<DkZipArchive> the archive (never null)
+ **/
+QSharedPointer<DkZipArchive> DkZipArchive::archive(const QString &zipFile)
+{
+    QFileInfo fi(zipFile);
+    QString key = fi.absoluteFilePath();
+
+    QMutexLocker lock(&zipArchiveMutex);
+    QSharedPointer<DkZipArchive> za = zipArchives.value(key);
+
+    // the archive was changed on disk
+    if (za && !za->isCurrent(fi))
+        za.clear();
+
+    if (!za) {
+        za = QSharedPointer<DkZipArchive>(new DkZipArchive(key));
+        zipArchives.insert(key, za);
+    }
+
+    zipArchiveOrder.removeAll(key);
+    zipArchiveOrder << key;
+
+    while (zipArchiveOrder.size() > maxZipArchives)
+        zipArchives.remove(zipArchiveOrder.takeFirst());
+
+    return za;
+}
+
+/**
+ * Closes all archives that are not in use.
+ **/
+void DkZipArchive::clear()
+{
+    QMutexLocker lock(&zipArchiveMutex);
+    zipArchives.clear();
+    zipArchiveOrder.clear();
+}
+
+QString DkZipArchive::filePath() const
+{
+    return mZipFile;
+}
+
+QStringList DkZipArchive::fileNames()
+{
+    QuaZip *zip = takeHandle();
+
+    if (!zip)
+        return QStringList();
+
+    QStringList names = zip->getFileNameList();
+    returnHandle(zip);
+
+    return names;
+}
+
+/**
+ * Extracts a file from the archive.
+ * Thread-safe: stored entries are copied from the memory map,
+ * compressed entries are inflated with a pooled QuaZip handle.
+ * @param imageFile the file's name within the archive
+ * @return QByteArray the file's buffer (empty on failure)
+ **/
+QByteArray DkZipArchive::extract(const QString &imageFile)
+{
+    auto e = mIndex.constFind(imageFile);
+
+    // stored & unencrypted: read it straight from the map
+    if (mMap && e != mIndex.constEnd() && e->method == 0 && !(e->flags & 0x1) && e->size < INT_MAX) {
+        const uchar *lh = mMap + e->localHeaderOffset;
+
+        if (e->localHeaderOffset + 30 <= (quint64)mMapSize && qFromLittleEndian<quint32>(lh) == 0x04034b50) {
+            quint64 dataOffset = e->localHeaderOffset + 30 + qFromLittleEndian<quint16>(lh + 26) + qFromLittleEndian<quint16>(lh + 28);
+
+            if (dataOffset + e->size <= (quint64)mMapSize) {
+                DkTracer::instance().addCounter("zip entries mapped");
+                return QByteArray(reinterpret_cast<const char *>(mMap + dataOffset), (int)e->size);
+            }
+        }
+    }
+
+    QuaZip *zip = takeHandle();
+
+    if (!zip)
+        return QByteArray();
+
+    QByteArray ba;
+
+    // QuaZip maps the directory of an open archive - so this lookup is only linear once per handle
+    if (zip->setCurrentFile(imageFile)) {
+        QuaZipFile extractedFile(zip);
+
+        if (extractedFile.open(QIODevice::ReadOnly) && extractedFile.getZipError() == UNZ_OK) {
+            ba = extractedFile.readAll();
+            extractedFile.close();
+        }
+    }
+
+    returnHandle(zip);
+    DkTracer::instance().addCounter("zip entries inflated");
+
+    return ba;
+}
+
+/**
+ * Indexes the central directory of the memory mapped archive.
+ * If the archive cannot be mapped (or parsed), all entries are read with QuaZip.
+ **/
+void DkZipArchive::indexCentralDirectory()
+{
+    DkTraceZone tz("DkZipArchive::indexCentralDirectory");
+
+    if (!mFile.open(QIODevice::ReadOnly))
+        return;
+
+    mMapSize = mFile.size();
+    mMap = mFile.map(0, mMapSize);
+
+    if (!mMap || mMapSize < 22)
+        return;
+
+    // find the end of central directory record (it is followed by a comment of up to 64 KB)
+    qint64 eocd = -1;
+    for (qint64 idx = mMapSize - 22; idx >= qMax(mMapSize - 22 - 0xFFFF, (qint64)0); idx--) {
+        if (qFromLittleEndian<quint32>(mMap + idx) == 0x06054b50) {
+            eocd = idx;
+            break;
+        }
+    }
+
+    if (eocd < 0)
+        return;
+
+    quint64 numEntries = qFromLittleEndian<quint16>(mMap + eocd + 10);
+    quint64 cdOffset = qFromLittleEndian<quint32>(mMap + eocd + 16);
+
+    // zip64: the real values are stored in the zip64 end of central directory record
+    if ((numEntries == 0xFFFF || cdOffset == 0xFFFFFFFF) && eocd >= 20 && qFromLittleEndian<quint32>(mMap + eocd - 20) == 0x07064b50) {
+        quint64 eocd64 = qFromLittleEndian<quint64>(mMap + eocd - 20 + 8);
+
+        if (eocd64 + 56 > (quint64)mMapSize || qFromLittleEndian<quint32>(mMap + eocd64) != 0x06064b50)
+            return;
+
+        numEntries = qFromLittleEndian<quint64>(mMap + eocd64 + 32);
+        cdOffset = qFromLittleEndian<quint64>(mMap + eocd64 + 48);
+    }
+
+    quint64 pos = cdOffset;
+    mIndex.reserve((int)qMin(numEntries, (quint64)INT_MAX));
+
+    for (quint64 idx = 0; idx < numEntries; idx++) {
+        if (pos + 46 > (quint64)mMapSize || qFromLittleEndian<quint32>(mMap + pos) != 0x02014b50)
+            break;
+
+        const uchar *h = mMap + pos;
+        quint16 nameLength = qFromLittleEndian<quint16>(h + 28);
+        quint16 extraLength = qFromLittleEndian<quint16>(h + 30);
+        quint16 commentLength = qFromLittleEndian<quint16>(h + 32);
+
+        if (pos + 46 + nameLength + extraLength > (quint64)mMapSize)
+            break;
+
+        Entry e;
+        e.flags = qFromLittleEndian<quint16>(h + 8);
+        e.method = qFromLittleEndian<quint16>(h + 10);
+        e.compressedSize = qFromLittleEndian<quint32>(h + 20);
+        e.size = qFromLittleEndian<quint32>(h + 24);
+        e.localHeaderOffset = qFromLittleEndian<quint32>(h + 42);
+
+        // zip64 extended information
+        const uchar *extra = h + 46 + nameLength;
+        for (int eIdx = 0; eIdx + 4 <= extraLength;) {
+            quint16 id = qFromLittleEndian<quint16>(extra + eIdx);
+            quint16 length = qFromLittleEndian<quint16>(extra + eIdx + 2);
+
+            if (id == 0x0001) {
+                int fIdx = eIdx + 4;
+                if (e.size == 0xFFFFFFFF && fIdx + 8 <= eIdx + 4 + length) {
+                    e.size = qFromLittleEndian<quint64>(extra + fIdx);
+                    fIdx += 8;
+                }
+                if (e.compressedSize == 0xFFFFFFFF && fIdx + 8 <= eIdx + 4 + length) {
+                    e.compressedSize = qFromLittleEndian<quint64>(extra + fIdx);
+                    fIdx += 8;
+                }
+                if (e.localHeaderOffset == 0xFFFFFFFF && fIdx + 8 <= eIdx + 4 + length)
+                    e.localHeaderOffset = qFromLittleEndian<quint64>(extra + fIdx);
+                break;
+            }
+
+            eIdx += 4 + length;
+        }
+
+        // bit 11: the file name is UTF-8 encoded
+        const char *name = reinterpret_cast<const char *>(h + 46);
+        QString fileName = (e.flags & 0x0800) ? QString::fromUtf8(name, nameLength) : QString::fromLocal8Bit(name, nameLength);
+
+        if (!fileName.endsWith("/"))
+            mIndex.insert(fileName, e);
+
+        pos += 46 + nameLength + extraLength + commentLength;
+    }
+}
+
+bool DkZipArchive::isCurrent(const QFileInfo &fileInfo) const
+{
+    return fileInfo.exists() && fileInfo.size() == mFileSize && fileInfo.lastModified() == mLastModified;
+}
+
+QuaZip *DkZipArchive::takeHandle()
+{
+    {
+        QMutexLocker lock(&mHandleMutex);
+
+        if (!mHandles.isEmpty())
+            return mHandles.takeLast();
+    }
+
+    QuaZip *zip = new QuaZip(mZipFile);
+
+    if (!zip->open(QuaZip::mdUnzip)) {
+        qWarning() << "[DkZipArchive] could not open" << mZipFile;
+        delete zip;
+        return 0;
+    }
+
+    return zip;
+}
+
+void DkZipArchive::returnHandle(QuaZip *zip)
+{
+    QMutexLocker lock(&mHandleMutex);
+
+    // keep one handle per core
+    if (mHandles.size() < QThread::idealThreadCount())
+        mHandles << zip;
+    else {
+        zip->close();
+        delete zip;
+    }
+}
+
 #endif
 
 // DkRawLoader --------------------------------------------------------------------
@@ -28,15 +28,23 @@
 #pragma once
 
 #pragma warning(push, 0)
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
 #include <QFutureWatcher>
+#include <QHash>
 #include <QImage>
+#include <QMutex>
 #include <QNetworkAccessManager>
 #include <QSharedPointer>
 #include <QUrl>
+#include <QVector>
 #pragma warning(pop)
 
 #pragma warning(disable : 4251) // TODO: remove
 // #include "DkImageStorage.h"
+#include "DkImageEncoder.h"
+#include "DkJpegTransform.h"
 
 #ifndef Q_OS_WIN
 #include "qpsdhandler.h"
@@ -65,6 +73,7 @@
 // Qt defines
 class QNetworkReply;
 class LibRaw;
+class QuaZip;
 
 namespace nmc
 {
@@ -94,6 +103,55 @@ protected:
     bool mImageInZip;
     static QString mZipMarker;
 };
+
+/**
+ * Shared, thread-safe access to a zip archive.
+ * An archive is opened once: its central directory is indexed by file name
+ * and stored (uncompressed) entries are copied straight from a memory map.
+ * Compressed entries are inflated by QuaZip - every reader gets its own
+ * pooled handle, so concurrent threads never share a cursor.
+ **/
+class DllCoreExport DkZipArchive
+{
+public:
+    ~DkZipArchive();
+
+    static QSharedPointer<DkZipArchive> archive(const QString &zipFile);
+    static void clear();
+
+    QString filePath() const;
+    QStringList fileNames();
+    QByteArray extract(const QString &imageFile);
+
+private:
+    DkZipArchive(const QString &zipFile);
+    DkZipArchive(const DkZipArchive &);
+
+    struct Entry {
+        quint64 localHeaderOffset = 0;
+        quint64 compressedSize = 0;
+        quint64 size = 0;
+        quint16 method = 0;
+        quint16 flags = 0;
+    };
+
+    void indexCentralDirectory();
+    bool isCurrent(const QFileInfo &fileInfo) const;
+    QuaZip *takeHandle();
+    void returnHandle(QuaZip *zip);
+
+    QString mZipFile;
+    qint64 mFileSize = 0;
+    QDateTime mLastModified;
+
+    QFile mFile;
+    const uchar *mMap = 0;
+    qint64 mMapSize = 0;
+    QHash<QString, Entry> mIndex;
+
+    QMutex mHandleMutex;
+    QVector<QuaZip *> mHandles; // idle handles
+};
 #endif
 
 class DllCoreExport DkEditImage
@@ -107,9 +165,17 @@ public:
     QImage image() const;
     int size() const;
 
+    void setLosslessTransform(const DkJpegTransform &transform);
+    bool isLossless() const;
+    DkJpegTransform losslessTransform() const;
+
 protected:
     QString mEditName;
     QImage mImg;
+
+    // the transform from the original file to this edit if it can be saved losslessly
+    DkJpegTransform mTransform;
+    bool mLossless = false;
 };
 
 class DllCoreExport DkRawLoader
@@ -249,12 +315,17 @@ public:
 
     QString save(const QString &filePath, const QImage &img, int compression = -1);
     bool saveToBuffer(const QString &filePath, const QImage &img, QSharedPointer<QByteArray> &ba, int compression = -1) const;
+    bool saveLossless(const QString &filePath, const QImage &img, QSharedPointer<QByteArray> &ba) const;
+    void setSavePreset(int preset);
+    int savePreset() const;
     void saveThumbToMetaData(const QString &filePath, QSharedPointer<QByteArray> &ba);
     void saveMetaData(const QString &filePath, QSharedPointer<QByteArray> &ba);
     void saveThumbToMetaData(const QString &filePath);
     void saveMetaData(const QString &filePath);
 
     static bool isContainer(const QString &filePath);
+    static bool loadPreview(const QString &filePath, QSharedPointer<QByteArray> ba, const QSize &maxSize, QImage &img, QSize &fullSize);
+    static QSize imageSize(const QString &filePath, QSharedPointer<QByteArray> ba);
 
     /**
      * Sets a new image (if edited outside the basicLoader class)
@@ -262,6 +333,8 @@ public:
      * @param file assigns the current file name
      **/
     void setImage(const QImage &img, const QString &editName, const QString &file);
+    void setSharedImage(const QImage &img);
+    bool loadShared(const QString &filePath, const QImage &img, const QSharedPointer<QByteArray> ba = QSharedPointer<QByteArray>());
     void pruneEditHistory();
     void setEditImage(const QImage &img, const QString &editName = "");
 
@@ -281,6 +354,7 @@ public:
     };
 
     QSharedPointer<DkMetaDataT> getMetaData() const;
+    void setMetaData(QSharedPointer<DkMetaDataT> metaData);
 
     /**
      * Returns the 8-bit image, which is rendered.
@@ -326,10 +400,12 @@ public:
     void redo();
     QVector<DkEditImage> *history();
     DkEditImage lastEdit() const;
+    void setLosslessEdit(const QImage &img, const DkJpegTransform &transform);
 
     void setMinHistorySize(int size);
     void setHistoryIndex(int idx);
     int historyIndex() const;
+    float historyMemoryUsage() const;
 
     bool isReferenceImageValid() const;
     void invalidateReferenceImage();
@@ -365,7 +441,7 @@ public:
 #endif
 
     bool loadPSDFile(const QString &filePath, QImage &img, QSharedPointer<QByteArray> ba = QSharedPointer<QByteArray>()) const;
-    bool loadTIFFile(const QString &filePath, QImage &img, QSharedPointer<QByteArray> ba = QSharedPointer<QByteArray>()) const;
+    bool loadTIFFile(const QString &filePath, QImage &img, QSharedPointer<QByteArray> ba = QSharedPointer<QByteArray>(), bool fast = false) const;
     bool loadDrifFile(const QString &filePath, QImage &img, QSharedPointer<QByteArray> ba = QSharedPointer<QByteArray>()) const;
 
 #ifdef Q_OS_WIN
@@ -384,6 +460,7 @@ public:
 
 signals:
     void errorDialogSignal(const QString &msg) const;
+    void previewSignal(const QImage &img, const QSize &fullSize) const;
 
     void undoSignal();
     void redoSignal();
@@ -393,7 +470,7 @@ protected:
     bool loadTgaFile(const QString &filePath, QImage &img, QSharedPointer<QByteArray> ba = QSharedPointer<QByteArray>()) const;
     bool loadRawFile(const QString &filePath, QImage &img, QSharedPointer<QByteArray> ba = QSharedPointer<QByteArray>(), bool fast = false) const;
     void indexPages(const QString &filePath, const QSharedPointer<QByteArray> ba = QSharedPointer<QByteArray>());
-    void convert32BitOrder(void *buffer, int width) const;
+    int loadOrientation() const;
 
     int mLoader;
     bool mTraining;
@@ -408,6 +485,8 @@ protected:
     int mMinHistorySize = 2;
     int mImageIndex = 0;
     int mReferenceImageIndex = 0;
+    int mLoadedOrientation = 0; // exif rotation applied when loading
+    int mSavePreset = DkImageEncoder::preset_default;
 };
 
 namespace tga
@@ -178,6 +178,8 @@ void DkSaveInfo::loadSettings(QSettings &settings)
     mMode = (DkSaveInfo::OverwriteMode)settings.value("Mode", mMode).toInt();
     mDeleteOriginal = settings.value("DeleteOriginal", mDeleteOriginal).toBool();
     mInputDirIsOutputDir = settings.value("InputDirIsOutputDir", mInputDirIsOutputDir).toBool();
+    mIncremental = settings.value("Incremental", mIncremental).toBool();
+    mSavePreset = settings.value("SavePreset", mSavePreset).toInt();
 
     settings.endGroup();
 }
@@ -190,6 +192,8 @@ void DkSaveInfo::saveSettings(QSettings &settings) const
     settings.setValue("Mode", mMode);
     settings.setValue("DeleteOriginal", mDeleteOriginal);
     settings.setValue("InputDirIsOutputDir", mInputDirIsOutputDir);
+    settings.setValue("Incremental", mIncremental);
+    settings.setValue("SavePreset", mSavePreset);
 
     settings.endGroup();
 }
@@ -225,6 +229,16 @@ void DkSaveInfo::setInputDirIsOutputDir(bool isOutputDir)
     mInputDirIsOutputDir = isOutputDir;
 }
 
+void DkSaveInfo::setIncremental(bool incremental)
+{
+    mIncremental = incremental;
+}
+
+void DkSaveInfo::setSavePreset(int preset)
+{
+    mSavePreset = preset;
+}
+
 QString DkSaveInfo::inputFilePath() const
 {
     return mFilePathIn;
@@ -270,9 +284,19 @@ bool DkSaveInfo::isInputDirOutputDir() const
     return mInputDirIsOutputDir;
 }
 
+bool DkSaveInfo::isIncremental() const
+{
+    return mIncremental;
+}
+
 int DkSaveInfo::compression() const
 {
     return mCompression;
 }
 
+int DkSaveInfo::savePreset() const
+{
+    return mSavePreset;
+}
+
 }
\ No newline at end of file
@@ -99,6 +99,8 @@ public:
     void setDeleteOriginal(bool deleteOriginal);
     void setCompression(int compression);
     void setInputDirIsOutputDir(bool isOutputDir);
+    void setIncremental(bool incremental);
+    void setSavePreset(int preset);
 
     QString inputFilePath() const;
     QString outputFilePath() const;
@@ -111,7 +113,9 @@ public:
     OverwriteMode mode() const;
     bool isDeleteOriginal() const;
     bool isInputDirOutputDir() const;
+    bool isIncremental() const;
     int compression() const;
+    int savePreset() const;
 
     void createBackupFilePath();
     void clearBackupFilePath();
@@ -125,6 +129,8 @@ private:
     int mCompression = -1;
     bool mDeleteOriginal = false;
     bool mInputDirIsOutputDir = false;
+    bool mIncremental = false;
+    int mSavePreset = 0; // DkImageEncoder::preset_default
 };
 
 }
@@ -0,0 +1,389 @@
+/*******************************************************************************************************
+ DkCacheManager.cpp
+ Created on:	19.10.2026
+
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+
+ Copyright (C) 2011-2016 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2016 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2016 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ *******************************************************************************************************/
+
+#include "DkCacheManager.h"
+#include "DkFileReadCache.h"
+#include "DkImageContainer.h"
+#include "DkImageLoader.h"
+#include "DkSettings.h"
+#include "DkTimer.h"
+#include "DkUtils.h"
+
+#pragma warning(push, 0) // no warnings from includes - begin
+#include <QAtomicInt>
+#include <QDebug>
+#include <QFile>
+#include <QSet>
+#pragma warning(pop) // no warnings from includes - end
+
+#include <algorithm>
+
+namespace nmc
+{
+
+// read by worker threads (see historyBudget)
+static QAtomicInt memoryPressure(0);
+
+// DkCacheManager::Stats --------------------------------------------------------------------
+double DkCacheManager::Stats::total() const
+{
+    return images + buffers + thumbs + histories + readCache;
+}
+
+double DkCacheManager::Stats::cached() const
+{
+    return images + buffers + histories;
+}
+
+QString DkCacheManager::Stats::toString() const
+{
+    QString str = QString("%1 images in %2 tabs: %3 MB decoded, %4 MB buffers, %5 MB thumbnails, %6 MB history, %7 MB read cache | %8 / %9 MB")
+                      .arg(numImages)
+                      .arg(numLoaders)
+                      .arg(images, 0, 'f', 0)
+                      .arg(buffers, 0, 'f', 0)
+                      .arg(thumbs, 0, 'f', 0)
+                      .arg(histories, 0, 'f', 0)
+                      .arg(readCache, 0, 'f', 0)
+                      .arg(cached(), 0, 'f', 0)
+                      .arg(budget, 0, 'f', 0);
+
+    if (available >= 0)
+        str += QString(" | %1 MB available").arg(available, 0, 'f', 0);
+    if (numEvicted > 0)
+        str += QString(" | %1 evicted").arg(numEvicted);
+    if (pressure)
+        str += " | memory pressure";
+
+    return str;
+}
+
+// DkCacheManager --------------------------------------------------------------------
+DkCacheManager::DkCacheManager()
+{
+    mStats.budget = DkSettingsManager::param().resources().cacheMemory;
+
+    mTimer.setInterval(mCheckInterval);
+    connect(&mTimer, SIGNAL(timeout()), this, SLOT(enforce()));
+}
+
+DkCacheManager &DkCacheManager::instance()
+{
+    static DkCacheManager inst;
+    return inst;
+}
+
+void DkCacheManager::addLoader(DkImageLoader *loader)
+{
+    if (!loader || mLoaders.contains(loader))
+        return;
+
+    mLoaders << loader;
+
+    if (!mTimer.isActive())
+        mTimer.start();
+}
+
+void DkCacheManager::removeLoader(DkImageLoader *loader)
+{
+    for (int idx = mLoaders.size() - 1; idx >= 0; idx--) {
+        if (!mLoaders[idx] || mLoaders[idx] == loader)
+            mLoaders.remove(idx);
+    }
+
+    // stop polling once the last tab is gone (e.g. on exit)
+    if (mLoaders.isEmpty())
+        mTimer.stop();
+}
+
+/**
+ * Marks an image as used.
+ * Images that were not used for the longest time are evicted first.
+ * @param imgC the image that is shown (or about to be shown)
+ **/
+void DkCacheManager::touch(QSharedPointer<DkImageContainerT> imgC)
+{
+    if (imgC)
+        mLastUsed.insert(imgC.data(), ++mClock);
+}
+
+/**
+ * Returns the global budget in MB.
+ * This is Resources::cacheMemory unless the system is low on memory.
+ **/
+double DkCacheManager::budget() const
+{
+    return mStats.budget;
+}
+
+/**
+ * Returns the memory (in MB) of all tabs that counts toward the budget (see Stats::cached)
+ * when enforce() was called last.
+ **/
+double DkCacheManager::usage() const
+{
+    return mStats.cached();
+}
+
+DkCacheManager::Stats DkCacheManager::stats() const
+{
+    return mStats;
+}
+
+/**
+ * Returns the memory (in MB) a single edit history may use.
+ * This function is thread-safe.
+ **/
+double DkCacheManager::historyBudget()
+{
+    double hm = DkSettingsManager::param().resources().historyMemory;
+
+    // keep the history short while the system is swapping
+    return memoryPressure.loadAcquire() ? hm * 0.25 : hm;
+}
+
+/**
+ * Returns the memory (in MB) that is available to nomacs or -1 if it is unknown.
+ * On linux, this is MemAvailable of /proc/meminfo (it includes reclaimable
+ * caches other than MemFree) or the headroom of the cgroup's memory limit if it is lower.
+ **/
+double DkCacheManager::availableMemory()
+{
+    double mem = -1;
+
+#if defined Q_OS_LINUX and not defined(Q_OS_OPENBSD)
+
+    QFile meminfo("/proc/meminfo");
+
+    if (meminfo.open(QIODevice::ReadOnly)) {
+        const QList<QByteArray> lines = meminfo.readAll().split('\n');
+
+        for (const QByteArray &l : lines) {
+            // MemAvailable:   12345678 kB
+            if (l.startsWith("MemAvailable:")) {
+                mem = l.mid(13).simplified().split(' ').first().toDouble() / 1024.0;
+                break;
+            }
+        }
+    }
+
+    double cgMem = cgroupAvailableMemory();
+
+    if (cgMem >= 0 && (mem < 0 || cgMem < mem))
+        mem = cgMem;
+#endif
+
+    if (mem < 0)
+        mem = DkMemory::getFreeMemory();
+
+    return mem;
+}
+
+double DkCacheManager::cgroupAvailableMemory()
+{
+    auto readMB = [](const QString &filePath) -> double {
+        QFile file(filePath);
+
+        if (!file.open(QIODevice::ReadOnly))
+            return -1;
+
+        bool ok = false;
+        double val = file.readAll().trimmed().toDouble(&ok); // "max" if there is no limit
+
+        // cgroup v1 reports a huge number if there is no limit
+        if (!ok || val >= double(1ll << 50))
+            return -1;
+
+        return val / (1024.0 * 1024.0);
+    };
+
+    // cgroup v2: 0::/path/of/our/group
+    QString group;
+    QFile cgroup("/proc/self/cgroup");
+
+    if (cgroup.open(QIODevice::ReadOnly)) {
+        const QList<QByteArray> lines = cgroup.readAll().split('\n');
+
+        for (const QByteArray &l : lines) {
+            if (l.startsWith("0::")) {
+                group = QString::fromUtf8(l.mid(3)).trimmed();
+                break;
+            }
+        }
+    }
+
+    QStringList dirs;
+    if (!group.isEmpty() && group != "/")
+        dirs << "/sys/fs/cgroup" + group;
+    dirs << "/sys/fs/cgroup";
+
+    for (const QString &d : dirs) {
+        double limit = readMB(d + "/memory.max");
+        double current = readMB(d + "/memory.current");
+
+        if (limit >= 0 && current >= 0)
+            return qMax(limit - current, 0.0);
+    }
+
+    // cgroup v1
+    double limit = readMB("/sys/fs/cgroup/memory/memory.limit_in_bytes");
+    double current = readMB("/sys/fs/cgroup/memory/memory.usage_in_bytes");
+
+    if (limit >= 0 && current >= 0)
+        return qMax(limit - current, 0.0);
+
+    return -1;
+}
+
+/**
+ * Updates the statistics and evicts images until all tabs fit into the budget.
+ * This is called periodically and whenever a tab changes its image.
+ **/
+void DkCacheManager::enforce()
+{
+    DkTimer dt;
+
+    struct Candidate {
+        QSharedPointer<DkImageContainerT> img;
+        quint64 lastUsed;
+    };
+
+    Stats s;
+    s.numEvicted = mStats.numEvicted;
+    s.available = availableMemory();
+
+    QSet<const DkImageContainerT *> pinned;
+    for (const QPointer<DkImageLoader> &l : mLoaders) {
+        if (l && l->getCurrentImage())
+            pinned.insert(l->getCurrentImage().data());
+    }
+
+    QVector<Candidate> candidates;
+    QHash<const DkImageContainerT *, quint64> lastUsed;
+
+    for (const QPointer<DkImageLoader> &l : mLoaders) {
+        if (!l)
+            continue;
+
+        s.numLoaders++;
+
+        for (const QSharedPointer<DkImageContainerT> &imgC : l->images()) {
+            // tabs of the same folder might share images
+            if (!imgC || lastUsed.contains(imgC.data()))
+                continue;
+
+            quint64 used = mLastUsed.value(imgC.data(), 0);
+            lastUsed.insert(imgC.data(), used);
+
+            double buffer = imgC->getBufferMemoryUsage();
+            double mem = imgC->getMemoryUsage();
+
+            s.buffers += buffer;
+            s.images += mem - buffer;
+            s.thumbs += imgC->getThumbMemoryUsage();
+            s.histories += imgC->getHistoryMemoryUsage();
+
+            if (mem <= 0)
+                continue;
+
+            s.numImages++;
+
+            if (!pinned.contains(imgC.data()) && !imgC->isEdited() && imgC->getLoadState() != DkImageContainer::loading)
+                candidates << Candidate{imgC, used};
+        }
+    }
+
+    // forget images that were deleted
+    mLastUsed = lastUsed;
+
+    // shrink the budget if the system runs out of memory
+    double base = DkSettingsManager::param().resources().cacheMemory;
+    s.budget = base;
+
+    if (s.available >= 0) {
+        double headroom = s.available - mMinFreeMemory;
+        s.pressure = headroom < 0;
+        s.budget = qMin(base, qMax(s.cached() + headroom, 0.0));
+    }
+
+    if (s.pressure != mStats.pressure) {
+        memoryPressure.storeRelease(s.pressure ? 1 : 0);
+        DkFileReadCache::instance().setLowMemory(s.pressure);
+
+        if (s.pressure)
+            qWarning() << "[CacheManager] memory pressure:" << s.available << "MB available - reducing budget to" << s.budget << "MB";
+        else
+            qInfo() << "[CacheManager] memory pressure relieved";
+    }
+
+    s.readCache = DkFileReadCache::instance().memoryUsage();
+
+    if (s.cached() > s.budget && !candidates.isEmpty()) {
+        std::sort(candidates.begin(), candidates.end(), [](const Candidate &lhs, const Candidate &rhs) {
+            return lhs.lastUsed < rhs.lastUsed;
+        });
+
+        int numEvicted = 0;
+        double freed = 0;
+
+        for (const Candidate &c : candidates) {
+            if (s.cached() <= s.budget)
+                break;
+
+            double buffer = c.img->getBufferMemoryUsage();
+            double mem = c.img->getMemoryUsage();
+            double history = c.img->getHistoryMemoryUsage();
+
+            c.img->clear();
+
+            // clear() is ignored while the image is fetched
+            if (c.img->getMemoryUsage() > 0)
+                continue;
+
+            s.buffers -= buffer;
+            s.images -= mem - buffer;
+            s.histories -= history;
+            s.numImages--;
+
+            freed += mem + history;
+            numEvicted++;
+        }
+
+        s.numEvicted += numEvicted;
+
+        if (numEvicted > 0)
+            qInfo() << "[CacheManager]" << numEvicted << "images evicted (" << qRound(freed) << "MB freed) in" << dt;
+    }
+
+    QString oldStats = mStats.toString();
+    mStats = s;
+
+    if (mStats.toString() != oldStats)
+        emit statsChanged(mStats.toString());
+}
+
+}
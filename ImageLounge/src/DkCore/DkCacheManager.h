@@ -0,0 +1,132 @@
+/*******************************************************************************************************
+ DkCacheManager.h
+ Created on:	19.10.2026
+
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+
+ Copyright (C) 2011-2016 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2016 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2016 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ *******************************************************************************************************/
+
+#pragma once
+
+#pragma warning(push, 0) // no warnings from includes - begin
+#include <QHash>
+#include <QObject>
+#include <QPointer>
+#include <QSharedPointer>
+#include <QString>
+#include <QTimer>
+#include <QVector>
+#pragma warning(pop) // no warnings from includes - end
+
+#pragma warning(disable : 4251) // TODO: remove
+
+#ifndef DllCoreExport
+#ifdef DK_CORE_DLL_EXPORT
+#define DllCoreExport Q_DECL_EXPORT
+#elif DK_DLL_IMPORT
+#define DllCoreExport Q_DECL_IMPORT
+#else
+#define DllCoreExport Q_DECL_IMPORT
+#endif
+#endif
+
+namespace nmc
+{
+
+class DkImageContainerT;
+class DkImageLoader;
+
+/**
+ * Accounts for everything nomacs keeps in memory: decoded images, file buffers,
+ * thumbnails and edit histories of all tabs as well as the file read cache.
+ * Every DkImageLoader registers here and all of them share one budget
+ * (Resources::cacheMemory). If it is exceeded, images are evicted in least
+ * recently used order - no matter which tab they belong to. The current image
+ * of each tab and edited images are never evicted.
+ * Thumbnails and the file read cache are reported, but they do not count
+ * toward the budget since evicting images cannot free them.
+ * The budget shrinks if the system (or the cgroup nomacs runs in) is low on memory.
+ * NOTE: all functions but historyBudget() must be called from the gui thread.
+ **/
+class DllCoreExport DkCacheManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    static DkCacheManager &instance();
+
+    // singleton
+    DkCacheManager(DkCacheManager const &) = delete;
+    void operator=(DkCacheManager const &) = delete;
+
+    struct Stats {
+        double images = 0; // decoded images (MB)
+        double buffers = 0; // file buffers (MB)
+        double thumbs = 0; // thumbnails (MB)
+        double histories = 0; // edit histories (MB)
+        double readCache = 0; // DkFileReadCache (MB)
+        double budget = 0; // global budget (MB)
+        double available = -1; // memory available to nomacs (MB) or -1 if unknown
+        int numImages = 0; // images held in memory
+        int numLoaders = 0;
+        int numEvicted = 0; // images evicted since nomacs started
+        bool pressure = false;
+
+        double total() const;
+        double cached() const; // memory that counts toward the budget
+        QString toString() const;
+    };
+
+    void addLoader(DkImageLoader *loader);
+    void removeLoader(DkImageLoader *loader);
+    void touch(QSharedPointer<DkImageContainerT> imgC);
+
+    double budget() const;
+    double usage() const;
+    Stats stats() const;
+
+    static double historyBudget();
+    static double availableMemory();
+
+public slots:
+    void enforce();
+
+signals:
+    void statsChanged(const QString &stats) const;
+
+private:
+    DkCacheManager();
+
+    static double cgroupAvailableMemory();
+
+    QVector<QPointer<DkImageLoader>> mLoaders;
+    QHash<const DkImageContainerT *, quint64> mLastUsed;
+    quint64 mClock = 0;
+
+    QTimer mTimer;
+    Stats mStats;
+
+    static const int mMinFreeMemory = 256; // MB we leave for the system
+    static const int mCheckInterval = 2000; // ms
+};
+
+}
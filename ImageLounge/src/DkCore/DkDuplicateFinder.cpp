@@ -0,0 +1,456 @@
+/*******************************************************************************************************
+ DkDuplicateFinder.cpp
+ Created on:	19.10.2026
+
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+
+ Copyright (C) 2011-2016 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2016 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2016 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ *******************************************************************************************************/
+
+#include "DkDuplicateFinder.h"
+#include "DkThumbs.h"
+#include "DkTimer.h"
+#include "DkUtils.h"
+
+#pragma warning(push, 0) // no warnings from includes - begin
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QSaveFile>
+#include <QtAlgorithms>
+#include <QtConcurrentMap>
+#include <QtConcurrentRun>
+#pragma warning(pop) // no warnings from includes - end
+
+#include <algorithm>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+namespace nmc
+{
+
+namespace
+{
+const QString hashesMagic = "nomacs-dhash";
+const int hashesVersion = 1;
+
+/**
+ * A BK-tree indexes hashes by their hamming distance.
+ * Range queries use the triangle inequality to skip
+ * most of the tree.
+ **/
+class DkBKTree
+{
+public:
+    void insert(quint64 hash, int id)
+    {
+        if (mNodes.empty()) {
+            mNodes.push_back({hash, id, {}});
+            return;
+        }
+
+        size_t cIdx = 0;
+
+        while (true) {
+            int d = DkDuplicateFinder::distance(hash, mNodes[cIdx].hash);
+            bool found = false;
+
+            for (const auto &c : mNodes[cIdx].children) {
+                if (c.first == d) {
+                    cIdx = c.second;
+                    found = true;
+                    break;
+                }
+            }
+
+            if (!found) {
+                mNodes[cIdx].children.push_back(std::make_pair(d, mNodes.size()));
+                mNodes.push_back({hash, id, {}});
+                return;
+            }
+        }
+    }
+
+    void find(quint64 hash, int maxDistance, QVector<int> &ids) const
+    {
+        if (mNodes.empty())
+            return;
+
+        std::vector<size_t> stack = {0};
+
+        while (!stack.empty()) {
+            const Node &n = mNodes[stack.back()];
+            stack.pop_back();
+
+            int d = DkDuplicateFinder::distance(hash, n.hash);
+
+            if (d <= maxDistance)
+                ids << n.id;
+
+            for (const auto &c : n.children) {
+                if (c.first >= d - maxDistance && c.first <= d + maxDistance)
+                    stack.push_back(c.second);
+            }
+        }
+    }
+
+private:
+    struct Node {
+        quint64 hash;
+        int id;
+        std::vector<std::pair<int, size_t>> children; // distance -> node
+    };
+
+    std::vector<Node> mNodes;
+};
+}
+
+// DkDuplicateFinder --------------------------------------------------------------------
+DkDuplicateFinder::DkDuplicateFinder(QObject *parent)
+    : QObject(parent)
+{
+    connect(&mWatcher, SIGNAL(finished()), this, SLOT(onFinished()));
+}
+
+DkDuplicateFinder::~DkDuplicateFinder()
+{
+    cancel();
+    mWatcher.waitForFinished();
+}
+
+/**
+ * Starts finding duplicates in the background.
+ * finishedSignal is emitted with all clusters of (near) duplicates.
+ * @param files the images to be compared
+ * @param maxDistance the maximal number of bits in which the hashes of near-duplicates differ
+ **/
+void DkDuplicateFinder::find(const QFileInfoList &files, int maxDistance)
+{
+    if (isRunning())
+        return;
+
+    mCancel = 0;
+    mWatcher.setFuture(QtConcurrent::run([this, files, maxDistance]() {
+        return findIntern(files, maxDistance);
+    }));
+}
+
+bool DkDuplicateFinder::isRunning() const
+{
+    return mWatcher.isRunning();
+}
+
+void DkDuplicateFinder::cancel()
+{
+    mCancel = 1;
+}
+
+void DkDuplicateFinder::onFinished()
+{
+    if (mCancel.loadAcquire())
+        return;
+
+    emit finishedSignal(mWatcher.result());
+}
+
+/**
+ * Computes the difference hash of an image.
+ * The image is reduced to 9x8 gray values and each bit
+ * encodes whether the brightness increases from left to right.
+ * @param img the image (typically its thumbnail)
+ * @return quint64 the 64 bit hash
+ **/
+quint64 DkDuplicateFinder::dHash(const QImage &img)
+{
+    QImage s = img.scaled(9, 8, Qt::IgnoreAspectRatio, Qt::SmoothTransformation).convertToFormat(QImage::Format_RGB32);
+    quint64 hash = 0;
+
+    for (int y = 0; y < 8; y++) {
+        const QRgb *line = reinterpret_cast<const QRgb *>(s.constScanLine(y));
+
+        for (int x = 0; x < 8; x++) {
+            hash <<= 1;
+            if (qGray(line[x]) < qGray(line[x + 1]))
+                hash |= 1;
+        }
+    }
+
+    return hash;
+}
+
+int DkDuplicateFinder::distance(quint64 h1, quint64 h2)
+{
+    return (int)qPopulationCount(h1 ^ h2);
+}
+
+/**
+ * Clusters images whose hashes differ in at most maxDistance bits.
+ * Identical hashes are grouped directly, all others are found by
+ * range queries in a BK-tree.
+ * @param hashes the file paths and their hashes
+ * @param maxDistance the maximal hamming distance of near-duplicates
+ * @return QVector<QStringList> the clusters (largest first) - single images are omitted
+ **/
+QVector<QStringList> DkDuplicateFinder::cluster(const QVector<QPair<QString, quint64>> &hashes, int maxDistance)
+{
+    QHash<quint64, int> hashIds;
+    QVector<quint64> uniqueHashes;
+    QVector<QStringList> files;
+
+    for (const auto &h : hashes) {
+        auto it = hashIds.constFind(h.second);
+
+        if (it == hashIds.constEnd()) {
+            hashIds.insert(h.second, uniqueHashes.size());
+            uniqueHashes << h.second;
+            files << QStringList(h.first);
+        } else
+            files[it.value()] << h.first;
+    }
+
+    // union-find over the unique hashes
+    QVector<int> parents(uniqueHashes.size());
+    std::iota(parents.begin(), parents.end(), 0);
+
+    auto root = [&parents](int idx) {
+        while (parents[idx] != idx) {
+            parents[idx] = parents[parents[idx]];
+            idx = parents[idx];
+        }
+        return idx;
+    };
+
+    if (maxDistance > 0) {
+        DkBKTree tree;
+        QVector<int> matches;
+
+        // query before inserting -> each pair is found exactly once
+        for (int idx = 0; idx < uniqueHashes.size(); idx++) {
+            matches.clear();
+            tree.find(uniqueHashes[idx], maxDistance, matches);
+
+            for (int m : matches) {
+                int r1 = root(idx);
+                int r2 = root(m);
+
+                if (r1 != r2)
+                    parents[r1] = r2;
+            }
+
+            tree.insert(uniqueHashes[idx], idx);
+        }
+    }
+
+    QHash<int, QStringList> groups;
+    for (int idx = 0; idx < uniqueHashes.size(); idx++)
+        groups[root(idx)] << files[idx];
+
+    QVector<QStringList> clusters;
+    for (auto it = groups.begin(); it != groups.end(); it++) {
+        if (it.value().size() > 1) {
+            it.value().sort();
+            clusters << it.value();
+        }
+    }
+
+    std::sort(clusters.begin(), clusters.end(), [](const QStringList &l, const QStringList &r) {
+        if (l.size() != r.size())
+            return l.size() > r.size();
+        return l.first() < r.first();
+    });
+
+    return clusters;
+}
+
+QVector<QStringList> DkDuplicateFinder::findIntern(const QFileInfoList &files, int maxDistance)
+{
+    DkTimer dt;
+
+    QHash<QString, QFileInfoList> folders;
+    for (const QFileInfo &f : files)
+        folders[QDir::cleanPath(f.absolutePath())] << f;
+
+    QVector<QPair<QString, quint64>> hashes;
+    int numHashed = 0;
+
+    for (auto it = folders.constBegin(); it != folders.constEnd(); it++) {
+        QHash<QString, HashEntry> folderHashes = hashFolder(it.key(), it.value(), numHashed, (int)files.size());
+
+        if (mCancel.loadAcquire())
+            return QVector<QStringList>();
+
+        for (const QFileInfo &f : it.value()) {
+            auto hIt = folderHashes.constFind(f.fileName());
+
+            if (hIt != folderHashes.constEnd() && hIt->valid)
+                hashes << qMakePair(f.absoluteFilePath(), hIt->hash);
+        }
+    }
+
+    QVector<QStringList> clusters = cluster(hashes, maxDistance);
+
+    qInfo() << "[Duplicates]" << clusters.size() << "clusters found in" << files.size() << "images in" << dt;
+
+    return clusters;
+}
+
+/**
+ * Returns the hashes of all files in a folder.
+ * Stored hashes are reused if the file did not change,
+ * all others are computed from the thumbnails in parallel.
+ **/
+QHash<QString, DkDuplicateFinder::HashEntry> DkDuplicateFinder::hashFolder(const QString &dirPath, const QFileInfoList &files, int &numHashed, int numFiles)
+{
+    QHash<QString, HashEntry> stored = loadHashes(dirPath);
+    QHash<QString, HashEntry> hashes;
+    QFileInfoList stale;
+
+    for (const QFileInfo &f : files) {
+        auto it = stored.constFind(f.fileName());
+
+        if (it != stored.constEnd() && it->fileSize == f.size() && it->modified == f.lastModified().toMSecsSinceEpoch())
+            hashes.insert(f.fileName(), it.value());
+        else
+            stale << f;
+    }
+
+    numHashed += hashes.size();
+    emit progressSignal(numHashed, numFiles);
+
+    if (stale.empty())
+        return hashes;
+
+    QVector<HashEntry> computed(stale.size());
+    HashEntry *pc = computed.data();
+    QVector<int> indexes(stale.size());
+    std::iota(indexes.begin(), indexes.end(), 0);
+
+    QAtomicInt numComputed(0);
+    int numHashedBefore = numHashed;
+
+    QtConcurrent::blockingMap(indexes, [&](int &idx) {
+        if (mCancel.loadAcquire())
+            return;
+
+        pc[idx] = hashFile(stale.at(idx));
+
+        int n = numComputed.fetchAndAddOrdered(1) + 1;
+        if (n % 16 == 0 || n == stale.size())
+            emit progressSignal(numHashedBefore + n, numFiles);
+    });
+
+    numHashed += numComputed.loadAcquire();
+
+    // keep what was computed - even if we were cancelled
+    for (int idx = 0; idx < stale.size(); idx++) {
+        if (computed[idx].modified != 0)
+            hashes.insert(stale.at(idx).fileName(), computed[idx]);
+    }
+
+    QHash<QString, HashEntry> all = stored;
+    for (auto it = hashes.constBegin(); it != hashes.constEnd(); it++)
+        all.insert(it.key(), it.value());
+
+    saveHashes(dirPath, all);
+
+    return hashes;
+}
+
+DkDuplicateFinder::HashEntry DkDuplicateFinder::hashFile(const QFileInfo &file)
+{
+    HashEntry e;
+    e.fileSize = file.size();
+    e.modified = file.lastModified().toMSecsSinceEpoch();
+
+    // the thumbnail is good enough & typically embedded
+    DkThumbNail thumb(file.absoluteFilePath());
+    thumb.compute();
+
+    QImage img = thumb.getImage();
+
+    if (!img.isNull()) {
+        e.hash = dHash(img);
+        e.valid = true;
+    }
+
+    return e;
+}
+
+QString DkDuplicateFinder::hashesPath(const QString &dirPath)
+{
+    QString hash = QString::fromLatin1(QCryptographicHash::hash(dirPath.toUtf8(), QCryptographicHash::Sha1).toHex());
+    return DkUtils::getAppDataPath() + QDir::separator() + "catalogs" + QDir::separator() + hash + ".hashes";
+}
+
+QHash<QString, DkDuplicateFinder::HashEntry> DkDuplicateFinder::loadHashes(const QString &dirPath)
+{
+    QHash<QString, HashEntry> hashes;
+
+    QFile file(hashesPath(dirPath));
+    if (!file.open(QIODevice::ReadOnly))
+        return hashes;
+
+    QString magic, path;
+    qint32 version = 0, size = 0;
+    QDataStream ds(&file);
+    ds >> magic >> version >> path >> size;
+
+    if (magic != hashesMagic || version != hashesVersion || path != dirPath)
+        return hashes;
+
+    hashes.reserve(size);
+
+    for (int idx = 0; idx < size && ds.status() == QDataStream::Ok; idx++) {
+        QString name;
+        HashEntry e;
+        ds >> name >> e.fileSize >> e.modified >> e.hash >> e.valid;
+        hashes.insert(name, e);
+    }
+
+    if (ds.status() != QDataStream::Ok)
+        hashes.clear();
+
+    return hashes;
+}
+
+bool DkDuplicateFinder::saveHashes(const QString &dirPath, const QHash<QString, HashEntry> &hashes)
+{
+    QString filePath = hashesPath(dirPath);
+    QDir().mkpath(QFileInfo(filePath).absolutePath());
+
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "[Duplicates] I could not write" << filePath;
+        return false;
+    }
+
+    QDataStream ds(&file);
+    ds << hashesMagic << (qint32)hashesVersion << dirPath << (qint32)hashes.size();
+
+    for (auto it = hashes.constBegin(); it != hashes.constEnd(); it++)
+        ds << it.key() << it->fileSize << it->modified << it->hash << it->valid;
+
+    return file.commit();
+}
+
+}
@@ -0,0 +1,110 @@
+/*******************************************************************************************************
+ DkDuplicateFinder.h
+ Created on:	19.10.2026
+
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+
+ Copyright (C) 2011-2016 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2016 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2016 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ *******************************************************************************************************/
+
+#pragma once
+
+#pragma warning(push, 0) // no warnings from includes - begin
+#include <QAtomicInt>
+#include <QFileInfo>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QImage>
+#include <QObject>
+#include <QStringList>
+#include <QVector>
+#pragma warning(pop) // no warnings from includes - end
+
+#pragma warning(disable : 4251) // TODO: remove
+
+#ifndef DllCoreExport
+#ifdef DK_CORE_DLL_EXPORT
+#define DllCoreExport Q_DECL_EXPORT
+#elif DK_DLL_IMPORT
+#define DllCoreExport Q_DECL_IMPORT
+#else
+#define DllCoreExport Q_DECL_IMPORT
+#endif
+#endif
+
+namespace nmc
+{
+
+/**
+ * Finds duplicates and near-duplicates (e.g. re-encoded or resized copies).
+ * A perceptual hash (dHash) is computed from each image's thumbnail in parallel.
+ * The hashes are stored per folder (keyed by file name, size and modification
+ * date) so that a re-run only hashes new or changed files. Images whose hashes
+ * differ in at most maxDistance bits are clustered using a BK-tree, hence
+ * we do not need to compare all pairs of images.
+ **/
+class DllCoreExport DkDuplicateFinder : public QObject
+{
+    Q_OBJECT
+
+public:
+    DkDuplicateFinder(QObject *parent = 0);
+    ~DkDuplicateFinder();
+
+    void find(const QFileInfoList &files, int maxDistance = 6);
+    bool isRunning() const;
+
+    static quint64 dHash(const QImage &img);
+    static int distance(quint64 h1, quint64 h2);
+    static QVector<QStringList> cluster(const QVector<QPair<QString, quint64>> &hashes, int maxDistance);
+
+public slots:
+    void cancel();
+
+signals:
+    void progressSignal(int numHashed, int numFiles) const;
+    void finishedSignal(const QVector<QStringList> &clusters) const;
+
+protected slots:
+    void onFinished();
+
+protected:
+    struct HashEntry {
+        qint64 fileSize = 0;
+        qint64 modified = 0;
+        quint64 hash = 0;
+        bool valid = false; // false if the image could not be loaded
+    };
+
+    QVector<QStringList> findIntern(const QFileInfoList &files, int maxDistance);
+    QHash<QString, HashEntry> hashFolder(const QString &dirPath, const QFileInfoList &files, int &numHashed, int numFiles);
+
+    static HashEntry hashFile(const QFileInfo &file);
+
+    static QString hashesPath(const QString &dirPath);
+    static QHash<QString, HashEntry> loadHashes(const QString &dirPath);
+    static bool saveHashes(const QString &dirPath, const QHash<QString, HashEntry> &hashes);
+
+    QFutureWatcher<QVector<QStringList>> mWatcher;
+    QAtomicInt mCancel;
+};
+
+}
@@ -0,0 +1,239 @@
+/*******************************************************************************************************
+ DkFileReadCache.cpp
+ Created on:	19.10.2026
+
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+
+ Copyright (C) 2011-2016 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2016 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2016 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ *******************************************************************************************************/
+
+#include "DkFileReadCache.h"
+#include "DkTimer.h"
+#include "DkUtils.h"
+
+#pragma warning(push, 0) // no warnings from includes - begin
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#pragma warning(pop) // no warnings from includes - end
+
+namespace nmc
+{
+
+// DkFileReadCache --------------------------------------------------------------------
+DkFileReadCache::DkFileReadCache()
+{
+    mEntries.setMaxCost(mMaxCacheKB);
+}
+
+DkFileReadCache &DkFileReadCache::instance()
+{
+    static DkFileReadCache inst;
+    return inst;
+}
+
+/**
+ * Returns the cached file buffer.
+ * @param filePath the file's path
+ * @return QSharedPointer<QByteArray> the buffer or a null pointer if the file was not read yet
+ **/
+QSharedPointer<QByteArray> DkFileReadCache::buffer(const QString &filePath)
+{
+    QFileInfo fi(DkUtils::resolveSymLink(filePath));
+
+    QMutexLocker lock(&mMutex);
+    Entry *e = entry(fi.absoluteFilePath(), fi);
+
+    if (!e || e->buffer.isEmpty()) {
+        DkTracer::instance().addCounter("read cache misses");
+        return QSharedPointer<QByteArray>();
+    }
+
+    DkTracer::instance().addCounter("read cache hits");
+
+    // the copy is cheap (implicitly shared) and callers may clear their buffer
+    return QSharedPointer<QByteArray>(new QByteArray(e->buffer));
+}
+
+/**
+ * Returns the file's buffer - the file is only read if it is not cached yet.
+ * @param filePath the file's path
+ * @return QSharedPointer<QByteArray> the file buffer (empty if the file could not be read or should be loaded from disk)
+ **/
+QSharedPointer<QByteArray> DkFileReadCache::read(const QString &filePath)
+{
+    QSharedPointer<QByteArray> ba = buffer(filePath);
+
+    if (ba)
+        return ba;
+
+    QFileInfo fi(DkUtils::resolveSymLink(filePath));
+
+    if (!isCacheable(fi))
+        return QSharedPointer<QByteArray>(new QByteArray());
+
+    QFile file(fi.absoluteFilePath());
+    file.open(QIODevice::ReadOnly);
+
+    ba = QSharedPointer<QByteArray>(new QByteArray(file.readAll()));
+    file.close();
+
+    DkTracer::instance().addCounter("bytes read", ba->size());
+
+    insert(filePath, ba);
+
+    return ba;
+}
+
+/**
+ * Shares a file buffer that was read by the caller.
+ * @param filePath the file's path
+ * @param ba the file's buffer
+ **/
+void DkFileReadCache::insert(const QString &filePath, QSharedPointer<QByteArray> ba)
+{
+    if (!ba || ba->isEmpty())
+        return;
+
+    QFileInfo fi(DkUtils::resolveSymLink(filePath));
+
+    if (!isCacheable(fi) || ba->size() / 1024 > mMaxCacheKB / 4)
+        return;
+
+    QMutexLocker lock(&mMutex);
+    Entry *e = entry(fi.absoluteFilePath(), fi);
+
+    Entry ne = e ? *e : Entry();
+    ne.buffer = *ba;
+
+    insert(fi.absoluteFilePath(), fi, ne);
+}
+
+/**
+ * Returns the cached embedded thumbnail.
+ * @param filePath the file's path
+ * @param thumb the thumbnail if it was parsed before
+ * @return bool true if the file's metadata was parsed before
+ **/
+bool DkFileReadCache::exifThumb(const QString &filePath, ExifThumb &thumb)
+{
+    QFileInfo fi(DkUtils::resolveSymLink(filePath));
+
+    QMutexLocker lock(&mMutex);
+    Entry *e = entry(fi.absoluteFilePath(), fi);
+
+    if (!e || !e->hasThumb)
+        return false;
+
+    thumb = e->thumb;
+    return true;
+}
+
+void DkFileReadCache::insert(const QString &filePath, const ExifThumb &thumb)
+{
+    QFileInfo fi(DkUtils::resolveSymLink(filePath));
+
+    if (!isCacheable(fi))
+        return;
+
+    QMutexLocker lock(&mMutex);
+    Entry *e = entry(fi.absoluteFilePath(), fi);
+
+    Entry ne = e ? *e : Entry();
+    ne.thumb = thumb;
+    ne.hasThumb = true;
+
+    insert(fi.absoluteFilePath(), fi, ne);
+}
+
+/**
+ * Removes a file from the cache.
+ * Call this whenever nomacs writes to the file.
+ * @param filePath the file's path
+ **/
+void DkFileReadCache::remove(const QString &filePath)
+{
+    QFileInfo fi(DkUtils::resolveSymLink(filePath));
+
+    QMutexLocker lock(&mMutex);
+    mEntries.remove(fi.absoluteFilePath());
+}
+
+void DkFileReadCache::clear()
+{
+    QMutexLocker lock(&mMutex);
+    mEntries.clear();
+}
+
+/**
+ * Limits the cache to a quarter of its size while the system is low on memory.
+ * Least recently used entries are evicted immediately.
+ * @param lowMemory true if the system is low on memory
+ **/
+void DkFileReadCache::setLowMemory(bool lowMemory)
+{
+    QMutexLocker lock(&mMutex);
+    mEntries.setMaxCost(lowMemory ? mMaxCacheKB / 4 : mMaxCacheKB);
+}
+
+/**
+ * Returns the memory used by all cached buffers in MB.
+ **/
+double DkFileReadCache::memoryUsage()
+{
+    QMutexLocker lock(&mMutex);
+    return mEntries.totalCost() / 1024.0;
+}
+
+DkFileReadCache::Entry *DkFileReadCache::entry(const QString &key, const QFileInfo &fileInfo)
+{
+    Entry *e = mEntries.object(key);
+
+    if (!e)
+        return 0;
+
+    // the file was changed (or removed) since we read it
+    if (!fileInfo.exists() || e->fileSize != fileInfo.size() || e->lastModified != fileInfo.lastModified()) {
+        mEntries.remove(key);
+        return 0;
+    }
+
+    return e;
+}
+
+void DkFileReadCache::insert(const QString &key, const QFileInfo &fileInfo, const Entry &e)
+{
+    Entry *ne = new Entry(e);
+    ne->fileSize = fileInfo.size();
+    ne->lastModified = fileInfo.lastModified();
+
+    int cost = qMax(ne->buffer.size() / 1024 + (int)(ne->thumb.img.sizeInBytes() / 1024), 1);
+    mEntries.insert(key, ne, cost);
+}
+
+bool DkFileReadCache::isCacheable(const QFileInfo &fileInfo) const
+{
+    // psd files might be way larger than the part we need to read
+    // and files in zip containers are extracted by the DkZipContainer
+    return fileInfo.exists() && fileInfo.isFile() && !fileInfo.suffix().contains("psd", Qt::CaseInsensitive);
+}
+
+}
@@ -0,0 +1,112 @@
+/*******************************************************************************************************
+ DkFileReadCache.h
+ Created on:	19.10.2026
+
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+
+ Copyright (C) 2011-2016 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2016 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2016 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ *******************************************************************************************************/
+
+#pragma once
+
+#pragma warning(push, 0) // no warnings from includes - begin
+#include <QByteArray>
+#include <QCache>
+#include <QDateTime>
+#include <QImage>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QString>
+#pragma warning(pop) // no warnings from includes - end
+
+#pragma warning(disable : 4251) // TODO: remove
+
+#ifndef DllCoreExport
+#ifdef DK_CORE_DLL_EXPORT
+#define DllCoreExport Q_DECL_EXPORT
+#elif DK_DLL_IMPORT
+#define DllCoreExport Q_DECL_IMPORT
+#else
+#define DllCoreExport Q_DECL_IMPORT
+#endif
+#endif
+
+class QFileInfo;
+
+namespace nmc
+{
+
+/**
+ * Shares what was read from a file between its consumers.
+ * Viewing an image used to read the same file up to three times
+ * (the thumbnail's Exif data, the file buffer and the metadata).
+ * The first consumer reads the file into memory, the others
+ * get the buffer and the parsed embedded thumbnail from here.
+ * Entries are validated against the file's size and modification date
+ * and evicted in least recently used order.
+ **/
+class DllCoreExport DkFileReadCache
+{
+public:
+    static DkFileReadCache &instance();
+
+    struct ExifThumb {
+        QImage img; // embedded thumbnail - null if the file has none
+        int orientation = 0; // Exif orientation in degrees
+        bool rotateWithImage = false; // the full image is rotated according to the orientation (jpg & raw)
+    };
+
+    QSharedPointer<QByteArray> buffer(const QString &filePath);
+    QSharedPointer<QByteArray> read(const QString &filePath);
+    void insert(const QString &filePath, QSharedPointer<QByteArray> ba);
+
+    bool exifThumb(const QString &filePath, ExifThumb &thumb);
+    void insert(const QString &filePath, const ExifThumb &thumb);
+
+    void remove(const QString &filePath);
+    void clear();
+
+    void setLowMemory(bool lowMemory);
+    double memoryUsage();
+
+private:
+    DkFileReadCache();
+    DkFileReadCache(const DkFileReadCache &);
+
+    struct Entry {
+        QByteArray buffer;
+        ExifThumb thumb;
+        bool hasThumb = false;
+        qint64 fileSize = -1;
+        QDateTime lastModified;
+    };
+
+    Entry *entry(const QString &key, const QFileInfo &fileInfo);
+    void insert(const QString &key, const QFileInfo &fileInfo, const Entry &e);
+    bool isCacheable(const QFileInfo &fileInfo) const;
+
+    QMutex mMutex;
+    QCache<QString, Entry> mEntries; // cost in KB
+
+    static const int mMaxCacheKB = 128 * 1024;
+};
+
+}
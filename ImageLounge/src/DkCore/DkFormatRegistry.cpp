@@ -0,0 +1,259 @@
+/*******************************************************************************************************
+ DkFormatRegistry.cpp
+ Created on:	19.10.2026
+
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+
+ Copyright (C) 2011-2016 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2016 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2016 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ *******************************************************************************************************/
+
+#include "DkFormatRegistry.h"
+#include "DkSettings.h"
+#include "DkTimer.h"
+#include "DkUtils.h"
+
+#pragma warning(push, 0) // no warnings from includes - begin
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#pragma warning(pop) // no warnings from includes - end
+
+#include <cstring>
+
+namespace nmc
+{
+
+// DkFormatRegistry --------------------------------------------------------------------
+DkFormatRegistry::DkFormatRegistry()
+{
+    initMagic();
+}
+
+DkFormatRegistry &DkFormatRegistry::instance()
+{
+    static DkFormatRegistry inst;
+    return inst;
+}
+
+/**
+ * Compiles the registry from the current file filters.
+ * It is called when the settings are initialized and
+ * has to be called whenever the file filters change.
+ **/
+void DkFormatRegistry::update()
+{
+    DkTimer dt;
+    const DkSettings::App &app = DkSettingsManager::param().app();
+
+    // formats with embedded thumbnails (besides raw files)
+    const QStringList thumbFilters = {"*.jpg", "*.jpeg", "*.jpe", "*.jfif", "*.jps", "*.mpo", "*.tif", "*.tiff", "*.heic", "*.heif", "*.avif", "*.jxl"};
+
+    QWriteLocker locker(&mLock);
+
+    mSuffixes.clear();
+    mPatterns.clear();
+    mMaxDots = 1;
+
+    addFiltersUnlocked(app.fileFilters, cap_decode);
+    addFiltersUnlocked(DkUtils::suffixOnly(app.saveFilters), cap_save);
+    addFiltersUnlocked(DkUtils::suffixOnly(app.rawFilters), Capabilities(cap_raw | cap_thumb));
+    addFiltersUnlocked(DkUtils::suffixOnly(app.containerFilters), cap_container);
+    addFiltersUnlocked(thumbFilters, cap_thumb);
+
+    qInfo() << "[FormatRegistry]" << mSuffixes.size() << "suffixes and" << mPatterns.size() << "patterns compiled in" << dt;
+}
+
+/**
+ * Adds wildcard filters (e.g. *.jpg) to the registry.
+ * If a suffix is registered already, the capabilities are merged.
+ * @param filters the suffix filters (e.g. *.jpg *.png)
+ * @param caps the capabilities of these formats
+ **/
+void DkFormatRegistry::addFilters(const QStringList &filters, Capabilities caps)
+{
+    QWriteLocker locker(&mLock);
+    addFiltersUnlocked(filters, caps);
+}
+
+void DkFormatRegistry::addFiltersUnlocked(const QStringList &filters, Capabilities caps)
+{
+    static const QRegularExpression wildcards("[\\*\\?\\[\\]/\\\\]");
+
+    for (const QString &f : filters) {
+        QString filter = f.trimmed();
+
+        if (filter.isEmpty())
+            continue;
+
+        QString suffix = filter.startsWith("*.") ? filter.mid(2).toLower() : QString();
+
+        // plain suffixes go to the hash table
+        if (!suffix.isEmpty() && !suffix.contains(wildcards)) {
+            mSuffixes[suffix] |= caps;
+            mMaxDots = qMax(mMaxDots, suffix.count('.') + 1);
+            continue;
+        }
+
+        // everything else is compiled only once
+        QRegularExpression exp(QRegularExpression::wildcardToRegularExpression(filter), QRegularExpression::CaseInsensitiveOption);
+        if (exp.isValid())
+            mPatterns << qMakePair(exp, caps);
+    }
+}
+
+/**
+ * Returns the capabilities of a file's format.
+ * @param fileName the file name or path
+ * @return the capabilities or cap_none if the format is unknown
+ **/
+DkFormatRegistry::Capabilities DkFormatRegistry::capabilities(const QString &fileName) const
+{
+    QReadLocker locker(&mLock);
+
+    int nameStart = qMax(fileName.lastIndexOf('/'), fileName.lastIndexOf('\\')) + 1;
+    int pos = fileName.size();
+
+    Capabilities caps = cap_none;
+
+    // check all suffixes (a.tar.gz -> gz, tar.gz) - usually just the last one
+    for (int idx = 0; idx < mMaxDots && pos > nameStart; idx++) {
+        pos = fileName.lastIndexOf('.', pos - 1);
+
+        if (pos < nameStart)
+            break;
+
+        auto it = mSuffixes.constFind(fileName.mid(pos + 1).toLower());
+        if (it != mSuffixes.constEnd())
+            caps |= it.value();
+    }
+
+    if (!mPatterns.empty()) {
+        QString name = fileName.mid(nameStart);
+
+        for (const auto &p : mPatterns) {
+            if (p.first.match(name).hasMatch())
+                caps |= p.second;
+        }
+    }
+
+    return caps;
+}
+
+DkFormatRegistry::Capabilities DkFormatRegistry::suffixCapabilities(const QString &suffix) const
+{
+    QReadLocker locker(&mLock);
+    return mSuffixes.value(suffix.toLower(), cap_none);
+}
+
+bool DkFormatRegistry::hasCapability(const QString &fileName, Capability cap) const
+{
+    return capabilities(fileName).testFlag(cap);
+}
+
+/**
+ * Identifies a file format by its magic number.
+ * @param header the first bytes of a file (at least sniffSize() bytes)
+ * @return the format's suffix or an empty string if no magic number matches
+ **/
+QString DkFormatRegistry::sniff(const QByteArray &header) const
+{
+    for (const Magic &m : mMagic) {
+        bool match = true;
+
+        for (const auto &p : m.parts) {
+            if (header.size() < p.first + p.second.size() || std::memcmp(header.constData() + p.first, p.second.constData(), p.second.size()) != 0) {
+                match = false;
+                break;
+            }
+        }
+
+        if (match)
+            return m.suffix;
+    }
+
+    return QString();
+}
+
+QString DkFormatRegistry::sniff(const QFileInfo &file) const
+{
+    QFile f(file.absoluteFilePath());
+
+    if (!f.open(QIODevice::ReadOnly))
+        return QString();
+
+    return sniff(f.read(mSniffSize));
+}
+
+int DkFormatRegistry::sniffSize() const
+{
+    return mSniffSize;
+}
+
+void DkFormatRegistry::addMagic(const QString &suffix, const QVector<QPair<int, QByteArray>> &parts)
+{
+    Magic m;
+    m.suffix = suffix;
+    m.parts = parts;
+
+    for (const auto &p : parts)
+        mSniffSize = qMax(mSniffSize, p.first + (int)p.second.size());
+
+    mMagic << m;
+}
+
+void DkFormatRegistry::initMagic()
+{
+    auto bytes = [](const char *b, int size) {
+        return QByteArray(b, size);
+    };
+
+    // NOTE: more specific signatures must precede general ones
+    // NOTE: a match is trusted without further checks - so no 2 byte signatures (e.g. text files starting with "BM")
+    // jxl codestreams (\xFF\x0A) are therefore left to the mime database
+    addMagic("jpg", {{0, bytes("\xFF\xD8\xFF", 3)}});
+    addMagic("png", {{0, bytes("\x89PNG\r\n\x1A\n", 8)}});
+    addMagic("gif", {{0, bytes("GIF8", 4)}});
+    addMagic("tif", {{0, bytes("II*\0", 4)}});
+    addMagic("tif", {{0, bytes("MM\0*", 4)}});
+    addMagic("webp", {{0, bytes("RIFF", 4)}, {8, bytes("WEBP", 4)}});
+    addMagic("cr3", {{4, bytes("ftypcrx ", 8)}});
+    addMagic("avif", {{4, bytes("ftypavif", 8)}});
+    addMagic("avifs", {{4, bytes("ftypavis", 8)}});
+    addMagic("heic", {{4, bytes("ftypheic", 8)}});
+    addMagic("heic", {{4, bytes("ftypheix", 8)}});
+    addMagic("heif", {{4, bytes("ftypmif1", 8)}});
+    addMagic("jxl", {{0, bytes("\0\0\0\x0CJXL \r\n\x87\n", 12)}});
+    addMagic("jp2", {{0, bytes("\0\0\0\x0CjP  \r\n\x87\n", 12)}});
+    addMagic("raf", {{0, bytes("FUJIFILMCCD-RAW", 15)}});
+    addMagic("psd", {{0, bytes("8BPS", 4)}});
+
+    // bmp: "BM" followed by the DIB header size at offset 14 (core, info, v2, v3, OS/2 v2, v4, v5)
+    for (char dibSize : {12, 40, 52, 56, 64, 108, 124})
+        addMagic("bmp", {{0, bytes("BM", 2)}, {14, QByteArray(1, dibSize) + bytes("\0\0\0", 3)}});
+
+    addMagic("ico", {{0, bytes("\0\0\1\0", 4)}});
+    addMagic("qoi", {{0, bytes("qoif", 4)}});
+    addMagic("exr", {{0, bytes("\x76\x2F\x31\x01", 4)}});
+    addMagic("dds", {{0, bytes("DDS ", 4)}});
+    addMagic("zip", {{0, bytes("PK\3\4", 4)}});
+}
+
+}
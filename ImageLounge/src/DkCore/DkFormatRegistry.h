@@ -0,0 +1,121 @@
+/*******************************************************************************************************
+ DkFormatRegistry.h
+ Created on:	19.10.2026
+
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+
+ Copyright (C) 2011-2016 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2016 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2016 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ *******************************************************************************************************/
+
+#pragma once
+
+#pragma warning(push, 0) // no warnings from includes - begin
+#include <QByteArray>
+#include <QHash>
+#include <QReadWriteLock>
+#include <QRegularExpression>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#pragma warning(pop) // no warnings from includes - end
+
+#pragma warning(disable : 4251) // TODO: remove
+
+#ifndef DllCoreExport
+#ifdef DK_CORE_DLL_EXPORT
+#define DllCoreExport Q_DECL_EXPORT
+#elif DK_DLL_IMPORT
+#define DllCoreExport Q_DECL_IMPORT
+#else
+#define DllCoreExport Q_DECL_IMPORT
+#endif
+#endif
+
+class QFileInfo;
+
+namespace nmc
+{
+
+/**
+ * Knows which file formats nomacs supports.
+ * The registry is compiled once from the file filters of the settings:
+ * each lower case suffix maps to the capabilities of its loader. Hence,
+ * suffix checks are hash lookups rather than a wildcard match per filter.
+ * In addition, it holds a magic number table which identifies files
+ * without (or with wrong) suffixes by their first bytes.
+ **/
+class DllCoreExport DkFormatRegistry
+{
+public:
+    enum Capability {
+        cap_none = 0x00,
+        cap_decode = 0x01,
+        cap_save = 0x02,
+        cap_thumb = 0x04, // the format may carry an embedded (exif) thumbnail
+        cap_raw = 0x08,
+        cap_container = 0x10,
+    };
+    Q_DECLARE_FLAGS(Capabilities, Capability)
+
+    static DkFormatRegistry &instance();
+
+    // singleton
+    DkFormatRegistry(DkFormatRegistry const &) = delete;
+    void operator=(DkFormatRegistry const &) = delete;
+
+    void update();
+    void addFilters(const QStringList &filters, Capabilities caps);
+
+    Capabilities capabilities(const QString &fileName) const;
+    Capabilities suffixCapabilities(const QString &suffix) const;
+    bool hasCapability(const QString &fileName, Capability cap) const;
+
+    QString sniff(const QByteArray &header) const;
+    QString sniff(const QFileInfo &file) const;
+    int sniffSize() const;
+
+private:
+    DkFormatRegistry();
+
+    struct Magic {
+        QVector<QPair<int, QByteArray>> parts; // offset -> bytes
+        QString suffix;
+    };
+
+    void addMagic(const QString &suffix, const QVector<QPair<int, QByteArray>> &parts);
+    void initMagic();
+    void addFiltersUnlocked(const QStringList &filters, Capabilities caps);
+
+    mutable QReadWriteLock mLock;
+
+    QHash<QString, Capabilities> mSuffixes;
+    int mMaxDots = 1;
+
+    // filters that are no plain suffixes (e.g. *.jp?) - compiled once
+    QVector<QPair<QRegularExpression, Capabilities>> mPatterns;
+
+    QVector<Magic> mMagic;
+    int mSniffSize = 0;
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(DkFormatRegistry::Capabilities)
+
+}
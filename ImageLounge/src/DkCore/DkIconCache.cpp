@@ -0,0 +1,245 @@
+/*******************************************************************************************************
+ DkIconCache.cpp
+ Created on:	19.10.2026
+
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+
+ Copyright (C) 2011-2016 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2016 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2016 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ *******************************************************************************************************/
+
+#include "DkIconCache.h"
+#include "DkImageStorage.h"
+#include "DkSettings.h"
+#include "DkTimer.h"
+#include "DkUtils.h"
+
+#pragma warning(push, 0) // no warnings from includes - begin
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QPainter>
+#include <QSaveFile>
+#pragma warning(pop) // no warnings from includes - end
+
+#include <algorithm>
+
+namespace nmc
+{
+
+// DkIconCache --------------------------------------------------------------------
+DkIconCache::DkIconCache()
+{
+}
+
+DkIconCache &DkIconCache::instance()
+{
+    static DkIconCache inst;
+    return inst;
+}
+
+/**
+ * Returns the rendered icon.
+ * It is taken from memory, from the atlas of the last session or rendered.
+ * @param filePath the svg's file path
+ * @param size the icon size in pixels
+ * @param col the icon color
+ * @param colorize if false, the svg's colors are kept
+ * @return QPixmap the icon
+ **/
+QPixmap DkIconCache::icon(const QString &filePath, const QSize &size, const QColor &col, bool colorize)
+{
+    QString k = key(filePath, size, col, colorize);
+
+    auto it = mIcons.constFind(k);
+    if (it != mIcons.constEnd()) {
+        DkTracer::instance().addCounter("iconCache.hit");
+        return it.value();
+    }
+
+    if (!mAtlasLoaded)
+        loadAtlas();
+
+    QPixmap pm;
+    QRect r = mAtlasIndex.value(k);
+
+    if (!r.isNull()) {
+        pm = QPixmap::fromImage(mAtlas.copy(r));
+        DkTracer::instance().addCounter("iconCache.atlas");
+    } else {
+        DkTraceZone tz("DkIconCache::render");
+
+        pm = DkImage::loadFromSvg(filePath, size);
+
+        if (colorize)
+            pm = DkImage::colorizePixmap(pm, col);
+
+        mDirty = true;
+        DkTracer::instance().addCounter("iconCache.miss");
+    }
+
+    mIcons.insert(k, pm);
+
+    return pm;
+}
+
+/**
+ * Writes all icons that were used in this session to the atlas.
+ * Nothing is written if no icon had to be rendered.
+ * @return bool true if the atlas is up-to-date
+ **/
+bool DkIconCache::save()
+{
+    if (!mDirty)
+        return true;
+
+    DkTimer dt;
+
+    // keep the icons of the last session that were not used this time
+    for (auto it = mAtlasIndex.constBegin(); it != mAtlasIndex.constEnd(); it++) {
+        if (!mIcons.contains(it.key()))
+            mIcons.insert(it.key(), QPixmap::fromImage(mAtlas.copy(it.value())));
+    }
+
+    // shelf packing - the icons are sorted by height to keep the shelves tight
+    QStringList keys = mIcons.keys();
+    std::sort(keys.begin(), keys.end(), [&](const QString &l, const QString &r) {
+        return mIcons[l].height() > mIcons[r].height();
+    });
+
+    const int atlasWidth = 1024;
+    QHash<QString, QRect> index;
+    QPoint pos(0, 0);
+    int shelfHeight = 0;
+
+    for (const QString &k : keys) {
+        QSize s = mIcons[k].size();
+
+        if (s.isEmpty() || s.width() > atlasWidth)
+            continue;
+
+        if (pos.x() + s.width() > atlasWidth) {
+            pos = QPoint(0, pos.y() + shelfHeight);
+            shelfHeight = 0;
+        }
+
+        index.insert(k, QRect(pos, s));
+        pos.rx() += s.width();
+        shelfHeight = qMax(shelfHeight, s.height());
+    }
+
+    QImage atlas(atlasWidth, qMax(pos.y() + shelfHeight, 1), QImage::Format_ARGB32_Premultiplied);
+    atlas.fill(Qt::transparent);
+
+    QPainter p(&atlas);
+    p.setCompositionMode(QPainter::CompositionMode_Source);
+
+    for (auto it = index.constBegin(); it != index.constEnd(); it++)
+        p.drawPixmap(it.value().topLeft(), mIcons[it.key()]);
+
+    p.end();
+
+    QSaveFile file(atlasPath());
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "[IconCache] I could not write" << atlasPath();
+        return false;
+    }
+
+    QDataStream ds(&file);
+    ds << stamp() << index << atlas;
+
+    if (!file.commit())
+        return false;
+
+    mDirty = false;
+    qInfo() << "[IconCache]" << index.size() << "icons written to the atlas in" << dt;
+
+    return true;
+}
+
+/**
+ * Removes all icons from memory - e.g. if the theme changed.
+ * The atlas is validated again before it is used next.
+ **/
+void DkIconCache::clear()
+{
+    mIcons.clear();
+    mAtlas = QImage();
+    mAtlasIndex.clear();
+    mAtlasLoaded = false;
+}
+
+QString DkIconCache::atlasPath()
+{
+    return DkUtils::getAppDataPath() + QDir::separator() + "icon-atlas.bin";
+}
+
+QString DkIconCache::key(const QString &filePath, const QSize &size, const QColor &col, bool colorize) const
+{
+    return filePath + "|" + QString::number(size.width()) + "x" + QString::number(size.height()) + "|"
+        + (colorize ? QString::number(col.rgba(), 16) : QString("-"));
+}
+
+/**
+ * The atlas is invalid if anything changes that is not part of the keys.
+ * (the svgs themselves come with the nomacs version)
+ **/
+QString DkIconCache::stamp() const
+{
+    DkSettings &s = DkSettingsManager::param();
+
+    return QCoreApplication::applicationVersion() + "|" + s.display().themeName + "|" + QString::number(s.dpiScaleFactor());
+}
+
+bool DkIconCache::loadAtlas()
+{
+    mAtlasLoaded = true;
+
+    QFile file(atlasPath());
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    DkTimer dt;
+
+    QString fileStamp;
+    QDataStream ds(&file);
+    ds >> fileStamp;
+
+    if (fileStamp != stamp()) {
+        qInfo() << "[IconCache] theme or dpi changed - the atlas is rebuilt";
+        mDirty = true;
+        return false;
+    }
+
+    ds >> mAtlasIndex >> mAtlas;
+
+    if (ds.status() != QDataStream::Ok || mAtlas.isNull()) {
+        mAtlasIndex.clear();
+        mAtlas = QImage();
+        return false;
+    }
+
+    qInfo() << "[IconCache]" << mAtlasIndex.size() << "icons loaded from the atlas in" << dt;
+
+    return true;
+}
+
+}
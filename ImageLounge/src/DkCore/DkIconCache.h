@@ -0,0 +1,94 @@
+/*******************************************************************************************************
+ DkIconCache.h
+ Created on:	19.10.2026
+
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+
+ Copyright (C) 2011-2016 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2016 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2016 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ *******************************************************************************************************/
+
+#pragma once
+
+#pragma warning(push, 0) // no warnings from includes - begin
+#include <QColor>
+#include <QHash>
+#include <QImage>
+#include <QPixmap>
+#include <QRect>
+#include <QString>
+#pragma warning(pop) // no warnings from includes - end
+
+#pragma warning(disable : 4251) // TODO: remove
+
+#ifndef DllCoreExport
+#ifdef DK_CORE_DLL_EXPORT
+#define DllCoreExport Q_DECL_EXPORT
+#elif DK_DLL_IMPORT
+#define DllCoreExport Q_DECL_IMPORT
+#else
+#define DllCoreExport Q_DECL_IMPORT
+#endif
+#endif
+
+namespace nmc
+{
+
+/**
+ * Caches the rendered & colorized svg icons of DkImage::loadIcon.
+ * Icons are keyed by path, pixel size and color. All icons rendered are
+ * packed into an atlas that is stored in the app data folder. It is
+ * loaded on the next start instead of rendering the svgs again and
+ * discarded if the theme, the dpi scaling or the nomacs version changed.
+ **/
+class DllCoreExport DkIconCache
+{
+public:
+    static DkIconCache &instance();
+
+    // singleton
+    DkIconCache(DkIconCache const &) = delete;
+    void operator=(DkIconCache const &) = delete;
+
+    QPixmap icon(const QString &filePath, const QSize &size, const QColor &col, bool colorize);
+
+    bool save();
+    void clear();
+
+    static QString atlasPath();
+
+private:
+    DkIconCache();
+
+    QString key(const QString &filePath, const QSize &size, const QColor &col, bool colorize) const;
+    QString stamp() const;
+    bool loadAtlas();
+
+    QHash<QString, QPixmap> mIcons;
+
+    // the atlas of the last session
+    QImage mAtlas;
+    QHash<QString, QRect> mAtlasIndex;
+    bool mAtlasLoaded = false;
+
+    bool mDirty = false;
+};
+
+}
@@ -27,17 +27,24 @@
 
 #include "DkImageContainer.h"
 #include "DkBasicLoader.h"
+#include "DkFileReadCache.h"
+#include "DkFormatRegistry.h"
 #include "DkImageStorage.h"
 #include "DkMetaData.h"
 #include "DkSettings.h"
+#include "DkSharedImage.h"
 #include "DkThumbs.h"
 #include "DkTimer.h"
 #include "DkUtils.h"
 
 #pragma warning(push, 0) // no warnings from includes - begin
+#include <QGuiApplication>
+#include <QHash>
 #include <QImage>
+#include <QMutex>
 #include <QObject>
 #include <QRegularExpression>
+#include <QScreen>
 #include <QtConcurrentRun>
 
 // quazip
@@ -58,6 +65,18 @@ namespace nmc
 QString DkZipContainer::mZipMarker = "dIrChAr";
 #endif
 
+namespace
+{
+
+// buffers are kept uncompressed if compression saves less
+const float maxCompressionRatio = 0.9f;
+
+// observed compression ratios per suffix (see DkImageContainer::compressionRatio)
+QMutex compressionMutex;
+QHash<QString, float> compressionRatios;
+
+}
+
 // DkImageContainer --------------------------------------------------------------------
 /**
  * Creates a DkImageContainer.
@@ -119,8 +138,9 @@ void DkImageContainer::clear()
 {
     if (mLoader)
         mLoader->release();
-    if (mFileBuffer)
-        mFileBuffer->clear();
+    clearFileBuffer();
+    mScaledImage = QImage();
+    mPrescaledImage = QImage();
     init();
 }
 
@@ -265,25 +285,136 @@ QSharedPointer<QByteArray> DkImageContainer::getFileBuffer()
         mFileBuffer = QSharedPointer<QByteArray>(new QByteArray());
     }
 
+    // the buffer was prefetched - but nobody decoded it yet
+    if (mFileBuffer->isEmpty() && !mCompressedBuffer.isEmpty()) {
+        mFileBuffer = uncompressBuffer(mCompressedBuffer);
+        mCompressedBuffer.clear();
+    }
+
     return mFileBuffer;
 }
 
+void DkImageContainer::clearFileBuffer()
+{
+    if (mFileBuffer)
+        mFileBuffer->clear();
+    mCompressedBuffer.clear();
+}
+
+/**
+ * Returns true if files of this format are typically stored without compression and compressing them paid off so far.
+ * Their buffers are compressed in memory when they are prefetched (see DkImageContainerT::fetchFile).
+ * @param filePath the image's file path
+ **/
+bool DkImageContainer::isCompressible(const QString &filePath)
+{
+    static const QStringList suffixes = {"bmp", "dib", "tif", "tiff", "ppm", "pgm", "pbm", "pnm", "pfm", "tga", "hdr", "psd", "psb"};
+
+    if (!suffixes.contains(QFileInfo(filePath).suffix().toLower()) && !DkFormatRegistry::instance().hasCapability(filePath, DkFormatRegistry::cap_raw))
+        return false;
+
+    // most RAW files and many tiffs are compressed already - stop once we observed that
+    return compressionRatio(filePath) <= maxCompressionRatio;
+}
+
+/**
+ * Returns the average compression ratio (compressed / original size) observed for files with this suffix.
+ * We assume that buffers halve until the first file is compressed.
+ * This function is thread-safe.
+ * @param filePath the image's file path
+ **/
+float DkImageContainer::compressionRatio(const QString &filePath)
+{
+    QMutexLocker locker(&compressionMutex);
+    return compressionRatios.value(QFileInfo(filePath).suffix().toLower(), 0.5f);
+}
+
+/**
+ * Adds an observed compression ratio (see compressionRatio).
+ * This function is thread-safe.
+ * @param filePath the image's file path
+ * @param ratio compressed / original size
+ **/
+void DkImageContainer::addCompressionRatio(const QString &filePath, float ratio)
+{
+    QString suffix = QFileInfo(filePath).suffix().toLower();
+
+    QMutexLocker locker(&compressionMutex);
+    auto it = compressionRatios.find(suffix);
+
+    if (it == compressionRatios.end())
+        compressionRatios.insert(suffix, ratio);
+    else
+        *it = 0.7f * *it + 0.3f * ratio;
+}
+
+QSharedPointer<QByteArray> DkImageContainer::uncompressBuffer(const QByteArray &compressed)
+{
+    DkTimer dt;
+    QSharedPointer<QByteArray> ba(new QByteArray(qUncompress(compressed)));
+    DkTracer::instance().addCounter("uncompressed buffers");
+
+    qDebug() << "[DkImageContainer] file buffer uncompressed in" << dt;
+
+    return ba;
+}
+
 float DkImageContainer::getMemoryUsage() const
 {
     if (!mLoader)
         return 0;
 
-    float memSize = mFileBuffer ? mFileBuffer->size() / (1024.0f * 1024.0f) : 0;
+    float memSize = getBufferMemoryUsage();
     memSize += DkImage::getBufferSizeFloat(mLoader->image().size(), mLoader->image().depth());
+    memSize += DkImage::getBufferSizeFloat(mPrescaledImage.size(), mPrescaledImage.depth());
 
     return memSize;
 }
 
+float DkImageContainer::getBufferMemoryUsage() const
+{
+    float memSize = mFileBuffer ? mFileBuffer->size() / (1024.0f * 1024.0f) : 0;
+    memSize += mCompressedBuffer.size() / (1024.0f * 1024.0f);
+
+    return memSize;
+}
+
+float DkImageContainer::getThumbMemoryUsage() const
+{
+    if (!mThumb)
+        return 0;
+
+    QImage thumb = mThumb->getImage();
+    return DkImage::getBufferSizeFloat(thumb.size(), thumb.depth());
+}
+
+/**
+ * Returns the memory used by edits that are not displayed (MB).
+ **/
+float DkImageContainer::getHistoryMemoryUsage() const
+{
+    return mLoader ? mLoader->historyMemoryUsage() : 0;
+}
+
 float DkImageContainer::getFileSize() const
 {
     return QFileInfo(mFilePath).size() / (1024.0f * 1024.0f);
 }
 
+/**
+ * Estimates the memory (in MB) the file buffer needs if it is prefetched.
+ * Compressed buffers are estimated with the ratio observed for their suffix.
+ **/
+float DkImageContainer::getPrefetchSize() const
+{
+    float size = getFileSize();
+
+    if (DkSettingsManager::param().resources().compressPrefetched && isCompressible(mFilePath))
+        size *= compressionRatio(mFilePath);
+
+    return size;
+}
+
 DkRotatingRect DkImageContainer::cropRect()
 {
     QSharedPointer<DkMetaDataT> metaData = getMetaData();
@@ -311,18 +442,50 @@ QImage DkImageContainer::pixmap()
 
 QImage DkImageContainer::imageScaledToHeight(int height)
 {
-    // NOTE: scaled image cache is now disabled
+    return scaledImage(QSize(0, height));
+}
+
+QImage DkImageContainer::imageScaledToWidth(int width)
+{
+    return scaledImage(QSize(width, 0));
+}
+
+/**
+ * Returns the image scaled to the requested width or height.
+ * The last result is cached since previews (e.g. the filmstrip) ask for it on every repaint.
+ * Edits change the image's cacheKey which invalidates the cache.
+ * @param request either the width or the height (the other one is 0)
+ **/
+QImage DkImageContainer::scaledImage(const QSize &request)
+{
+    QImage img = image();
+
+    if (!mScaledImage.isNull() && mScaledImageKey == img.cacheKey() && mScaledImageRequest == request)
+        return mScaledImage;
+
+    DkTraceZone tz("DkImageContainer::scaledImage");
+
+    if (request.height() > 0)
+        mScaledImage = img.scaledToHeight(request.height(), Qt::SmoothTransformation);
+    else
+        mScaledImage = img.scaledToWidth(request.width(), Qt::SmoothTransformation);
 
-    QImage sImg = image().scaledToHeight(height, Qt::SmoothTransformation);
+    mScaledImageKey = img.cacheKey();
+    mScaledImageRequest = request;
 
-    return sImg;
+    return mScaledImage;
 }
 
-QImage DkImageContainer::imageScaledToWidth(int width)
+/**
+ * Returns the pixmap downsampled to the display size (see DkImageContainerT::prescale).
+ * @return QImage the prescaled image or a null image if it was not computed or the image changed since
+ **/
+QImage DkImageContainer::prescaledImage()
 {
-    QImage sImg = image().scaledToWidth(width, Qt::SmoothTransformation);
+    if (!mLoader || mPrescaledImage.isNull() || mPrescaledImageKey != mLoader->pixmap().cacheKey())
+        return QImage();
 
-    return sImg;
+    return mPrescaledImage;
 }
 
 void DkImageContainer::setImage(const QImage &img, const QString &editName)
@@ -401,8 +564,9 @@ bool DkImageContainer::saveImage(const QString &filePath, const QImage saveImg,
     return saveFile.exists() && saveFile.isFile();
 }
 
-QSharedPointer<QByteArray> DkImageContainer::loadFileToBuffer(const QString &filePath)
+QSharedPointer<QByteArray> DkImageContainer::loadFileToBuffer(const QString &filePath, bool prefetch)
 {
+    DkTraceZone tz("DkImageContainer::loadFileToBuffer");
     QFileInfo fInfo = QFileInfo(filePath);
 
     if (fInfo.isSymLink())
@@ -413,33 +577,56 @@ QSharedPointer<QByteArray> DkImageContainer::loadFileToBuffer(const QString &fil
         return getZipData()->extractImage(getZipData()->getZipFilePath(), getZipData()->getImageFileName());
 #endif
 
-    if (fInfo.suffix().contains("psd")) { // for now just psd's are not cached because their file might be way larger than the part we need to read
+    // psd's are not cached because their file might be way larger than the part we need to read
+    // prefetched psd's are compressed (see DkImageContainerT::fetchFile)
+    if (!prefetch && fInfo.suffix().contains("psd")) {
         return QSharedPointer<QByteArray>(new QByteArray());
     }
 
-    QFile file(fInfo.absoluteFilePath());
-    file.open(QIODevice::ReadOnly);
-
-    QSharedPointer<QByteArray> ba(new QByteArray(file.readAll()));
-    file.close();
-
-    return ba;
+    // the thumbnail might have read the file already
+    return DkFileReadCache::instance().read(fInfo.absoluteFilePath());
 }
 
 QSharedPointer<DkBasicLoader>
 DkImageContainer::loadImageIntern(const QString &filePath, QSharedPointer<DkBasicLoader> loader, const QSharedPointer<QByteArray> fileBuffer)
 {
+    DkTraceZone tz("DkImageContainer::loadImageIntern");
+
+    // synchronized instances share decoded images
+    DkSharedImage &shared = DkSharedImage::instance();
+    bool sharing = shared.isEnabled();
+
+    if (sharing) {
+        QImage img = shared.acquire(filePath, fileBuffer);
+
+        if (loader->loadShared(filePath, img, fileBuffer)) {
+            DkTracer::instance().addCounter("images shared by peers");
+
+            return loader;
+        }
+    }
+
     try {
         loader->loadGeneral(filePath, fileBuffer, true, false);
     } catch (...) {
         qWarning() << "Unknown error in DkImageContainer::lfoadImageIntern";
     }
 
+    if (sharing) {
+        if (loader->hasImage() && loader->getNumPages() <= 1)
+            loader->setSharedImage(shared.publish(filePath, loader->image()));
+        shared.releaseClaim(filePath);
+    }
+
+    if (loader->hasImage())
+        DkTracer::instance().addCounter("bytes decoded", loader->image().sizeInBytes());
+
     return loader;
 }
 
 QString DkImageContainer::saveImageIntern(const QString &filePath, QSharedPointer<DkBasicLoader> loader, QImage saveImg, int compression)
 {
+    DkFileReadCache::instance().remove(filePath);
     return loader->save(filePath, saveImg, compression);
 }
 
@@ -448,12 +635,13 @@ void DkImageContainer::saveMetaData()
     if (!mLoader)
         return;
 
-    saveMetaDataIntern(mFilePath, mLoader, mFileBuffer);
+    saveMetaDataIntern(mFilePath, mLoader, getFileBuffer());
 }
 
 void DkImageContainer::saveMetaDataIntern(const QString &filePath, QSharedPointer<DkBasicLoader> loader, QSharedPointer<QByteArray> fileBuffer)
 {
     // TODO this shouldn't be used without notifying the user, see issue #799
+    DkFileReadCache::instance().remove(filePath);
     loader->saveMetaData(filePath, fileBuffer);
 }
 
@@ -578,6 +766,11 @@ DkImageContainerT::~DkImageContainerT()
     mImageWatcher.blockSignals(true);
     mImageWatcher.cancel();
 
+    mPrescaleWatcher.blockSignals(true);
+
+    // the preview worker emits from its thread
+    mPreviewWatcher.waitForFinished();
+
     // This dtor is where saveMetaData() used to be called, which called the "dangerous" overload of saveMetaData(),
     // which is dangerous because it updates the file. We consider this to be a bug.
     // The other place where the file was silently updated in the background was the release() routine, called on unload.
@@ -651,6 +844,8 @@ void DkImageContainerT::checkForFileUpdates()
 
 bool DkImageContainerT::loadImageThreaded(bool force)
 {
+    DkTraceZone tz("DkImageContainerT::loadImageThreaded");
+
 #ifdef WITH_QUAZIP
     // zip archives: get zip file fileInfo for checks
     if (isFromZip())
@@ -692,6 +887,54 @@ bool DkImageContainerT::loadImageThreaded(bool force)
     return true;
 }
 
+/**
+ * Loads a preview of the image while it is loading (progressive display).
+ * The thumbnail is delivered right away (if it was loaded before) and
+ * a reduced resolution decode (see DkBasicLoader::loadPreview) is started in parallel
+ * to the full decode. Previews are sent with previewLoadedSignal.
+ **/
+void DkImageContainerT::fetchPreview()
+{
+    if (!DkSettingsManager::param().resources().progressiveLoading || getLoadState() != loading || mWaitForUpdate != update_idle
+        || getLoader()->hasImage() || mPreviewWatcher.isRunning())
+        return;
+
+    DkTracer::instance().addCounter("previews");
+
+    QImage thumb = getThumb()->hasImage() ? getThumb()->getImage() : QImage();
+
+    // compressed buffers are not worth inflating here - the preview reads only parts of the file
+    QSharedPointer<QByteArray> fileBuffer = mFileBuffer;
+    QString fp = filePath();
+    QSize maxSize;
+
+    if (QScreen *screen = QGuiApplication::primaryScreen())
+        maxSize = screen->size() * screen->devicePixelRatio();
+
+    if (maxSize.isEmpty())
+        maxSize = QSize(1920, 1080);
+
+    mPreviewWatcher.setFuture(QtConcurrent::run([this, fp, fileBuffer, maxSize, thumb] {
+        // the thumbnail can only be painted with the geometry of the full image
+        if (!thumb.isNull()) {
+            QSize thumbFullSize = DkBasicLoader::imageSize(fp, fileBuffer);
+
+            // thumbnails are rotated according to the exif orientation already
+            if ((thumb.width() > thumb.height()) != (thumbFullSize.width() > thumbFullSize.height()))
+                thumbFullSize.transpose();
+
+            if (!thumbFullSize.isEmpty())
+                emit previewLoadedSignal(thumb, thumbFullSize);
+        }
+
+        QImage img;
+        QSize fullSize;
+
+        if (DkBasicLoader::loadPreview(fp, fileBuffer, maxSize, img, fullSize))
+            emit previewLoadedSignal(img, fullSize);
+    }));
+}
+
 void DkImageContainerT::fetchFile()
 {
     if (mFetchingBuffer && getLoadState() == loading_canceled) {
@@ -705,15 +948,44 @@ void DkImageContainerT::fetchFile()
         return;
 
     // ignore doubled calls
-    if (mFileBuffer && !mFileBuffer->isEmpty()) {
+    if ((mFileBuffer && !mFileBuffer->isEmpty()) || !mCompressedBuffer.isEmpty()) {
+        DkTracer::instance().addCounter("file buffer hits");
         bufferLoaded();
         return;
     }
 
+    DkTracer::instance().addCounter("file buffer misses");
+
+    // buffers that are prefetched (not decoded right away) are compressed
+    // so that more of them fit into the cache budget
+    mCompressingBuffer =
+        getLoadState() != loading && DkSettingsManager::param().resources().compressPrefetched && isCompressible(filePath());
+
     mFetchingBuffer = true; // saves the threaded call
     connect(&mBufferWatcher, SIGNAL(finished()), this, SLOT(bufferLoaded()), Qt::UniqueConnection);
-    mBufferWatcher.setFuture(QtConcurrent::run([&] {
-        return loadFileToBuffer(filePath());
+    mBufferWatcher.setFuture(QtConcurrent::run([this] {
+        QSharedPointer<QByteArray> ba = loadFileToBuffer(filePath(), mCompressingBuffer);
+
+        if (mCompressingBuffer && ba && !ba->isEmpty()) {
+            DkTimer dt;
+            QByteArray compressed = qCompress(*ba, 1);
+            float ratio = (float)compressed.size() / ba->size();
+            addCompressionRatio(filePath(), qMin(ratio, 1.0f));
+
+            qDebug() << "[DkImageContainer]" << fileName() << "compressed to" << qRound(100.0 * ratio) << "% in" << dt;
+
+            if (ratio <= maxCompressionRatio)
+                ba = QSharedPointer<QByteArray>(new QByteArray(compressed));
+            else {
+                // not worth it: keep the original (psd's are read from the file when decoding - see loadFileToBuffer)
+                mCompressingBuffer = false;
+
+                if (QFileInfo(filePath()).suffix().contains("psd", Qt::CaseInsensitive))
+                    ba = QSharedPointer<QByteArray>(new QByteArray());
+            }
+        }
+
+        return ba;
     }));
 }
 
@@ -721,8 +993,15 @@ void DkImageContainerT::bufferLoaded()
 {
     mFetchingBuffer = false;
 
-    if (!mBufferWatcher.isCanceled())
-        mFileBuffer = mBufferWatcher.result();
+    if (!mBufferWatcher.isCanceled()) {
+        QSharedPointer<QByteArray> ba = mBufferWatcher.result();
+
+        if (mCompressingBuffer && ba && !ba->isEmpty()) {
+            mCompressedBuffer = *ba;
+            mFileBuffer.clear();
+        } else
+            mFileBuffer = ba;
+    }
 
     if (getLoadState() == loading)
         fetchImage();
@@ -753,8 +1032,17 @@ void DkImageContainerT::fetchImage()
 
     connect(&mImageWatcher, SIGNAL(finished()), this, SLOT(imageLoaded()), Qt::UniqueConnection);
 
-    mImageWatcher.setFuture(QtConcurrent::run([&] {
-        return loadImageIntern(filePath(), mLoader, mFileBuffer);
+    // the compressed buffer is uncompressed in the loading thread
+    // the decoded image keeps the uncompressed buffer (e.g. saving metadata needs it in the gui thread)
+    QSharedPointer<QByteArray> fileBuffer = mFileBuffer;
+    QByteArray compressed = mCompressedBuffer;
+
+    mImageWatcher.setFuture(QtConcurrent::run([this, fileBuffer, compressed] {
+        if (compressed.isEmpty())
+            return loadImageIntern(filePath(), mLoader, fileBuffer);
+
+        mInflatedBuffer = uncompressBuffer(compressed);
+        return loadImageIntern(filePath(), mLoader, mInflatedBuffer);
     }));
 }
 
@@ -762,6 +1050,14 @@ void DkImageContainerT::imageLoaded()
 {
     mFetchingImage = false;
 
+    QSharedPointer<QByteArray> inflated = mInflatedBuffer;
+    mInflatedBuffer.clear();
+
+    if (inflated && !inflated->isEmpty()) {
+        mFileBuffer = inflated;
+        mCompressedBuffer.clear();
+    }
+
     if (getLoadState() == loading_canceled) {
         mLoadState = not_loaded;
         clear();
@@ -810,18 +1106,55 @@ void DkImageContainerT::loadingFinished()
     }
 
     // clear file buffer if it exceeds a certain size?! e.g. psd files
-    if (mFileBuffer) {
-        double bs = mFileBuffer->size() / (1024.0f * 1024.0f);
+    double bs = getBufferMemoryUsage();
 
-        // if the file buffer is more than 5MB - we check if we need to delete it
-        if (bs > 5 && bs > DkSettingsManager::param().resources().cacheMemory * 0.5f)
-            mFileBuffer->clear();
-    }
+    // if the file buffer is more than 5MB - we check if we need to delete it
+    if (bs > 5 && bs > DkSettingsManager::param().resources().cacheMemory * 0.5f)
+        clearFileBuffer();
 
     mLoadState = loaded;
     emit fileLoadedSignal(true);
 }
 
+/**
+ * Downsamples the loaded image to the display size in the background.
+ * imagePrescaledSignal is emitted once the image is ready for display.
+ * @param displaySize the size of the viewport the image is shown in
+ **/
+void DkImageContainerT::prescale(const QSize &displaySize)
+{
+    if (!hasImage() || displaySize.isEmpty() || mPrescaleWatcher.isRunning())
+        return;
+
+    QImage img = getLoader()->pixmap();
+    QSize size = img.size().scaled(displaySize, Qt::KeepAspectRatio);
+
+    // small images are displayed as they are
+    if (size.width() >= img.width() || (mPrescaledImageKey == img.cacheKey() && mPrescaledImage.size() == size)) {
+        emit imagePrescaledSignal();
+        return;
+    }
+
+    mPrescalingKey = img.cacheKey();
+
+    connect(&mPrescaleWatcher, SIGNAL(finished()), this, SLOT(imagePrescaled()), Qt::UniqueConnection);
+    mPrescaleWatcher.setFuture(QtConcurrent::run([img, size] {
+        return DkImageStorage::scaleToDisplay(img, size);
+    }));
+}
+
+void DkImageContainerT::imagePrescaled()
+{
+    // the image was evicted meanwhile
+    if (!hasImage())
+        return;
+
+    mPrescaledImage = mPrescaleWatcher.result();
+    mPrescaledImageKey = mPrescalingKey;
+
+    emit imagePrescaledSignal();
+}
+
 void DkImageContainerT::downloadFile(const QUrl &url)
 {
     if (!mFileDownloader) {
@@ -848,6 +1181,7 @@ void DkImageContainerT::fileDownloaded(const QString &filePath)
     }
 
     mFileBuffer = mFileDownloader->downloadedData();
+    mCompressedBuffer.clear();
 
     if (!mFileBuffer || mFileBuffer->isEmpty()) {
         qDebug() << mFileDownloader->getUrl() << " not downloaded...";
@@ -886,6 +1220,7 @@ void DkImageContainerT::receiveUpdates(QObject *obj, bool connectSignals /* = tr
         connect(this, SIGNAL(fileSavedSignal(const QString &, bool, bool)), obj, SLOT(imageSaved(const QString &, bool, bool)), Qt::UniqueConnection);
         connect(this, SIGNAL(imageUpdatedSignal()), obj, SLOT(currentImageUpdated()), Qt::UniqueConnection);
         connect(this, SIGNAL(imageHistoryChangedSignal()), obj, SIGNAL(imageHistoryChangedSignal()), Qt::UniqueConnection);
+        connect(this, SIGNAL(previewLoadedSignal(const QImage &, const QSize &)), obj, SLOT(previewLoaded(const QImage &, const QSize &)), Qt::UniqueConnection);
         mFileUpdateTimer.start();
     } else if (!connectSignals) {
         disconnect(this, SIGNAL(errorDialogSignal(const QString &)), obj, SLOT(errorDialog(const QString &)));
@@ -894,6 +1229,7 @@ void DkImageContainerT::receiveUpdates(QObject *obj, bool connectSignals /* = tr
         disconnect(this, SIGNAL(fileSavedSignal(const QString &, bool, bool)), obj, SLOT(imageSaved(const QString &, bool, bool)));
         disconnect(this, SIGNAL(imageUpdatedSignal()), obj, SLOT(currentImageUpdated()));
         disconnect(this, SIGNAL(imageHistoryChangedSignal()), obj, SIGNAL(imageHistoryChangedSignal()));
+        disconnect(this, SIGNAL(previewLoadedSignal(const QImage &, const QSize &)), obj, SLOT(previewLoaded(const QImage &, const QSize &)));
         mFileUpdateTimer.stop();
     }
 
@@ -969,8 +1305,7 @@ void DkImageContainerT::savingFinished()
         //// reset thumb - loadImageThreaded should do it anyway
         // thumb = QSharedPointer<DkThumbNailT>(new DkThumbNailT(saveFile, loader->image()));
 
-        if (mFileBuffer)
-            mFileBuffer->clear(); // do a complete clear?
+        clearFileBuffer(); // do a complete clear?
 
         if (DkSettingsManager::param().resources().loadSavedImage == DkSettings::ls_load || filePath().isEmpty() || dirPath() == sInfo.absolutePath()) {
             setFilePath(savePath);
@@ -989,9 +1324,9 @@ void DkImageContainerT::savingFinished()
     }
 }
 
-QSharedPointer<QByteArray> DkImageContainerT::loadFileToBuffer(const QString &filePath)
+QSharedPointer<QByteArray> DkImageContainerT::loadFileToBuffer(const QString &filePath, bool prefetch)
 {
-    return DkImageContainer::loadFileToBuffer(filePath);
+    return DkImageContainer::loadFileToBuffer(filePath, prefetch);
 }
 
 QSharedPointer<DkBasicLoader>
@@ -1015,6 +1350,7 @@ QSharedPointer<DkBasicLoader> DkImageContainerT::getLoader()
     if (!mLoader) {
         DkImageContainer::getLoader();
         connect(mLoader.data(), SIGNAL(errorDialogSignal(const QString &)), this, SIGNAL(errorDialogSignal(const QString &)));
+        connect(mLoader.data(), SIGNAL(previewSignal(const QImage &, const QSize &)), this, SIGNAL(previewLoadedSignal(const QImage &, const QSize &)));
     }
 
     return mLoader;
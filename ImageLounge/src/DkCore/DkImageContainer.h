@@ -79,6 +79,7 @@ public:
     QImage pixmap();
     QImage imageScaledToHeight(int height);
     QImage imageScaledToWidth(int width);
+    QImage prescaledImage();
 
     bool hasImage() const;
     bool hasSvg() const;
@@ -95,7 +96,11 @@ public:
     void setEdited(bool edited = true);
     QString getTitleAttribute() const;
     float getMemoryUsage() const;
+    float getBufferMemoryUsage() const;
+    float getThumbMemoryUsage() const;
+    float getHistoryMemoryUsage() const;
     float getFileSize() const;
+    float getPrefetchSize() const;
 
     virtual QSharedPointer<DkBasicLoader> getLoader();
     virtual QSharedPointer<DkMetaDataT> getMetaData();
@@ -111,7 +116,7 @@ public:
     bool exists();
     bool setPageIdx(int skipIdx);
 
-    QSharedPointer<QByteArray> loadFileToBuffer(const QString &filePath);
+    QSharedPointer<QByteArray> loadFileToBuffer(const QString &filePath, bool prefetch = false);
     bool loadImage();
     void setImage(const QImage &img, const QString &editName);
     void setImage(const QImage &img, const QString &editName, const QString &filePath);
@@ -125,6 +130,10 @@ public:
     void cropImage(const DkRotatingRect &rect, const QColor &col, bool cropToMetadata);
     DkRotatingRect cropRect();
 
+    static bool isCompressible(const QString &filePath);
+    static float compressionRatio(const QString &filePath);
+    static void addCompressionRatio(const QString &filePath, float ratio);
+
 protected:
     QSharedPointer<DkBasicLoader> loadImageIntern(const QString &filePath, QSharedPointer<DkBasicLoader> loader, const QSharedPointer<QByteArray> fileBuffer);
     void
@@ -132,8 +141,13 @@ protected:
     QString saveImageIntern(const QString &filePath, QSharedPointer<DkBasicLoader> loader, QImage saveImg, int compression);
     void setFilePath(const QString &filePath);
     void init();
+    void clearFileBuffer();
+    QImage scaledImage(const QSize &request);
+
+    static QSharedPointer<QByteArray> uncompressBuffer(const QByteArray &compressed);
 
     QSharedPointer<QByteArray> mFileBuffer;
+    QByteArray mCompressedBuffer; // prefetched file buffer (qCompress) - it is uncompressed when the image is decoded
     QSharedPointer<DkBasicLoader> mLoader;
     QSharedPointer<DkThumbNailT> mThumb;
 
@@ -143,6 +157,15 @@ protected:
 
     QFileInfo mFileInfo;
 
+    // the last scaled preview - it is valid as long as the image's cacheKey does not change
+    QImage mScaledImage;
+    qint64 mScaledImageKey = 0;
+    QSize mScaledImageRequest;
+
+    // the pixmap downsampled to the display size ahead of time (e.g. for slide shows)
+    QImage mPrescaledImage;
+    qint64 mPrescaledImageKey = 0;
+
 #ifdef WITH_QUAZIP
     QSharedPointer<DkZipContainer> mZipData;
 #endif
@@ -172,6 +195,8 @@ public:
     void downloadFile(const QUrl &url);
 
     bool loadImageThreaded(bool force = false);
+    void fetchPreview();
+    void prescale(const QSize &displaySize);
     bool saveImageThreaded(const QString &filePath, const QImage saveImg, int compression = -1);
     bool saveImageThreaded(const QString &filePath, int compression = -1);
     void saveMetaDataThreaded(const QString &filePath);
@@ -192,6 +217,8 @@ signals:
     void showInfoSignal(const QString &msg, int time = 3000, int position = 0) const;
     void errorDialogSignal(const QString &msg) const;
     void thumbLoadedSignal(bool loaded = true) const;
+    void previewLoadedSignal(const QImage &img, const QSize &fullSize) const;
+    void imagePrescaledSignal() const;
     void imageUpdatedSignal() const;
     void imageHistoryChangedSignal() const;
 
@@ -203,18 +230,22 @@ protected slots:
     void imageLoaded();
     void savingFinished();
     void loadingFinished();
+    void imagePrescaled();
     void fileDownloaded(const QString &filePath);
 
 protected:
     void fetchImage();
 
-    QSharedPointer<QByteArray> loadFileToBuffer(const QString &filePath);
+    QSharedPointer<QByteArray> loadFileToBuffer(const QString &filePath, bool prefetch = false);
     QSharedPointer<DkBasicLoader> loadImageIntern(const QString &filePath, QSharedPointer<DkBasicLoader> loader, const QSharedPointer<QByteArray> fileBuffer);
     QString saveImageIntern(const QString &filePath, QSharedPointer<DkBasicLoader> loader, QImage saveImg, int compression);
     void saveMetaDataIntern(const QString &filePath, QSharedPointer<DkBasicLoader> loader, QSharedPointer<QByteArray> fileBuffer);
 
     QFutureWatcher<QSharedPointer<QByteArray>> mBufferWatcher;
     QFutureWatcher<QSharedPointer<DkBasicLoader>> mImageWatcher;
+    QFutureWatcher<void> mPreviewWatcher;
+    QFutureWatcher<QImage> mPrescaleWatcher;
+    qint64 mPrescalingKey = 0;
     QFutureWatcher<QString> mSaveImageWatcher;
     QFutureWatcher<bool> mSaveMetaDataWatcher;
 
@@ -232,8 +263,11 @@ protected:
 
     bool mFetchingImage = false;
     bool mFetchingBuffer = false;
+    bool mCompressingBuffer = false;
     bool mDownloaded = false;
 
+    QSharedPointer<QByteArray> mInflatedBuffer; // the compressed buffer uncompressed for decoding
+
     QTimer mFileUpdateTimer;
 };
 
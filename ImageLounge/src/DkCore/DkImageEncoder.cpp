@@ -0,0 +1,314 @@
+/*******************************************************************************************************
+ DkImageEncoder.cpp
+ Created on:	19.10.2026
+
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+
+ Copyright (C) 2011-2016 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2016 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2016 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ *******************************************************************************************************/
+
+#include "DkImageEncoder.h"
+#include "DkTimer.h"
+
+#pragma warning(push, 0) // no warnings from includes - begin
+#include <QDebug>
+#include <QIODevice>
+#include <QImageWriter>
+#include <QRegularExpression>
+#include <QVector>
+#include <QtConcurrentMap>
+#include <QtEndian>
+#pragma warning(pop) // no warnings from includes - end
+
+#include <cstring>
+#include <numeric>
+
+namespace nmc
+{
+
+namespace
+{
+
+// uncompressed bytes per TIFF strip - small enough to keep all cores busy
+const int tiffStripBytes = 256 * 1024;
+
+// below this size, threads cost more than they save
+const int tiffStripMinPixels = 1024 * 1024;
+
+enum TiffType {
+    tiff_short = 3,
+    tiff_long = 4,
+    tiff_rational = 5,
+};
+
+struct TiffEntry {
+    quint16 tag = 0;
+    quint16 type = tiff_short;
+    quint32 count = 0;
+    QByteArray data; // little endian values
+};
+
+void putU16(QByteArray &ba, quint16 v)
+{
+    char b[2];
+    qToLittleEndian(v, b);
+    ba.append(b, 2);
+}
+
+void putU32(QByteArray &ba, quint32 v)
+{
+    char b[4];
+    qToLittleEndian(v, b);
+    ba.append(b, 4);
+}
+
+TiffEntry tiffEntry(quint16 tag, quint16 type, const QVector<quint32> &values)
+{
+    TiffEntry e;
+    e.tag = tag;
+    e.type = type;
+    e.count = (quint32)values.size();
+
+    for (quint32 v : values) {
+        if (type == tiff_short)
+            putU16(e.data, (quint16)v);
+        else
+            putU32(e.data, v);
+    }
+
+    if (type == tiff_rational)
+        e.count /= 2; // numerator, denominator
+
+    return e;
+}
+
+}
+
+// DkImageEncoder --------------------------------------------------------------------
+QString DkImageEncoder::presetName(int preset)
+{
+    switch (preset) {
+    case preset_fast:
+        return "fast";
+    case preset_small:
+        return "small";
+    default:
+        return "default";
+    }
+}
+
+/**
+ * Maps the preset to the options of the writer's format plugin.
+ * Must be called after the writer's format and compression are set.
+ * @param writer the image writer
+ * @param preset the encoder preset
+ **/
+void DkImageEncoder::applyPreset(QImageWriter &writer, int preset)
+{
+    if (preset == preset_default)
+        return;
+
+    const QByteArray format = writer.format().toLower();
+    bool fast = preset == preset_fast;
+
+    if (format == "jpg" || format == "jpeg") {
+        // optimized Huffman tables need a second pass over the coefficients
+        writer.setOptimizedWrite(!fast);
+        writer.setProgressiveScanWrite(!fast);
+    } else if (format == "png") {
+        // Qt maps the quality [0 100] to the zlib level [9 0]: 80 -> 1
+        writer.setQuality(fast ? 80 : 0);
+    } else if (format == "tif" || format == "tiff") {
+        // 0: uncompressed, 1: LZW
+        writer.setCompression(fast ? 0 : 1);
+    }
+}
+
+/**
+ * Returns true if writeTiff() should be used instead of QImageWriter.
+ * The strip encoder only writes 8 bit images and is used for large images
+ * if a preset was chosen (the default preset keeps Qt's output).
+ * @param suffix the output file suffix
+ * @param img the image to be saved
+ * @param preset the encoder preset
+ **/
+bool DkImageEncoder::isStripEncoderSupported(const QString &suffix, const QImage &img, int preset)
+{
+    if (preset == preset_default || img.isNull() || img.depth() > 32)
+        return false;
+
+    if ((qint64)img.width() * img.height() < tiffStripMinPixels)
+        return false;
+
+    return suffix.contains(QRegularExpression("^tiff?$", QRegularExpression::CaseInsensitiveOption));
+}
+
+/**
+ * Writes img as deflate compressed TIFF.
+ * Each strip is an independent zlib stream, so strips are compressed
+ * in parallel. The horizontal predictor is applied before compression.
+ * @param img the image (converted to Gray8, RGB888 or RGBA8888)
+ * @param device the output device
+ * @param preset the encoder preset (selects the zlib level)
+ * @return bool true if the image was written
+ **/
+bool DkImageEncoder::writeTiff(const QImage &img, QIODevice *device, int preset)
+{
+    if (img.isNull() || !device)
+        return false;
+
+    DkTimer dt;
+    QImage sImg;
+
+    if (img.format() == QImage::Format_Grayscale8 || (img.format() == QImage::Format_Indexed8 && img.isGrayscale()))
+        sImg = img.convertToFormat(QImage::Format_Grayscale8);
+    else if (img.hasAlphaChannel())
+        sImg = img.convertToFormat(QImage::Format_RGBA8888);
+    else
+        sImg = img.convertToFormat(QImage::Format_RGB888);
+
+    const int spp = sImg.depth() / 8;
+    const int rowBytes = sImg.width() * spp;
+    const int rowsPerStrip = qBound(1, tiffStripBytes / qMax(rowBytes, 1), sImg.height());
+    const int numStrips = (sImg.height() + rowsPerStrip - 1) / rowsPerStrip;
+    const int level = preset == preset_fast ? 1 : 9;
+
+    QVector<QByteArray> strips(numStrips);
+    QByteArray *stripData = strips.data();
+
+    QVector<int> stripIdx(numStrips);
+    std::iota(stripIdx.begin(), stripIdx.end(), 0);
+
+    QtConcurrent::blockingMap(stripIdx, [&](int &idx) {
+        int firstRow = idx * rowsPerStrip;
+        stripData[idx] = encodeStrip(sImg, firstRow, qMin(rowsPerStrip, sImg.height() - firstRow), level);
+    });
+
+    // layout: header | strips | IFD | values that do not fit into the IFD
+    QVector<quint32> offsets, counts;
+    quint32 offset = 8;
+
+    for (const QByteArray &s : strips) {
+        if (s.isEmpty())
+            return false;
+
+        offsets << offset;
+        counts << (quint32)s.size();
+        offset += (quint32)s.size();
+    }
+
+    quint32 ifdOffset = offset + (offset & 1); // word aligned
+
+    // resolution in dots per inch
+    quint32 dpmX = sImg.dotsPerMeterX() > 0 ? (quint32)sImg.dotsPerMeterX() : 2835;
+    quint32 dpmY = sImg.dotsPerMeterY() > 0 ? (quint32)sImg.dotsPerMeterY() : 2835;
+
+    QVector<TiffEntry> entries;
+    entries << tiffEntry(256, tiff_long, {(quint32)sImg.width()});
+    entries << tiffEntry(257, tiff_long, {(quint32)sImg.height()});
+    entries << tiffEntry(258, tiff_short, QVector<quint32>(spp, 8));
+    entries << tiffEntry(259, tiff_short, {8}); // adobe deflate
+    entries << tiffEntry(262, tiff_short, {spp < 3 ? 1u : 2u}); // black is zero : RGB
+    entries << tiffEntry(273, tiff_long, offsets);
+    entries << tiffEntry(277, tiff_short, {(quint32)spp});
+    entries << tiffEntry(278, tiff_long, {(quint32)rowsPerStrip});
+    entries << tiffEntry(279, tiff_long, counts);
+    entries << tiffEntry(282, tiff_rational, {dpmX * 254, 10000});
+    entries << tiffEntry(283, tiff_rational, {dpmY * 254, 10000});
+    entries << tiffEntry(284, tiff_short, {1}); // chunky
+    entries << tiffEntry(296, tiff_short, {2}); // inch
+    entries << tiffEntry(317, tiff_short, {2}); // horizontal differencing
+
+    if (spp == 4)
+        entries << tiffEntry(338, tiff_short, {2}); // unassociated alpha
+
+    QByteArray ifd;
+    QByteArray values;
+    quint32 valueOffset = ifdOffset + 2 + (quint32)entries.size() * 12 + 4;
+
+    putU16(ifd, (quint16)entries.size());
+
+    for (const TiffEntry &e : entries) {
+        putU16(ifd, e.tag);
+        putU16(ifd, e.type);
+        putU32(ifd, e.count);
+
+        if (e.data.size() <= 4) {
+            ifd.append(e.data);
+            ifd.append(QByteArray(4 - e.data.size(), '\0'));
+        } else {
+            putU32(ifd, valueOffset + (quint32)values.size());
+            values.append(e.data);
+            if (values.size() & 1)
+                values.append('\0');
+        }
+    }
+    putU32(ifd, 0); // no next IFD
+
+    QByteArray header("II");
+    putU16(header, 42);
+    putU32(header, ifdOffset);
+
+    bool written = device->write(header) == header.size();
+
+    for (const QByteArray &s : strips)
+        written = written && device->write(s) == s.size();
+
+    if (offset & 1)
+        written = written && device->write(QByteArray(1, '\0')) == 1;
+
+    written = written && device->write(ifd) == ifd.size();
+    written = written && device->write(values) == values.size();
+
+    qInfo() << "[DkImageEncoder] tiff with" << numStrips << "strips encoded in" << dt;
+
+    return written;
+}
+
+/**
+ * Compresses the rows [firstRow firstRow+numRows[ of img.
+ * @param img a Gray8, RGB888 or RGBA8888 image
+ * @param firstRow the first row of the strip
+ * @param numRows the number of rows
+ * @param compressionLevel the zlib level
+ * @return QByteArray the zlib stream of the strip
+ **/
+QByteArray DkImageEncoder::encodeStrip(const QImage &img, int firstRow, int numRows, int compressionLevel)
+{
+    const int spp = img.depth() / 8;
+    const int rowBytes = img.width() * spp;
+
+    QByteArray raw(rowBytes * numRows, Qt::Uninitialized);
+
+    for (int y = 0; y < numRows; y++) {
+        uchar *dst = reinterpret_cast<uchar *>(raw.data()) + y * rowBytes;
+        std::memcpy(dst, img.constScanLine(firstRow + y), rowBytes);
+
+        // predictor 2: each sample stores the difference to its left neighbor
+        for (int x = rowBytes - 1; x >= spp; x--)
+            dst[x] = (uchar)(dst[x] - dst[x - spp]);
+    }
+
+    // qCompress prepends the uncompressed size - the remainder is a zlib stream
+    return qCompress(raw, compressionLevel).mid(4);
+}
+
+}
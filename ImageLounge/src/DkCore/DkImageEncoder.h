@@ -0,0 +1,84 @@
+/*******************************************************************************************************
+ DkImageEncoder.h
+ Created on:	19.10.2026
+
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+
+ Copyright (C) 2011-2016 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2016 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2016 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ *******************************************************************************************************/
+
+#pragma once
+
+#pragma warning(push, 0) // no warnings from includes - begin
+#include <QImage>
+#include <QString>
+#pragma warning(pop) // no warnings from includes - end
+
+#pragma warning(disable : 4251) // TODO: remove
+
+#ifndef DllCoreExport
+#ifdef DK_CORE_DLL_EXPORT
+#define DllCoreExport Q_DECL_EXPORT
+#elif DK_DLL_IMPORT
+#define DllCoreExport Q_DECL_IMPORT
+#else
+#define DllCoreExport Q_DECL_IMPORT
+#endif
+#endif
+
+// Qt defines
+class QIODevice;
+class QImageWriter;
+
+namespace nmc
+{
+
+/**
+ * Encoder speed/size presets for the save path.
+ * QImageWriter only exposes a single compression knob, so the presets
+ * are mapped to the options each format plugin actually understands
+ * (zlib level for PNG, optimized/progressive Huffman tables for JPEG,
+ * LZW for TIFF). Large TIFF outputs are written by a strip encoder that
+ * deflates the strips in parallel.
+ **/
+class DllCoreExport DkImageEncoder
+{
+public:
+    enum Preset {
+        preset_default = 0, // Qt's defaults
+        preset_fast, // fastest encoding, larger files
+        preset_small, // smallest files, slower encoding
+
+        preset_end
+    };
+
+    static QString presetName(int preset);
+
+    static void applyPreset(QImageWriter &writer, int preset);
+
+    static bool isStripEncoderSupported(const QString &suffix, const QImage &img, int preset);
+    static bool writeTiff(const QImage &img, QIODevice *device, int preset);
+
+protected:
+    static QByteArray encodeStrip(const QImage &img, int firstRow, int numRows, int compressionLevel);
+};
+
+}
@@ -29,11 +29,13 @@
 
 #include "DkActionManager.h"
 #include "DkBasicLoader.h"
+#include "DkCacheManager.h"
 #include "DkDialog.h"
 #include "DkImageContainer.h"
 #include "DkImageStorage.h"
 #include "DkMessageBox.h"
 #include "DkMetaData.h"
+#include "DkMetaDataCatalog.h"
 #include "DkSaveDialog.h"
 #include "DkSettings.h"
 #include "DkStatusBar.h"
@@ -153,6 +155,9 @@ DkImageLoader::DkImageLoader(const QString &filePath)
     connect(DkActionManager::instance().action(DkActionManager::menu_view_gps_map), SIGNAL(triggered()), this, SLOT(showOnMap()));
     connect(DkActionManager::instance().action(DkActionManager::sc_delete_silent), SIGNAL(triggered()), this, SLOT(deleteFile()), Qt::UniqueConnection);
 
+    // all tabs share one memory budget
+    DkCacheManager::instance().addLoader(this);
+
     // saveDir = DkSettingsManager::param().global().lastSaveDir;	// loading save dir is obsolete ?!
 
     QFileInfo fInfo(filePath);
@@ -171,6 +176,8 @@ DkImageLoader::~DkImageLoader()
 {
     if (mCreateImageWatcher.isRunning())
         mCreateImageWatcher.blockSignals(true);
+
+    DkCacheManager::instance().removeLoader(this);
 }
 
 /**
@@ -200,7 +207,7 @@ void DkImageLoader::clearPath()
  **/
 bool DkImageLoader::loadZipArchive(const QString &zipPath)
 {
-    QStringList fileNameList = JlCompress::getFileList(zipPath);
+    QStringList fileNameList = DkZipArchive::archive(zipPath)->fileNames();
 
     // remove the * in fileFilters
     QStringList fileFiltersClean = DkSettingsManager::param().app().browseFilters;
@@ -288,6 +295,9 @@ bool DkImageLoader::loadDir(const QString &newDirPath, bool scanRecursive)
         // else
         createImages(files, true);
 
+        if (DkSettingsManager::param().resources().indexMetaData)
+            DkMetaDataCatalog::updateAsync(files);
+
         qDebug() << "getting file list.....";
     }
     // new folder is loaded
@@ -336,6 +346,10 @@ bool DkImageLoader::loadDir(const QString &newDirPath, bool scanRecursive)
         // else
         createImages(files, true);
 
+        // parse the metadata of all images in the background
+        if (DkSettingsManager::param().resources().indexMetaData)
+            DkMetaDataCatalog::updateAsync(files);
+
         qInfoClean() << newDirPath << " [" << mImages.size() << "] indexed in " << dt;
     }
     // else
@@ -366,6 +380,25 @@ void DkImageLoader::sortImagesThreaded(QVector<QSharedPointer<DkImageContainerT>
     qDebug() << "sorting images threaded...";
 }
 
+/**
+ * Filters the folder again if metadata was added to the catalog
+ * (see getFilteredFileInfoList).
+ **/
+void DkImageLoader::catalogUpdated()
+{
+    QFutureWatcher<int> *catalogWatcher = dynamic_cast<QFutureWatcher<int> *>(sender());
+
+    if (!catalogWatcher)
+        return;
+
+    if (catalogWatcher->result() > 0 && DkCatalogQuery::isQuery(mFolderFilterString)) {
+        mFolderUpdated = true;
+        loadDir(mCurrentDir, false);
+    }
+
+    catalogWatcher->deleteLater();
+}
+
 void DkImageLoader::imagesSorted()
 {
     mSortingImages = false;
@@ -687,6 +720,14 @@ QVector<QSharedPointer<DkImageContainerT>> DkImageLoader::getImages()
     return mImages;
 }
 
+/**
+ * Returns the images without (re)loading the current directory.
+ **/
+const QVector<QSharedPointer<DkImageContainerT>> &DkImageLoader::images() const
+{
+    return mImages;
+}
+
 void DkImageLoader::setImages(QVector<QSharedPointer<DkImageContainerT>> images)
 {
     mImages = images;
@@ -892,6 +933,9 @@ void DkImageLoader::load(QSharedPointer<DkImageContainerT> image /* = QSharedPoi
     if (!image)
         return;
 
+    DkTraceZone tz("DkImageLoader::load");
+    DkTracer::instance().addCounter(image->hasImage() ? "image cache hits" : "image cache misses");
+
 #ifdef WITH_QUAZIP
     bool isZipArchive = DkBasicLoader::isContainer(image->filePath());
 
@@ -904,18 +948,37 @@ void DkImageLoader::load(QSharedPointer<DkImageContainerT> image /* = QSharedPoi
 
     setCurrentImage(image);
 
-    if (mCurrentImage && mCurrentImage->getLoadState() == DkImageContainerT::loading)
+    // the image is prefetched already - show a preview until it's decoded
+    if (mCurrentImage && mCurrentImage->getLoadState() == DkImageContainerT::loading) {
+        mCurrentImage->fetchPreview();
         return;
+    }
 
     emit updateSpinnerSignalDelayed(true);
     bool loaded = mCurrentImage->loadImageThreaded(); // loads file threaded
 
     if (!loaded)
         emit updateSpinnerSignalDelayed(false);
+    else
+        mCurrentImage->fetchPreview();
 
     // if loaded is false, we definitively know that the file does not exist -> early exception here?
 }
 
+/**
+ * Forwards previews of the current image while it is loading.
+ * @param img the preview
+ * @param fullSize the size of the full resolution image (empty if unknown)
+ **/
+void DkImageLoader::previewLoaded(const QImage &img, const QSize &fullSize) const
+{
+    // previews are queued - drop them if the user switched images or the image is loaded
+    if (!mCurrentImage || sender() != mCurrentImage.data() || mCurrentImage->getLoadState() != DkImageContainerT::loading)
+        return;
+
+    emit imagePreviewSignal(mCurrentImage, img, fullSize);
+}
+
 void DkImageLoader::imageLoaded(bool loaded /* = false */)
 {
     emit updateSpinnerSignalDelayed(false);
@@ -1738,28 +1801,35 @@ void DkImageLoader::errorDialog(const QString &msg) const
 
 void DkImageLoader::updateCacher(QSharedPointer<DkImageContainerT> imgC)
 {
-    if (!imgC || !DkSettingsManager::param().resources().cacheMemory)
+    if (!imgC)
         return;
 
-    DkTimer dt;
+    DkCacheManager &cm = DkCacheManager::instance();
+    cm.touch(imgC);
 
-    //// no caching? delete all
-    // if (!DkSettingsManager::param().resources().cacheMemory) {
-    //	for (int idx = 0; idx < images.size(); idx++) {
-    //		images.at(idx)->clear();
-    //	}
-    //	return;
-    // }
+    if (!DkSettingsManager::param().resources().cacheMemory)
+        return;
+
+    DkTimer dt;
 
     int cIdx = findFileIdx(imgC->filePath(), mImages);
     double mem = 0;
-    double totalMem = 0;
 
     if (cIdx == -1) {
         qWarning() << "WARNING: image not found for caching!";
         return;
     }
 
+    // images we do not need anymore are evicted by the cache manager
+    // in LRU order across all tabs - so we only prefetch if there is room left
+    cm.enforce();
+    double room = cm.budget() - cm.usage();
+
+    // compressed buffers are small - so we look further ahead
+    int numCached = DkSettingsManager::param().resources().maxImagesCached;
+    int numFetched = numCached - 2;
+    int numCompressed = DkSettingsManager::param().resources().compressPrefetched ? numCached * 3 : numFetched;
+
     for (int idx = 0; idx < mImages.size(); idx++) {
         auto cImg = mImages.at(idx);
 
@@ -1769,36 +1839,31 @@ void DkImageLoader::updateCacher(QSharedPointer<DkImageContainerT> imgC)
             continue;
         }
 
-        // do not count the last & the current image
-        if (idx > cIdx && idx <= cIdx + DkSettingsManager::param().resources().maxImagesCached)
-            mem += cImg->getMemoryUsage();
-        else if (abs(cIdx - idx) > 1) {
-            cImg->clear();
-            if (cImg->hasImage())
-                qDebug() << "[Cacher]" << cImg->filePath() << "freed";
-
+        // only prefetch the next images
+        if (idx <= cIdx || idx > cIdx + qMax(numCached, numCompressed))
             continue;
-        } else
-            totalMem += cImg->getMemoryUsage();
 
-        // ignore the last and current one
-        if (idx == cIdx - 1 || idx == cIdx) {
+        mem += cImg->getMemoryUsage();
+
+        if (room <= 0 || cImg->getLoadState() != DkImageContainerT::not_loaded)
             continue;
-        }
+
         // fully load the next image
-        else if (idx == cIdx + 1 && mem < DkSettingsManager::param().resources().cacheMemory
-                 && mImages.at(idx)->getLoadState() == DkImageContainerT::not_loaded) {
+        if (idx == cIdx + 1) {
             cImg->loadImageThreaded();
             qDebug() << "[Cacher] " << cImg->filePath() << " fully cached...";
-        } else if (idx > cIdx && idx < cIdx + DkSettingsManager::param().resources().maxImagesCached - 2
-                   && mem < DkSettingsManager::param().resources().cacheMemory && mImages.at(idx)->getLoadState() == DkImageContainerT::not_loaded) {
-            // dt.getIvl();
-            mImages.at(idx)->fetchFile(); // TODO: crash detected here
+        } else if (idx < cIdx + numFetched || (idx < cIdx + numCompressed && DkImageContainer::isCompressible(cImg->filePath()))) {
+            cImg->fetchFile(); // TODO: crash detected here
             qDebug() << "[Cacher] " << cImg->filePath() << " file fetched...";
-        }
+        } else
+            continue;
+
+        // prefetched images are evicted after the ones we have seen already
+        cm.touch(cImg);
+        room -= cImg->getPrefetchSize();
     }
 
-    qDebug() << "[Cacher] created in" << dt << "(" << mem + totalMem << "MB)";
+    qDebug() << "[Cacher] created in" << dt << "(" << mem << "MB prefetched," << cm.usage() << "MB in all tabs)";
 }
 
 /**
@@ -1894,7 +1959,21 @@ QFileInfoList DkImageLoader::getFilteredFileInfoList(const QString &dirPath, QSt
         fileList = fileList.filter(keywords[idx], Qt::CaseInsensitive);
     }
 
-    if (folderKeywords != "") {
+    if (DkCatalogQuery::isQuery(folderKeywords)) {
+        // metadata queries (e.g. rating >= 4) are answered by the folder's catalog
+        QFileInfoList files;
+        for (const QString &name : fileList)
+            files << QFileInfo(dirPath, name);
+
+        // only indexed files are matched - the folder is filtered again once the catalog is updated
+        QFutureWatcher<int> *catalogWatcher = new QFutureWatcher<int>(this);
+        connect(catalogWatcher, SIGNAL(finished()), this, SLOT(catalogUpdated()));
+        catalogWatcher->setFuture(DkMetaDataCatalog::updateAsync(files));
+
+        fileList.clear();
+        for (const QString &filePath : DkMetaDataCatalog::query(files, DkCatalogQuery(folderKeywords)))
+            fileList << QFileInfo(filePath).fileName();
+    } else if (folderKeywords != "") {
         QStringList filterList = fileList;
         fileList = filterList.filter(folderKeywords, Qt::CaseInsensitive);
     }
@@ -100,6 +100,7 @@ public:
     QStringList getFileNames() const;
 
     QVector<QSharedPointer<DkImageContainerT>> getImages();
+    const QVector<QSharedPointer<DkImageContainerT>> &images() const;
     void setImages(QVector<QSharedPointer<DkImageContainerT>> images);
     QSharedPointer<DkImageContainerT> setImage(const QImage &img, const QString &editName, const QString &editFilePath = QString());
     QSharedPointer<DkImageContainerT> setImage(QSharedPointer<DkImageContainerT> img);
@@ -161,6 +162,7 @@ signals:
     void imageUpdatedSignal(QSharedPointer<DkImageContainerT> image) const;
     void imageUpdatedSignal(int idx) const; // folder scrollbar needs that
     void imageLoadedSignal(QSharedPointer<DkImageContainerT> image, bool loaded = true) const;
+    void imagePreviewSignal(QSharedPointer<DkImageContainerT> image, const QImage &preview, const QSize &fullSize) const;
     void showInfoSignal(const QString &msg, int time = 3000, int position = 0) const;
     void updateDirSignal(QVector<QSharedPointer<DkImageContainerT>> images) const;
     void imageHasGPSSignal(bool hasGPS) const;
@@ -194,8 +196,10 @@ public slots:
     // new slots
     void currentImageUpdated() const;
     void imageLoaded(bool loaded = false);
+    void previewLoaded(const QImage &img, const QSize &fullSize) const;
     void imageSaved(const QString &file, bool saved = true, bool loadToTab = true);
     void imagesSorted();
+    void catalogUpdated();
     bool unloadFile();
     void reloadImage();
     void showOnMap();
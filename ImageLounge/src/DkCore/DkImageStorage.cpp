@@ -27,6 +27,7 @@
 
 #include "DkImageStorage.h"
 #include "DkActionManager.h"
+#include "DkIconCache.h"
 #include "DkMath.h"
 #include "DkSettings.h"
 #include "DkThumbs.h"
@@ -35,6 +36,7 @@
 #pragma warning(push, 0) // no warnings from includes - begin
 #include <QBitmap>
 #include <QDebug>
+#include <QIconEngine>
 #include <QPainter>
 #include <QPixmap>
 #include <QSvgRenderer>
@@ -48,6 +50,53 @@
 #endif
 namespace nmc
 {
+/**
+ * Renders the svg icon the first time it is drawn.
+ * Icons of menus that are never opened are therefore not rasterized.
+ **/
+class DkDeferredIconEngine : public QIconEngine
+{
+public:
+    DkDeferredIconEngine(const QString &filePath)
+        : mFilePath(filePath)
+    {
+    }
+
+    void paint(QPainter *painter, const QRect &rect, QIcon::Mode mode, QIcon::State state) override
+    {
+        icon().paint(painter, rect, Qt::AlignCenter, mode, state);
+    }
+
+    QPixmap pixmap(const QSize &size, QIcon::Mode mode, QIcon::State state) override
+    {
+        return icon().pixmap(size, mode, state);
+    }
+
+    QSize actualSize(const QSize &size, QIcon::Mode mode, QIcon::State state) override
+    {
+        return icon().actualSize(size, mode, state);
+    }
+
+    QIconEngine *clone() const override
+    {
+        return new DkDeferredIconEngine(*this);
+    }
+
+private:
+    const QIcon &icon()
+    {
+        if (mIcon.isNull()) {
+            DkTraceZone tz("DkDeferredIconEngine::render");
+            mIcon = QIcon(DkImage::loadIcon(mFilePath));
+        }
+
+        return mIcon;
+    }
+
+    QString mFilePath;
+    QIcon mIcon;
+};
+
 // DkImage --------------------------------------------------------------------
 
 /**
@@ -1020,14 +1069,9 @@ QPixmap DkImage::loadIcon(const QString &filePath, const QSize &size, const QCol
         s = QSize(eis, eis);
     }
 
-    QPixmap icon = loadFromSvg(filePath, s);
-
     QColor c = (col.isValid()) ? col : DkSettingsManager::param().display().iconColor;
 
-    if (c.alpha() != 0)
-        icon = colorizePixmap(icon, c);
-
-    return icon;
+    return DkIconCache::instance().icon(filePath, s, c, c.alpha() != 0);
 }
 
 QPixmap DkImage::loadIcon(const QString &filePath, const QColor &col, const QSize &size)
@@ -1039,10 +1083,17 @@ QPixmap DkImage::loadIcon(const QString &filePath, const QColor &col, const QSiz
         is = QSize(s, s);
     }
 
-    QPixmap icon = loadFromSvg(filePath, is);
-    icon = colorizePixmap(icon, col);
+    return DkIconCache::instance().icon(filePath, is, col, true);
+}
 
-    return icon;
+/**
+ * Creates an icon that is rendered (see loadIcon) when it is shown first.
+ * @param filePath the svg's file path
+ * @return QIcon the icon
+ **/
+QIcon DkImage::loadDeferredIcon(const QString &filePath)
+{
+    return QIcon(new DkDeferredIconEngine(filePath));
 }
 
 QPixmap DkImage::loadFromSvg(const QString &filePath, const QSize &size)
@@ -1396,6 +1447,21 @@ QImage DkImage::createThumb(const QImage &image, int maxSize)
     return thumb;
 }
 
+/**
+ * Returns the format QPainter can blit without converting.
+ * @param img the source image
+ * @return QImage::Format premultiplied ARGB32 if img has an alpha channel, RGB32 otherwise
+ **/
+QImage::Format DkImage::displayFormat(const QImage &img)
+{
+    return img.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32;
+}
+
+bool DkImage::isDisplayFormat(const QImage &img)
+{
+    return img.format() == QImage::Format_ARGB32_Premultiplied || img.format() == QImage::Format_RGB32;
+}
+
 // NOTE: this is just for fun (all images in the world : )
 bool DkImage::addToImage(QImage &img, unsigned char val)
 {
@@ -1479,6 +1545,12 @@ QColor DkImage::getMeanColor(const QImage &img)
 }
 
 // DkImageStorage --------------------------------------------------------------------
+// zoom levels that are off by a pixel (rounding of the display rect) are reused
+static bool isSimilarSize(const QSize &s1, const QSize &s2)
+{
+    return qAbs(s1.width() - s2.width()) <= 1 && qAbs(s1.height() - s2.height()) <= 1;
+}
+
 DkImageStorage::DkImageStorage(const QImage &img)
 {
     mImg = img;
@@ -1491,6 +1563,7 @@ DkImageStorage::DkImageStorage(const QImage &img)
 
     connect(mWaitTimer, SIGNAL(timeout()), this, SLOT(compute()), Qt::UniqueConnection);
     connect(&mFutureWatcher, SIGNAL(finished()), this, SLOT(imageComputed()), Qt::UniqueConnection);
+    connect(&mConvertWatcher, SIGNAL(finished()), this, SLOT(imageConverted()), Qt::UniqueConnection);
     connect(DkActionManager::instance().action(DkActionManager::menu_view_anti_aliasing),
             SIGNAL(toggled(bool)),
             this,
@@ -1510,16 +1583,73 @@ void DkImageStorage::setImage(const QImage &img)
 {
     init();
     mImg = img;
+    mFullSize = QSize();
+    mPixmapCache.clear();
 
     mComputeState = l_cancelled;
+
+    // convert once (in the background) so that painting never converts on the fly
+    if (mImg.isNull() || DkImage::isDisplayFormat(mImg)) {
+        mDisplayImg = mImg;
+    } else {
+        mDisplayImg = QImage();
+        mConvertWatcher.setFuture(QtConcurrent::run([img] {
+            DkTraceZone tz("DkImageStorage::convertToDisplayFormat");
+            return img.convertToFormat(DkImage::displayFormat(img));
+        }));
+    }
+}
+
+/**
+ * Sets a reduced preview of an image that is still loading.
+ * size() reports the size of the full image, hence the preview
+ * is painted with the geometry of the full resolution image.
+ * @param img the preview
+ * @param fullSize the size of the full resolution image
+ **/
+void DkImageStorage::setPreview(const QImage &img, const QSize &fullSize)
+{
+    setImage(img);
+    mFullSize = fullSize.isEmpty() ? img.size() : fullSize;
+}
+
+/**
+ * Sets a downsampled version of the image that was computed ahead of time (see scaleToDisplay).
+ * It is used as zoom level if the display size matches.
+ * @param img the downsampled image
+ **/
+void DkImageStorage::setScaledImage(const QImage &img)
+{
+    if (img.isNull() || mImg.isNull() || img.width() >= mImg.width())
+        return;
+
+    mWaitTimer->stop();
+    mScaledImg = img;
+    mSize = img.size();
+    mComputeState = l_computed;
+    cachePixmap(img);
+}
+
+void DkImageStorage::imageConverted()
+{
+    QImage img = mConvertWatcher.result();
+
+    // the image was replaced while we were converting
+    if (img.size() != mImg.size() || !mDisplayImg.isNull())
+        return;
+
+    mDisplayImg = img;
+    emit imageUpdated();
 }
 
 void DkImageStorage::antiAliasingChanged(bool antiAliasing)
 {
     DkSettingsManager::param().display().antiAliasing = antiAliasing;
 
-    if (!antiAliasing)
+    if (!antiAliasing) {
         init();
+        mPixmapCache.clear();
+    }
 
     emit infoSignal((antiAliasing) ? tr("Anti Aliasing Enabled") : tr("Anti Aliasing Disabled"));
     emit imageUpdated();
@@ -1537,7 +1667,7 @@ QImage DkImageStorage::image(const QSize &size)
     )
         return mImg;
 
-    if (mScaledImg.size() == size)
+    if (!mScaledImg.isNull() && isSimilarSize(mScaledImg.size(), size))
         return mScaledImg;
 
     if (mComputeState != l_computing) {
@@ -1551,6 +1681,58 @@ QImage DkImageStorage::image(const QSize &size)
     return mImg;
 }
 
+/**
+ * Returns the image in a format that can be painted without conversion.
+ * While the background conversion is running, the original image is returned.
+ * @param size the target size (see image())
+ * @return QImage the display image
+ **/
+QImage DkImageStorage::displayImage(const QSize &size)
+{
+    QImage img = image(size);
+
+    if (img.cacheKey() == mImg.cacheKey() && !mDisplayImg.isNull())
+        return mDisplayImg;
+
+    return img;
+}
+
+/**
+ * Returns a cached pixmap of the zoom level size.
+ * If the level is not cached yet, its computation is triggered and a null pixmap is returned.
+ * @param size the target size
+ * @return QPixmap the cached pixmap or a null pixmap
+ **/
+QPixmap DkImageStorage::pixmap(const QSize &size)
+{
+    if (size.isEmpty() || mImg.isNull())
+        return QPixmap();
+
+    for (int idx = 0; idx < mPixmapCache.size(); idx++) {
+        if (isSimilarSize(mPixmapCache[idx].size(), size)) {
+            if (idx > 0)
+                mPixmapCache.move(idx, 0);
+            return mPixmapCache.first();
+        }
+    }
+
+    // schedule the level (if needed)
+    image(size);
+
+    return QPixmap();
+}
+
+void DkImageStorage::cachePixmap(const QImage &img)
+{
+    if (img.isNull())
+        return;
+
+    mPixmapCache.prepend(QPixmap::fromImage(img));
+
+    while (mPixmapCache.size() > mMaxCachedLevels)
+        mPixmapCache.removeLast();
+}
+
 void DkImageStorage::cancel()
 {
     mComputeState = l_cancelled;
@@ -1558,6 +1740,8 @@ void DkImageStorage::cancel()
 
 void DkImageStorage::compute()
 {
+    DkTraceZone tz("DkImageStorage::compute");
+
     if (mComputeState == l_computed) {
         emit imageUpdated();
         qDebug() << "image is up-to-date in DkImageStorage::compute...";
@@ -1569,16 +1753,30 @@ void DkImageStorage::compute()
 
     mComputeState = l_computing;
 
-    mFutureWatcher.setFuture(QtConcurrent::run([&] {
-        return computeIntern(mImg, mSize);
+    QImage img = mImg;
+    QSize size = mSize;
+    mComputeKey = img.cacheKey();
+
+    mFutureWatcher.setFuture(QtConcurrent::run([img, size] {
+        return scaleToDisplay(img, size);
     }));
 }
 
-QImage DkImageStorage::computeIntern(const QImage &src, const QSize &size)
+/**
+ * Downsamples the image to the size it is displayed with.
+ * The result is converted to the native paint format.
+ * It is thread-safe, hence zoom levels can be computed ahead of time (e.g. for slide shows).
+ * @param src the image
+ * @param size the display size
+ * @return QImage the downsampled image
+ **/
+QImage DkImageStorage::scaleToDisplay(const QImage &src, const QSize &size)
 {
+    DkTraceZone tz("DkImageStorage::scaleToDisplay");
+
     // should not happen
-    if (size.width() >= mImg.width()) {
-        qWarning() << "DkImageStorage::computeIntern was called without a need...";
+    if (size.width() >= src.width()) {
+        qWarning() << "DkImageStorage::scaleToDisplay was called without a need...";
         return src;
     }
 
@@ -1594,12 +1792,12 @@ QImage DkImageStorage::computeIntern(const QImage &src, const QSize &size)
         }
 
         // for extreme panorama images the Qt scaling crashes (if we have a width > 30000) so we simply
-        if (cs != mImg.size()) {
+        if (cs != src.size()) {
             resizedImg = resizedImg.scaled(cs, Qt::KeepAspectRatio, Qt::FastTransformation);
         }
     }
 
-    QSize s = mSize;
+    QSize s = size;
 
     if (s.height() == 0)
         s.setHeight(1);
@@ -1619,6 +1817,10 @@ QImage DkImageStorage::computeIntern(const QImage &src, const QSize &size)
     resizedImg = resizedImg.scaled(s, Qt::KeepAspectRatio, Qt::SmoothTransformation);
 #endif
 
+    // convert here so that the GUI thread gets a blittable image
+    if (!DkImage::isDisplayFormat(resizedImg))
+        resizedImg = resizedImg.convertToFormat(DkImage::displayFormat(resizedImg));
+
     return resizedImg;
 }
 
@@ -1629,12 +1831,18 @@ void DkImageStorage::imageComputed()
         return;
     }
 
+    // the job belongs to a previous image (e.g. setScaledImage() was called meanwhile)
+    if (mComputeKey != mImg.cacheKey() || !mFutureWatcher.isFinished())
+        return;
+
     mScaledImg = mFutureWatcher.result();
 
     mComputeState = (mScaledImg.isNull()) ? l_empty : l_computed;
 
-    if (mComputeState == l_computed)
+    if (mComputeState == l_computed) {
+        cachePixmap(mScaledImg);
         emit imageUpdated();
+    }
     else
         qWarning() << "could not compute interpolated image...";
 }
@@ -30,8 +30,10 @@
 #pragma warning(push, 0) // no warnings from includes - begin
 #include <QColor>
 #include <QFutureWatcher>
+#include <QIcon>
 #include <QImage>
 #include <QObject>
+#include <QPixmap>
 #include <QVector>
 
 // opencv
@@ -62,7 +64,6 @@
 #endif
 
 // Qt defines
-class QPixmap;
 class QString;
 class QSize;
 class QColor;
@@ -118,8 +119,11 @@ public:
     static QPixmap colorizePixmap(const QPixmap &icon, const QColor &col, float opacity = 1.0f);
     static QPixmap loadIcon(const QString &filePath = QString(), const QSize &size = QSize(), const QColor &col = QColor());
     static QPixmap loadIcon(const QString &filePath, const QColor &col, const QSize &size = QSize());
+    static QIcon loadDeferredIcon(const QString &filePath);
     static QPixmap loadFromSvg(const QString &filePath, const QSize &size);
     static QImage createThumb(const QImage &img, const int maxSize = -1);
+    static QImage::Format displayFormat(const QImage &img);
+    static bool isDisplayFormat(const QImage &img);
     static bool addToImage(QImage &img, unsigned char val = 1);
     static QColor getMeanColor(const QImage &img);
     static uchar findHistPeak(const int *hist, float quantile = 0.005f);
@@ -168,17 +172,29 @@ public:
 
     QSize size() const
     {
-        return mImg.size();
+        return isPreview() ? mFullSize : mImg.size();
+    };
+
+    bool isPreview() const
+    {
+        return !mFullSize.isEmpty();
     };
 
     void setImage(const QImage &img);
+    void setPreview(const QImage &img, const QSize &fullSize);
+    void setScaledImage(const QImage &img);
     QImage imageConst() const;
     QImage image(const QSize &size = QSize());
+    QImage displayImage(const QSize &size = QSize());
+    QPixmap pixmap(const QSize &size);
     void cancel();
 
+    static QImage scaleToDisplay(const QImage &src, const QSize &size);
+
 public slots:
     void antiAliasingChanged(bool antiAliasing);
     void imageComputed();
+    void imageConverted();
     void compute();
 
 signals:
@@ -187,15 +203,23 @@ signals:
 
 protected:
     QImage mImg;
+    QImage mDisplayImg; // mImg converted to the native paint format
     QImage mScaledImg;
     QSize mSize;
+    QSize mFullSize; // size of the full image if mImg is a preview
+
+    // display ready pixmaps of recently computed zoom levels (most recent first)
+    QList<QPixmap> mPixmapCache;
+    int mMaxCachedLevels = 4;
 
     QTimer *mWaitTimer = 0;
     QFutureWatcher<QImage> mFutureWatcher;
+    QFutureWatcher<QImage> mConvertWatcher;
 
     ComputeState mComputeState = l_not_computed;
+    qint64 mComputeKey = 0; // cache key of the image that is downsampled in the background
 
-    QImage computeIntern(const QImage &src, const QSize &size);
+    void cachePixmap(const QImage &img);
     void init();
 };
 //
@@ -0,0 +1,1407 @@
+/*******************************************************************************************************
+ DkJpegTransform.cpp
+ Created on:	19.10.2026
+
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+
+ Copyright (C) 2011-2016 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2016 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2016 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ *******************************************************************************************************/
+
+#include "DkJpegTransform.h"
+#include "DkTimer.h"
+
+#pragma warning(push, 0) // no warnings from includes - begin
+#include <QDebug>
+#include <QTransform>
+#pragma warning(pop) // no warnings from includes - end
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace nmc
+{
+
+// jpeg codec --------------------------------------------------------------------
+namespace
+{
+
+// zig-zag index -> natural (row major) index
+const int jpegNatural[64] = {0,  1,  8,  16, 9,  2,  3,  10, 17, 24, 32, 25, 18, 11, 4,  5,  12, 19, 26, 33, 40, 48,
+                             41, 34, 27, 20, 13, 6,  7,  14, 21, 28, 35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23,
+                             30, 37, 44, 51, 58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63};
+
+struct JpegTransformParams {
+    bool transpose = false;
+    bool flipX = false;
+    bool flipY = false;
+
+    bool crop = false;
+    bool cropCenter = false;
+    int cropX = 0;
+    int cropY = 0;
+    int cropWidth = 0;
+    int cropHeight = 0;
+};
+
+struct JpegComponent {
+    int id = 0;
+    int h = 1;
+    int v = 1;
+    int tq = 0;
+
+    // scan tables
+    int td = 0;
+    int ta = 0;
+
+    // block grid (padded to full MCUs)
+    int bw = 0;
+    int bh = 0;
+    std::vector<int16_t> coefs;
+
+    int16_t *block(int bx, int by)
+    {
+        return &coefs[((size_t)by * bw + bx) * 64];
+    }
+};
+
+struct JpegHuffmanTable {
+    bool defined = false;
+    uint8_t bits[17] = {0};
+    std::vector<uint8_t> values;
+
+    // decoding
+    int maxCode[18] = {0};
+    int valOffset[18] = {0};
+    int lookup[256] = {0}; // (length << 8) | value for codes with <= 8 bits
+
+    // encoding
+    uint16_t code[256] = {0};
+    uint8_t size[256] = {0};
+
+    bool init()
+    {
+        int numCodes = 0;
+        for (int l = 1; l <= 16; l++)
+            numCodes += bits[l];
+
+        if (numCodes > 256 || numCodes > (int)values.size())
+            return false;
+
+        std::vector<int> huffCode(numCodes);
+        std::vector<int> huffSize(numCodes);
+
+        int k = 0;
+        int c = 0;
+        for (int l = 1; l <= 16; l++) {
+            for (int i = 0; i < bits[l]; i++) {
+                huffCode[k] = c++;
+                huffSize[k] = l;
+                k++;
+            }
+
+            if (c > (1 << l))
+                return false; // over-subscribed
+            c <<= 1;
+        }
+
+        int p = 0;
+        for (int l = 1; l <= 16; l++) {
+            if (bits[l]) {
+                valOffset[l] = p - huffCode[p];
+                p += bits[l];
+                maxCode[l] = huffCode[p - 1];
+            } else
+                maxCode[l] = -1;
+        }
+        maxCode[17] = 0xfffff; // sentinel
+
+        std::memset(lookup, 0, sizeof(lookup));
+        std::memset(size, 0, sizeof(size));
+        for (int idx = 0; idx < numCodes; idx++) {
+            int l = huffSize[idx];
+            uint8_t val = values[idx];
+
+            code[val] = (uint16_t)huffCode[idx];
+            size[val] = (uint8_t)l;
+
+            if (l <= 8) {
+                int first = huffCode[idx] << (8 - l);
+                for (int j = 0; j < (1 << (8 - l)); j++)
+                    lookup[first + j] = (l << 8) | val;
+            }
+        }
+
+        defined = true;
+        return true;
+    }
+
+    // Annex K.2 & K.3 of the JPEG standard (see also jpeg_gen_optimal_table)
+    void createOptimal(const long freqIn[256])
+    {
+        long freq[257];
+        int codeSize[257];
+        int others[257];
+
+        for (int idx = 0; idx < 256; idx++)
+            freq[idx] = freqIn[idx];
+        freq[256] = 1; // reserve one code point so that no code is all ones
+
+        for (int idx = 0; idx < 257; idx++) {
+            codeSize[idx] = 0;
+            others[idx] = -1;
+        }
+
+        for (;;) {
+            int c1 = -1;
+            long v = 1000000000L;
+            for (int i = 0; i <= 256; i++) {
+                if (freq[i] && freq[i] <= v) {
+                    v = freq[i];
+                    c1 = i;
+                }
+            }
+
+            int c2 = -1;
+            v = 1000000000L;
+            for (int i = 0; i <= 256; i++) {
+                if (freq[i] && freq[i] <= v && i != c1) {
+                    v = freq[i];
+                    c2 = i;
+                }
+            }
+
+            if (c2 < 0)
+                break;
+
+            freq[c1] += freq[c2];
+            freq[c2] = 0;
+
+            codeSize[c1]++;
+            while (others[c1] >= 0) {
+                c1 = others[c1];
+                codeSize[c1]++;
+            }
+            others[c1] = c2;
+
+            codeSize[c2]++;
+            while (others[c2] >= 0) {
+                c2 = others[c2];
+                codeSize[c2]++;
+            }
+        }
+
+        int lengths[33] = {0};
+        for (int i = 0; i <= 256; i++) {
+            if (codeSize[i])
+                lengths[qMin(codeSize[i], 32)]++;
+        }
+
+        // limit code lengths to 16 bits
+        for (int i = 32; i > 16; i--) {
+            while (lengths[i] > 0) {
+                int j = i - 2;
+                while (lengths[j] == 0)
+                    j--;
+
+                lengths[i] -= 2;
+                lengths[i - 1]++;
+                lengths[j + 1] += 2;
+                lengths[j]--;
+            }
+        }
+
+        // remove the reserved code point
+        int i = 16;
+        while (lengths[i] == 0)
+            i--;
+        lengths[i]--;
+
+        for (int l = 0; l <= 16; l++)
+            bits[l] = (uint8_t)(l ? lengths[l] : 0);
+
+        values.clear();
+        for (int l = 1; l <= 32; l++) {
+            for (int j = 0; j < 256; j++) {
+                if (codeSize[j] == l)
+                    values.push_back((uint8_t)j);
+            }
+        }
+
+        init();
+    }
+};
+
+class JpegBitReader
+{
+public:
+    JpegBitReader(const uint8_t *data, size_t size, size_t pos)
+        : mData(data)
+        , mSize(size)
+        , mPos(pos)
+    {
+    }
+
+    int get(int n)
+    {
+        if (n == 0)
+            return 0;
+
+        int v = peek(n);
+        skip(n);
+        return v;
+    }
+
+    int peek(int n)
+    {
+        fill();
+        return (int)(mAcc >> (32 - n));
+    }
+
+    void skip(int n)
+    {
+        mAcc <<= n;
+        mBits -= n;
+    }
+
+    int decode(const JpegHuffmanTable &table)
+    {
+        int e = table.lookup[peek(8)];
+        if (e) {
+            skip(e >> 8);
+            return e & 0xff;
+        }
+
+        for (int l = 9; l <= 16; l++) {
+            int c = peek(l);
+            if (c <= table.maxCode[l]) {
+                skip(l);
+                int idx = c + table.valOffset[l];
+                return (idx >= 0 && idx < (int)table.values.size()) ? table.values[idx] : -1;
+            }
+        }
+
+        return -1; // corrupt data
+    }
+
+    // skips to the data following the next RSTn marker
+    bool restart()
+    {
+        mAcc = 0;
+        mBits = 0;
+        mMarker = false;
+
+        while (mPos + 1 < mSize) {
+            if (mData[mPos] == 0xff && mData[mPos + 1] >= 0xd0 && mData[mPos + 1] <= 0xd7) {
+                mPos += 2;
+                return true;
+            }
+            mPos++;
+        }
+
+        return false;
+    }
+
+    // position of the marker that terminates the entropy coded segment
+    size_t markerPos() const
+    {
+        size_t p = mPos;
+        while (p + 1 < mSize) {
+            if (mData[p] == 0xff && mData[p + 1] != 0 && !(mData[p + 1] >= 0xd0 && mData[p + 1] <= 0xd7))
+                return p;
+            p++;
+        }
+
+        return mSize;
+    }
+
+private:
+    void fill()
+    {
+        while (mBits <= 24) {
+            uint32_t b = 0;
+
+            if (!mMarker && mPos < mSize) {
+                b = mData[mPos];
+
+                if (b == 0xff) {
+                    uint8_t next = mPos + 1 < mSize ? mData[mPos + 1] : 0xd9;
+                    if (next == 0)
+                        mPos += 2; // stuffed byte
+                    else {
+                        mMarker = true; // stop in front of markers & feed zeros
+                        b = 0;
+                    }
+                } else
+                    mPos++;
+            }
+
+            mAcc |= b << (24 - mBits);
+            mBits += 8;
+        }
+    }
+
+    const uint8_t *mData;
+    size_t mSize;
+    size_t mPos;
+    uint32_t mAcc = 0;
+    int mBits = 0;
+    bool mMarker = false;
+};
+
+class JpegBitWriter
+{
+public:
+    JpegBitWriter(std::vector<uint8_t> &out)
+        : mOut(out)
+    {
+    }
+
+    void put(uint32_t code, int size)
+    {
+        mAcc = (mAcc << size) | (code & ((1u << size) - 1));
+        mBits += size;
+
+        while (mBits >= 8) {
+            uint8_t b = (uint8_t)(mAcc >> (mBits - 8));
+            mOut.push_back(b);
+            if (b == 0xff)
+                mOut.push_back(0);
+            mBits -= 8;
+        }
+    }
+
+    void flush()
+    {
+        if (mBits > 0)
+            put(0x7f, 8 - mBits); // pad with ones
+    }
+
+private:
+    std::vector<uint8_t> &mOut;
+    uint64_t mAcc = 0;
+    int mBits = 0;
+};
+
+inline int jpegNumBits(int v)
+{
+    // number of bits of the magnitude (the JPEG category)
+    static const struct Table {
+        uint8_t bits[256];
+        Table()
+        {
+            bits[0] = 0;
+            for (int idx = 1; idx < 256; idx++)
+                bits[idx] = bits[idx >> 1] + 1;
+        }
+    } table;
+
+    v = v < 0 ? -v : v;
+    return v < 256 ? table.bits[v] : (v < 65536 ? 8 + table.bits[(v >> 8) & 0xff] : 16);
+}
+
+inline uint16_t jpegRead16(const uint8_t *p)
+{
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+inline void jpegWrite16(std::vector<uint8_t> &out, int v)
+{
+    out.push_back((uint8_t)(v >> 8));
+    out.push_back((uint8_t)(v & 0xff));
+}
+
+class JpegCoefficientCodec
+{
+public:
+    bool read(const uint8_t *data, size_t size, std::string &error);
+    bool transform(const JpegTransformParams &params, std::string &error);
+    void write(std::vector<uint8_t> &out);
+
+private:
+    bool readFrame(const uint8_t *seg, int len, std::string &error);
+    bool readHuffmanTables(const uint8_t *seg, int len, std::string &error);
+    bool readQuantTables(const uint8_t *seg, int len, std::string &error);
+    bool readScan(const uint8_t *seg, int len, const uint8_t *data, size_t size, size_t &pos, std::string &error);
+    bool decodeBlock(JpegBitReader &br, JpegComponent &c, int16_t *blk, int &pred);
+
+    void setupGrid();
+    int validBlocksX(const JpegComponent &c) const;
+    int validBlocksY(const JpegComponent &c) const;
+
+    template <typename BlockFunc>
+    void forEachBlock(const std::vector<int> &scan, BlockFunc func);
+    std::vector<std::vector<int>> outputScans() const;
+
+    std::vector<std::vector<uint8_t>> mSegments; // APPn & COM segments (verbatim)
+    std::vector<JpegComponent> mComponents;
+    uint16_t mQuant[4][64];
+    int mQuantPrecision[4] = {0};
+    bool mQuantDefined[4] = {false};
+    JpegHuffmanTable mDc[4];
+    JpegHuffmanTable mAc[4];
+
+    int mSofMarker = 0xc0;
+    int mWidth = 0;
+    int mHeight = 0;
+    int mHMax = 1;
+    int mVMax = 1;
+    int mMcusX = 0;
+    int mMcusY = 0;
+    int mRestartInterval = 0;
+    bool mHasFrame = false;
+};
+
+bool JpegCoefficientCodec::read(const uint8_t *data, size_t size, std::string &error)
+{
+    if (size < 4 || data[0] != 0xff || data[1] != 0xd8) {
+        error = "not a JPEG";
+        return false;
+    }
+
+    size_t pos = 2;
+    int numScans = 0;
+
+    while (pos + 1 < size) {
+        if (data[pos] != 0xff) {
+            error = "corrupt marker";
+            return false;
+        }
+
+        int marker = data[pos + 1];
+        pos += 2;
+
+        if (marker == 0xff) { // fill byte
+            pos--;
+            continue;
+        }
+        if (marker == 0xd9) // EOI
+            break;
+        if (marker == 0x01 || (marker >= 0xd0 && marker <= 0xd7))
+            continue;
+
+        if (pos + 2 > size) {
+            error = "truncated segment";
+            return false;
+        }
+
+        int len = jpegRead16(data + pos);
+        if (len < 2 || pos + len > size) {
+            error = "truncated segment";
+            return false;
+        }
+
+        const uint8_t *seg = data + pos + 2;
+        int segLen = len - 2;
+
+        switch (marker) {
+        case 0xc0: // baseline
+        case 0xc1: // extended sequential
+            mSofMarker = marker;
+            if (!readFrame(seg, segLen, error))
+                return false;
+            break;
+        case 0xc4:
+            if (!readHuffmanTables(seg, segLen, error))
+                return false;
+            break;
+        case 0xdb:
+            if (!readQuantTables(seg, segLen, error))
+                return false;
+            break;
+        case 0xdd:
+            if (segLen < 2) {
+                error = "corrupt DRI";
+                return false;
+            }
+            mRestartInterval = jpegRead16(seg);
+            break;
+        case 0xda: {
+            if (!mHasFrame) {
+                error = "scan before frame header";
+                return false;
+            }
+
+            pos += len;
+            if (!readScan(seg, segLen, data, size, pos, error))
+                return false;
+            numScans++;
+            continue;
+        }
+        default:
+            if ((marker >= 0xe0 && marker <= 0xef) || marker == 0xfe) {
+                mSegments.push_back(std::vector<uint8_t>(data + pos - 2, data + pos + len));
+            } else if (marker >= 0xc0 && marker <= 0xcf) {
+                error = "only baseline and sequential Huffman JPEGs are supported";
+                return false;
+            }
+            // other markers (e.g. DHP, EXP) are dropped
+        }
+
+        pos += len;
+    }
+
+    if (!mHasFrame || numScans == 0) {
+        error = "no image data found";
+        return false;
+    }
+
+    return true;
+}
+
+bool JpegCoefficientCodec::readFrame(const uint8_t *seg, int len, std::string &error)
+{
+    if (mHasFrame || len < 6) {
+        error = "corrupt frame header";
+        return false;
+    }
+
+    int precision = seg[0];
+    mHeight = jpegRead16(seg + 1);
+    mWidth = jpegRead16(seg + 3);
+    int nc = seg[5];
+
+    if (precision != 8) {
+        error = "only 8 bit JPEGs are supported";
+        return false;
+    }
+
+    if (mWidth == 0 || mHeight == 0 || nc < 1 || nc > 4 || len < 6 + 3 * nc) {
+        error = "corrupt frame header";
+        return false;
+    }
+
+    for (int idx = 0; idx < nc; idx++) {
+        JpegComponent c;
+        c.id = seg[6 + idx * 3];
+        c.h = seg[7 + idx * 3] >> 4;
+        c.v = seg[7 + idx * 3] & 15;
+        c.tq = seg[8 + idx * 3];
+
+        if (c.h < 1 || c.h > 4 || c.v < 1 || c.v > 4 || c.tq > 3) {
+            error = "corrupt frame header";
+            return false;
+        }
+
+        mComponents.push_back(c);
+    }
+
+    // single component images are never interleaved
+    if (nc == 1) {
+        mComponents[0].h = 1;
+        mComponents[0].v = 1;
+    }
+
+    setupGrid();
+
+    for (JpegComponent &c : mComponents)
+        c.coefs.assign((size_t)c.bw * c.bh * 64, 0);
+
+    mHasFrame = true;
+    return true;
+}
+
+void JpegCoefficientCodec::setupGrid()
+{
+    mHMax = 1;
+    mVMax = 1;
+
+    for (const JpegComponent &c : mComponents) {
+        mHMax = qMax(mHMax, c.h);
+        mVMax = qMax(mVMax, c.v);
+    }
+
+    mMcusX = (mWidth + 8 * mHMax - 1) / (8 * mHMax);
+    mMcusY = (mHeight + 8 * mVMax - 1) / (8 * mVMax);
+
+    for (JpegComponent &c : mComponents) {
+        c.bw = mMcusX * c.h;
+        c.bh = mMcusY * c.v;
+    }
+}
+
+int JpegCoefficientCodec::validBlocksX(const JpegComponent &c) const
+{
+    int w = (mWidth * c.h + mHMax - 1) / mHMax;
+    return (w + 7) / 8;
+}
+
+int JpegCoefficientCodec::validBlocksY(const JpegComponent &c) const
+{
+    int h = (mHeight * c.v + mVMax - 1) / mVMax;
+    return (h + 7) / 8;
+}
+
+bool JpegCoefficientCodec::readHuffmanTables(const uint8_t *seg, int len, std::string &error)
+{
+    int p = 0;
+
+    while (p < len) {
+        if (p + 17 > len) {
+            error = "corrupt Huffman table";
+            return false;
+        }
+
+        int tc = seg[p] >> 4;
+        int th = seg[p] & 15;
+        if (tc > 1 || th > 3) {
+            error = "corrupt Huffman table";
+            return false;
+        }
+
+        JpegHuffmanTable &t = tc == 0 ? mDc[th] : mAc[th];
+        int numValues = 0;
+        t.bits[0] = 0;
+        for (int l = 1; l <= 16; l++) {
+            t.bits[l] = seg[p + l];
+            numValues += t.bits[l];
+        }
+        p += 17;
+
+        if (p + numValues > len) {
+            error = "corrupt Huffman table";
+            return false;
+        }
+
+        t.values.assign(seg + p, seg + p + numValues);
+        p += numValues;
+
+        if (!t.init()) {
+            error = "corrupt Huffman table";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool JpegCoefficientCodec::readQuantTables(const uint8_t *seg, int len, std::string &error)
+{
+    int p = 0;
+
+    while (p < len) {
+        int pq = seg[p] >> 4;
+        int tq = seg[p] & 15;
+        int n = pq ? 128 : 64;
+
+        if (tq > 3 || pq > 1 || p + 1 + n > len) {
+            error = "corrupt quantization table";
+            return false;
+        }
+
+        for (int k = 0; k < 64; k++)
+            mQuant[tq][jpegNatural[k]] = pq ? jpegRead16(seg + p + 1 + 2 * k) : seg[p + 1 + k];
+
+        mQuantPrecision[tq] = pq;
+        mQuantDefined[tq] = true;
+        p += 1 + n;
+    }
+
+    return true;
+}
+
+bool JpegCoefficientCodec::decodeBlock(JpegBitReader &br, JpegComponent &c, int16_t *blk, int &pred)
+{
+    const JpegHuffmanTable &dc = mDc[c.td];
+    const JpegHuffmanTable &ac = mAc[c.ta];
+
+    int s = br.decode(dc);
+    if (s < 0 || s > 11)
+        return false;
+
+    int diff = br.get(s);
+    if (s && diff < (1 << (s - 1)))
+        diff += -(1 << s) + 1;
+
+    pred += diff;
+    blk[0] = (int16_t)pred;
+
+    for (int k = 1; k < 64;) {
+        int rs = br.decode(ac);
+        if (rs < 0)
+            return false;
+
+        int r = rs >> 4;
+        s = rs & 15;
+
+        if (s == 0) {
+            if (r != 15)
+                break; // EOB
+            k += 16;
+            continue;
+        }
+
+        k += r;
+        if (k > 63)
+            return false;
+
+        int v = br.get(s);
+        if (v < (1 << (s - 1)))
+            v += -(1 << s) + 1;
+
+        blk[jpegNatural[k]] = (int16_t)v;
+        k++;
+    }
+
+    return true;
+}
+
+bool JpegCoefficientCodec::readScan(const uint8_t *seg, int len, const uint8_t *data, size_t size, size_t &pos, std::string &error)
+{
+    if (len < 1) {
+        error = "corrupt scan header";
+        return false;
+    }
+
+    int ns = seg[0];
+    if (ns < 1 || ns > 4 || len < 4 + 2 * ns) {
+        error = "corrupt scan header";
+        return false;
+    }
+
+    std::vector<int> scan;
+    for (int idx = 0; idx < ns; idx++) {
+        int id = seg[1 + idx * 2];
+        int cIdx = -1;
+
+        for (int ci = 0; ci < (int)mComponents.size(); ci++) {
+            if (mComponents[ci].id == id)
+                cIdx = ci;
+        }
+
+        if (cIdx < 0) {
+            error = "unknown component in scan";
+            return false;
+        }
+
+        JpegComponent &c = mComponents[cIdx];
+        c.td = seg[2 + idx * 2] >> 4;
+        c.ta = seg[2 + idx * 2] & 15;
+
+        if (c.td > 3 || c.ta > 3 || !mDc[c.td].defined || !mAc[c.ta].defined) {
+            error = "missing Huffman table";
+            return false;
+        }
+
+        scan.push_back(cIdx);
+    }
+
+    int ss = seg[1 + ns * 2];
+    int se = seg[2 + ns * 2];
+    int ahal = seg[3 + ns * 2];
+    if (ss != 0 || se != 63 || ahal != 0) {
+        error = "progressive scans are not supported";
+        return false;
+    }
+
+    JpegBitReader br(data, size, pos);
+    std::vector<int> preds(mComponents.size(), 0);
+    int mcusLeft = mRestartInterval;
+    bool ok = true;
+
+    auto restart = [&]() {
+        if (mRestartInterval == 0)
+            return;
+
+        if (mcusLeft == 0) {
+            br.restart();
+            std::fill(preds.begin(), preds.end(), 0);
+            mcusLeft = mRestartInterval;
+        }
+        mcusLeft--;
+    };
+
+    if (scan.size() == 1) {
+        JpegComponent &c = mComponents[scan[0]];
+        int bw = validBlocksX(c);
+        int bh = validBlocksY(c);
+
+        for (int by = 0; by < bh && ok; by++) {
+            for (int bx = 0; bx < bw && ok; bx++) {
+                restart();
+                ok = decodeBlock(br, c, c.block(bx, by), preds[scan[0]]);
+            }
+        }
+    } else {
+        for (int my = 0; my < mMcusY && ok; my++) {
+            for (int mx = 0; mx < mMcusX && ok; mx++) {
+                restart();
+
+                for (int cIdx : scan) {
+                    JpegComponent &c = mComponents[cIdx];
+
+                    for (int v = 0; v < c.v && ok; v++) {
+                        for (int h = 0; h < c.h && ok; h++)
+                            ok = decodeBlock(br, c, c.block(mx * c.h + h, my * c.v + v), preds[cIdx]);
+                    }
+                }
+            }
+        }
+    }
+
+    if (!ok) {
+        error = "corrupt entropy coded data";
+        return false;
+    }
+
+    pos = br.markerPos();
+    return true;
+}
+
+bool JpegCoefficientCodec::transform(const JpegTransformParams &params, std::string &error)
+{
+    // dimensions after transposing & flipping
+    int tw = params.transpose ? mHeight : mWidth;
+    int th = params.transpose ? mWidth : mHeight;
+    int mcuW = 8 * (params.transpose ? mVMax : mHMax);
+    int mcuH = 8 * (params.transpose ? mHMax : mVMax);
+
+    // we cannot move partial MCUs from the right/bottom edge to the left/top
+    if ((params.flipX && tw % mcuW) || (params.flipY && th % mcuH)) {
+        error = "the image size is not a multiple of the MCU size";
+        return false;
+    }
+
+    int cx = 0;
+    int cy = 0;
+    int cw = tw;
+    int ch = th;
+
+    if (params.crop) {
+        cw = qMin(params.cropWidth, tw);
+        ch = qMin(params.cropHeight, th);
+        cx = params.cropX;
+        cy = params.cropY;
+
+        if (params.cropCenter) {
+            if (cw < tw)
+                cx = (tw - cw) / 2;
+            if (ch < th)
+                cy = (th - ch) / 2;
+        }
+
+        // same as QRect::intersected with the image rect
+        if (cx < 0) {
+            cw += cx;
+            cx = 0;
+        }
+        if (cy < 0) {
+            ch += cy;
+            cy = 0;
+        }
+        cw = qMin(cw, tw - cx);
+        ch = qMin(ch, th - cy);
+
+        if (cw <= 0 || ch <= 0) {
+            error = "the crop rectangle is empty";
+            return false;
+        }
+
+        if (cx % mcuW || cy % mcuH) {
+            error = "the crop rectangle is not aligned to the MCU grid";
+            return false;
+        }
+    }
+
+    // maps the output coefficients to the input coefficients (incl. the sign)
+    int coefIdx[64];
+    bool coefNegate[64];
+    for (int v = 0; v < 8; v++) {
+        for (int u = 0; u < 8; u++) {
+            coefIdx[v * 8 + u] = params.transpose ? u * 8 + v : v * 8 + u;
+            coefNegate[v * 8 + u] = ((params.flipX && (u & 1)) != 0) != ((params.flipY && (v & 1)) != 0);
+        }
+    }
+
+    std::vector<JpegComponent> components;
+
+    for (JpegComponent &src : mComponents) {
+        JpegComponent c = src;
+        c.coefs.clear();
+
+        if (params.transpose)
+            std::swap(c.h, c.v);
+
+        // the transformed (uncropped) block grid
+        int tbw = params.transpose ? src.bh : src.bw;
+        int tbh = params.transpose ? src.bw : src.bh;
+
+        c.bw = ((cw + mcuW - 1) / mcuW) * c.h;
+        c.bh = ((ch + mcuH - 1) / mcuH) * c.v;
+        c.coefs.assign((size_t)c.bw * c.bh * 64, 0);
+
+        int bx0 = cx / mcuW * c.h;
+        int by0 = cy / mcuH * c.v;
+
+        for (int by = 0; by < c.bh; by++) {
+            for (int bx = 0; bx < c.bw; bx++) {
+                int tx = bx + bx0;
+                int ty = by + by0;
+
+                if (tx >= tbw || ty >= tbh)
+                    continue; // padding
+
+                if (params.flipX)
+                    tx = tbw - 1 - tx;
+                if (params.flipY)
+                    ty = tbh - 1 - ty;
+
+                int sx = params.transpose ? ty : tx;
+                int sy = params.transpose ? tx : ty;
+
+                const int16_t *in = src.block(sx, sy);
+                int16_t *out = c.block(bx, by);
+
+                for (int k = 0; k < 64; k++)
+                    out[k] = coefNegate[k] ? (int16_t)-in[coefIdx[k]] : in[coefIdx[k]];
+            }
+        }
+
+        components.push_back(c);
+    }
+
+    if (params.transpose) {
+        for (int idx = 0; idx < 4; idx++) {
+            if (!mQuantDefined[idx])
+                continue;
+
+            uint16_t q[64];
+            for (int v = 0; v < 8; v++) {
+                for (int u = 0; u < 8; u++)
+                    q[v * 8 + u] = mQuant[idx][u * 8 + v];
+            }
+            std::memcpy(mQuant[idx], q, sizeof(q));
+        }
+    }
+
+    mComponents.swap(components);
+    mWidth = cw;
+    mHeight = ch;
+    setupGrid();
+
+    return true;
+}
+
+std::vector<std::vector<int>> JpegCoefficientCodec::outputScans() const
+{
+    std::vector<std::vector<int>> scans;
+
+    int blocksPerMcu = 0;
+    for (const JpegComponent &c : mComponents)
+        blocksPerMcu += c.h * c.v;
+
+    if (blocksPerMcu <= 10) {
+        std::vector<int> scan;
+        for (int idx = 0; idx < (int)mComponents.size(); idx++)
+            scan.push_back(idx);
+        scans.push_back(scan);
+    } else {
+        for (int idx = 0; idx < (int)mComponents.size(); idx++)
+            scans.push_back(std::vector<int>(1, idx));
+    }
+
+    return scans;
+}
+
+template <typename BlockFunc>
+void JpegCoefficientCodec::forEachBlock(const std::vector<int> &scan, BlockFunc func)
+{
+    if (scan.size() == 1) {
+        JpegComponent &c = mComponents[scan[0]];
+        int bw = validBlocksX(c);
+        int bh = validBlocksY(c);
+
+        for (int by = 0; by < bh; by++) {
+            for (int bx = 0; bx < bw; bx++)
+                func(scan[0], c.block(bx, by));
+        }
+    } else {
+        for (int my = 0; my < mMcusY; my++) {
+            for (int mx = 0; mx < mMcusX; mx++) {
+                for (int cIdx : scan) {
+                    JpegComponent &c = mComponents[cIdx];
+
+                    for (int v = 0; v < c.v; v++) {
+                        for (int h = 0; h < c.h; h++)
+                            func(cIdx, c.block(mx * c.h + h, my * c.v + v));
+                    }
+                }
+            }
+        }
+    }
+}
+
+void JpegCoefficientCodec::write(std::vector<uint8_t> &out)
+{
+    out.reserve(out.size() + (size_t)mWidth * mHeight / 2);
+
+    // luminance gets table 0, all chroma components share table 1
+    for (int idx = 0; idx < (int)mComponents.size(); idx++) {
+        mComponents[idx].td = idx == 0 ? 0 : 1;
+        mComponents[idx].ta = idx == 0 ? 0 : 1;
+    }
+
+    std::vector<std::vector<int>> scans = outputScans();
+
+    // gather statistics for optimal Huffman tables
+    long dcFreq[2][256] = {{0}};
+    long acFreq[2][256] = {{0}};
+
+    for (const std::vector<int> &scan : scans) {
+        std::vector<int> preds(mComponents.size(), 0);
+
+        forEachBlock(scan, [&](int cIdx, const int16_t *blk) {
+            const JpegComponent &c = mComponents[cIdx];
+
+            int diff = blk[0] - preds[cIdx];
+            preds[cIdx] = blk[0];
+            dcFreq[c.td][jpegNumBits(diff)]++;
+
+            int r = 0;
+            for (int k = 1; k < 64; k++) {
+                int v = blk[jpegNatural[k]];
+                if (v == 0) {
+                    r++;
+                    continue;
+                }
+
+                while (r > 15) {
+                    acFreq[c.ta][0xf0]++;
+                    r -= 16;
+                }
+                acFreq[c.ta][(r << 4) | jpegNumBits(v)]++;
+                r = 0;
+            }
+
+            if (r > 0)
+                acFreq[c.ta][0]++;
+        });
+    }
+
+    int numTables = mComponents.size() > 1 ? 2 : 1;
+    JpegHuffmanTable dc[2];
+    JpegHuffmanTable ac[2];
+    for (int idx = 0; idx < numTables; idx++) {
+        dc[idx].createOptimal(dcFreq[idx]);
+        ac[idx].createOptimal(acFreq[idx]);
+    }
+
+    // SOI
+    out.push_back(0xff);
+    out.push_back(0xd8);
+
+    for (const std::vector<uint8_t> &s : mSegments)
+        out.insert(out.end(), s.begin(), s.end());
+
+    // DQT
+    for (int idx = 0; idx < 4; idx++) {
+        bool used = false;
+        for (const JpegComponent &c : mComponents)
+            used |= c.tq == idx;
+
+        if (!used || !mQuantDefined[idx])
+            continue;
+
+        int pq = mQuantPrecision[idx];
+        out.push_back(0xff);
+        out.push_back(0xdb);
+        jpegWrite16(out, 3 + (pq ? 128 : 64));
+        out.push_back((uint8_t)((pq << 4) | idx));
+
+        for (int k = 0; k < 64; k++) {
+            if (pq)
+                jpegWrite16(out, mQuant[idx][jpegNatural[k]]);
+            else
+                out.push_back((uint8_t)mQuant[idx][jpegNatural[k]]);
+        }
+    }
+
+    // SOF
+    out.push_back(0xff);
+    out.push_back((uint8_t)mSofMarker);
+    jpegWrite16(out, 8 + 3 * (int)mComponents.size());
+    out.push_back(8);
+    jpegWrite16(out, mHeight);
+    jpegWrite16(out, mWidth);
+    out.push_back((uint8_t)mComponents.size());
+    for (const JpegComponent &c : mComponents) {
+        out.push_back((uint8_t)c.id);
+        out.push_back((uint8_t)((c.h << 4) | c.v));
+        out.push_back((uint8_t)c.tq);
+    }
+
+    // DHT
+    for (int idx = 0; idx < numTables; idx++) {
+        for (int tc = 0; tc < 2; tc++) {
+            const JpegHuffmanTable &t = tc == 0 ? dc[idx] : ac[idx];
+
+            out.push_back(0xff);
+            out.push_back(0xc4);
+            jpegWrite16(out, 2 + 17 + (int)t.values.size());
+            out.push_back((uint8_t)((tc << 4) | idx));
+            out.insert(out.end(), t.bits + 1, t.bits + 17);
+            out.insert(out.end(), t.values.begin(), t.values.end());
+        }
+    }
+
+    for (const std::vector<int> &scan : scans) {
+        // SOS
+        out.push_back(0xff);
+        out.push_back(0xda);
+        jpegWrite16(out, 6 + 2 * (int)scan.size());
+        out.push_back((uint8_t)scan.size());
+        for (int cIdx : scan) {
+            const JpegComponent &c = mComponents[cIdx];
+            out.push_back((uint8_t)c.id);
+            out.push_back((uint8_t)((c.td << 4) | c.ta));
+        }
+        out.push_back(0);
+        out.push_back(63);
+        out.push_back(0);
+
+        JpegBitWriter bw(out);
+        std::vector<int> preds(mComponents.size(), 0);
+
+        forEachBlock(scan, [&](int cIdx, const int16_t *blk) {
+            const JpegComponent &c = mComponents[cIdx];
+            const JpegHuffmanTable &dct = dc[c.td];
+            const JpegHuffmanTable &act = ac[c.ta];
+
+            int diff = blk[0] - preds[cIdx];
+            preds[cIdx] = blk[0];
+
+            int s = jpegNumBits(diff);
+            bw.put(dct.code[s], dct.size[s]);
+            if (s)
+                bw.put(diff < 0 ? diff - 1 : diff, s);
+
+            int r = 0;
+            for (int k = 1; k < 64; k++) {
+                int v = blk[jpegNatural[k]];
+                if (v == 0) {
+                    r++;
+                    continue;
+                }
+
+                while (r > 15) {
+                    bw.put(act.code[0xf0], act.size[0xf0]);
+                    r -= 16;
+                }
+
+                s = jpegNumBits(v);
+                bw.put(act.code[(r << 4) | s], act.size[(r << 4) | s]);
+                bw.put(v < 0 ? v - 1 : v, s);
+                r = 0;
+            }
+
+            if (r > 0)
+                bw.put(act.code[0], act.size[0]);
+        });
+
+        bw.flush();
+    }
+
+    // EOI
+    out.push_back(0xff);
+    out.push_back(0xd9);
+}
+
+}
+
+// DkJpegTransform --------------------------------------------------------------------
+DkJpegTransform::DkJpegTransform()
+{
+}
+
+void DkJpegTransform::multiply(const int m[2][2])
+{
+    int r[2][2];
+
+    for (int i = 0; i < 2; i++) {
+        for (int j = 0; j < 2; j++)
+            r[i][j] = m[i][0] * mM[0][j] + m[i][1] * mM[1][j];
+    }
+
+    std::memcpy(mM, r, sizeof(r));
+}
+
+/**
+ * Rotates clockwise (same as DkImage::rotateImage).
+ * @param angle the angle in degrees, must be a multiple of 90
+ **/
+void DkJpegTransform::rotate(int angle)
+{
+    angle = ((angle % 360) + 360) % 360;
+
+    if (angle % 90 != 0 || (hasCrop() && angle != 0)) {
+        mValid = false;
+        return;
+    }
+
+    const int cw[2][2] = {{0, -1}, {1, 0}};
+    for (int idx = 0; idx < angle / 90; idx++)
+        multiply(cw);
+}
+
+void DkJpegTransform::flipHorizontal()
+{
+    if (hasCrop())
+        mValid = false;
+
+    const int f[2][2] = {{-1, 0}, {0, 1}};
+    multiply(f);
+}
+
+void DkJpegTransform::flipVertical()
+{
+    if (hasCrop())
+        mValid = false;
+
+    const int f[2][2] = {{1, 0}, {0, -1}};
+    multiply(f);
+}
+
+/**
+ * Applies other after this transform.
+ * @param other the transform that should be applied next
+ **/
+void DkJpegTransform::append(const DkJpegTransform &other)
+{
+    bool otherIsIdentity = other.mM[0][0] == 1 && other.mM[1][1] == 1 && other.mM[0][1] == 0;
+
+    // crops can only be the last operation
+    if (!other.mValid || (hasCrop() && (other.hasCrop() || !otherIsIdentity))) {
+        mValid = false;
+        return;
+    }
+
+    multiply(other.mM);
+
+    if (other.hasCrop()) {
+        mCrop = other.mCrop;
+        mCropCenter = other.mCropCenter;
+    }
+}
+
+/**
+ * Crops the transformed image.
+ * The top left corner must be aligned to the MCU grid (usually 8 or 16 px).
+ * @param rect the crop rectangle (it is intersected with the image)
+ * @param center if true, the rectangle is centered (same as DkBatchTransform)
+ **/
+void DkJpegTransform::setCrop(const QRect &rect, bool center)
+{
+    mCrop = rect;
+    mCropCenter = center;
+}
+
+bool DkJpegTransform::isValid() const
+{
+    return mValid;
+}
+
+bool DkJpegTransform::isIdentity() const
+{
+    return mM[0][0] == 1 && mM[1][1] == 1 && mM[0][1] == 0 && !hasCrop();
+}
+
+bool DkJpegTransform::hasCrop() const
+{
+    return !mCrop.isEmpty();
+}
+
+/**
+ * Applies the rotation & flips to a decoded image (e.g. the Exif thumbnail).
+ * The crop is ignored.
+ * @param img the image
+ * @return QImage the transformed image
+ **/
+QImage DkJpegTransform::apply(const QImage &img) const
+{
+    if (mM[0][0] == 1 && mM[1][1] == 1 && mM[0][1] == 0)
+        return img;
+
+    // QTransform maps (x, y) -> (m11 x + m21 y, m12 x + m22 y)
+    QTransform t(mM[0][0], mM[1][0], mM[0][1], mM[1][1], 0, 0);
+    return img.transformed(t);
+}
+
+/**
+ * Transforms a JPEG without decoding it.
+ * APPn segments (Exif, ICC profiles, ...) and comments are copied verbatim.
+ * @param jpeg the encoded JPEG
+ * @param error if not 0, the reason is reported if the transform is not possible
+ * @return QByteArray the transformed JPEG or an empty array
+ **/
+QByteArray DkJpegTransform::apply(const QByteArray &jpeg, QString *error) const
+{
+    DkTraceZone tz("DkJpegTransform::apply");
+
+    if (!mValid) {
+        if (error)
+            *error = QObject::tr("the transform cannot be done losslessly");
+        return QByteArray();
+    }
+
+    // M = F * T where T is an optional transpose and F mirrors the axes
+    JpegTransformParams params;
+    params.transpose = mM[0][1] != 0;
+    params.flipX = params.transpose ? mM[0][1] < 0 : mM[0][0] < 0;
+    params.flipY = params.transpose ? mM[1][0] < 0 : mM[1][1] < 0;
+
+    if (hasCrop()) {
+        params.crop = true;
+        params.cropCenter = mCropCenter;
+        params.cropX = mCrop.x();
+        params.cropY = mCrop.y();
+        params.cropWidth = mCrop.width();
+        params.cropHeight = mCrop.height();
+    }
+
+    std::string err;
+    std::vector<uint8_t> out;
+    JpegCoefficientCodec codec;
+
+    if (!codec.read(reinterpret_cast<const uint8_t *>(jpeg.constData()), (size_t)jpeg.size(), err) || !codec.transform(params, err)) {
+        if (error)
+            *error = QString::fromStdString(err);
+        return QByteArray();
+    }
+
+    codec.write(out);
+    DkTracer::instance().addCounter("lossless jpeg transforms");
+
+    return QByteArray(reinterpret_cast<const char *>(out.data()), (int)out.size());
+}
+
+bool DkJpegTransform::isJpeg(const QByteArray &ba)
+{
+    return ba.size() > 3 && (uchar)ba[0] == 0xff && (uchar)ba[1] == 0xd8 && (uchar)ba[2] == 0xff;
+}
+
+bool DkJpegTransform::isJpegSuffix(const QString &suffix)
+{
+    QString s = suffix.toLower();
+    return s == "jpg" || s == "jpeg" || s == "jpe" || s == "jfif";
+}
+
+}
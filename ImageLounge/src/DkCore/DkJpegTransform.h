@@ -0,0 +1,94 @@
+/*******************************************************************************************************
+ DkJpegTransform.h
+ Created on:	19.10.2026
+
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+
+ Copyright (C) 2011-2016 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2016 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2016 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ *******************************************************************************************************/
+
+#pragma once
+
+#pragma warning(push, 0) // no warnings from includes - begin
+#include <QByteArray>
+#include <QImage>
+#include <QRect>
+#include <QString>
+#pragma warning(pop) // no warnings from includes - end
+
+#pragma warning(disable : 4251) // TODO: remove
+
+#ifndef DllCoreExport
+#ifdef DK_CORE_DLL_EXPORT
+#define DllCoreExport Q_DECL_EXPORT
+#elif DK_DLL_IMPORT
+#define DllCoreExport Q_DECL_IMPORT
+#else
+#define DllCoreExport Q_DECL_IMPORT
+#endif
+#endif
+
+namespace nmc
+{
+
+/**
+ * Lossless JPEG transforms (rotations, flips and MCU aligned crops).
+ * Like jpegtran, the transform is applied to the DCT coefficients:
+ * the entropy coded data is decoded, the blocks are rearranged and
+ * re-encoded with optimized Huffman tables - pixels are never touched.
+ * Only baseline and extended sequential (Huffman) JPEGs are supported.
+ * If an edge MCU would have to be moved (e.g. flipping an image whose width
+ * is not a multiple of the MCU size), the transform fails and callers
+ * fall back to decoding and encoding.
+ **/
+class DllCoreExport DkJpegTransform
+{
+public:
+    DkJpegTransform();
+
+    void rotate(int angle);
+    void flipHorizontal();
+    void flipVertical();
+    void append(const DkJpegTransform &other);
+    void setCrop(const QRect &rect, bool center = false);
+
+    bool isValid() const;
+    bool isIdentity() const;
+    bool hasCrop() const;
+
+    QImage apply(const QImage &img) const;
+    QByteArray apply(const QByteArray &jpeg, QString *error = 0) const;
+
+    static bool isJpeg(const QByteArray &ba);
+    static bool isJpegSuffix(const QString &suffix);
+
+protected:
+    void multiply(const int m[2][2]);
+
+    // maps (centered) input coordinates to output coordinates
+    int mM[2][2] = {{1, 0}, {0, 1}};
+
+    QRect mCrop;
+    bool mCropCenter = false;
+    bool mValid = true;
+};
+
+}
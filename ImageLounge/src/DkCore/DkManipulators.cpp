@@ -301,6 +301,16 @@ void DkBaseManipulator::saveSettings(QSettings &settings)
     settings.endGroup();
 }
 
+/// <summary>
+/// Appends this manipulator to a lossless jpg transform.
+/// </summary>
+/// <param name="transform">The transform.</param>
+/// <returns>false if the manipulator cannot be expressed as lossless transform.</returns>
+bool DkBaseManipulator::losslessTransform(DkJpegTransform &) const
+{
+    return false;
+}
+
 void DkBaseManipulator::loadSettings(QSettings &settings)
 {
     settings.beginGroup(name());
@@ -52,6 +52,7 @@ namespace nmc
 
 // nomacs defines
 class DkImageContainer;
+class DkJpegTransform;
 
 /// <summary>
 /// Base class of simple image manipulators.
@@ -74,6 +75,7 @@ public:
 
     virtual QString errorMessage() const = 0;
     virtual QImage apply(const QImage &img) const = 0;
+    virtual bool losslessTransform(DkJpegTransform &transform) const;
 
     virtual void saveSettings(QSettings &settings);
     virtual void loadSettings(QSettings &settings);
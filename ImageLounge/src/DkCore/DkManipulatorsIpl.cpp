@@ -29,6 +29,7 @@
 #include "DkManipulatorsIpl.h"
 
 #include "DkImageStorage.h"
+#include "DkJpegTransform.h"
 #include "DkMath.h"
 
 #pragma warning(push, 0) // no warnings from includes
@@ -133,6 +134,12 @@ QString DkFlipHManipulator::errorMessage() const
     return QObject::tr("Cannot flip image");
 }
 
+bool DkFlipHManipulator::losslessTransform(DkJpegTransform &transform) const
+{
+    transform.flipHorizontal();
+    return true;
+}
+
 // Flip Vertically --------------------------------------------------------------------
 DkFlipVManipulator::DkFlipVManipulator(QAction *action)
     : DkBaseManipulator(action)
@@ -149,6 +156,12 @@ QString DkFlipVManipulator::errorMessage() const
     return QObject::tr("Cannot flip image");
 }
 
+bool DkFlipVManipulator::losslessTransform(DkJpegTransform &transform) const
+{
+    transform.flipVertical();
+    return true;
+}
+
 // DkRotateCWManipulator --------------------------------------------------------------------
 DkRotateCWManipulator::DkRotateCWManipulator(QAction *action)
     : DkBaseManipulator(action)
@@ -165,6 +178,12 @@ QString DkRotateCWManipulator::errorMessage() const
     return QObject::tr("Cannot rotate image");
 }
 
+bool DkRotateCWManipulator::losslessTransform(DkJpegTransform &transform) const
+{
+    transform.rotate(90);
+    return true;
+}
+
 // DkRotateCCWManipulator --------------------------------------------------------------------
 DkRotateCCWManipulator::DkRotateCCWManipulator(QAction *action)
     : DkBaseManipulator(action)
@@ -181,6 +200,12 @@ QString DkRotateCCWManipulator::errorMessage() const
     return QObject::tr("Cannot rotate image");
 }
 
+bool DkRotateCCWManipulator::losslessTransform(DkJpegTransform &transform) const
+{
+    transform.rotate(-90);
+    return true;
+}
+
 // DkRotate180Manipulator --------------------------------------------------------------------
 DkRotate180Manipulator::DkRotate180Manipulator(QAction *action)
     : DkBaseManipulator(action)
@@ -197,6 +222,12 @@ QString DkRotate180Manipulator::errorMessage() const
     return QObject::tr("Cannot rotate image");
 }
 
+bool DkRotate180Manipulator::losslessTransform(DkJpegTransform &transform) const
+{
+    transform.rotate(180);
+    return true;
+}
+
 // DkTinyPlanetManipulator --------------------------------------------------------------------
 DkTinyPlanetManipulator::DkTinyPlanetManipulator(QAction *action)
     : DkBaseManipulatorExt(action)
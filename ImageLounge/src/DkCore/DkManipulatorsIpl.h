@@ -96,6 +96,7 @@ public:
 
     QImage apply(const QImage &img) const override;
     QString errorMessage() const override;
+    bool losslessTransform(DkJpegTransform &transform) const override;
 };
 
 class DkFlipVManipulator : public DkBaseManipulator
@@ -105,6 +106,7 @@ public:
 
     QImage apply(const QImage &img) const override;
     QString errorMessage() const override;
+    bool losslessTransform(DkJpegTransform &transform) const override;
 };
 
 class DkRotateCWManipulator : public DkBaseManipulator
@@ -114,6 +116,7 @@ public:
 
     QImage apply(const QImage &img) const override;
     QString errorMessage() const override;
+    bool losslessTransform(DkJpegTransform &transform) const override;
 };
 
 class DkRotateCCWManipulator : public DkBaseManipulator
@@ -123,6 +126,7 @@ public:
 
     QImage apply(const QImage &img) const override;
     QString errorMessage() const override;
+    bool losslessTransform(DkJpegTransform &transform) const override;
 };
 
 class DkRotate180Manipulator : public DkBaseManipulator
@@ -132,6 +136,7 @@ public:
 
     QImage apply(const QImage &img) const override;
     QString errorMessage() const override;
+    bool losslessTransform(DkJpegTransform &transform) const override;
 };
 
 // Extended --------------------------------------------------------------------
@@ -37,6 +37,7 @@
 #include <QBuffer>
 #include <QDebug>
 #include <QImage>
+#include <QImageReader>
 #include <QObject>
 #include <QRegularExpression>
 #include <QTranslator>
@@ -585,6 +586,44 @@ QString DkMetaDataT::getIptcValue(const QString &key) const
     return info;
 }
 
+/**
+ * Returns the keywords (tags) of the image.
+ * IPTC keywords are repeatable and the XMP subject is a bag,
+ * so all values are collected.
+ * @return QStringList the unique keywords
+ **/
+QStringList DkMetaDataT::getKeywords() const
+{
+    QStringList keywords;
+
+    if (mExifState != loaded && mExifState != dirty)
+        return keywords;
+
+    try {
+        Exiv2::IptcData &iptcData = mExifImg->iptcData();
+
+        for (auto it = iptcData.begin(); it != iptcData.end(); ++it) {
+            if (it->key() == "Iptc.Application2.Keywords")
+                keywords << exiv2ToQString(it->toString());
+        }
+
+        Exiv2::XmpData &xmpData = mExifImg->xmpData();
+        Exiv2::XmpData::iterator pos = xmpData.findKey(Exiv2::XmpKey("Xmp.dc.subject"));
+
+        if (pos != xmpData.end()) {
+            for (long idx = 0; idx < (long)pos->count(); idx++)
+                keywords << exiv2ToQString(pos->toString(idx));
+        }
+    } catch (...) {
+        qDebug() << "[Exiv2] could not read keywords";
+    }
+
+    keywords.removeAll(QString());
+    keywords.removeDuplicates();
+
+    return keywords;
+}
+
 void DkMetaDataT::getFileMetaData(QStringList &fileKeys, QStringList &fileValues) const
 {
     QFileInfo fileInfo(mFilePath);
@@ -961,6 +1000,25 @@ void DkMetaDataT::setQtValues(const QImage &cImg)
     }
 }
 
+/**
+ * Reads the Qt values from the image's header (without decoding the pixels).
+ **/
+void DkMetaDataT::setQtValues(const QImageReader &reader)
+{
+    QStringList qtKeysInit = reader.textKeys();
+
+    for (QString cKey : qtKeysInit) {
+        if (!cKey.isEmpty() && cKey != "Raw profile type exif") {
+            QString val = reader.text(cKey).size() < 5000 ? reader.text(cKey) : QObject::tr("<data too large to display>");
+
+            if (!val.isEmpty()) {
+                mQtValues.append(val);
+                mQtKeys.append(cKey);
+            }
+        }
+    }
+}
+
 QString DkMetaDataT::getQtValue(const QString &key) const
 {
     int idx = mQtKeys.indexOf(key);
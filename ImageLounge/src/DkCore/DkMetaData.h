@@ -79,6 +79,7 @@ typedef unsigned char byte;
 // Qt defines
 class QVector2D;
 class QImage;
+class QImageReader;
 
 namespace nmc
 {
@@ -110,6 +111,7 @@ public:
     QString getXmpValue(const QString &key) const;
     QString getExifValue(const QString &key) const;
     QString getIptcValue(const QString &key) const;
+    QStringList getKeywords() const;
     QString getQtValue(const QString &key) const;
     QImage getThumbnail() const;
     QImage getPreviewImage(int minPreviewWidth = 0) const;
@@ -133,6 +135,7 @@ public:
     bool updateImageMetaData(const QImage &img, bool reset_orientation = true);
     void setThumbnail(QImage thumb);
     void setQtValues(const QImage &cImg);
+    void setQtValues(const QImageReader &reader);
     static QString exiv2ToQString(std::string exifString);
     void setUseSidecar(bool useSideCar = false);
 
@@ -0,0 +1,783 @@
+/*******************************************************************************************************
+ DkMetaDataCatalog.cpp
+ Created on:	19.10.2026
+
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+
+ Copyright (C) 2011-2016 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2016 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2016 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ *******************************************************************************************************/
+
+#include "DkMetaDataCatalog.h"
+#include "DkFormatRegistry.h"
+#include "DkMetaData.h"
+#include "DkSettings.h"
+#include "DkTimer.h"
+#include "DkUtils.h"
+
+#pragma warning(push, 0) // no warnings from includes - begin
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QSaveFile>
+#include <QSet>
+#include <QThreadPool>
+#include <QtConcurrentRun>
+#pragma warning(pop) // no warnings from includes - end
+
+#include <algorithm>
+
+namespace nmc
+{
+
+namespace
+{
+// metadata is located in the file's header - so we don't need to read whole images
+const qint64 catalogHeaderSize = 256 * 1024;
+const QString catalogMagic = "nomacs-metadata-catalog";
+const int catalogVersion = 1;
+
+/**
+ * Converts exif GPS coordinates (e.g. 48/1 8/1 3194/100) to degrees.
+ **/
+double gpsToDegrees(const QString &coordinates, bool *ok)
+{
+    QStringList parts = coordinates.split(" ", Qt::SkipEmptyParts);
+    double degrees = 0.0;
+    double scale = 1.0;
+
+    *ok = !parts.empty();
+
+    for (const QString &p : parts) {
+        QStringList r = p.split("/");
+        double den = r.size() == 2 ? r[1].toDouble() : 1.0;
+
+        if (den == 0.0) {
+            *ok = false;
+            break;
+        }
+
+        degrees += r[0].toDouble() / den / scale;
+        scale *= 60.0;
+    }
+
+    return degrees;
+}
+}
+
+// DkCatalogEntry --------------------------------------------------------------------
+QString DkCatalogEntry::camera() const
+{
+    // most vendors repeat the make in the model name (e.g. Canon - Canon EOS 5D)
+    if (model.startsWith(make, Qt::CaseInsensitive))
+        return model;
+
+    return (make + " " + model).trimmed();
+}
+
+bool DkCatalogEntry::isStale(const QFileInfo &file) const
+{
+    return fileSize != file.size() || modified != file.lastModified().toMSecsSinceEpoch();
+}
+
+/**
+ * Parses the metadata of a file.
+ * Only the file's header is read. If the metadata could not be
+ * found there, formats that might store it anywhere (e.g. tiff, raw)
+ * are read completely.
+ * @param file the image file
+ * @return DkCatalogEntry the file's catalog entry
+ **/
+DkCatalogEntry DkCatalogEntry::fromFile(const QFileInfo &file)
+{
+    DkCatalogEntry e;
+    e.fileName = file.fileName();
+    e.fileSize = file.size();
+    e.modified = file.lastModified().toMSecsSinceEpoch();
+
+    QSharedPointer<QByteArray> ba(new QByteArray());
+    QFile f(file.absoluteFilePath());
+    if (f.open(QIODevice::ReadOnly))
+        *ba = f.read(catalogHeaderSize);
+
+    DkMetaDataT metaData;
+    metaData.readMetaData(file.absoluteFilePath(), ba);
+
+    DkFormatRegistry::Capabilities caps = DkFormatRegistry::instance().capabilities(e.fileName);
+    if (!metaData.hasMetaData() && f.isOpen() && ba->size() < e.fileSize
+        && (caps.testFlag(DkFormatRegistry::cap_thumb) || caps.testFlag(DkFormatRegistry::cap_raw))) {
+        *ba += f.readAll();
+        metaData.readMetaData(file.absoluteFilePath(), ba);
+    }
+
+    if (!metaData.hasMetaData())
+        return e;
+
+    QDateTime captured = DkUtils::getConvertableDate(metaData.getExifValue("DateTimeOriginal"));
+    if (!captured.isValid())
+        captured = DkUtils::getConvertableDate(metaData.getExifValue("DateTime"));
+    if (captured.isValid())
+        e.captured = captured.toMSecsSinceEpoch();
+
+    e.make = metaData.getExifValue("Make").trimmed();
+    e.model = metaData.getExifValue("Model").trimmed();
+    e.lens = metaData.getNativeExifValue("Exif.Photo.LensModel", false).trimmed();
+    if (e.lens.isEmpty())
+        e.lens = metaData.getXmpValue("Xmp.aux.Lens").trimmed();
+
+    e.rating = qMax(metaData.getRating(), 0);
+    e.keywords = metaData.getKeywords();
+    e.size = metaData.getImageSize();
+
+    bool latOk = false, lonOk = false;
+    double lat = gpsToDegrees(metaData.getNativeExifValue("Exif.GPSInfo.GPSLatitude", false), &latOk);
+    double lon = gpsToDegrees(metaData.getNativeExifValue("Exif.GPSInfo.GPSLongitude", false), &lonOk);
+
+    if (latOk && lonOk) {
+        e.hasGps = true;
+        e.latitude = metaData.getNativeExifValue("Exif.GPSInfo.GPSLatitudeRef", false) == "S" ? -lat : lat;
+        e.longitude = metaData.getNativeExifValue("Exif.GPSInfo.GPSLongitudeRef", false) == "W" ? -lon : lon;
+    }
+
+    return e;
+}
+
+QDataStream &operator<<(QDataStream &s, const DkCatalogEntry &e)
+{
+    s << e.fileName << e.fileSize << e.modified << e.captured << e.make << e.model << e.lens << (qint32)e.rating << e.keywords << e.size << e.hasGps << e.latitude
+      << e.longitude;
+
+    return s;
+}
+
+QDataStream &operator>>(QDataStream &s, DkCatalogEntry &e)
+{
+    qint32 rating = 0;
+    s >> e.fileName >> e.fileSize >> e.modified >> e.captured >> e.make >> e.model >> e.lens >> rating >> e.keywords >> e.size >> e.hasGps >> e.latitude >> e.longitude;
+    e.rating = rating;
+
+    return s;
+}
+
+// DkCatalogQuery --------------------------------------------------------------------
+DkCatalogQuery::DkCatalogQuery(const QString &query)
+{
+    QString q = query.trimmed();
+
+    // order by <field> [asc|desc]
+    static const QRegularExpression orderExp("\\s*\\border\\s+by\\s+(\\w+)(?:\\s+(asc|desc))?\\s*$", QRegularExpression::CaseInsensitiveOption);
+    QRegularExpressionMatch m = orderExp.match(q);
+
+    if (m.hasMatch()) {
+        mSortField = toField(m.captured(1));
+        mSortDescending = m.captured(2).compare("desc", Qt::CaseInsensitive) == 0;
+
+        if (mSortField == field_end)
+            mError = QObject::tr("Unknown field: %1").arg(m.captured(1));
+
+        q = q.left(m.capturedStart());
+    }
+
+    static const QRegularExpression andExp("\\s+and\\s+|\\s*&&\\s*", QRegularExpression::CaseInsensitiveOption);
+
+    for (const QString &c : q.split(andExp, Qt::SkipEmptyParts)) {
+        if (!parseClause(c))
+            break;
+    }
+}
+
+/**
+ * Returns true if query looks like a metadata query (e.g. rating >= 4).
+ **/
+bool DkCatalogQuery::isQuery(const QString &query)
+{
+    static const QRegularExpression exp("^\\s*(name|date|rating|camera|make|model|lens|keywords?|tags?|width|height|gps)\\s*(>=|<=|!=|=|<|>|~|\\x{2265}|\\x{2264})",
+                                        QRegularExpression::CaseInsensitiveOption);
+
+    return exp.match(query).hasMatch();
+}
+
+bool DkCatalogQuery::isValid() const
+{
+    return mError.isEmpty();
+}
+
+QString DkCatalogQuery::error() const
+{
+    return mError;
+}
+
+bool DkCatalogQuery::matches(const DkCatalogEntry &entry) const
+{
+    for (const Clause &c : mClauses) {
+        if (!matches(c, entry))
+            return false;
+    }
+
+    return true;
+}
+
+void DkCatalogQuery::sort(QVector<DkCatalogEntry> &entries) const
+{
+    auto lessThan = [this](const DkCatalogEntry &l, const DkCatalogEntry &r) -> bool {
+        switch (mSortField) {
+        case field_date:
+            if (l.captured != r.captured)
+                return l.captured < r.captured;
+            break;
+        case field_rating:
+            if (l.rating != r.rating)
+                return l.rating < r.rating;
+            break;
+        case field_width:
+            if (l.size.width() != r.size.width())
+                return l.size.width() < r.size.width();
+            break;
+        case field_height:
+            if (l.size.height() != r.size.height())
+                return l.size.height() < r.size.height();
+            break;
+        case field_camera:
+        case field_make:
+        case field_model:
+        case field_lens: {
+            const QString ls = mSortField == field_lens ? l.lens : l.camera();
+            const QString rs = mSortField == field_lens ? r.lens : r.camera();
+            int cmp = ls.compare(rs, Qt::CaseInsensitive);
+            if (cmp != 0)
+                return cmp < 0;
+            break;
+        }
+        default:
+            break;
+        }
+
+        return l.fileName.compare(r.fileName, Qt::CaseInsensitive) < 0;
+    };
+
+    std::sort(entries.begin(), entries.end(), lessThan);
+
+    if (mSortDescending)
+        std::reverse(entries.begin(), entries.end());
+}
+
+bool DkCatalogQuery::parseClause(const QString &clause)
+{
+    static const QRegularExpression clauseExp("^\\s*(\\w+)\\s*(>=|<=|!=|=|<|>|~|\\x{2265}|\\x{2264})\\s*(.*?)\\s*$");
+    QRegularExpressionMatch m = clauseExp.match(clause);
+
+    if (!m.hasMatch()) {
+        mError = QObject::tr("I cannot parse: %1").arg(clause);
+        return false;
+    }
+
+    Clause c;
+    c.field = toField(m.captured(1));
+
+    if (c.field == field_end) {
+        mError = QObject::tr("Unknown field: %1").arg(m.captured(1));
+        return false;
+    }
+
+    QString op = m.captured(2);
+    if (op == "=")
+        c.op = op_eq;
+    else if (op == "!=")
+        c.op = op_neq;
+    else if (op == "<")
+        c.op = op_less;
+    else if (op == "<=" || op == QChar(0x2264))
+        c.op = op_less_eq;
+    else if (op == ">")
+        c.op = op_greater;
+    else if (op == ">=" || op == QChar(0x2265))
+        c.op = op_greater_eq;
+    else
+        c.op = op_regexp;
+
+    c.text = m.captured(3);
+    if (c.text.size() >= 2 && c.text.startsWith('"') && c.text.endsWith('"'))
+        c.text = c.text.mid(1, c.text.size() - 2);
+
+    bool ok = true;
+
+    switch (c.field) {
+    case field_date:
+        ok = c.op != op_regexp && parseDate(c.text, c.number, c.numberEnd);
+        break;
+    case field_rating:
+    case field_width:
+    case field_height:
+        c.number = c.text.toLongLong(&ok);
+        c.numberEnd = c.number + 1;
+        ok = ok && c.op != op_regexp;
+        break;
+    case field_gps: {
+        QString v = c.text.toLower();
+        c.number = (v == "yes" || v == "true" || v == "1") ? 1 : 0;
+        ok = c.op == op_eq || c.op == op_neq;
+        break;
+    }
+    default:
+        if (c.op == op_regexp) {
+            c.exp = QRegularExpression(c.text, QRegularExpression::CaseInsensitiveOption);
+            ok = c.exp.isValid();
+        } else
+            ok = c.op == op_eq || c.op == op_neq;
+        break;
+    }
+
+    if (!ok) {
+        mError = QObject::tr("Illegal condition: %1").arg(clause.trimmed());
+        return false;
+    }
+
+    mClauses << c;
+    return true;
+}
+
+bool DkCatalogQuery::matches(const Clause &c, const DkCatalogEntry &entry) const
+{
+    switch (c.field) {
+    case field_name:
+        return matchesText(c, entry.fileName);
+    case field_date:
+        return entry.captured != 0 && compare(c, entry.captured);
+    case field_rating:
+        return compare(c, entry.rating);
+    case field_width:
+        return compare(c, entry.size.width());
+    case field_height:
+        return compare(c, entry.size.height());
+    case field_gps:
+        return (entry.hasGps == (c.number == 1)) == (c.op == op_eq);
+    case field_camera:
+        return matchesText(c, entry.camera());
+    case field_make:
+        return matchesText(c, entry.make);
+    case field_model:
+        return matchesText(c, entry.model);
+    case field_lens:
+        return matchesText(c, entry.lens);
+    case field_keyword: {
+        bool found = false;
+        for (const QString &k : entry.keywords) {
+            Clause pc = c;
+            pc.op = c.op == op_neq ? op_eq : c.op;
+            if (matchesText(pc, k)) {
+                found = true;
+                break;
+            }
+        }
+        return c.op == op_neq ? !found : found;
+    }
+    default:
+        return false;
+    }
+}
+
+bool DkCatalogQuery::matchesText(const Clause &c, const QString &text) const
+{
+    if (c.op == op_regexp)
+        return c.exp.match(text).hasMatch();
+
+    bool contains = text.contains(c.text, Qt::CaseInsensitive);
+    return c.op == op_neq ? !contains : contains;
+}
+
+bool DkCatalogQuery::compare(const Clause &c, qint64 value) const
+{
+    // values are compared against the period [number, numberEnd)
+    switch (c.op) {
+    case op_eq:
+        return value >= c.number && value < c.numberEnd;
+    case op_neq:
+        return value < c.number || value >= c.numberEnd;
+    case op_less:
+        return value < c.number;
+    case op_less_eq:
+        return value < c.numberEnd;
+    case op_greater:
+        return value >= c.numberEnd;
+    case op_greater_eq:
+        return value >= c.number;
+    default:
+        return false;
+    }
+}
+
+DkCatalogQuery::Field DkCatalogQuery::toField(const QString &name)
+{
+    static const QHash<QString, Field> fields = {
+        {"name", field_name},
+        {"date", field_date},
+        {"rating", field_rating},
+        {"camera", field_camera},
+        {"make", field_make},
+        {"model", field_model},
+        {"lens", field_lens},
+        {"keyword", field_keyword},
+        {"keywords", field_keyword},
+        {"tag", field_keyword},
+        {"tags", field_keyword},
+        {"width", field_width},
+        {"height", field_height},
+        {"gps", field_gps},
+    };
+
+    return fields.value(name.toLower(), field_end);
+}
+
+/**
+ * Parses a date (yyyy, yyyy-MM or yyyy-MM-dd) into the period it covers.
+ **/
+bool DkCatalogQuery::parseDate(const QString &date, qint64 &start, qint64 &end)
+{
+    QString d = date;
+    d.replace(QRegularExpression("[\\.:/]"), "-");
+
+    QDate s, e;
+    if ((s = QDate::fromString(d, "yyyy-MM-dd")).isValid())
+        e = s.addDays(1);
+    else if ((s = QDate::fromString(d, "yyyy-MM")).isValid())
+        e = s.addMonths(1);
+    else if ((s = QDate::fromString(d, "yyyy")).isValid())
+        e = s.addYears(1);
+    else
+        return false;
+
+    start = s.startOfDay().toMSecsSinceEpoch();
+    end = e.startOfDay().toMSecsSinceEpoch();
+
+    return true;
+}
+
+// DkMetaDataCatalog --------------------------------------------------------------------
+DkMetaDataCatalog::DkMetaDataCatalog(const QString &dirPath)
+{
+    mDirPath = dirPath;
+}
+
+/**
+ * Returns the catalog of a folder.
+ * Catalogs of recently used folders are kept in memory.
+ * @param dirPath the folder
+ **/
+QSharedPointer<DkMetaDataCatalog> DkMetaDataCatalog::catalog(const QString &dirPath)
+{
+    static QMutex mutex;
+    static QVector<QSharedPointer<DkMetaDataCatalog>> catalogs;
+    const int maxCatalogs = 4;
+
+    QString path = QDir::cleanPath(dirPath);
+    QMutexLocker locker(&mutex);
+
+    for (int idx = 0; idx < catalogs.size(); idx++) {
+        if (catalogs[idx]->dirPath() == path) {
+            QSharedPointer<DkMetaDataCatalog> c = catalogs.takeAt(idx);
+            catalogs.prepend(c);
+            return c;
+        }
+    }
+
+    QSharedPointer<DkMetaDataCatalog> c(new DkMetaDataCatalog(path));
+    catalogs.prepend(c);
+
+    if (catalogs.size() > maxCatalogs)
+        catalogs.removeLast();
+
+    return c;
+}
+
+/**
+ * Updates the catalogs of all files' folders.
+ * Only files that are new or changed since the last update are parsed.
+ * @param files the image files
+ **/
+void DkMetaDataCatalog::update(const QFileInfoList &files)
+{
+    QHash<QString, QFileInfoList> folders;
+    for (const QFileInfo &f : files)
+        folders[QDir::cleanPath(f.absolutePath())] << f;
+
+    for (auto it = folders.constBegin(); it != folders.constEnd(); it++)
+        catalog(it.key())->updateFolder(it.value());
+}
+
+/**
+ * Updates the catalogs in the background.
+ * @param files the image files
+ * @return QFuture<int> the number of files that were parsed (0 if the catalogs were up-to-date)
+ **/
+QFuture<int> DkMetaDataCatalog::updateAsync(const QFileInfoList &files)
+{
+    QHash<QString, QFileInfoList> folders;
+    for (const QFileInfo &f : files)
+        folders[QDir::cleanPath(f.absolutePath())] << f;
+
+    QVector<QSharedPointer<DkMetaDataCatalog>> catalogs;
+    QVector<QFileInfoList> folderFiles;
+
+    for (auto it = folders.constBegin(); it != folders.constEnd(); it++) {
+        catalogs << catalog(it.key());
+        folderFiles << it.value();
+    }
+
+    // the catalogs are kept alive until the update is finished
+    QFuture<int> future = QtConcurrent::run([catalogs, folderFiles]() {
+        int numParsed = 0;
+
+        for (int idx = 0; idx < catalogs.size(); idx++)
+            numParsed += catalogs[idx]->updateFolder(folderFiles[idx]);
+
+        return numParsed;
+    });
+
+    for (QSharedPointer<DkMetaDataCatalog> &c : catalogs)
+        c->mUpdateFuture = future;
+
+    return future;
+}
+
+/**
+ * Queries the catalogs of all files' folders.
+ * Only files that are indexed are matched. Call update() or updateAsync()
+ * before, if the catalogs might be outdated.
+ * @param files the files to be queried
+ * @param query the metadata query
+ * @return QStringList the file paths of all matches (sorted as requested by the query)
+ **/
+QStringList DkMetaDataCatalog::query(const QFileInfoList &files, const DkCatalogQuery &query)
+{
+    DkTimer dt;
+
+    QHash<QString, QSet<QString>> folders;
+    for (const QFileInfo &f : files)
+        folders[QDir::cleanPath(f.absolutePath())] << f.fileName();
+
+    QVector<DkCatalogEntry> results;
+
+    for (auto it = folders.constBegin(); it != folders.constEnd(); it++) {
+        QSharedPointer<DkMetaDataCatalog> c = catalog(it.key());
+        QMutexLocker locker(&c->mMutex);
+
+        if (!c->mLoaded)
+            c->load();
+
+        const QSet<QString> &fileNames = it.value();
+
+        for (auto eIt = c->mEntries.constBegin(); eIt != c->mEntries.constEnd(); eIt++) {
+            if (fileNames.contains(eIt.key()) && query.matches(eIt.value())) {
+                results << eIt.value();
+                results.last().fileName = QFileInfo(it.key(), eIt.key()).absoluteFilePath();
+            }
+        }
+    }
+
+    query.sort(results);
+
+    QStringList filePaths;
+    for (const DkCatalogEntry &e : results)
+        filePaths << e.fileName;
+
+    qInfo() << "[Catalog]" << filePaths.size() << "of" << files.size() << "files match in" << dt;
+
+    return filePaths;
+}
+
+void DkMetaDataCatalog::waitForUpdate()
+{
+    mUpdateFuture.waitForFinished();
+}
+
+QVector<DkCatalogEntry> DkMetaDataCatalog::entries() const
+{
+    QMutexLocker locker(&mMutex);
+
+    QVector<DkCatalogEntry> entries;
+    entries.reserve(mEntries.size());
+    for (auto it = mEntries.constBegin(); it != mEntries.constEnd(); it++)
+        entries << it.value();
+
+    return entries;
+}
+
+QString DkMetaDataCatalog::dirPath() const
+{
+    return mDirPath;
+}
+
+/**
+ * The catalog is stored in the app data folder (we do not want to write to image folders).
+ **/
+QString DkMetaDataCatalog::catalogPath() const
+{
+    QString hash = QString::fromLatin1(QCryptographicHash::hash(mDirPath.toUtf8(), QCryptographicHash::Sha1).toHex());
+    return DkUtils::getAppDataPath() + QDir::separator() + "catalogs" + QDir::separator() + hash + ".cat";
+}
+
+/**
+ * Metadata is parsed in a separate pool, so that indexing
+ * large folders does not block loading images & thumbnails.
+ **/
+QThreadPool *DkMetaDataCatalog::pool()
+{
+    static QThreadPool *p = []() {
+        QThreadPool *tp = new QThreadPool();
+        tp->setMaxThreadCount(qMax(tp->maxThreadCount() / 2, 1));
+        return tp;
+    }();
+
+    return p;
+}
+
+int DkMetaDataCatalog::updateFolder(const QFileInfoList &files)
+{
+    // one update at a time - a second one finds everything up-to-date
+    QMutexLocker updateLocker(&mUpdateMutex);
+
+    DkTimer dt;
+    QFileInfoList stale;
+    QHash<QString, DkCatalogEntry> entries;
+    QSet<QString> fileNames;
+    QHash<QString, DkCatalogEntry> oldEntries;
+
+    {
+        QMutexLocker locker(&mMutex);
+
+        if (!mLoaded)
+            load();
+
+        oldEntries = mEntries;
+    }
+
+    // the files are checked without holding the lock, so that queries are not blocked
+    for (const QFileInfo &f : files) {
+        fileNames << f.fileName();
+        auto it = oldEntries.constFind(f.fileName());
+
+        if (it == oldEntries.constEnd() || it->isStale(f))
+            stale << f;
+        else
+            entries.insert(it.key(), it.value());
+    }
+
+    // keep entries of files that are not listed (e.g. filtered) if they still exist
+    for (auto it = oldEntries.constBegin(); it != oldEntries.constEnd(); it++) {
+        if (!fileNames.contains(it.key()) && QFileInfo(mDirPath, it.key()).exists())
+            entries.insert(it.key(), it.value());
+    }
+
+    bool changed = !stale.empty() || entries.size() != oldEntries.size();
+
+    if (!stale.empty()) {
+        QVector<DkCatalogEntry> parsed(stale.size());
+        DkCatalogEntry *pd = parsed.data();
+
+        int numChunks = qMin(pool()->maxThreadCount(), (int)stale.size());
+        int chunkSize = (int)(stale.size() + numChunks - 1) / numChunks;
+        QVector<QFuture<void>> futures;
+
+        for (int cIdx = 0; cIdx < numChunks; cIdx++) {
+            int start = cIdx * chunkSize;
+            int end = qMin(start + chunkSize, (int)stale.size());
+
+            futures << QtConcurrent::run(pool(), [&stale, pd, start, end]() {
+                for (int idx = start; idx < end; idx++)
+                    pd[idx] = DkCatalogEntry::fromFile(stale.at(idx));
+            });
+        }
+
+        for (QFuture<void> &f : futures)
+            f.waitForFinished();
+
+        for (const DkCatalogEntry &e : parsed)
+            entries.insert(e.fileName, e);
+
+        qInfo() << "[Catalog]" << stale.size() << "files parsed in" << dt;
+    }
+
+    {
+        QMutexLocker locker(&mMutex);
+        mEntries = entries;
+    }
+
+    if (changed)
+        save();
+
+    return (int)stale.size();
+}
+
+bool DkMetaDataCatalog::load()
+{
+    mLoaded = true;
+
+    QFile file(catalogPath());
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    DkTimer dt;
+
+    QString magic, dirPath;
+    qint32 version = 0;
+    QDataStream ds(&file);
+    ds >> magic >> version >> dirPath;
+
+    if (magic != catalogMagic || version != catalogVersion || dirPath != mDirPath) {
+        qInfo() << "[Catalog] ignoring outdated catalog of" << mDirPath;
+        return false;
+    }
+
+    QVector<DkCatalogEntry> entries;
+    ds >> entries;
+
+    if (ds.status() != QDataStream::Ok)
+        return false;
+
+    mEntries.clear();
+    mEntries.reserve(entries.size());
+    for (const DkCatalogEntry &e : entries)
+        mEntries.insert(e.fileName, e);
+
+    qInfo() << "[Catalog]" << mEntries.size() << "entries loaded in" << dt;
+
+    return true;
+}
+
+bool DkMetaDataCatalog::save() const
+{
+    QVector<DkCatalogEntry> entries = this->entries();
+
+    QDir().mkpath(QFileInfo(catalogPath()).absolutePath());
+    QSaveFile file(catalogPath());
+
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "[Catalog] I could not write" << catalogPath();
+        return false;
+    }
+
+    QDataStream ds(&file);
+    ds << catalogMagic << (qint32)catalogVersion << mDirPath << entries;
+
+    return file.commit();
+}
+
+}
@@ -0,0 +1,202 @@
+/*******************************************************************************************************
+ DkMetaDataCatalog.h
+ Created on:	19.10.2026
+
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+
+ Copyright (C) 2011-2016 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2016 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2016 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ *******************************************************************************************************/
+
+#pragma once
+
+#pragma warning(push, 0) // no warnings from includes - begin
+#include <QDateTime>
+#include <QFileInfo>
+#include <QFuture>
+#include <QHash>
+#include <QMutex>
+#include <QRegularExpression>
+#include <QSharedPointer>
+#include <QSize>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#pragma warning(pop) // no warnings from includes - end
+
+#pragma warning(disable : 4251) // TODO: remove
+
+#ifndef DllCoreExport
+#ifdef DK_CORE_DLL_EXPORT
+#define DllCoreExport Q_DECL_EXPORT
+#elif DK_DLL_IMPORT
+#define DllCoreExport Q_DECL_IMPORT
+#else
+#define DllCoreExport Q_DECL_IMPORT
+#endif
+#endif
+
+class QDataStream;
+class QThreadPool;
+
+namespace nmc
+{
+
+/**
+ * The metadata of a single file as stored in the catalog.
+ **/
+class DllCoreExport DkCatalogEntry
+{
+public:
+    QString fileName;
+    qint64 fileSize = 0;
+    qint64 modified = 0; // msecs since epoch
+
+    qint64 captured = 0; // msecs since epoch, 0 if unknown
+    QString make;
+    QString model;
+    QString lens;
+    int rating = 0;
+    QStringList keywords;
+    QSize size;
+
+    bool hasGps = false;
+    double latitude = 0.0;
+    double longitude = 0.0;
+
+    QString camera() const;
+    bool isStale(const QFileInfo &file) const;
+
+    static DkCatalogEntry fromFile(const QFileInfo &file);
+};
+
+DllCoreExport QDataStream &operator<<(QDataStream &s, const DkCatalogEntry &e);
+DllCoreExport QDataStream &operator>>(QDataStream &s, DkCatalogEntry &e);
+
+/**
+ * A metadata query such as: rating >= 4 and camera = nikon order by date desc
+ * Clauses are combined with 'and', text fields match case insensitive
+ * substrings ('~' matches regular expressions). Dates can be given as
+ * yyyy, yyyy-MM or yyyy-MM-dd and compare against the whole period.
+ **/
+class DllCoreExport DkCatalogQuery
+{
+public:
+    DkCatalogQuery(const QString &query = QString());
+
+    enum Field {
+        field_name = 0,
+        field_date,
+        field_rating,
+        field_camera,
+        field_make,
+        field_model,
+        field_lens,
+        field_keyword,
+        field_width,
+        field_height,
+        field_gps,
+
+        field_end
+    };
+
+    static bool isQuery(const QString &query);
+
+    bool isValid() const;
+    QString error() const;
+
+    bool matches(const DkCatalogEntry &entry) const;
+    void sort(QVector<DkCatalogEntry> &entries) const;
+
+private:
+    enum Op {
+        op_eq = 0,
+        op_neq,
+        op_less,
+        op_less_eq,
+        op_greater,
+        op_greater_eq,
+        op_regexp,
+    };
+
+    struct Clause {
+        Field field = field_end;
+        Op op = op_eq;
+        QString text;
+        QRegularExpression exp;
+        qint64 number = 0;
+        qint64 numberEnd = 0; // dates are periods [number, numberEnd)
+    };
+
+    bool parseClause(const QString &clause);
+    bool matches(const Clause &c, const DkCatalogEntry &entry) const;
+    bool matchesText(const Clause &c, const QString &text) const;
+    bool compare(const Clause &c, qint64 value) const;
+
+    static Field toField(const QString &name);
+    static bool parseDate(const QString &date, qint64 &start, qint64 &end);
+
+    QVector<Clause> mClauses;
+    Field mSortField = field_end;
+    bool mSortDescending = false;
+    QString mError;
+};
+
+/**
+ * A persistent metadata catalog of a single folder.
+ * The catalog parses the metadata headers of all images once (in parallel)
+ * and stores them keyed by file name, size and modification date in the app
+ * data folder. Queries and sorting then run in memory without touching the
+ * images again. Only files that changed are parsed when it is updated.
+ **/
+class DllCoreExport DkMetaDataCatalog
+{
+public:
+    static QSharedPointer<DkMetaDataCatalog> catalog(const QString &dirPath);
+
+    static void update(const QFileInfoList &files);
+    static QFuture<int> updateAsync(const QFileInfoList &files);
+    static QStringList query(const QFileInfoList &files, const DkCatalogQuery &query);
+
+    void waitForUpdate();
+    QVector<DkCatalogEntry> entries() const;
+
+    QString dirPath() const;
+    QString catalogPath() const;
+
+    static QThreadPool *pool();
+
+private:
+    DkMetaDataCatalog(const QString &dirPath);
+
+    int updateFolder(const QFileInfoList &files);
+    bool load();
+    bool save() const;
+
+    QString mDirPath;
+    QHash<QString, DkCatalogEntry> mEntries;
+    bool mLoaded = false;
+
+    mutable QMutex mMutex;
+    QMutex mUpdateMutex;
+    QFuture<void> mUpdateFuture;
+};
+
+}
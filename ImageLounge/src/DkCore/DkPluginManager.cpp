@@ -35,6 +35,7 @@
 
 #pragma warning(push, 0) // no warnings from includes - begin
 #include <QAction>
+#include <QBuffer>
 #include <QDebug>
 #include <QDir>
 #include <QHeaderView>
@@ -174,7 +175,6 @@ DkPluginContainer::DkPluginContainer(const QString &pluginPath)
 {
     mPluginPath = pluginPath;
     mLoader = QSharedPointer<QPluginLoader>(new QPluginLoader(mPluginPath));
-    loadJson();
 }
 
 DkPluginContainer::~DkPluginContainer()
@@ -193,6 +193,10 @@ void DkPluginContainer::setActive(bool active)
 {
     mActive = active;
 
+    // do not pull in the library just to deactivate it
+    if (!mInitialized)
+        return;
+
     DkPluginInterface *p = plugin();
     if (p && p->interfaceType() == DkPluginInterface::interface_viewport) {
         DkViewPortInterface *vPlugin = pluginViewPort();
@@ -216,6 +220,9 @@ bool DkPluginContainer::isLoaded() const
 
 bool DkPluginContainer::load()
 {
+    if (mInitialized)
+        return true;
+
     DkTimer dt;
 
     if (!isValid()) {
@@ -263,10 +270,142 @@ bool DkPluginContainer::load()
         createMenu();
     }
 
+    mInitialized = true;
+
     qInfo() << mPluginPath << "loaded in" << dt;
     return true;
 }
 
+/**
+ * Loads the plugin if only its manifest is known so far.
+ * The manifest is refreshed with the plugin's real actions afterwards.
+ * @return bool true if the plugin is ready to be used
+ **/
+bool DkPluginContainer::ensureLoaded()
+{
+    if (mInitialized)
+        return true;
+
+    if (!load())
+        return false;
+
+    QSettings manifest(DkPluginManager::manifestPath(), QSettings::IniFormat);
+    saveManifest(manifest);
+
+    return true;
+}
+
+/**
+ * Initializes the container from the cached plugin manifest.
+ * The entry is only used if the plugin file did not change since it was written.
+ * @param settings the manifest
+ * @return bool true if a matching entry was found
+ **/
+bool DkPluginContainer::loadManifest(QSettings &settings)
+{
+    QFileInfo fi(mPluginPath);
+
+    settings.beginGroup(fi.fileName());
+
+    bool upToDate = settings.value("path").toString() == mPluginPath && settings.value("size").toLongLong() == fi.size()
+        && settings.value("modified").toDateTime() == fi.lastModified()
+        && settings.value("nomacsVersion").toString() == QCoreApplication::applicationVersion();
+
+    if (upToDate) {
+        mIsValid = settings.value("valid", false).toBool();
+        mType = (PluginType)settings.value("type", type_unknown).toInt();
+        mPluginName = settings.value("PluginName").toString();
+        mAuthorName = settings.value("AuthorName").toString();
+        mCompany = settings.value("Company").toString();
+        mDateCreated = settings.value("DateCreated").toDate();
+        mDateModified = settings.value("DateModified").toDate();
+        mDescription = settings.value("Description").toString();
+        mTagline = settings.value("Tagline").toString();
+        mVersion = settings.value("Version").toString();
+        mId = settings.value("PluginId").toString();
+
+        int numActions = settings.beginReadArray("Actions");
+
+        for (int idx = 0; idx < numActions; idx++) {
+            settings.setArrayIndex(idx);
+
+            QAction *a = new QAction(settings.value("text").toString(), this);
+            a->setData(settings.value("runId"));
+            a->setStatusTip(settings.value("statusTip").toString());
+
+            QPixmap icon;
+            if (icon.loadFromData(settings.value("icon").toByteArray(), "PNG"))
+                a->setIcon(icon);
+
+            connect(a, SIGNAL(triggered()), this, SLOT(runProxyAction()));
+            mProxyActions << a;
+        }
+
+        settings.endArray();
+        createProxyMenu();
+    }
+
+    settings.endGroup();
+
+    return upToDate;
+}
+
+/**
+ * Writes the plugin's metadata and actions to the manifest.
+ * Invalid plugins are stored too so that their metadata is not parsed again.
+ * @param settings the manifest
+ **/
+void DkPluginContainer::saveManifest(QSettings &settings) const
+{
+    QFileInfo fi(mPluginPath);
+
+    settings.beginGroup(fi.fileName());
+    settings.remove("");
+
+    settings.setValue("path", mPluginPath);
+    settings.setValue("size", fi.size());
+    settings.setValue("modified", fi.lastModified());
+    settings.setValue("nomacsVersion", QCoreApplication::applicationVersion());
+    settings.setValue("valid", mIsValid);
+
+    if (mIsValid) {
+        settings.setValue("type", mType);
+        settings.setValue("PluginName", mPluginName);
+        settings.setValue("AuthorName", mAuthorName);
+        settings.setValue("Company", mCompany);
+        settings.setValue("DateCreated", mDateCreated);
+        settings.setValue("DateModified", mDateModified);
+        settings.setValue("Description", mDescription);
+        settings.setValue("Tagline", mTagline);
+        settings.setValue("Version", mVersion);
+        settings.setValue("PluginId", mId);
+
+        QList<QAction *> pActions = actions();
+        settings.beginWriteArray("Actions", pActions.size());
+
+        for (int idx = 0; idx < pActions.size(); idx++) {
+            const QAction *a = pActions[idx];
+
+            settings.setArrayIndex(idx);
+            settings.setValue("text", a->text());
+            settings.setValue("runId", a->data());
+            settings.setValue("statusTip", a->statusTip());
+
+            if (!a->icon().isNull()) {
+                QByteArray ba;
+                QBuffer buffer(&ba);
+                buffer.open(QIODevice::WriteOnly);
+                a->icon().pixmap(32).save(&buffer, "PNG");
+                settings.setValue("icon", ba);
+            }
+        }
+
+        settings.endArray();
+    }
+
+    settings.endGroup();
+}
+
 bool DkPluginContainer::uninstall()
 {
     mLoader->unload();
@@ -283,6 +422,10 @@ void DkPluginContainer::createMenu()
     if (!p || p->pluginActions().empty())
         return;
 
+    // replace the manifest's stand-in menu
+    if (mPluginMenu)
+        mPluginMenu->deleteLater();
+
     mPluginMenu = new QMenu(pluginName(), DkUtils::getMainWindow());
 
     for (auto action : p->pluginActions()) {
@@ -291,6 +434,15 @@ void DkPluginContainer::createMenu()
     }
 }
 
+void DkPluginContainer::createProxyMenu()
+{
+    if (mProxyActions.empty())
+        return;
+
+    mPluginMenu = new QMenu(pluginName(), DkUtils::getMainWindow());
+    mPluginMenu->addActions(mProxyActions);
+}
+
 void DkPluginContainer::loadJson()
 {
     QJsonObject metaData = mLoader->metaData();
@@ -361,6 +513,9 @@ void DkPluginContainer::loadMetaData(const QJsonValue &val)
 
 void DkPluginContainer::run()
 {
+    if (!ensureLoaded())
+        return;
+
     DkPluginInterface *p = plugin();
 
     if (p && p->interfaceType() == DkPluginInterface::interface_viewport) {
@@ -392,6 +547,24 @@ void DkPluginContainer::run()
         qWarning() << "plugin with illegal interface detected in DkPluginContainer::run()";
 }
 
+void DkPluginContainer::runProxyAction()
+{
+    QAction *proxy = qobject_cast<QAction *>(QObject::sender());
+
+    if (!proxy || !ensureLoaded())
+        return;
+
+    // forward to the plugin's own action so that its connections are triggered too
+    for (QAction *a : plugin()->pluginActions()) {
+        if (a->data() == proxy->data()) {
+            a->trigger();
+            return;
+        }
+    }
+
+    run();
+}
+
 bool DkPluginContainer::isValid() const
 {
     return mIsValid;
@@ -472,11 +645,29 @@ QDate DkPluginContainer::dateModified() const
     return mDateModified;
 }
 
+DkPluginContainer::PluginType DkPluginContainer::type() const
+{
+    return mType;
+}
+
 QMenu *DkPluginContainer::pluginMenu() const
 {
     return mPluginMenu;
 }
 
+/**
+ * Returns the plugin's actions.
+ * If the plugin is not loaded yet, the stand-ins from the manifest are returned.
+ **/
+QList<QAction *> DkPluginContainer::actions() const
+{
+    if (!mInitialized)
+        return mProxyActions;
+
+    DkPluginInterface *p = plugin();
+    return p ? p->pluginActions() : QList<QAction *>();
+}
+
 QSharedPointer<QPluginLoader> DkPluginContainer::loader() const
 {
     return mLoader;
@@ -518,11 +709,7 @@ DkViewPortInterface *DkPluginContainer::pluginViewPort() const
 
 QString DkPluginContainer::actionNameToRunId(const QString &actionName) const
 {
-    if (!plugin())
-        return QString();
-
-    QList<QAction *> actions = plugin()->pluginActions();
-    for (const QAction *a : actions) {
+    for (const QAction *a : actions()) {
         if (a->text() == actionName)
             return a->data().toString();
     }
@@ -1047,7 +1234,7 @@ void DkDescriptionImage::updateImage()
         const QVector<QSharedPointer<DkPluginContainer>> &plugins = DkPluginManager::instance().getPlugins();
         QSharedPointer<DkPluginContainer> plugin = plugins.at(sourceIndex.row());
 
-        if (plugin && plugin->plugin())
+        if (plugin && plugin->ensureLoaded() && plugin->plugin())
             img = plugin->plugin()->image();
         if (!img.isNull())
             setPixmap(QPixmap::fromImage(img));
@@ -1146,6 +1333,9 @@ void DkPluginManager::loadPlugins()
 
     DkTimer dt;
 
+    // plugins found in the manifest are not loaded before they are used
+    QSettings manifest(manifestPath(), QSettings::IniFormat);
+
     QStringList loadedPluginFileNames = QStringList();
     QStringList libPaths = QCoreApplication::libraryPaths();
     libPaths.append(QCoreApplication::applicationDirPath() + "/plugins");
@@ -1175,7 +1365,7 @@ void DkPluginManager::loadPlugins()
 #endif
             QString shortFileName = fileName.split("/").last();
             if (!loadedPluginFileNames.contains(shortFileName)) { // prevent double loading of the same plugin
-                if (singlePluginLoad(pluginsDir.absoluteFilePath(fileName)))
+                if (singlePluginLoad(pluginsDir.absoluteFilePath(fileName), manifest))
                     loadedPluginFileNames.append(shortFileName);
             }
             // else
@@ -1184,27 +1374,38 @@ void DkPluginManager::loadPlugins()
     }
 
     std::sort(mPlugins.begin(), mPlugins.end()); // , &DkPluginContainer::operator<);
-    qInfo() << mPlugins.size() << "plugins loaded in" << dt;
+    qInfo() << mPlugins.size() << "plugins found in" << dt;
 
     if (mPlugins.empty())
         qInfo() << "I was searching these paths" << libPaths;
 }
 
 /**
- * Loads one plugin from file fileName
+ * Adds one plugin from file fileName.
+ * The library is only loaded if the manifest does not know the plugin yet.
  * @param fileName
+ * @param manifest the cached plugin manifest
  **/
-bool DkPluginManager::singlePluginLoad(const QString &filePath)
+bool DkPluginManager::singlePluginLoad(const QString &filePath, QSettings &manifest)
 {
     if (isBlackListed(filePath))
         return false;
 
-    DkTimer dt;
     QSharedPointer<DkPluginContainer> plugin = QSharedPointer<DkPluginContainer>(new DkPluginContainer(filePath));
-    if (plugin->load())
-        mPlugins.append(plugin);
 
-    return plugin->isLoaded();
+    if (!plugin->loadManifest(manifest)) {
+        plugin->loadJson();
+
+        // libraries that fail to load are probed again on the next start
+        if (plugin->load() || !plugin->isValid())
+            plugin->saveManifest(manifest);
+    }
+
+    if (!plugin->isValid() || plugin->type() == DkPluginContainer::type_unknown)
+        return false;
+
+    mPlugins.append(plugin);
+    return true;
 }
 
 QSharedPointer<DkPluginContainer> DkPluginManager::getPluginByName(const QString &pluginName) const
@@ -1232,9 +1433,7 @@ QVector<QSharedPointer<DkPluginContainer>> DkPluginManager::getBasicPlugins() co
     QVector<QSharedPointer<DkPluginContainer>> plugins;
 
     for (auto plugin : mPlugins) {
-        DkPluginInterface *p = plugin->plugin();
-
-        if (p && p->interfaceType() == DkPluginInterface::interface_basic) {
+        if (plugin->type() == DkPluginContainer::type_simple) {
             plugins.append(plugin);
         }
     }
@@ -1247,9 +1446,7 @@ QVector<QSharedPointer<DkPluginContainer>> DkPluginManager::getBatchPlugins() co
     QVector<QSharedPointer<DkPluginContainer>> plugins;
 
     for (auto plugin : mPlugins) {
-        DkPluginInterface *p = plugin->plugin();
-
-        if (p && (p->interfaceType() == DkPluginInterface::interface_basic || p->interfaceType() == DkPluginInterface::interface_batch)) {
+        if (plugin->type() == DkPluginContainer::type_simple || plugin->type() == DkPluginContainer::type_batch) {
             plugins.append(plugin);
         }
     }
@@ -1329,6 +1526,11 @@ void DkPluginManager::createPluginsPath()
 #endif // WITH_PLUGINS
 }
 
+QString DkPluginManager::manifestPath()
+{
+    return DkUtils::getAppDataPath() + QDir::separator() + "plugin-manifest.ini";
+}
+
 // DkPluginActionManager --------------------------------------------------------------------
 DkPluginActionManager::DkPluginActionManager(QObject *parent)
     : QObject(parent)
@@ -1441,13 +1643,10 @@ void DkPluginActionManager::addPluginsToMenu()
     QStringList pluginMenu = QStringList();
 
     for (auto plugin : loadedPlugins) {
-        DkPluginInterface *pi = plugin->plugin();
-
-        if (pi && plugin->pluginMenu()) {
-            QList<QAction *> actions = pi->createActions(DkUtils::getMainWindow());
+        if (plugin->pluginMenu()) {
             mPluginSubMenus.append(plugin->pluginMenu());
             mMenu->addMenu(plugin->pluginMenu());
-        } else if (pi) {
+        } else {
             QAction *a = new QAction(plugin->pluginName(), this);
             a->setData(plugin->id());
             mPluginActions.append(a);
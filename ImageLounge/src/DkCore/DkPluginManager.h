@@ -51,6 +51,7 @@ class QItemSelection;
 class QProgressDialog;
 class QSortFilterProxyModel;
 class QJsonValue;
+class QSettings;
 
 namespace nmc
 {
@@ -115,8 +116,13 @@ public:
     bool isValid() const;
     bool isLoaded() const;
     bool load();
+    bool ensureLoaded();
     bool uninstall();
 
+    void loadJson();
+    bool loadManifest(QSettings &settings);
+    void saveManifest(QSettings &settings) const;
+
     // attributes
     QString pluginPath() const;
     QString pluginName() const;
@@ -131,7 +137,9 @@ public:
     QDate dateCreated() const;
     QDate dateModified() const;
 
+    PluginType type() const;
     QMenu *pluginMenu() const;
+    QList<QAction *> actions() const;
 
     QSharedPointer<QPluginLoader> loader() const;
     DkPluginInterface *plugin() const;
@@ -145,6 +153,7 @@ signals:
 
 public slots:
     void run();
+    void runProxyAction();
 
 protected:
     QString mPluginPath;
@@ -161,15 +170,17 @@ protected:
 
     bool mActive = false;
     bool mIsValid = false;
+    bool mInitialized = false;
 
     PluginType mType = type_unknown;
 
     QMenu *mPluginMenu = 0;
+    QList<QAction *> mProxyActions; // stand-ins built from the manifest until the plugin is loaded
 
     QSharedPointer<QPluginLoader> mLoader = QSharedPointer<QPluginLoader>();
 
     void createMenu();
-    void loadJson();
+    void createProxyMenu();
     void loadMetaData(const QJsonValue &val);
 };
 
@@ -232,7 +243,7 @@ public:
 
     void loadPlugins();
 
-    bool singlePluginLoad(const QString &filePath);
+    bool singlePluginLoad(const QString &filePath, QSettings &manifest);
 
     QVector<QSharedPointer<DkPluginContainer>> getBasicPlugins() const;
     QVector<QSharedPointer<DkPluginContainer>> getBatchPlugins() const;
@@ -245,6 +256,7 @@ public:
     bool isBlackListed(const QString &pluginPath) const;
     static QStringList blackList();
     static void createPluginsPath();
+    static QString manifestPath();
 
 private:
     DkPluginManager();
@@ -26,8 +26,10 @@
  *******************************************************************************************************/
 
 #include "DkProcess.h"
+#include "DkFileReadCache.h"
 #include "DkImageContainer.h"
 #include "DkImageStorage.h"
+#include "DkJpegTransform.h"
 #include "DkManipulators.h"
 #include "DkMath.h"
 #include "DkPluginManager.h"
@@ -38,13 +40,32 @@
 #include "DkMetaData.h"
 
 #pragma warning(push, 0) // no warnings from includes - begin
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDir>
 #include <QFuture>
 #include <QFutureWatcher>
+#include <QImageReader>
+#include <QSet>
+#include <QSettings>
+#include <QTemporaryFile>
 #include <QWidget>
 #include <QtConcurrentMap>
+#include <QtConcurrentRun>
 #pragma warning(pop) // no warnings from includes - end
 
+#if defined(Q_OS_LINUX)
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#elif defined(Q_OS_MAC)
+#include <sys/clonefile.h>
+#endif
+
 #include <cassert>
+#include <functional>
 
 namespace nmc
 {
@@ -246,6 +267,19 @@ bool DkBatchTransform::isActive() const
     return mAngle != 0 || mCropFromMetadata || cropFromRectangle() || isResizeActive();
 }
 
+bool DkBatchTransform::losslessTransform(DkJpegTransform &transform) const
+{
+    if (mCropFromMetadata || isResizeActive() || mAngle % 90 != 0)
+        return false;
+
+    transform.rotate(mAngle);
+
+    if (cropFromRectangle())
+        transform.setCrop(mCropRect, mCropRectCenter);
+
+    return transform.isValid();
+}
+
 int DkBatchTransform::angle() const
 {
     return mAngle;
@@ -512,6 +546,16 @@ bool DkManipulatorBatch::isActive() const
     return mManager.numSelected() > 0;
 }
 
+bool DkManipulatorBatch::losslessTransform(DkJpegTransform &transform) const
+{
+    for (const QSharedPointer<DkBaseManipulator> &mpl : mManager.manipulators()) {
+        if (mpl->isSelected() && !mpl->losslessTransform(transform))
+            return false;
+    }
+
+    return transform.isValid();
+}
+
 DkManipulatorManager DkManipulatorBatch::manager() const
 {
     return mManager;
@@ -690,6 +734,10 @@ void DkPluginBatch::loadAllPlugins()
         if (pluginContainer) {
             qDebug() << "loading" << pluginContainer->pluginName() << "id:" << runID;
 
+            // plugins are loaded lazily - this is their first use
+            if (!pluginContainer->ensureLoaded())
+                qWarning() << "could not load: " << cPluginString;
+
             // get plugin
             DkBatchPluginInterface *plugin = pluginContainer->batchPlugin();
 
@@ -719,6 +767,194 @@ void DkPluginBatch::loadPlugin(const QString &pluginString, QSharedPointer<DkPlu
 }
 #endif
 
+// serializes whatever write() stores into an ini file
+static QByteArray settingsToBytes(const std::function<void(QSettings &)> &write)
+{
+    QTemporaryFile tmpFile;
+    if (!tmpFile.open())
+        return QByteArray();
+    tmpFile.close(); // the file is removed when tmpFile is destroyed
+
+    {
+        QSettings settings(tmpFile.fileName(), QSettings::IniFormat);
+        write(settings);
+        settings.sync();
+    }
+
+    QFile file(tmpFile.fileName());
+    if (!file.open(QIODevice::ReadOnly))
+        return QByteArray();
+
+    return file.readAll();
+}
+
+// number of leading process steps that are equal (same type and settings) in all chains
+static int commonPrefixLength(const QVector<QSharedPointer<DkAbstractBatch>> &chain, const QVector<QVector<QSharedPointer<DkAbstractBatch>>> &others)
+{
+    auto settingsOf = [](const QSharedPointer<DkAbstractBatch> &batch) {
+        return settingsToBytes([&batch](QSettings &settings) {
+            batch->saveSettings(settings);
+        });
+    };
+
+    int length = 0;
+
+    for (; length < chain.size(); length++) {
+        const QSharedPointer<DkAbstractBatch> &step = chain[length];
+        if (!step)
+            return length;
+
+        QByteArray stepSettings = settingsOf(step);
+
+        for (const QVector<QSharedPointer<DkAbstractBatch>> &o : others) {
+            if (length >= o.size() || !o[length])
+                return length;
+
+            if (o[length] != step && (o[length]->settingsName() != step->settingsName() || settingsOf(o[length]) != stepSettings))
+                return length;
+        }
+    }
+
+    return length;
+}
+
+// DkBatchManifest --------------------------------------------------------------------
+DkBatchManifest::DkBatchManifest(const QString &outputDirPath, const QString &profileHash)
+{
+    mProfileHash = profileHash;
+    mFile.setFileName(QDir(outputDirPath).absoluteFilePath(fileName()));
+
+    load();
+}
+
+DkBatchManifest::~DkBatchManifest()
+{
+    mFile.close();
+}
+
+QString DkBatchManifest::fileName()
+{
+    return ".nomacs-batch-manifest";
+}
+
+/**
+ * Hashes everything that influences the output of a batch except for the file list.
+ * @param config the batch config
+ * @return QString a hex encoded SHA1 hash of the profile
+ **/
+QString DkBatchManifest::profileHash(const DkBatchConfig &config)
+{
+    DkBatchConfig bc = config;
+    bc.setFileList(QStringList());
+
+    QByteArray ba = settingsToBytes([&bc](QSettings &settings) {
+        bc.saveSettings(settings);
+    });
+
+    return QCryptographicHash::hash(ba, QCryptographicHash::Sha1).toHex();
+}
+
+bool DkBatchManifest::isUpToDate(const DkSaveInfo &saveInfo) const
+{
+    QFileInfo inInfo(saveInfo.inputFilePath());
+    QString outPath = QFileInfo(saveInfo.outputFilePath()).absoluteFilePath();
+
+    Entry entry;
+    {
+        QMutexLocker locker(&mMutex);
+        auto it = mEntries.constFind(outPath);
+
+        if (it == mEntries.constEnd())
+            return false;
+        entry = it.value();
+    }
+
+    return entry.profileHash == mProfileHash && entry.inputFilePath == inInfo.absoluteFilePath() && entry.size == inInfo.size()
+        && entry.lastModified == inInfo.lastModified().toMSecsSinceEpoch() && QFileInfo::exists(outPath);
+}
+
+void DkBatchManifest::update(const DkSaveInfo &saveInfo)
+{
+    QFileInfo inInfo(saveInfo.inputFilePath());
+    QString outPath = QFileInfo(saveInfo.outputFilePath()).absoluteFilePath();
+
+    Entry entry;
+    entry.inputFilePath = inInfo.absoluteFilePath();
+    entry.size = inInfo.size();
+    entry.lastModified = inInfo.lastModified().toMSecsSinceEpoch();
+    entry.profileHash = mProfileHash;
+
+    QMutexLocker locker(&mMutex);
+    mEntries.insert(outPath, entry);
+
+    if (mFile.isOpen()) {
+        mFile.write(toLine(outPath, entry).toUtf8());
+        mFile.flush(); // flush every line - we want to resume if we crash
+    }
+}
+
+void DkBatchManifest::load()
+{
+    const QString header = "# nomacs batch manifest 1";
+    int numLines = 0;
+
+    if (mFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        if (QString::fromUtf8(mFile.readLine()).trimmed() == header) {
+            while (!mFile.atEnd()) {
+                QByteArray line = mFile.readLine();
+                if (line.endsWith('\n'))
+                    line.chop(1);
+
+                QStringList cols = QString::fromUtf8(line).split('\t');
+                numLines++;
+
+                if (cols.size() != 5)
+                    continue;
+
+                Entry entry;
+                entry.inputFilePath = cols[0];
+                entry.size = cols[1].toLongLong();
+                entry.lastModified = cols[2].toLongLong();
+                entry.profileHash = cols[3];
+                mEntries.insert(cols[4], entry);
+            }
+        } else
+            qWarning() << "ignoring unknown batch manifest:" << mFile.fileName();
+
+        mFile.close();
+    }
+
+    // drop superseded lines if the manifest grew too much
+    if (numLines > 2 * mEntries.size() + 256 || numLines == 0) {
+        compact();
+        return;
+    }
+
+    if (!mFile.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text))
+        qWarning() << "cannot write batch manifest:" << mFile.fileName();
+}
+
+void DkBatchManifest::compact()
+{
+    if (!mFile.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        qWarning() << "cannot write batch manifest:" << mFile.fileName();
+        return;
+    }
+
+    QByteArray ba = "# nomacs batch manifest 1\n";
+    for (auto it = mEntries.constBegin(); it != mEntries.constEnd(); it++)
+        ba += toLine(it.key(), it.value()).toUtf8();
+
+    mFile.write(ba);
+    mFile.flush();
+}
+
+QString DkBatchManifest::toLine(const QString &outputFilePath, const Entry &entry) const
+{
+    return entry.inputFilePath + '\t' + QString::number(entry.size) + '\t' + QString::number(entry.lastModified) + '\t' + entry.profileHash + '\t'
+        + outputFilePath + '\n';
+}
+
 // DkBatchProcess --------------------------------------------------------------------
 DkBatchProcess::DkBatchProcess(const DkSaveInfo &saveInfo)
 {
@@ -730,6 +966,33 @@ void DkBatchProcess::setProcessChain(const QVector<QSharedPointer<DkAbstractBatc
     mProcessFunctions = processes;
 }
 
+void DkBatchProcess::setSharedProcessChain(const QVector<QSharedPointer<DkAbstractBatch>> processes)
+{
+    mSharedFunctions = processes;
+}
+
+void DkBatchProcess::addBranch(const DkBatchProcess &branch)
+{
+    mBranches << branch;
+}
+
+void DkBatchProcess::setManifest(QSharedPointer<DkBatchManifest> manifest)
+{
+    mManifest = manifest;
+}
+
+/**
+ * Stores the result of the planning phase.
+ * @param outputExists true if the output file existed when the batch was planned
+ * @param conflict if not empty, the item fails with this message (e.g. two items share a target)
+ **/
+void DkBatchProcess::setPlan(bool outputExists, const QString &conflict)
+{
+    mIsPlanned = true;
+    mOutputExists = outputExists;
+    mConflict = conflict;
+}
+
 QString DkBatchProcess::inputFile() const
 {
     return mSaveInfo.inputFilePath();
@@ -755,16 +1018,46 @@ bool DkBatchProcess::wasProcessed() const
     return mIsProcessed;
 }
 
+bool DkBatchProcess::wasSkipped() const
+{
+    return mIsSkipped;
+}
+
 bool DkBatchProcess::compute()
 {
     mIsProcessed = true;
 
+    // the planning phase found that this item clashes with another one
+    if (!mConflict.isEmpty()) {
+        mLogStrings.append(mConflict);
+        mFailure++;
+        return mFailure == 0;
+    }
+
+    // nothing changed since the last run?
+    if (isUpToDate()) {
+        mLogStrings.append(QObject::tr("%1 is up to date -> skipping").arg(mSaveInfo.inputFilePath()));
+        mIsSkipped = true;
+        DkTracer::instance().addCounter("batch items up to date");
+        return true;
+    }
+
     QFileInfo fInfoIn(mSaveInfo.inputFilePath());
     QFileInfo fInfoOut(mSaveInfo.outputFilePath());
 
+    // an existing primary output is skipped, missing branch outputs are still produced
+    mSkipOutput = skipsOutput();
+    bool branchesSkipped = true;
+
+    for (const DkBatchProcess &branch : mBranches) {
+        if (!branch.skipsOutput()) {
+            branchesSkipped = false;
+            break;
+        }
+    }
+
     // check errors
-    if ((mSaveInfo.mode() & DkSaveInfo::mode_do_not_save_output) == 0 && // do not save is not set
-        (fInfoOut.exists() && mSaveInfo.mode() == DkSaveInfo::mode_skip_existing)) {
+    if (mSkipOutput && branchesSkipped) {
         mLogStrings.append(QObject::tr("%1 already exists -> skipping (check 'overwrite' if you want to overwrite the file)").arg(mSaveInfo.outputFilePath()));
         mFailure++;
         return mFailure == 0;
@@ -773,31 +1066,36 @@ bool DkBatchProcess::compute()
         mLogStrings.append(QObject::tr("Input: %1").arg(mSaveInfo.inputFilePath()));
         mFailure++;
         return mFailure == 0;
-    } else if (mSaveInfo.inputFilePath() == mSaveInfo.outputFilePath() && mProcessFunctions.empty()) {
+    } else if (mSaveInfo.inputFilePath() == mSaveInfo.outputFilePath() && mProcessFunctions.empty() && mBranches.empty()) {
         mLogStrings.append(QObject::tr("Skipping: nothing to do here."));
         mFailure++;
         return mFailure == 0;
     }
 
-    // rename operation?
-    if (mProcessFunctions.empty() && mSaveInfo.inputFilePath() == mSaveInfo.outputFilePath() && fInfoIn.suffix() == fInfoOut.suffix()) {
+    // rename operation? (a copy within the same directory that deletes the original)
+    if (mProcessFunctions.empty() && mBranches.empty() && (mSaveInfo.mode() & DkSaveInfo::mode_do_not_save_output) == 0 && mSaveInfo.isDeleteOriginal()
+        && fInfoIn.absolutePath() == fInfoOut.absolutePath() && fInfoIn.suffix() == fInfoOut.suffix() && !outputExists()) {
         if (!renameFile())
             mFailure++;
         return mFailure == 0;
     }
     // copy operation?
-    else if (mProcessFunctions.empty() && fInfoIn.suffix() == fInfoOut.suffix()) {
+    else if (mProcessFunctions.empty() && mBranches.empty() && fInfoIn.suffix() == fInfoOut.suffix()) {
         if (!copyFile())
             mFailure++;
         else
             deleteOriginalFile();
 
+        updateManifest();
+
         return mFailure == 0;
     }
 
     // do the work
     process();
 
+    updateManifest();
+
     // delete the original file if the user requested it
     deleteOriginalFile();
 
@@ -809,10 +1107,55 @@ QStringList DkBatchProcess::getLog() const
     return mLogStrings;
 }
 
+bool DkBatchProcess::isUpToDate() const
+{
+    if (!mManifest || !mManifest->isUpToDate(mSaveInfo))
+        return false;
+
+    for (const DkBatchProcess &branch : mBranches) {
+        if (!mManifest->isUpToDate(branch.mSaveInfo))
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * Returns true if the output exists and the user does not want to overwrite it.
+ **/
+bool DkBatchProcess::skipsOutput() const
+{
+    return (mSaveInfo.mode() & DkSaveInfo::mode_do_not_save_output) == 0 && mSaveInfo.mode() == DkSaveInfo::mode_skip_existing && outputExists();
+}
+
+bool DkBatchProcess::outputExists() const
+{
+    // the planning phase lists each output directory once instead of querying every file
+    if (mIsPlanned)
+        return mOutputExists;
+
+    return QFileInfo::exists(mSaveInfo.outputFilePath());
+}
+
+void DkBatchProcess::updateManifest()
+{
+    if (!mManifest || mFailure != 0)
+        return;
+
+    mManifest->update(mSaveInfo);
+
+    for (const DkBatchProcess &branch : mBranches)
+        mManifest->update(branch.mSaveInfo);
+}
+
 bool DkBatchProcess::process()
 {
     mLogStrings.append(QObject::tr("processing %1").arg(mSaveInfo.inputFilePath()));
 
+    // rotations, flips & aligned crops of jpgs do not need a decode
+    if (mBranches.empty() && processLossless())
+        return mFailure == 0;
+
     QSharedPointer<DkImageContainer> imgC(new DkImageContainer(mSaveInfo.inputFilePath()));
 
     if (!imgC->loadImage() || imgC->image().isNull()) {
@@ -821,7 +1164,165 @@ bool DkBatchProcess::process()
         return false;
     }
 
+    if (mBranches.empty())
+        return processImage(imgC);
+
+    // steps that all outputs have in common are computed once
+    applyProcessChain(mSharedFunctions, imgC);
+
+    // each branch gets its own copy of the decoded image and runs in parallel
+    QVector<QFuture<bool>> branchResults;
+    DkBatchProcess *branches = mBranches.data();
+
+    for (int idx = 0; idx < mBranches.size(); idx++) {
+        QSharedPointer<DkImageContainer> bImgC(new DkImageContainer(imgC->filePath()));
+        bImgC->getLoader()->setMetaData(imgC->getMetaData()->copy());
+        bImgC->getLoader()->setImage(imgC->image(), QObject::tr("Original Image"), imgC->filePath());
+
+        branchResults << QtConcurrent::run([branches, idx, bImgC]() {
+            return branches[idx].processBranch(bImgC);
+        });
+    }
+
+    bool success = false;
+
+    if (mSkipOutput) {
+        mLogStrings.append(QObject::tr("%1 already exists -> skipping (check 'overwrite' if you want to overwrite the file)").arg(mSaveInfo.outputFilePath()));
+        mFailure++;
+    } else
+        success = processImage(imgC);
+
+    for (int idx = 0; idx < mBranches.size(); idx++) {
+        branchResults[idx].waitForFinished();
+
+        const DkBatchProcess &branch = mBranches.at(idx);
+        mLogStrings << branch.getLog();
+        mInfos << branch.batchInfo();
+
+        if (branch.hasFailed()) {
+            mFailure++;
+            success = false;
+        }
+    }
+
+    return success;
+}
+
+/**
+ * @brief processLossless() transforms jpgs in the DCT domain.
+ *
+ * This is only done if all active batch functions are rotations, flips
+ * or MCU aligned crops and the output is a jpg too.
+ * @return bool false if the image needs to be processed the usual way
+ */
+bool DkBatchProcess::processLossless()
+{
+    if (mSaveInfo.mode() & DkSaveInfo::mode_do_not_save_output)
+        return false;
+
+    if (!DkJpegTransform::isJpegSuffix(mSaveInfo.outputFileInfo().suffix()))
+        return false;
+
+    DkJpegTransform transform;
+    bool active = false;
+
     for (QSharedPointer<DkAbstractBatch> batch : mProcessFunctions) {
+        if (!batch || !batch->isActive())
+            continue;
+
+        if (!batch->losslessTransform(transform))
+            return false;
+
+        active = true;
+    }
+
+    if (!active)
+        return false;
+
+    QSharedPointer<QByteArray> src = DkFileReadCache::instance().read(mSaveInfo.inputFilePath());
+    if (!src || !DkJpegTransform::isJpeg(*src))
+        return false;
+
+    QSharedPointer<DkMetaDataT> md(new DkMetaDataT());
+    md->readMetaData(mSaveInfo.inputFilePath(), src);
+
+    // the batch functions work on images that are already exif rotated
+    DkJpegTransform lossless;
+    int orientation = md->isLoaded() ? md->getOrientationDegree() : 0;
+    if (orientation != -1 && !DkSettingsManager::param().metaData().ignoreExifOrientation)
+        lossless.rotate(orientation);
+    lossless.append(transform);
+
+    QString error;
+    QSharedPointer<QByteArray> ba(new QByteArray(lossless.apply(*src, &error)));
+
+    if (ba->isEmpty()) {
+        mLogStrings.append(QObject::tr("Cannot transform losslessly (%1) -> re-encoding").arg(error));
+        return false;
+    }
+
+    // report we could not back-up & break here
+    if (!prepareDeleteExisting()) {
+        mFailure++;
+        return true;
+    }
+
+    if (md->isLoaded()) {
+        updateMetaData(md.data());
+
+        // a scaled read is cheap for jpgs - the thumbnail has to match the crop
+        QBuffer buffer(ba.data());
+        QImageReader reader(&buffer);
+        QSize size = reader.size();
+        reader.setScaledSize(size.scaled(200, 200, Qt::KeepAspectRatio));
+
+        QImage thumb = reader.read();
+        if (!thumb.isNull()) {
+            md->setExifValue("Exif.Image.ImageWidth", QString::number(size.width()));
+            md->setExifValue("Exif.Image.ImageLength", QString::number(size.height()));
+            md->setThumbnail(thumb);
+        }
+        md->clearOrientation();
+
+        if (!md->saveMetaData(ba, true))
+            mLogStrings.append(QObject::tr("Could not update the metadata of %1").arg(mSaveInfo.outputFilePath()));
+    }
+
+    QFile file(mSaveInfo.outputFilePath());
+    if (file.open(QIODevice::WriteOnly) && file.write(*ba) == ba->size()) {
+        for (QSharedPointer<DkAbstractBatch> batch : mProcessFunctions) {
+            if (batch && batch->isActive())
+                mLogStrings.append(QObject::tr("%1 applied losslessly.").arg(batch->name()));
+        }
+        mLogStrings.append(QObject::tr("%1 saved losslessly...").arg(mSaveInfo.outputFilePath()));
+    } else {
+        mLogStrings.append(QObject::tr("Could not save: %1").arg(mSaveInfo.outputFilePath()));
+        mFailure++;
+    }
+    file.close();
+
+    if (!deleteOrRestoreExisting())
+        mFailure++;
+
+    return true;
+}
+
+bool DkBatchProcess::processBranch(QSharedPointer<DkImageContainer> imgC)
+{
+    mIsProcessed = true;
+
+    if (skipsOutput()) {
+        mLogStrings.append(QObject::tr("%1 already exists -> skipping (check 'overwrite' if you want to overwrite the file)").arg(mSaveInfo.outputFilePath()));
+        mFailure++;
+        return false;
+    }
+
+    return processImage(imgC);
+}
+
+void DkBatchProcess::applyProcessChain(const QVector<QSharedPointer<DkAbstractBatch>> &processes, QSharedPointer<DkImageContainer> imgC)
+{
+    for (QSharedPointer<DkAbstractBatch> batch : processes) {
         if (!batch) {
             mLogStrings.append(QObject::tr("Error: cannot process a NULL function."));
             continue;
@@ -835,6 +1336,11 @@ bool DkBatchProcess::process()
 
         mInfos << cInfos;
     }
+}
+
+bool DkBatchProcess::processImage(QSharedPointer<DkImageContainer> imgC)
+{
+    applyProcessChain(mProcessFunctions, imgC);
 
     // report we could not back-up & break here
     if (!prepareDeleteExisting()) {
@@ -853,6 +1359,7 @@ bool DkBatchProcess::process()
         mLogStrings.append(QObject::tr("Original filename added to Exif"));
 
     // save the image
+    imgC->getLoader()->setSavePreset(mSaveInfo.savePreset());
     if (imgC->saveImage(mSaveInfo.outputFilePath(), mSaveInfo.compression())) {
         mLogStrings.append(QObject::tr("%1 saved...").arg(mSaveInfo.outputFilePath()));
     } else {
@@ -870,7 +1377,7 @@ bool DkBatchProcess::process()
 
 bool DkBatchProcess::renameFile()
 {
-    if (QFileInfo(mSaveInfo.outputFilePath()).exists()) {
+    if (outputExists()) {
         mLogStrings.append(QObject::tr("Error: could not rename file, the target file exists already."));
         return false;
     }
@@ -885,7 +1392,7 @@ bool DkBatchProcess::renameFile()
             mLogStrings.append(QObject::tr("Original filename added to Exif"));
     }
 
-    // Note: if two images are renamed at the same time to the same name, one image is lost -> see Qt comment Race Condition
+    // no two items of a batch share a target (see DkBatchProcessing::plan) so parallel renames cannot clobber each other
     if (!file.rename(mSaveInfo.outputFilePath())) {
         mLogStrings.append(QObject::tr("Error: could not rename file"));
         mLogStrings.append(file.errorString());
@@ -928,21 +1435,33 @@ bool DkBatchProcess::copyFile()
         return false;
     }
 
-    QSharedPointer<DkMetaDataT> md(new DkMetaDataT());
-    md->readMetaData(mSaveInfo.inputFilePath());
+    // the metadata is only needed if the original filename is added
+    QSharedPointer<DkMetaDataT> md;
+
+    if (mSaveInfo.inputFileInfo().fileName() != mSaveInfo.outputFileInfo().fileName()) {
+        md = QSharedPointer<DkMetaDataT>(new DkMetaDataT());
+        md->readMetaData(mSaveInfo.inputFilePath());
+    }
+
+    bool copied = false;
+
+    if (updateMetaData(md.data())) {
+        copied = copyWithMetaData(md.data());
 
-    bool exifUpdated = updateMetaData(md.data());
+        if (copied)
+            mLogStrings.append(QObject::tr("Original filename added to Exif"));
+    }
+
+    if (!copied)
+        copied = copyFileFast(mSaveInfo.inputFilePath(), mSaveInfo.outputFilePath());
 
-    if (!file.copy(mSaveInfo.outputFilePath())) {
+    if (!copied && !file.copy(mSaveInfo.outputFilePath())) {
         mLogStrings.append(QObject::tr("Error: could not copy file"));
         mLogStrings.append(QObject::tr("Input: %1").arg(mSaveInfo.inputFilePath()));
         mLogStrings.append(QObject::tr("Output: %1").arg(mSaveInfo.outputFilePath()));
         mLogStrings.append(file.errorString());
         return false;
     } else {
-        if (exifUpdated && md->saveMetaData(mSaveInfo.outputFilePath()))
-            mLogStrings.append(QObject::tr("Original filename added to Exif"));
-
         mLogStrings.append(QObject::tr("Copying: %1 -> %2").arg(mSaveInfo.inputFilePath()).arg(mSaveInfo.outputFilePath()));
     }
 
@@ -954,9 +1473,110 @@ bool DkBatchProcess::copyFile()
     return true;
 }
 
+/**
+ * Writes the input file with updated metadata to the output.
+ * The file is read & written once rather than being copied and rewritten by exiv2.
+ **/
+bool DkBatchProcess::copyWithMetaData(DkMetaDataT *md)
+{
+    QFile inFile(mSaveInfo.inputFilePath());
+
+    if (!md || !inFile.open(QIODevice::ReadOnly))
+        return false;
+
+    QSharedPointer<QByteArray> ba(new QByteArray(inFile.readAll()));
+    inFile.close();
+
+    if (!md->saveMetaData(ba) || ba->isEmpty())
+        return false;
+
+    QFile outFile(mSaveInfo.outputFilePath());
+
+    if (!outFile.open(QIODevice::WriteOnly))
+        return false;
+
+    if (outFile.write(*ba) != ba->size()) {
+        outFile.remove();
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Copies a file without moving its content through user space.
+ * Uses reflinks (btrfs, xfs, APFS) or copy_file_range (in-kernel and server-side copies) where available.
+ * @return false if the file could not be copied - the caller falls back to QFile::copy then
+ **/
+bool DkBatchProcess::copyFileFast(const QString &srcPath, const QString &dstPath)
+{
+#if defined(Q_OS_LINUX)
+    int in = ::open(QFile::encodeName(srcPath).constData(), O_RDONLY | O_CLOEXEC);
+
+    if (in < 0)
+        return false;
+
+    struct stat st;
+
+    if (::fstat(in, &st) != 0) {
+        ::close(in);
+        return false;
+    }
+
+    // O_EXCL: never clobber a file that appeared after the batch was planned
+    int out = ::open(QFile::encodeName(dstPath).constData(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, st.st_mode & 0777);
+
+    if (out < 0) {
+        ::close(in);
+        return false;
+    }
+
+    bool copied = false;
+
+#ifdef FICLONE
+    copied = ::ioctl(out, FICLONE, in) == 0;
+#endif
+
+#if defined(__GLIBC__) && defined(__GLIBC_PREREQ)
+#if __GLIBC_PREREQ(2, 27)
+    if (!copied) {
+        off_t remaining = st.st_size;
+        ssize_t n = 1;
+
+        while (remaining > 0 && n > 0) {
+            n = ::copy_file_range(in, nullptr, out, nullptr, static_cast<size_t>(remaining), 0);
+
+            if (n > 0)
+                remaining -= n;
+        }
+
+        copied = remaining == 0;
+    }
+#endif
+#endif
+
+    ::close(in);
+
+    if (::close(out) != 0)
+        copied = false;
+
+    if (!copied)
+        ::unlink(QFile::encodeName(dstPath).constData());
+
+    return copied;
+#elif defined(Q_OS_MAC)
+    // fails with ENOTSUP if the volume is not APFS
+    return ::clonefile(QFile::encodeName(srcPath).constData(), QFile::encodeName(dstPath).constData(), 0) == 0;
+#else
+    Q_UNUSED(srcPath);
+    Q_UNUSED(dstPath);
+    return false;
+#endif
+}
+
 bool DkBatchProcess::prepareDeleteExisting()
 {
-    if (QFileInfo(mSaveInfo.outputFilePath()).exists() && mSaveInfo.mode() == DkSaveInfo::mode_overwrite) {
+    if (outputExists() && mSaveInfo.mode() == DkSaveInfo::mode_overwrite) {
         mSaveInfo.createBackupFilePath();
 
         // check the uniqueness : )
@@ -1074,6 +1694,31 @@ void DkBatchProcessing::init()
 
     QStringList fileList = mBatchConfig.getFileList();
 
+    // the manifest only makes sense if outputs are written next to each other and the inputs are kept
+    QSharedPointer<DkBatchManifest> manifest;
+    DkSaveInfo bsi = mBatchConfig.saveInfo();
+
+    if (bsi.isIncremental() && !bsi.isInputDirOutputDir() && !bsi.isDeleteOriginal() && !(bsi.mode() & DkSaveInfo::mode_do_not_save_output))
+        manifest = QSharedPointer<DkBatchManifest>(new DkBatchManifest(mBatchConfig.getOutputDirPath(), DkBatchManifest::profileHash(mBatchConfig)));
+
+    // split the chains of multi-output configs into the common prefix and the branch specific steps
+    QVector<DkBatchConfig> branches = mBatchConfig.getBranches();
+    QVector<QSharedPointer<DkAbstractBatch>> sharedFunctions;
+    QVector<QSharedPointer<DkAbstractBatch>> primaryFunctions = mBatchConfig.getProcessFunctions();
+    QVector<QVector<QSharedPointer<DkAbstractBatch>>> branchFunctions;
+
+    for (const DkBatchConfig &bc : branches)
+        branchFunctions << bc.getProcessFunctions();
+
+    if (!branches.empty()) {
+        int prefixLength = commonPrefixLength(primaryFunctions, branchFunctions);
+        sharedFunctions = primaryFunctions.mid(0, prefixLength);
+        primaryFunctions = primaryFunctions.mid(prefixLength);
+
+        for (QVector<QSharedPointer<DkAbstractBatch>> &bf : branchFunctions)
+            bf = bf.mid(prefixLength);
+    }
+
     for (int idx = 0; idx < fileList.size(); idx++) {
         DkSaveInfo si = mBatchConfig.saveInfo();
 
@@ -1088,23 +1733,108 @@ void DkBatchProcessing::init()
         si.setOutputFilePath(outputFilePath);
 
         DkBatchProcess cProcess(si);
-        cProcess.setProcessChain(mBatchConfig.getProcessFunctions());
+        cProcess.setProcessChain(primaryFunctions);
+        cProcess.setSharedProcessChain(sharedFunctions);
+        cProcess.setManifest(manifest);
+
+        for (int bIdx = 0; bIdx < branches.size(); bIdx++) {
+            const DkBatchConfig &bc = branches[bIdx];
+            DkSaveInfo bsi = bc.saveInfo();
+            QString bOutDir = bsi.isInputDirOutputDir() ? cFileInfo.absolutePath() : bc.getOutputDirPath();
+
+            DkFileNameConverter bConverter(cFileInfo.fileName(), bc.getFileNamePattern(), idx);
+            bsi.setInputFilePath(fileList.at(idx));
+            bsi.setOutputFilePath(QFileInfo(bOutDir, bConverter.getConvertedFileName()).absoluteFilePath());
+
+            DkBatchProcess bProcess(bsi);
+            bProcess.setProcessChain(branchFunctions[bIdx]);
+            cProcess.addBranch(bProcess);
+        }
 
         mBatchItems.push_back(cProcess);
     }
+
+    plan();
+}
+
+static QString planKey(const QString &path)
+{
+#if defined(Q_OS_WIN) || defined(Q_OS_MAC)
+    // default file systems are case insensitive
+    return QDir::cleanPath(path).toLower();
+#else
+    return QDir::cleanPath(path);
+#endif
+}
+
+/**
+ * Resolves all targets before any file is touched.
+ * Items sharing a target or writing to the input of another item would race
+ * once they run in parallel - they fail with a conflict instead.
+ * Each output directory is listed once so the items do not need to query their targets.
+ **/
+void DkBatchProcessing::plan()
+{
+    if (mBatchConfig.saveInfo().mode() & DkSaveInfo::mode_do_not_save_output)
+        return;
+
+    DkTimer dt;
+
+    QHash<QString, int> inputs;
+
+    for (int idx = 0; idx < mBatchItems.size(); idx++)
+        inputs.insert(planKey(QFileInfo(mBatchItems[idx].inputFile()).absoluteFilePath()), idx);
+
+    QHash<QString, int> targets;
+    QHash<QString, QSet<QString>> dirEntries;
+    int numConflicts = 0;
+
+    for (int idx = 0; idx < mBatchItems.size(); idx++) {
+        DkBatchProcess &item = mBatchItems[idx];
+        QFileInfo outInfo(item.outputFile());
+        QString key = planKey(outInfo.absoluteFilePath());
+        QString conflict;
+
+        if (targets.contains(key))
+            conflict = tr("Error: %1 is the target of %2 too").arg(item.outputFile()).arg(mBatchItems[targets.value(key)].inputFile());
+        else if (inputs.contains(key) && inputs.value(key) != idx)
+            conflict = tr("Error: %1 is the input of another item of this batch").arg(item.outputFile());
+        else
+            targets.insert(key, idx);
+
+        QString dir = outInfo.absolutePath();
+
+        if (!dirEntries.contains(dir)) {
+            QSet<QString> entries;
+            const QStringList names = QDir(dir).entryList(QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot);
+
+            for (const QString &name : names)
+                entries.insert(planKey(name));
+
+            dirEntries.insert(dir, entries);
+        }
+
+        if (!conflict.isEmpty())
+            numConflicts++;
+
+        item.setPlan(dirEntries[dir].contains(planKey(outInfo.fileName())), conflict);
+    }
+
+    qInfo() << "[Batch] planned" << mBatchItems.size() << "items," << numConflicts << "conflicts in" << dt;
 }
 
 void DkBatchConfig::saveSettings(QSettings &settings) const
 {
     settings.beginGroup("General"); // this general group could be removed in future releases
     settings.setValue("FileList", mFileList.join(";"));
-    settings.setValue("OutputDirPath", mOutputDirPath);
-    settings.setValue("FileNamePattern", mFileNamePattern);
 
-    mSaveInfo.saveSettings(settings);
+    saveOutputSettings(settings);
 
-    for (auto pf : mProcessFunctions)
-        pf->saveSettings(settings);
+    for (int idx = 0; idx < mBranches.size(); idx++) {
+        settings.beginGroup("Branch" + QString::number(idx));
+        mBranches[idx].saveOutputSettings(settings);
+        settings.endGroup();
+    }
 
     settings.endGroup();
 }
@@ -1113,6 +1843,35 @@ void DkBatchConfig::loadSettings(QSettings &settings)
 {
     settings.beginGroup("General");
     mFileList = settings.value("FileList", mFileList).toString().split(";");
+
+    loadOutputSettings(settings);
+
+    // additional outputs: Branch0, Branch1, ...
+    for (int idx = 0; settings.childGroups().contains("Branch" + QString::number(idx)); idx++) {
+        DkBatchConfig branch;
+        settings.beginGroup("Branch" + QString::number(idx));
+        branch.loadOutputSettings(settings);
+        settings.endGroup();
+
+        mBranches << branch;
+    }
+
+    settings.endGroup();
+}
+
+void DkBatchConfig::saveOutputSettings(QSettings &settings) const
+{
+    settings.setValue("OutputDirPath", mOutputDirPath);
+    settings.setValue("FileNamePattern", mFileNamePattern);
+
+    mSaveInfo.saveSettings(settings);
+
+    for (auto pf : mProcessFunctions)
+        pf->saveSettings(settings);
+}
+
+void DkBatchConfig::loadOutputSettings(QSettings &settings)
+{
     mOutputDirPath = settings.value("OutputDirPath", mOutputDirPath).toString();
     mFileNamePattern = settings.value("FileNamePattern", mFileNamePattern).toString();
 
@@ -1122,7 +1881,7 @@ void DkBatchConfig::loadSettings(QSettings &settings)
 
     for (const QString &name : groups) {
         // known groups that are not batch processes
-        if (name == "SaveInfo")
+        if (name == "SaveInfo" || name.startsWith("Branch"))
             continue;
 
         QSharedPointer<DkAbstractBatch> batch = DkAbstractBatch::createFromName(name);
@@ -1136,8 +1895,6 @@ void DkBatchConfig::loadSettings(QSettings &settings)
 
     for (auto pf : mProcessFunctions)
         pf->saveSettings(settings);
-
-    settings.endGroup();
 }
 
 void DkBatchProcessing::compute()
@@ -1189,7 +1946,7 @@ void DkBatchProcessing::computeBatch(const QString &settingsPath, const QString
 
     process->waitForFinished(); // block
 
-    qInfo() << "batch finished with" << process->getNumFailures() << "errors in" << dt;
+    qInfo() << "batch finished with" << process->getNumFailures() << "errors," << process->getNumSkipped() << "files up to date in" << dt;
 
     if (!logPath.isEmpty()) {
         QFileInfo fi(logPath);
@@ -1245,6 +2002,18 @@ int DkBatchProcessing::getNumProcessed() const
     return numProcessed;
 }
 
+int DkBatchProcessing::getNumSkipped() const
+{
+    int numSkipped = 0;
+
+    for (const DkBatchProcess &batch : mBatchItems) {
+        if (batch.wasSkipped())
+            numSkipped++;
+    }
+
+    return numSkipped;
+}
+
 QList<int> DkBatchProcessing::getCurrentResults()
 {
     if (mResList.empty()) {
@@ -1279,7 +2048,9 @@ QString DkBatchProcessing::getBatchSummary(const DkBatchProcess &batch) const
 {
     QString res = batch.inputFile() + "\t";
 
-    if (!batch.hasFailed())
+    if (batch.wasSkipped())
+        res += " <span style=\" color:#888888;\">" + tr("[UP TO DATE]") + "</span>";
+    else if (!batch.hasFailed())
         res += " <span style=\" color:#00aa00;\">" + tr("[OK]") + "</span>";
     else
         res += " <span style=\" color:#aa0000;\">" + tr("[FAIL]") + "</span>";
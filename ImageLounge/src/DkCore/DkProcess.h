@@ -29,14 +29,18 @@
 
 #pragma warning(push, 0) // no warnings from includes - begin
 #include <QDir>
+#include <QFile>
 #include <QFileInfo>
 #include <QFutureWatcher>
+#include <QHash>
+#include <QMutex>
 #include <QSharedPointer>
 #include <QStringList>
 #include <QUrl>
 #pragma warning(pop) // no warnings from includes - end
 
 #include "DkBatchInfo.h"
+#include "DkJpegTransform.h"
 #include "DkManipulators.h"
 
 #pragma warning(disable : 4251) // TODO: remove
@@ -85,6 +89,10 @@ public:
     {
         return false;
     };
+    virtual bool losslessTransform(DkJpegTransform &) const
+    {
+        return false;
+    };
     virtual void postLoad(const QVector<QSharedPointer<DkBatchInfo>> &) const {};
 
     virtual QString name() const
@@ -148,6 +156,7 @@ public:
     virtual bool compute(QSharedPointer<DkImageContainer> container, QStringList &logStrings) const override;
     virtual QString name() const override;
     virtual bool isActive() const override;
+    virtual bool losslessTransform(DkJpegTransform &transform) const override;
 
     DkManipulatorManager manager() const;
 
@@ -196,6 +205,7 @@ public:
     virtual bool compute(QSharedPointer<DkImageContainer> container, QStringList &logStrings) const override;
     virtual QString name() const override;
     virtual bool isActive() const override;
+    virtual bool losslessTransform(DkJpegTransform &transform) const override;
 
     int angle() const;
     bool cropMetatdata() const;
@@ -231,16 +241,60 @@ protected:
     QRect mCropRect;
 };
 
+class DkBatchConfig;
+
+/**
+ * Remembers which inputs a batch profile has already processed.
+ * The manifest is an append-only text file in the output directory. Every
+ * successfully processed file appends one line (input path, size, last modified,
+ * profile hash, output path) which is flushed immediately - so an interrupted
+ * run resumes where it stopped. Later lines override earlier ones.
+ **/
+class DllCoreExport DkBatchManifest
+{
+public:
+    DkBatchManifest(const QString &outputDirPath, const QString &profileHash);
+    ~DkBatchManifest();
+
+    bool isUpToDate(const DkSaveInfo &saveInfo) const;
+    void update(const DkSaveInfo &saveInfo);
+
+    static QString fileName();
+    static QString profileHash(const DkBatchConfig &config);
+
+protected:
+    struct Entry {
+        QString inputFilePath;
+        qint64 size = 0;
+        qint64 lastModified = 0;
+        QString profileHash;
+    };
+
+    void load();
+    void compact();
+    QString toLine(const QString &outputFilePath, const Entry &entry) const;
+
+    QString mProfileHash;
+    QHash<QString, Entry> mEntries; // keyed by output file path
+    QFile mFile;
+    mutable QMutex mMutex;
+};
+
 class DllCoreExport DkBatchProcess
 {
 public:
     DkBatchProcess(const DkSaveInfo &saveInfo = DkSaveInfo());
 
     void setProcessChain(const QVector<QSharedPointer<DkAbstractBatch>> processes);
+    void setSharedProcessChain(const QVector<QSharedPointer<DkAbstractBatch>> processes);
+    void addBranch(const DkBatchProcess &branch);
+    void setManifest(QSharedPointer<DkBatchManifest> manifest);
+    void setPlan(bool outputExists, const QString &conflict = QString());
     bool compute(); // do the work
     QStringList getLog() const;
     bool hasFailed() const;
     bool wasProcessed() const;
+    bool wasSkipped() const;
     QString inputFile() const;
     QString outputFile() const;
 
@@ -248,19 +302,39 @@ public:
 
 protected:
     bool process();
+    bool processImage(QSharedPointer<DkImageContainer> imgC);
+    bool processLossless();
+    bool processBranch(QSharedPointer<DkImageContainer> imgC);
+    void applyProcessChain(const QVector<QSharedPointer<DkAbstractBatch>> &processes, QSharedPointer<DkImageContainer> imgC);
+    bool isUpToDate() const;
+    bool outputExists() const;
+    bool skipsOutput() const;
+    void updateManifest();
     bool prepareDeleteExisting();
     bool deleteOrRestoreExisting();
     bool deleteOriginalFile();
     bool copyFile();
     bool renameFile();
     bool updateMetaData(DkMetaDataT *md);
+    bool copyWithMetaData(DkMetaDataT *md);
+    static bool copyFileFast(const QString &srcPath, const QString &dstPath);
 
     DkSaveInfo mSaveInfo;
     int mFailure = 0;
     bool mIsProcessed = false;
+    bool mIsSkipped = false;
+    bool mSkipOutput = false; // the primary output exists (branches are processed anyway)
+
+    // filled by the planning phase of DkBatchProcessing
+    bool mIsPlanned = false;
+    bool mOutputExists = false;
+    QString mConflict;
 
+    QSharedPointer<DkBatchManifest> mManifest;
     QVector<QSharedPointer<DkBatchInfo>> mInfos;
     QVector<QSharedPointer<DkAbstractBatch>> mProcessFunctions;
+    QVector<QSharedPointer<DkAbstractBatch>> mSharedFunctions; // computed once before the image is handed to the branches
+    QVector<DkBatchProcess> mBranches;
     QStringList mLogStrings;
 };
 
@@ -295,6 +369,10 @@ public:
     {
         mSaveInfo = saveInfo;
     };
+    void addBranch(const DkBatchConfig &branch)
+    {
+        mBranches << branch;
+    };
 
     QStringList getFileList() const
     {
@@ -316,8 +394,15 @@ public:
     {
         return mSaveInfo;
     };
+    QVector<DkBatchConfig> getBranches() const
+    {
+        return mBranches;
+    };
 
 protected:
+    void saveOutputSettings(QSettings &settings) const;
+    void loadOutputSettings(QSettings &settings);
+
     DkSaveInfo mSaveInfo;
 
     QStringList mFileList;
@@ -325,6 +410,9 @@ protected:
     QString mFileNamePattern;
 
     QVector<QSharedPointer<DkAbstractBatch>> mProcessFunctions;
+
+    // additional outputs that share the decoded input (the file list is ignored)
+    QVector<DkBatchConfig> mBranches;
 };
 
 class DllCoreExport DkBatchProcessing : public QObject
@@ -349,6 +437,7 @@ public:
     int getNumFailures() const;
     int getNumItems() const;
     int getNumProcessed() const;
+    int getNumSkipped() const;
 
     bool isComputing() const;
     QList<int> getCurrentResults();
@@ -387,6 +476,7 @@ protected:
     QFutureWatcher<void> mBatchWatcher;
 
     void init();
+    void plan();
 };
 
 class DllCoreExport DkBatchProfile
@@ -26,6 +26,8 @@
  *******************************************************************************************************/
 
 #include "DkSettings.h"
+#include "DkFormatRegistry.h"
+#include "DkTimer.h"
 #include "DkUtils.h"
 
 #pragma warning(push, 0) // no warnings from includes - begin
@@ -369,6 +371,7 @@ void DkSettings::load(QSettings &settings, bool defaults)
     app_p.closeOnMiddleMouse = settings.value("closeOnMiddleMouse", app_p.closeOnMiddleMouse).toBool();
     app_p.showRecentFiles = settings.value("showRecentFiles", app_p.showRecentFiles).toBool();
     app_p.useLogFile = settings.value("useLogFile", app_p.useLogFile).toBool();
+    app_p.useTraceFile = settings.value("useTraceFile", app_p.useTraceFile).toBool();
     app_p.defaultJpgQuality = settings.value("defaultJpgQuality", app_p.defaultJpgQuality).toInt();
 
     QStringList tmpFileFilters = app_p.fileFilters;
@@ -498,6 +501,9 @@ void DkSettings::load(QSettings &settings, bool defaults)
     resources_p.filterRawImages = settings.value("filterRawImages", resources_p.filterRawImages).toBool();
     resources_p.loadRawThumb = settings.value("loadRawThumb", resources_p.loadRawThumb).toInt();
     resources_p.filterDuplicats = settings.value("filterDuplicates", resources_p.filterDuplicats).toBool();
+    resources_p.indexMetaData = settings.value("indexMetaData", resources_p.indexMetaData).toBool();
+    resources_p.compressPrefetched = settings.value("compressPrefetched", resources_p.compressPrefetched).toBool();
+    resources_p.progressiveLoading = settings.value("progressiveLoading", resources_p.progressiveLoading).toBool();
     resources_p.preferredExtension = settings.value("preferredExtension", resources_p.preferredExtension).toString();
     resources_p.gammaCorrection = settings.value("gammaCorrection", resources_p.gammaCorrection).toBool();
     resources_p.loadSavedImage = settings.value("loadSavedImage", resources_p.loadSavedImage).toInt();
@@ -590,6 +596,8 @@ void DkSettings::save(QSettings &settings, bool force)
         settings.setValue("showRecentFiles", app_p.showRecentFiles);
     if (force || app_p.useLogFile != app_d.useLogFile)
         settings.setValue("useLogFile", app_p.useLogFile);
+    if (force || app_p.useTraceFile != app_d.useTraceFile)
+        settings.setValue("useTraceFile", app_p.useTraceFile);
     if (force || app_p.browseFilters != app_d.browseFilters)
         settings.setValue("browseFilters", app_p.browseFilters);
     if (force || app_p.registerFilters != app_d.registerFilters)
@@ -787,6 +795,12 @@ void DkSettings::save(QSettings &settings, bool force)
         settings.setValue("loadRawThumb", resources_p.loadRawThumb);
     if (force || resources_p.filterDuplicats != resources_d.filterDuplicats)
         settings.setValue("filterDuplicates", resources_p.filterDuplicats);
+    if (force || resources_p.indexMetaData != resources_d.indexMetaData)
+        settings.setValue("indexMetaData", resources_p.indexMetaData);
+    if (force || resources_p.compressPrefetched != resources_d.compressPrefetched)
+        settings.setValue("compressPrefetched", resources_p.compressPrefetched);
+    if (force || resources_p.progressiveLoading != resources_d.progressiveLoading)
+        settings.setValue("progressiveLoading", resources_p.progressiveLoading);
     if (force || resources_p.preferredExtension != resources_d.preferredExtension)
         settings.setValue("preferredExtension", resources_p.preferredExtension);
     if (force || resources_p.gammaCorrection != resources_d.gammaCorrection)
@@ -834,6 +848,7 @@ void DkSettings::setToDefaultSettings()
     app_p.browseFilters = QStringList();
     app_p.showMenuBar = true;
     app_p.useLogFile = false;
+    app_p.useTraceFile = false;
 
     // now set default show options
     app_p.showFileInfoLabel.setBit(mode_default, false);
@@ -937,6 +952,9 @@ void DkSettings::setToDefaultSettings()
     resources_p.filterRawImages = true;
     resources_p.loadRawThumb = raw_thumb_always;
     resources_p.filterDuplicats = false;
+    resources_p.indexMetaData = true;
+    resources_p.compressPrefetched = true;
+    resources_p.progressiveLoading = true;
     resources_p.preferredExtension = "*.jpg";
     resources_p.gammaCorrection = true;
     resources_p.loadSavedImage = ls_load_to_tab;
@@ -1078,6 +1096,7 @@ void DkSettingsManager::init()
 {
     // init settings
     param().initFileFilters();
+    DkFormatRegistry::instance().update();
     DefaultSettings settings;
 
     param().load(settings, true); // load defaults
@@ -1091,6 +1110,10 @@ void DkSettingsManager::init()
     if (nmc::DkSettingsManager::param().app().useLogFile)
         std::cout << "log is saved to: " << nmc::DkUtils::getLogFilePath().toStdString() << std::endl;
 
+    // performance traces
+    if (nmc::DkSettingsManager::param().app().useTraceFile)
+        DkTracer::instance().setEnabled(true);
+
     qInfo() << "Hi there";
     qInfoClean() << "my name is " << QApplication::organizationName() << " | " << QApplication::applicationName() << " v" << QApplication::applicationVersion()
                  << (nmc::DkSettingsManager::param().isPortable() ? " (portable)" : " (installed)");
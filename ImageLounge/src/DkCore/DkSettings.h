@@ -188,6 +188,7 @@ public:
         QBitArray showLogDock;
         bool showRecentFiles;
         bool useLogFile;
+        bool useTraceFile;
         int appMode;
         int currentAppMode;
         bool privateMode;
@@ -318,6 +319,9 @@ public:
         bool waitForLastImg;
         bool filterRawImages;
         bool filterDuplicats;
+        bool indexMetaData;
+        bool compressPrefetched;
+        bool progressiveLoading;
         int loadRawThumb;
         QString preferredExtension;
         bool gammaCorrection;
@@ -0,0 +1,396 @@
+/*******************************************************************************************************
+ DkSharedImage.cpp
+ Created on:	19.10.2026
+
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+
+ Copyright (C) 2011-2016 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2016 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2016 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ *******************************************************************************************************/
+
+#include "DkSharedImage.h"
+
+#pragma warning(push, 0) // no warnings from includes - begin
+#include <QBuffer>
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QSharedMemory>
+#include <QThread>
+#pragma warning(pop) // no warnings from includes - end
+
+#ifdef Q_OS_UNIX
+#include <cerrno>
+#include <signal.h>
+#endif
+
+#include <cstring>
+
+namespace nmc
+{
+
+namespace
+{
+
+const quint32 sharedImageMagic = 0x69736d6e; // "nmsi"
+const quint32 sharedImageVersion = 1;
+
+// smaller images are decoded faster than we can claim & attach segments
+const qint64 sharedImageMinBytes = 4 * 1024 * 1024;
+
+struct SharedImageHeader {
+    quint32 magic;
+    quint32 version;
+    qint32 width;
+    qint32 height;
+    qint32 bytesPerLine;
+    qint32 format;
+    qint32 refCount; // instances that use the image
+    qint32 ready; // pixels are written
+    qint64 dataSize;
+};
+
+// the pixels start here (aligned for SIMD loads)
+const int sharedImageHeaderSize = 64;
+static_assert(sizeof(SharedImageHeader) <= sharedImageHeaderSize, "shared image header too large");
+
+bool isRunning(qint64 pid)
+{
+#ifdef Q_OS_UNIX
+    return ::kill(static_cast<pid_t>(pid), 0) == 0 || errno == EPERM;
+#else
+    // windows removes the segments of crashed processes
+    Q_UNUSED(pid);
+    return true;
+#endif
+}
+
+}
+
+// DkSharedImage --------------------------------------------------------------------
+DkSharedImage::DkSharedImage()
+{
+}
+
+DkSharedImage &DkSharedImage::instance()
+{
+    static DkSharedImage inst;
+    return inst;
+}
+
+/**
+ * Images are only shared while we are synchronized with local peers.
+ * @param enabled if true, decoded images are shared
+ **/
+void DkSharedImage::setEnabled(bool enabled)
+{
+    QMutexLocker locker(&mMutex);
+    mEnabled = enabled;
+}
+
+bool DkSharedImage::isEnabled() const
+{
+    QMutexLocker locker(&mMutex);
+    return mEnabled;
+}
+
+/**
+ * Returns the segment key of a file.
+ * The key changes if the file is modified.
+ * @param filePath the image's file path
+ * @return QString the key or an empty string if the file does not exist
+ **/
+QString DkSharedImage::key(const QString &filePath) const
+{
+    QFileInfo fileInfo(filePath);
+
+    if (!fileInfo.isFile())
+        return QString();
+
+    QByteArray id = fileInfo.absoluteFilePath().toUtf8();
+    id += "|" + QByteArray::number(fileInfo.size());
+    id += "|" + QByteArray::number(fileInfo.lastModified().toMSecsSinceEpoch());
+
+    return "nomacs-image-" + QCryptographicHash::hash(id, QCryptographicHash::Sha1).toHex();
+}
+
+/**
+ * Returns the decoded image of filePath if a peer shares it.
+ * If a peer is currently decoding the file, we wait for its result.
+ * If nobody shares it, we claim the file: call publish() once it is decoded
+ * and releaseClaim() in any case.
+ * Images that will not be published are never claimed.
+ * @param filePath the image's file path
+ * @param ba the file buffer (can be empty)
+ * @return QImage a read-only image backed by shared memory or a null image
+ **/
+QImage DkSharedImage::acquire(const QString &filePath, QSharedPointer<QByteArray> ba)
+{
+    if (!isEnabled())
+        return QImage();
+
+    // peers derive the same key from the file - modified files get a new key
+    QString k = key(filePath);
+    if (k.isEmpty())
+        return QImage();
+
+    QImage img = attach(k);
+    if (!img.isNull())
+        return img;
+
+    // peers should not wait for decodes that are never shared
+    if (!isShareable(filePath, ba))
+        return QImage();
+
+    // nobody shares it yet: claim the file so that peers wait for our result
+    if (claim(k))
+        return QImage();
+
+    // a peer is decoding this file
+    QElapsedTimer timer;
+    timer.start();
+
+    while (timer.elapsed() < mWaitTimeout) {
+        QThread::msleep(mPollInterval);
+
+        img = attach(k);
+        if (!img.isNull()) {
+            qInfo() << "[DkSharedImage]" << QFileInfo(filePath).fileName() << "received from a peer in" << timer.elapsed() << "ms";
+            return img;
+        }
+
+        // the peer released its claim without publishing the image (or it crashed)
+        if (!isClaimed(k))
+            break;
+    }
+
+    return QImage();
+}
+
+/**
+ * Creates the claim of key.
+ * Claims of crashed peers are removed (they are not removed by the OS on unix).
+ * @param key the segment key
+ * @return bool true if we hold the claim
+ **/
+bool DkSharedImage::claim(const QString &key)
+{
+    QSharedPointer<QSharedMemory> claim(new QSharedMemory(key + "-claim"));
+
+    if (!claim->create(sizeof(qint64))) {
+        // isClaimed() removes stale claims
+        if (isClaimed(key) || !claim->create(sizeof(qint64)))
+            return false;
+
+        qInfo() << "[DkSharedImage] removed the claim of a crashed peer";
+    }
+
+    claim->lock();
+    *static_cast<qint64 *>(claim->data()) = QCoreApplication::applicationPid();
+    claim->unlock();
+
+    QMutexLocker locker(&mMutex);
+    mClaims.insert(key, claim);
+
+    return true;
+}
+
+/**
+ * Returns true if a running peer claims key.
+ * If the claimant is not running anymore, the claim is removed
+ * when our probe detaches (it is the last reference).
+ * @param key the segment key
+ **/
+bool DkSharedImage::isClaimed(const QString &key) const
+{
+    QSharedMemory probe(key + "-claim");
+
+    if (!probe.attach(QSharedMemory::ReadOnly))
+        return false;
+
+    qint64 pid = 0;
+
+    if (probe.size() >= (int)sizeof(qint64) && probe.lock()) {
+        pid = *static_cast<const qint64 *>(probe.constData());
+        probe.unlock();
+    }
+
+    // 0: the claimant did not write its pid yet
+    return pid == 0 || isRunning(pid);
+}
+
+/**
+ * Estimates from the image's header if publish() will share the decoded image.
+ * Small, indexed and multi-page images are not shared.
+ * @param filePath the image's file path
+ * @param ba the file buffer (can be empty)
+ **/
+bool DkSharedImage::isShareable(const QString &filePath, QSharedPointer<QByteArray> ba)
+{
+    QBuffer buffer;
+    QImageReader reader;
+
+    if (ba && !ba->isEmpty()) {
+        buffer.setData(*ba);
+        buffer.open(QIODevice::ReadOnly);
+        reader.setDevice(&buffer);
+    } else
+        reader.setFileName(filePath);
+
+    // formats Qt cannot read (e.g. RAW files) decode to images that are much larger than the file
+    if (!reader.canRead())
+        return QFileInfo(filePath).size() * 4 >= sharedImageMinBytes;
+
+    QImage::Format format = reader.imageFormat();
+
+    if (reader.imageCount() > 1 || format == QImage::Format_Indexed8 || format == QImage::Format_Mono || format == QImage::Format_MonoLSB)
+        return false;
+
+    QSize size = reader.size();
+    int bytesPerPixel = format != QImage::Format_Invalid ? qMax(QImage::toPixelFormat(format).bitsPerPixel() / 8, 1) : 4;
+
+    return size.isValid() && (qint64)size.width() * size.height() * bytesPerPixel >= sharedImageMinBytes;
+}
+
+/**
+ * Copies img to a new shared memory segment.
+ * The returned image should replace img so that the pixels
+ * are kept once for all instances (including us).
+ * @param filePath the image's file path
+ * @param img the decoded image
+ * @return QImage a read-only copy of img backed by shared memory or a null image
+ **/
+QImage DkSharedImage::publish(const QString &filePath, const QImage &img)
+{
+    // color tables are not shared
+    if (img.isNull() || img.colorCount() > 0 || img.sizeInBytes() < sharedImageMinBytes || !isEnabled())
+        return QImage();
+
+    QString k = key(filePath);
+    if (k.isEmpty())
+        return QImage();
+
+    qint64 dataSize = img.sizeInBytes();
+    QSharedMemory *segment = new QSharedMemory(k);
+
+    if (!segment->create(sharedImageHeaderSize + dataSize)) {
+        qInfo() << "[DkSharedImage] cannot share" << QFileInfo(filePath).fileName() << segment->errorString();
+        delete segment;
+        return QImage();
+    }
+
+    segment->lock();
+    SharedImageHeader *header = static_cast<SharedImageHeader *>(segment->data());
+    header->magic = sharedImageMagic;
+    header->version = sharedImageVersion;
+    header->width = img.width();
+    header->height = img.height();
+    header->bytesPerLine = (qint32)img.bytesPerLine();
+    header->format = img.format();
+    header->refCount = 0;
+    header->dataSize = dataSize;
+    std::memcpy(static_cast<char *>(segment->data()) + sharedImageHeaderSize, img.constBits(), dataSize);
+    header->ready = 1;
+    segment->unlock();
+
+    QImage sharedImg = imageFromSegment(segment);
+
+    if (sharedImg.isNull()) {
+        delete segment;
+        return QImage();
+    }
+
+    return sharedImg;
+}
+
+/**
+ * Releases the claim of acquire().
+ * Peers that wait for the file stop waiting.
+ * @param filePath the image's file path
+ **/
+void DkSharedImage::releaseClaim(const QString &filePath)
+{
+    QString k = key(filePath);
+
+    QMutexLocker locker(&mMutex);
+    mClaims.remove(k);
+}
+
+QImage DkSharedImage::attach(const QString &key) const
+{
+    // read & write: the reference count lives in the segment
+    QSharedMemory *segment = new QSharedMemory(key);
+
+    if (!segment->attach(QSharedMemory::ReadWrite)) {
+        delete segment;
+        return QImage();
+    }
+
+    QImage img = imageFromSegment(segment);
+
+    if (img.isNull())
+        delete segment;
+
+    return img;
+}
+
+QImage DkSharedImage::imageFromSegment(QSharedMemory *segment)
+{
+    if (!segment->lock())
+        return QImage();
+
+    SharedImageHeader *header = static_cast<SharedImageHeader *>(segment->data());
+
+    bool valid = segment->size() >= sharedImageHeaderSize && header->magic == sharedImageMagic && header->version == sharedImageVersion
+        && header->ready == 1 && sharedImageHeaderSize + header->dataSize <= segment->size()
+        && (qint64)header->bytesPerLine * header->height <= header->dataSize;
+
+    if (valid)
+        header->refCount++;
+
+    segment->unlock();
+
+    if (!valid)
+        return QImage();
+
+    // const data: the image is deep copied as soon as somebody edits it
+    const uchar *bits = static_cast<const uchar *>(segment->constData()) + sharedImageHeaderSize;
+
+    return QImage(bits, header->width, header->height, header->bytesPerLine, (QImage::Format)header->format, releaseSegment, segment);
+}
+
+void DkSharedImage::releaseSegment(void *segmentPtr)
+{
+    QSharedMemory *segment = static_cast<QSharedMemory *>(segmentPtr);
+
+    if (segment->lock()) {
+        static_cast<SharedImageHeader *>(segment->data())->refCount--;
+        segment->unlock();
+    }
+
+    // the OS removes the segment when the last instance detaches
+    delete segment;
+}
+
+}
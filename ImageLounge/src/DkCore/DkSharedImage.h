@@ -0,0 +1,102 @@
+/*******************************************************************************************************
+ DkSharedImage.h
+ Created on:	19.10.2026
+
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+
+ Copyright (C) 2011-2016 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2016 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2016 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ *******************************************************************************************************/
+
+#pragma once
+
+#pragma warning(push, 0) // no warnings from includes - begin
+#include <QByteArray>
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QString>
+#pragma warning(pop) // no warnings from includes - end
+
+#pragma warning(disable : 4251) // TODO: remove
+
+#ifndef DllCoreExport
+#ifdef DK_CORE_DLL_EXPORT
+#define DllCoreExport Q_DECL_EXPORT
+#elif DK_DLL_IMPORT
+#define DllCoreExport Q_DECL_IMPORT
+#else
+#define DllCoreExport Q_DECL_IMPORT
+#endif
+#endif
+
+// Qt defines
+class QSharedMemory;
+
+namespace nmc
+{
+
+/**
+ * Shares decoded images between synchronized local instances.
+ * The instance that decodes a file first copies the pixels to a named
+ * shared memory segment and uses that copy itself. Peers that open the same
+ * file attach to the segment instead of decoding it again, so four
+ * synchronized windows showing one image hold a single decoded buffer.
+ * The segment's header counts the instances using it; the OS removes the
+ * segment once the last instance detaches.
+ * While a peer decodes a file, it holds a claim so that others wait
+ * for its result instead of decoding the same file in parallel.
+ * The claim stores the peer's process id so that claims of crashed
+ * peers are detected.
+ **/
+class DllCoreExport DkSharedImage
+{
+public:
+    static DkSharedImage &instance();
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const;
+
+    QString key(const QString &filePath) const;
+    QImage acquire(const QString &filePath, QSharedPointer<QByteArray> ba = QSharedPointer<QByteArray>());
+    QImage publish(const QString &filePath, const QImage &img);
+    void releaseClaim(const QString &filePath);
+
+private:
+    DkSharedImage();
+    DkSharedImage(const DkSharedImage &);
+
+    QImage attach(const QString &key) const;
+    bool claim(const QString &key);
+    bool isClaimed(const QString &key) const;
+    static bool isShareable(const QString &filePath, QSharedPointer<QByteArray> ba);
+    static QImage imageFromSegment(QSharedMemory *segment);
+    static void releaseSegment(void *segment);
+
+    mutable QMutex mMutex;
+    bool mEnabled = false;
+    QHash<QString, QSharedPointer<QSharedMemory>> mClaims; // files we are decoding
+
+    static const int mWaitTimeout = 10000; // ms we wait for a peer that decodes the file
+    static const int mPollInterval = 20; // ms
+};
+
+}
@@ -0,0 +1,260 @@
+/*******************************************************************************************************
+ DkSlideShow.cpp
+ Created on:	19.10.2026
+
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+
+ Copyright (C) 2011-2016 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2016 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2016 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ *******************************************************************************************************/
+
+#include "DkSlideShow.h"
+#include "DkCacheManager.h"
+#include "DkImageContainer.h"
+#include "DkImageLoader.h"
+#include "DkSettings.h"
+#include "DkTimer.h"
+#include "DkUtils.h"
+
+#pragma warning(push, 0) // no warnings from includes - begin
+#include <QDebug>
+#include <qmath.h>
+#pragma warning(pop) // no warnings from includes - end
+
+namespace nmc
+{
+
+// DkSlideShowScheduler --------------------------------------------------------------------
+DkSlideShowScheduler::DkSlideShowScheduler(QObject *parent)
+    : QObject(parent)
+{
+    mDeadlineTimer.setSingleShot(true);
+    mDeadlineTimer.setTimerType(Qt::PreciseTimer);
+    connect(&mDeadlineTimer, SIGNAL(timeout()), this, SLOT(deadlineReached()));
+}
+
+void DkSlideShowScheduler::setImageLoader(QSharedPointer<DkImageLoader> loader)
+{
+    mLoader = loader;
+}
+
+void DkSlideShowScheduler::setDisplaySize(const QSize &size)
+{
+    mDisplaySize = size;
+}
+
+void DkSlideShowScheduler::setInterval(int ms)
+{
+    mInterval = qMax(ms, 1);
+}
+
+void DkSlideShowScheduler::start()
+{
+    mRunning = true;
+    mAdvancing = false;
+    mWaitingFor.clear();
+    mNumSlides = 0;
+    mNumMissed = 0;
+
+    mClock.start();
+    mDeadline = mInterval;
+    mDeadlineTimer.start(mInterval);
+
+    prefetch();
+}
+
+void DkSlideShowScheduler::stop()
+{
+    if (mRunning && mNumSlides > 0)
+        qInfo() << "[SlideShow]" << mNumMissed << "of" << mNumSlides << "slides missed their deadline";
+
+    mRunning = false;
+    mDeadlineTimer.stop();
+    mWaitingFor.clear();
+    mRequested.clear();
+}
+
+bool DkSlideShowScheduler::isRunning() const
+{
+    return mRunning;
+}
+
+/**
+ * Schedules the next deadline. Call this if a new slide is displayed.
+ **/
+void DkSlideShowScheduler::slideShown()
+{
+    if (!mRunning)
+        return;
+
+    qint64 now = mClock.elapsed();
+    bool late = !mWaitingFor.isNull();
+
+    mNumSlides++;
+    DkTracer::instance().addCounter("slide show slides");
+
+    if (late) {
+        mNumMissed++;
+        DkTracer::instance().addCounter("slide show missed deadlines");
+        qInfo() << "[SlideShow]" << mWaitingFor->fileName() << "missed its deadline by" << now - mDeadline << "ms (" << mNumMissed << "of" << mNumSlides
+                << "slides late, prefetching" << prefetchDepth() << "slides)";
+        mWaitingFor.clear();
+    }
+
+    // keep the cadence if we advanced in time - otherwise (late or user interaction) the slide gets the full interval
+    if (mAdvancing && !late)
+        mDeadline = qMax(mDeadline + mInterval, now);
+    else
+        mDeadline = now + mInterval;
+
+    mAdvancing = false;
+    mDeadlineTimer.start(qMax(mDeadline - now, (qint64)0));
+
+    prefetch();
+}
+
+/**
+ * Returns the number of slides that are loaded ahead.
+ * It covers the time needed to load a slide plus one slide of headroom.
+ **/
+int DkSlideShowScheduler::prefetchDepth() const
+{
+    int maxDepth = qBound(1, DkSettingsManager::param().resources().maxImagesCached, mMaxPrefetchDepth);
+
+    return qBound(1, qCeil(mLoadTime / mInterval) + 1, maxDepth);
+}
+
+void DkSlideShowScheduler::deadlineReached()
+{
+    if (!mRunning)
+        return;
+
+    QVector<QSharedPointer<DkImageContainerT>> next = upcomingSlides(1);
+
+    // wait until the next slide is decoded (slideLoaded)
+    if (!next.isEmpty() && !next.first()->hasImage() && next.first()->getLoadState() != DkImageContainerT::exists_not) {
+        mWaitingFor = next.first();
+        request(mWaitingFor);
+        return;
+    }
+
+    advance();
+}
+
+void DkSlideShowScheduler::slideLoaded(bool loaded)
+{
+    DkImageContainerT *imgC = qobject_cast<DkImageContainerT *>(sender());
+
+    if (!imgC)
+        return;
+
+    disconnect(imgC, SIGNAL(fileLoadedSignal(bool)), this, SLOT(slideLoaded(bool)));
+
+    if (loaded && mRunning && !mDisplaySize.isEmpty()) {
+        connect(imgC, SIGNAL(imagePrescaledSignal()), this, SLOT(slidePrescaled()), Qt::UniqueConnection);
+        imgC->prescale(mDisplaySize);
+    } else
+        measure(imgC);
+
+    // the slide is late already - show it right away
+    if (mRunning && mWaitingFor.data() == imgC)
+        advance();
+}
+
+void DkSlideShowScheduler::slidePrescaled()
+{
+    DkImageContainerT *imgC = qobject_cast<DkImageContainerT *>(sender());
+
+    if (!imgC)
+        return;
+
+    disconnect(imgC, SIGNAL(imagePrescaledSignal()), this, SLOT(slidePrescaled()));
+    measure(imgC);
+}
+
+QVector<QSharedPointer<DkImageContainerT>> DkSlideShowScheduler::upcomingSlides(int num) const
+{
+    QVector<QSharedPointer<DkImageContainerT>> slides;
+
+    if (!mLoader || !mLoader->getCurrentImage())
+        return slides;
+
+    const QVector<QSharedPointer<DkImageContainerT>> &images = mLoader->images();
+    int cIdx = mLoader->findFileIdx(mLoader->getCurrentImage()->filePath(), images);
+
+    if (cIdx == -1)
+        return slides;
+
+    for (int idx = cIdx + 1; idx <= cIdx + num && idx - cIdx < images.size(); idx++) {
+        if (idx >= images.size() && !DkSettingsManager::param().global().loop)
+            break;
+
+        slides << images[idx % images.size()];
+    }
+
+    return slides;
+}
+
+/**
+ * Decodes and downsamples the next slides.
+ **/
+void DkSlideShowScheduler::prefetch()
+{
+    DkCacheManager &cm = DkCacheManager::instance();
+
+    for (const QSharedPointer<DkImageContainerT> &imgC : upcomingSlides(prefetchDepth())) {
+        // upcoming slides are evicted last
+        cm.touch(imgC);
+
+        if (!imgC->hasImage() && imgC->getLoadState() != DkImageContainerT::exists_not)
+            request(imgC);
+        else if (imgC->prescaledImage().isNull() && !mDisplaySize.isEmpty()) // e.g. the window was resized
+            imgC->prescale(mDisplaySize);
+    }
+}
+
+void DkSlideShowScheduler::request(QSharedPointer<DkImageContainerT> imgC)
+{
+    if (!mRequested.contains(imgC.data()))
+        mRequested.insert(imgC.data(), mClock.elapsed());
+
+    connect(imgC.data(), SIGNAL(fileLoadedSignal(bool)), this, SLOT(slideLoaded(bool)), Qt::UniqueConnection);
+
+    // the slide might be loading already (e.g. by the cacher)
+    if (imgC->getLoadState() == DkImageContainerT::not_loaded)
+        imgC->loadImageThreaded();
+}
+
+void DkSlideShowScheduler::measure(const DkImageContainerT *imgC)
+{
+    if (!mRequested.contains(imgC))
+        return;
+
+    double dt = mClock.elapsed() - mRequested.take(imgC);
+    mLoadTime = (mLoadTime > 0) ? 0.7 * mLoadTime + 0.3 * dt : dt;
+}
+
+void DkSlideShowScheduler::advance()
+{
+    mAdvancing = true;
+    emit nextSignal();
+}
+
+}
@@ -0,0 +1,121 @@
+/*******************************************************************************************************
+ DkSlideShow.h
+ Created on:	19.10.2026
+
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+
+ Copyright (C) 2011-2016 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2016 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2016 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ *******************************************************************************************************/
+
+#pragma once
+
+#pragma warning(push, 0) // no warnings from includes - begin
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QSharedPointer>
+#include <QSize>
+#include <QTimer>
+#include <QVector>
+#pragma warning(pop) // no warnings from includes - end
+
+#pragma warning(disable : 4251) // TODO: remove
+
+#ifndef DllCoreExport
+#ifdef DK_CORE_DLL_EXPORT
+#define DllCoreExport Q_DECL_EXPORT
+#elif DK_DLL_IMPORT
+#define DllCoreExport Q_DECL_IMPORT
+#else
+#define DllCoreExport Q_DECL_IMPORT
+#endif
+#endif
+
+namespace nmc
+{
+
+class DkImageContainerT;
+class DkImageLoader;
+
+/**
+ * Schedules the slides of a slide show.
+ * Each slide has a deadline (the time it should be shown) on a fixed cadence,
+ * hence the time needed to load a slide does not add up to its display time.
+ * The next slides are decoded and downsampled to the display size ahead of
+ * their deadlines. The number of slides prefetched adapts to the time
+ * loading a slide takes (e.g. large images on a network share).
+ * If a slide is not ready at its deadline, it is shown as soon as it
+ * is decoded and the missed deadline is logged.
+ **/
+class DllCoreExport DkSlideShowScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    DkSlideShowScheduler(QObject *parent = 0);
+
+    void setImageLoader(QSharedPointer<DkImageLoader> loader);
+    void setDisplaySize(const QSize &size);
+    void setInterval(int ms);
+
+    void start();
+    void stop();
+    bool isRunning() const;
+
+    void slideShown();
+    int prefetchDepth() const;
+
+signals:
+    void nextSignal() const;
+
+protected slots:
+    void deadlineReached();
+    void slideLoaded(bool loaded);
+    void slidePrescaled();
+
+protected:
+    QVector<QSharedPointer<DkImageContainerT>> upcomingSlides(int num) const;
+    void prefetch();
+    void request(QSharedPointer<DkImageContainerT> imgC);
+    void measure(const DkImageContainerT *imgC);
+    void advance();
+
+    QSharedPointer<DkImageLoader> mLoader;
+    QSize mDisplaySize;
+    int mInterval = 3000; // ms
+
+    QTimer mDeadlineTimer;
+    QElapsedTimer mClock;
+    qint64 mDeadline = 0; // deadline of the next slide (ms on mClock)
+    bool mRunning = false;
+    bool mAdvancing = false; // the slide shown next was requested by us
+    QSharedPointer<DkImageContainerT> mWaitingFor; // the next slide was not ready at its deadline
+
+    // prefetch statistics
+    QHash<const DkImageContainerT *, qint64> mRequested; // start of loading (ms on mClock)
+    double mLoadTime = 0; // moving average of the time needed to load & downsample a slide (ms)
+    int mNumSlides = 0;
+    int mNumMissed = 0;
+
+    static const int mMaxPrefetchDepth = 8;
+};
+
+}
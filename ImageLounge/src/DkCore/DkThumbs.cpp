@@ -27,6 +27,7 @@
 
 #include "DkThumbs.h"
 #include "DkBasicLoader.h"
+#include "DkFileReadCache.h"
 #include "DkImageStorage.h"
 #include "DkMetaData.h"
 #include "DkSettings.h"
@@ -96,39 +97,58 @@ QImage DkThumbNail::computeIntern(const QString &filePath, QSharedPointer<QByteA
     // see if we can read the thumbnail from the exif data
     QImage thumb;
     DkMetaDataT metaData;
+    DkFileReadCache &readCache = DkFileReadCache::instance();
+    bool saveThumb = forceLoad == save_thumb || forceLoad == force_save_thumb;
 
     QSharedPointer<QByteArray> baZip = QSharedPointer<QByteArray>();
 #ifdef WITH_QUAZIP
     if (QFileInfo(mFile).dir().path().contains(DkZipContainer::zipMarker()))
         baZip = DkZipContainer::extractImage(DkZipContainer::decodeZipFile(filePath), DkZipContainer::decodeImageFile(filePath));
 #endif
-    try {
-        // [DIEM] READ  build crashed here 09.06.2016
-        if (baZip && !baZip->isEmpty())
-            metaData.readMetaData(filePath, baZip);
-        else if (!ba || ba->isEmpty())
-            metaData.readMetaData(filePath);
-        else
-            metaData.readMetaData(filePath, ba);
 
-        // read the full image if we want to create new thumbnails
-        if (forceLoad != force_save_thumb)
-            thumb = metaData.getThumbnail();
-    } catch (...) {
-        // do nothing - we'll load the full file
-    }
-    removeBlackBorder(thumb);
+    // reuse the buffer if the file was read before (e.g. by the viewer)
+    QSharedPointer<QByteArray> readBa = ba;
+    if ((!readBa || readBa->isEmpty()) && (!baZip || baZip->isEmpty()))
+        readBa = readCache.buffer(filePath);
 
-    bool exifThumb = !thumb.isNull();
-    int orientation = metaData.getOrientationDegree();
+    // we need the metadata itself if we save the thumbnail
+    DkFileReadCache::ExifThumb exif;
+    if (saveThumb || !readCache.exifThumb(filePath, exif)) {
+        try {
+            // [DIEM] READ  build crashed here 09.06.2016
+            if (baZip && !baZip->isEmpty())
+                metaData.readMetaData(filePath, baZip);
+            else if (!readBa || readBa->isEmpty())
+                metaData.readMetaData(filePath);
+            else
+                metaData.readMetaData(filePath, readBa);
 
-    if (exifThumb && (metaData.isAVIF() || metaData.isHEIF() || metaData.isJXL()) && orientation != -1 && orientation != 0) {
-        // do not rotate together with full image but rotate Exif thumb only
-        QTransform rotationMatrix;
-        rotationMatrix.rotate((double)orientation);
-        thumb = thumb.transformed(rotationMatrix);
+            // read the full image if we want to create new thumbnails
+            if (forceLoad != force_save_thumb)
+                exif.img = metaData.getThumbnail();
+        } catch (...) {
+            // do nothing - we'll load the full file
+        }
+        removeBlackBorder(exif.img);
+
+        exif.orientation = metaData.getOrientationDegree();
+        exif.rotateWithImage = metaData.isJpg() || metaData.isRaw();
+
+        if (!exif.img.isNull() && (metaData.isAVIF() || metaData.isHEIF() || metaData.isJXL()) && exif.orientation != -1 && exif.orientation != 0) {
+            // do not rotate together with full image but rotate Exif thumb only
+            QTransform rotationMatrix;
+            rotationMatrix.rotate((double)exif.orientation);
+            exif.img = exif.img.transformed(rotationMatrix);
+        }
+
+        if (!saveThumb && (!baZip || baZip->isEmpty()))
+            readCache.insert(filePath, exif);
     }
 
+    thumb = exif.img;
+    bool exifThumb = !thumb.isNull();
+    int orientation = exif.orientation;
+
     QFileInfo fInfo(filePath);
     QString lFilePath = fInfo.isSymLink() ? fInfo.symLinkTarget() : filePath;
     fInfo = QFileInfo(lFilePath);
@@ -145,7 +165,11 @@ QImage DkThumbNail::computeIntern(const QString &filePath, QSharedPointer<QByteA
             if (loader.loadGeneral(lFilePath, baZip, true, true))
                 thumb = loader.image();
         } else {
-            if (loader.loadGeneral(lFilePath, ba, true, true))
+            // read the file once - the viewer reuses the buffer
+            if (!readBa || readBa->isEmpty())
+                readBa = readCache.read(lFilePath);
+
+            if (loader.loadGeneral(lFilePath, readBa, true, true))
                 thumb = loader.image();
         }
     }
@@ -176,7 +200,7 @@ QImage DkThumbNail::computeIntern(const QString &filePath, QSharedPointer<QByteA
         thumb = thumb.scaled(QSize(w, h), Qt::KeepAspectRatio, Qt::SmoothTransformation);
     }
 
-    if (orientation != -1 && orientation != 0 && (metaData.isJpg() || metaData.isRaw())) {
+    if (orientation != -1 && orientation != 0 && exif.rotateWithImage) {
         QTransform rotationMatrix;
         rotationMatrix.rotate((double)orientation);
         thumb = thumb.transformed(rotationMatrix);
@@ -194,9 +218,10 @@ QImage DkThumbNail::computeIntern(const QString &filePath, QSharedPointer<QByteA
 
             metaData.updateImageMetaData(sThumb);
 
-            if (!ba || ba->isEmpty())
+            if (!ba || ba->isEmpty()) {
+                readCache.remove(lFilePath);
                 metaData.saveMetaData(lFilePath);
-            else
+            } else
                 metaData.saveMetaData(ba);
 
             qDebug() << "[thumb] saved to exif data";
@@ -289,13 +314,31 @@ DkThumbNailT::~DkThumbNailT()
 {
 }
 
-bool DkThumbNailT::fetchThumb(int forceLoad /* = false */, QSharedPointer<QByteArray> ba)
+bool DkThumbNailT::fetchThumb(int forceLoad /* = false */, QSharedPointer<QByteArray> ba, int priority, const DkThumbsFetchToken &token)
 {
     if (forceLoad == force_full_thumb || forceLoad == force_save_thumb || forceLoad == save_thumb)
         mImg = QImage();
 
-    if (!mImg.isNull() || !mImgExists || mFetching)
+    if (!mImg.isNull() || !mImgExists)
+        return false;
+
+    // already queued: move it to the caller's priority and generation
+    if (mFetching) {
+        // requests without token must not become stale if a view asks for the same thumbnail
+        DkThumbsFetchToken fetchToken = mFetchPinned ? DkThumbsFetchToken() : token;
+
+        if (priority < mFetchPriority || fetchToken.generation() != mFetchGeneration || (fetchToken.isNull() && !mFetchPinned)) {
+            // the workers drop requests whose ticket is outdated
+            // a ticket of 0 means that a worker is already decoding it
+            int oldTicket = mTicket.loadAcquire();
+            int ticket = DkThumbsFetchController::instance().nextTicket();
+
+            if (oldTicket > 0 && mTicket.testAndSetOrdered(oldTicket, ticket))
+                enqueue(ticket, priority, fetchToken);
+        }
+
         return false;
+    }
 
     // check if we can load the file
     // though if it might seem over engineered: it is much faster cascading it here
@@ -306,20 +349,52 @@ bool DkThumbNailT::fetchThumb(int forceLoad /* = false */, QSharedPointer<QByteA
     // watcher.isRunning() returns false if the thread is waiting in the pool
     mFetching = true;
     mForceLoad = forceLoad;
+    mFetchBuffer = ba;
+
+    int ticket = DkThumbsFetchController::instance().nextTicket();
+    mTicket.storeRelease(ticket);
 
     // process with the concurrent queue
-    DkThumbsFetchController::instance().enqueue(sharedFromThis(), mFile, ba,
-            forceLoad, mMaxThumbSize);
+    enqueue(ticket, priority, token);
 
     return true;
 }
 
+void DkThumbNailT::enqueue(int ticket, int priority, const DkThumbsFetchToken &token)
+{
+    mFetchPriority = priority;
+    mFetchGeneration = token.generation();
+    mFetchPinned = token.isNull();
+
+    DkThumbsFetchController::Request request;
+    request.thumb = sharedFromThis();
+    request.filePath = mFile;
+    request.ba = mFetchBuffer;
+    request.forceLoad = mForceLoad;
+    request.maxThumbSize = mMaxThumbSize;
+    request.ticket = ticket;
+    request.token = token;
+    request.generation = mFetchGeneration;
+
+    DkThumbsFetchController::instance().enqueue(request, priority);
+}
+
 QImage DkThumbNailT::computeCall(const QString &filePath, QSharedPointer<QByteArray> ba, int forceLoad, int maxThumbSize)
 {
     QImage thumb = DkThumbNail::computeIntern(filePath, ba, forceLoad, maxThumbSize);
     return DkImage::createThumb(thumb);
 }
 
+/**
+ * Claims a request for decoding (called by the fetch workers).
+ * @param ticket the ticket of the dequeued request
+ * @return bool false if the request was superseded by a newer one
+ **/
+bool DkThumbNailT::takeTicket(int ticket)
+{
+    return mTicket.testAndSetOrdered(ticket, 0);
+}
+
 void DkThumbNailT::thumbLoaded(const QImage &img)
 {
     mImg = img;
@@ -328,9 +403,17 @@ void DkThumbNailT::thumbLoaded(const QImage &img)
         mImgExists = false;
 
     mFetching = false;
+    mFetchBuffer.clear();
     emit thumbLoadedSignal(!mImg.isNull());
 }
 
+void DkThumbNailT::thumbCancelled()
+{
+    mFetching = false;
+    mFetchBuffer.clear();
+    emit thumbCancelledSignal();
+}
+
 // DkThumbsThreadPool --------------------------------------------------------------------
 DkThumbsThreadPool::DkThumbsThreadPool()
 {
@@ -360,44 +443,27 @@ DkThumbsFetchWorker::DkThumbsFetchWorker()
 {
 }
 
-void DkThumbsFetchWorker::DkThumbsFetchWorker::process()
+void DkThumbsFetchWorker::process()
 {
-    for ( ; ; ) {
-        DkThumbsFetchController &controller = DkThumbsFetchController::instance();
-
-        // wait for request
-        controller.numRequests().acquire();
-
-        QSharedPointer<DkThumbNailT> thumb;
-        DkThumbsFetchController::RequestOption option;
-        {
-            QMutexLocker lock(&controller.queueMutex());
-
-            // exit gracefully if the queue is empty
-            if (controller.requestQueue().size() <= 0) {
-                break;
-            }
-
-            // get request
-            thumb = controller.requestQueue().dequeue();
-            option = controller.requestOptionQueue().dequeue();
+    DkThumbsFetchController &controller = DkThumbsFetchController::instance();
+    DkThumbsFetchController::Request request;
+
+    while (controller.dequeue(request)) {
+        // a newer request of this thumbnail is queued
+        if (!request.thumb->takeTicket(request.ticket)) {
+            request = DkThumbsFetchController::Request();
+            continue;
         }
 
-        // process
-        auto img = thumb->computeCall(option.filePath, option.ba,
-                option.forceLoad, option.maxThumbSize);
-
-        {
-            QMutexLocker lock(&controller.queueMutex());
-
-            // put request
-            controller.resultQueue().enqueue(thumb);
-            controller.resultDataQueue().enqueue(img);
+        // the view moved on - drop it without decoding
+        if (request.token.isStale(request.generation)) {
+            DkTracer::instance().addCounter("thumbnails dropped");
+            controller.processed(request, QImage(), true);
+            continue;
         }
 
-        controller.numRequestsAvailable().release();
-
-        emit processed();
+        QImage img = request.thumb->computeCall(request.filePath, request.ba, request.forceLoad, request.maxThumbSize);
+        controller.processed(request, img);
     }
 
     emit finished();
@@ -406,7 +472,6 @@ void DkThumbsFetchWorker::DkThumbsFetchWorker::process()
 // DkThumbsFetchController --------------------------------------------------------------------
 
 DkThumbsFetchController::DkThumbsFetchController()
-    : mNumRequestsAvailable(1000)      // queue size
 {
 }
 
@@ -418,69 +483,123 @@ DkThumbsFetchController &DkThumbsFetchController::instance()
 
 void DkThumbsFetchController::init()
 {
-    QThread* thread = new QThread();
-    DkThumbsFetchWorker* worker = new DkThumbsFetchWorker();
-    worker->moveToThread(thread);
+    mQuit = 0;
+
+    // keep some cores for the image loader
+    mNumWorkers = qBound(1, QThread::idealThreadCount() / 2, 4);
 
-    connect(thread, SIGNAL(started()), worker, SLOT(process()));
-    connect(worker, SIGNAL(finished()), thread, SLOT(quit()));
-    connect(worker, SIGNAL(finished()), worker, SLOT(deleteLater()));
-    connect(thread, SIGNAL(finished()), thread, SLOT(deleteLater()));
+    for (int idx = 0; idx < mNumWorkers; idx++) {
+        QThread *thread = new QThread();
+        DkThumbsFetchWorker *worker = new DkThumbsFetchWorker();
+        worker->moveToThread(thread);
 
-    connect(worker, SIGNAL(processed()), this, SLOT(processed()));
+        connect(thread, SIGNAL(started()), worker, SLOT(process()));
+        connect(worker, SIGNAL(finished()), thread, SLOT(quit()));
+        connect(worker, SIGNAL(finished()), worker, SLOT(deleteLater()));
+        connect(thread, SIGNAL(finished()), thread, SLOT(deleteLater()));
 
-    thread->start();
+        thread->start();
+    }
 }
 
 void DkThumbsFetchController::release()
 {
+    // this makes the workers exit gracefully
+    mQuit = 1;
+
+    for (Shard &shard : mShards) {
+        QMutexLocker lock(&shard.mutex);
+        shard.requests.clear();
+    }
+
+    mNumRequests.release(mNumWorkers);
+}
+
+void DkThumbsFetchController::enqueue(const Request &request, int priority)
+{
+    if (priority < 0 || priority >= DkThumbNailT::fetch_end)
+        priority = DkThumbNailT::fetch_background;
+
     {
-        // this makes the worker exit gracefully
-        QMutexLocker lock(&mQueueMutex);
-        mRequestQueue.clear();
-        mRequestOptionQueue.clear();
+        Shard &shard = mShards[priority];
+        QMutexLocker lock(&shard.mutex);
+        shard.requests.enqueue(request);
     }
 
-    mNumRequests.release();     // request with empty
+    mNumRequests.release();
 }
 
-void DkThumbsFetchController::enqueue(QSharedPointer<DkThumbNailT> thumb,
-        const QString &filePath, QSharedPointer<QByteArray> ba,
-        int forceLoad, int maxThumbSize)
+/**
+ * Returns the most important pending request (called by the fetch workers).
+ * Blocks until a request is available.
+ * @param request the dequeued request
+ * @return bool false if the workers should exit
+ **/
+bool DkThumbsFetchController::dequeue(Request &request)
 {
-    RequestOption option;
-    option.filePath = filePath;
-    option.ba = ba;
-    option.forceLoad = forceLoad;
-    option.maxThumbSize = maxThumbSize;
+    for (;;) {
+        mNumRequests.acquire();
+
+        if (mQuit.loadAcquire())
+            return false;
+
+        for (Shard &shard : mShards) {
+            QMutexLocker lock(&shard.mutex);
+
+            if (!shard.requests.isEmpty()) {
+                request = shard.requests.dequeue();
+                return true;
+            }
+        }
+    }
+}
 
-    // wait while the request queue is full
-    // (adjust the queue size if ui tends to be unresponsive)
-    mNumRequestsAvailable.acquire();
+void DkThumbsFetchController::processed(const Request &request, const QImage &img, bool cancelled)
+{
+    Result result;
+    result.thumb = request.thumb;
+    result.img = img;
+    result.cancelled = cancelled;
 
+    bool notify = false;
     {
-        // put request
-        QMutexLocker lock(&mQueueMutex);
-        mRequestQueue.enqueue(thumb);
-        mRequestOptionQueue.enqueue(option);
+        QMutexLocker lock(&mResultMutex);
+        notify = mResults.isEmpty();
+        mResults << result;
     }
 
-    mNumRequests.release();
+    // results that arrive before the GUI thread picks them up are delivered with this call
+    if (notify)
+        QMetaObject::invokeMethod(this, "deliverResults", Qt::QueuedConnection);
 }
 
-void DkThumbsFetchController::processed()
+int DkThumbsFetchController::nextTicket()
 {
-    QSharedPointer<DkThumbNailT> thumb;
-    QImage img;
+    int ticket = mTicket.fetchAndAddOrdered(1) + 1;
+
+    // keep tickets positive if we ever wrap around
+    if (ticket <= 0) {
+        mTicket = 1;
+        ticket = 1;
+    }
+
+    return ticket;
+}
+
+void DkThumbsFetchController::deliverResults()
+{
+    QVector<Result> results;
     {
-        // get result
-        QMutexLocker lock(&mQueueMutex);
-        thumb = mResultQueue.dequeue();
-        img = mResultDataQueue.dequeue();
+        QMutexLocker lock(&mResultMutex);
+        results.swap(mResults);
     }
 
-    // post process
-    thumb->thumbLoaded(img);
+    for (const Result &r : results) {
+        if (r.cancelled)
+            r.thumb->thumbCancelled();
+        else
+            r.thumb->thumbLoaded(r.img);
+    }
 }
 
 }
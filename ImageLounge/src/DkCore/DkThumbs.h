@@ -28,14 +28,17 @@
 #pragma once
 
 #pragma warning(push, 0) // no warnings from includes - begin
+#include <QAtomicInt>
 #include <QColor>
 #include <QDir>
 #include <QFutureWatcher>
 #include <QImage>
 #include <QSharedPointer>
 #include <QThread>
+#include <QMutex>
 #include <QQueue>
 #include <QSemaphore>
+#include <QVector>
 #pragma warning(pop) // no warnings from includes - end
 
 #pragma warning(disable : 4251) // TODO: remove
@@ -167,6 +170,49 @@ protected:
     int mMaxThumbSize;
 };
 
+/**
+ * Generation token of a thumbnail view.
+ * A view starts a new generation whenever the thumbnails it shows change
+ * (e.g. scrolling). Requests that were enqueued with an older generation
+ * are dropped before they are decoded. A default constructed token is
+ * never stale.
+ **/
+class DllCoreExport DkThumbsFetchToken
+{
+public:
+    DkThumbsFetchToken() = default;
+
+    static DkThumbsFetchToken create()
+    {
+        DkThumbsFetchToken token;
+        token.mGeneration = QSharedPointer<QAtomicInt>(new QAtomicInt(0));
+        return token;
+    };
+
+    int newGeneration()
+    {
+        return mGeneration ? mGeneration->fetchAndAddOrdered(1) + 1 : 0;
+    };
+
+    int generation() const
+    {
+        return mGeneration ? mGeneration->loadAcquire() : 0;
+    };
+
+    bool isStale(int generation) const
+    {
+        return mGeneration && mGeneration->loadAcquire() != generation;
+    };
+
+    bool isNull() const
+    {
+        return !mGeneration;
+    };
+
+private:
+    QSharedPointer<QAtomicInt> mGeneration;
+};
+
 class DllCoreExport DkThumbNailT : public QObject, public DkThumbNail,
         public QEnableSharedFromThis<DkThumbNailT>
 {
@@ -176,7 +222,18 @@ public:
     DkThumbNailT(const QString &mFile = QString(), const QImage &mImg = QImage());
     ~DkThumbNailT();
 
-    bool fetchThumb(int forceLoad = do_not_force, QSharedPointer<QByteArray> ba = QSharedPointer<QByteArray>());
+    enum FetchPriority {
+        fetch_visible = 0,
+        fetch_neighbour,
+        fetch_background,
+
+        fetch_end,
+    };
+
+    bool fetchThumb(int forceLoad = do_not_force,
+                    QSharedPointer<QByteArray> ba = QSharedPointer<QByteArray>(),
+                    int priority = fetch_visible,
+                    const DkThumbsFetchToken &token = DkThumbsFetchToken());
 
     /**
      * Returns whether the thumbnail was loaded, or does not exist.
@@ -197,14 +254,24 @@ public:
     };
 
     QImage computeCall(const QString &filePath, QSharedPointer<QByteArray> ba, int forceLoad, int maxThumbSize);
+    bool takeTicket(int ticket);
     void thumbLoaded(const QImage &img);
+    void thumbCancelled();
 
 signals:
     void thumbLoadedSignal(bool loaded = true);
+    void thumbCancelledSignal();
 
 protected:
+    void enqueue(int ticket, int priority, const DkThumbsFetchToken &token);
+
     bool mFetching;
     int mForceLoad;
+    QSharedPointer<QByteArray> mFetchBuffer;
+    int mFetchPriority = fetch_end;
+    int mFetchGeneration = 0;
+    bool mFetchPinned = false; // the queued request has no token (e.g. saving thumbnails) and is never dropped
+    QAtomicInt mTicket; // > 0 queued, 0 decoding or idle
 };
 
 // currently used by DkUtils::exists
@@ -223,7 +290,8 @@ private:
     QThreadPool *mPool;
 };
 
-class DkThumbsFetchWorker : public QObject {
+class DkThumbsFetchWorker : public QObject
+{
     Q_OBJECT
 
 public:
@@ -232,12 +300,18 @@ public:
 
 signals:
     void finished() const;
-    void processed() const;
 
 public slots:
     void process();
 };
 
+/**
+ * Schedules thumbnail requests.
+ * Requests are sharded by priority (visible, neighbour, background) and each
+ * shard has its own lock, so enqueueing never waits for the decoding workers.
+ * Requests whose view has moved on (see DkThumbsFetchToken) are dropped without
+ * being decoded and results are handed to the GUI thread in batches.
+ **/
 class DkThumbsFetchController : public QObject
 {
     Q_OBJECT
@@ -246,37 +320,49 @@ public:
     static DkThumbsFetchController &instance();
     virtual ~DkThumbsFetchController() {};
 
-    struct RequestOption {
+    struct Request {
+        QSharedPointer<DkThumbNailT> thumb;
         QString filePath;
         QSharedPointer<QByteArray> ba;
-        int forceLoad;
-        int maxThumbSize;
+        int forceLoad = DkThumbNail::do_not_force;
+        int maxThumbSize = max_thumb_size;
+        int ticket = 0;
+        int generation = 0;
+        DkThumbsFetchToken token;
     };
 
-    QSemaphore &numRequests() { return mNumRequests; }
-    QSemaphore &numRequestsAvailable() { return mNumRequestsAvailable; }
-    QMutex &queueMutex() { return mQueueMutex; }
-    QQueue<QSharedPointer<DkThumbNailT>> &requestQueue() { return mRequestQueue; }
-    QQueue<RequestOption> &requestOptionQueue() { return mRequestOptionQueue; }
-    QQueue<QSharedPointer<DkThumbNailT>> &resultQueue() { return mResultQueue; }
-    QQueue<QImage> &resultDataQueue() { return mResultDataQueue; }
     void init();
     void release();
-    void enqueue(QSharedPointer<DkThumbNailT> thumb, const QString &filePath,
-            QSharedPointer<QByteArray> ba, int forceLoad, int maxThumbSize);
+    void enqueue(const Request &request, int priority);
+    bool dequeue(Request &request);
+    void processed(const Request &request, const QImage &img, bool cancelled = false);
+    int nextTicket();
 
 public slots:
-    void processed();
+    void deliverResults();
 
 private:
     DkThumbsFetchController();
+
+    struct Shard {
+        QMutex mutex;
+        QQueue<Request> requests;
+    };
+
+    struct Result {
+        QSharedPointer<DkThumbNailT> thumb;
+        QImage img;
+        bool cancelled = false;
+    };
+
+    Shard mShards[DkThumbNailT::fetch_end];
     QSemaphore mNumRequests;
-    QSemaphore mNumRequestsAvailable;
-    QMutex mQueueMutex;
-    QQueue<QSharedPointer<DkThumbNailT>> mRequestQueue;
-    QQueue<RequestOption> mRequestOptionQueue;
-    QQueue<QSharedPointer<DkThumbNailT>> mResultQueue;
-    QQueue<QImage> mResultDataQueue;
+    QAtomicInt mTicket;
+    QAtomicInt mQuit;
+    int mNumWorkers = 0;
+
+    QMutex mResultMutex;
+    QVector<Result> mResults;
 };
 
 }
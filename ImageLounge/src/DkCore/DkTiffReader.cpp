@@ -0,0 +1,518 @@
+/*******************************************************************************************************
+ DkTiffReader.cpp
+ Created on:	19.10.2026
+
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+
+ Copyright (C) 2011-2016 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2016 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2016 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ *******************************************************************************************************/
+
+#include "DkTiffReader.h"
+#include "DkTimer.h"
+#include "DkUtils.h"
+
+#pragma warning(push, 0) // no warnings from includes - begin
+#include <QDebug>
+#include <QFile>
+#include <QThreadPool>
+#include <QVector>
+#include <QtConcurrentMap>
+#pragma warning(pop) // no warnings from includes - end
+
+#include <cstring>
+
+#ifdef WITH_LIBTIFF
+#ifdef Q_OS_WIN
+#include <tif_config.h>
+#endif
+
+// see DkBasicLoader.cpp
+#define uint64 uint64_hack_
+#define int64 int64_hack_
+
+#include <tiffio.h>
+
+#undef uint64
+#undef int64
+#endif // #ifdef WITH_LIBTIFF
+
+namespace nmc
+{
+
+#ifdef WITH_LIBTIFF
+
+// in-memory tiffs --------------------------------------------------------------------
+// every libtiff handle needs its own read position
+struct DkTiffBuffer {
+    const char *data = 0;
+    toff_t size = 0;
+    toff_t pos = 0;
+};
+
+static tmsize_t tiffRead(thandle_t handle, void *buf, tmsize_t size)
+{
+    DkTiffBuffer *b = static_cast<DkTiffBuffer *>(handle);
+
+    tmsize_t n = (tmsize_t)qMin((toff_t)size, b->pos < b->size ? b->size - b->pos : 0);
+    memcpy(buf, b->data + b->pos, n);
+    b->pos += n;
+
+    return n;
+}
+
+static tmsize_t tiffWrite(thandle_t, void *, tmsize_t)
+{
+    return 0;
+}
+
+static toff_t tiffSeek(thandle_t handle, toff_t offset, int whence)
+{
+    DkTiffBuffer *b = static_cast<DkTiffBuffer *>(handle);
+
+    if (whence == SEEK_CUR)
+        offset += b->pos;
+    else if (whence == SEEK_END)
+        offset += b->size;
+
+    b->pos = offset;
+    return b->pos;
+}
+
+static int tiffClose(thandle_t)
+{
+    // the buffer is owned by DkTiffHandle
+    return 0;
+}
+
+static toff_t tiffSize(thandle_t handle)
+{
+    return static_cast<DkTiffBuffer *>(handle)->size;
+}
+
+static int tiffMap(thandle_t handle, void **base, toff_t *size)
+{
+    DkTiffBuffer *b = static_cast<DkTiffBuffer *>(handle);
+    *base = const_cast<char *>(b->data);
+    *size = b->size;
+
+    return 1;
+}
+
+static void tiffUnmap(thandle_t, void *, toff_t)
+{
+}
+
+// DkTiffHandle --------------------------------------------------------------------
+// a libtiff handle - libtiff handles must not be shared between threads
+class DkTiffHandle
+{
+public:
+    DkTiffHandle(const QString &filePath, const QSharedPointer<QByteArray> &ba)
+    {
+        if (ba && !ba->isEmpty()) {
+            mBuffer.data = ba->constData();
+            mBuffer.size = ba->size();
+            mTiff = TIFFClientOpen("MemTIFF", "r", &mBuffer, tiffRead, tiffWrite, tiffSeek, tiffClose, tiffSize, tiffMap, tiffUnmap);
+        } else {
+#ifdef Q_OS_WIN
+            mTiff = TIFFOpenW(reinterpret_cast<const wchar_t *>(filePath.utf16()), "r");
+#else
+            mTiff = TIFFOpen(QFile::encodeName(filePath).constData(), "r");
+#endif
+        }
+    }
+
+    ~DkTiffHandle()
+    {
+        if (mTiff)
+            TIFFClose(mTiff);
+    }
+
+    TIFF *tiff() const
+    {
+        return mTiff;
+    }
+
+private:
+    TIFF *mTiff = 0;
+    DkTiffBuffer mBuffer;
+};
+
+// libtiff delivers ABGR - Qt wants ARGB (see DkBasicLoader::convert32BitOrder)
+static inline uint32_t abgrToArgb(uint32_t p)
+{
+    return (p & 0xff000000) | ((p & 0x00ff0000) >> 16) | (p & 0x0000ff00) | ((p & 0x000000ff) << 16);
+}
+
+static QSize imageSize(TIFF *tiff)
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+
+    TIFFGetField(tiff, TIFFTAG_IMAGEWIDTH, &width);
+    TIFFGetField(tiff, TIFFTAG_IMAGELENGTH, &height);
+
+    return QSize((int)width, (int)height);
+}
+
+#endif // #ifdef WITH_LIBTIFF
+
+// DkTiffReader --------------------------------------------------------------------
+DkTiffReader::DkTiffReader(const QString &filePath, QSharedPointer<QByteArray> ba)
+    : mFilePath(filePath)
+    , mBuffer(ba)
+{
+#ifdef WITH_LIBTIFF
+    DkTiffHandle *h = new DkTiffHandle(filePath, ba);
+
+    if (!h->tiff()) {
+        delete h;
+        return;
+    }
+
+    mClientData = h;
+    mTiff = h->tiff();
+    mDirOffset = TIFFCurrentDirOffset(mTiff);
+    mSize = imageSize(mTiff);
+#endif
+}
+
+DkTiffReader::~DkTiffReader()
+{
+#ifdef WITH_LIBTIFF
+    delete static_cast<DkTiffHandle *>(mClientData);
+#endif
+}
+
+bool DkTiffReader::isOpen() const
+{
+    return mTiff != 0;
+}
+
+/**
+ * Switches to the page (directory) idx.
+ * @param idx the page index (starting with 0)
+ * @return bool true if the tiff has this page
+ **/
+bool DkTiffReader::setDirectory(int idx)
+{
+#ifdef WITH_LIBTIFF
+    if (!mTiff || !TIFFSetDirectory(mTiff, (tdir_t)idx))
+        return false;
+
+    mDirOffset = TIFFCurrentDirOffset(mTiff);
+    mSize = imageSize(mTiff);
+
+    return true;
+#else
+    Q_UNUSED(idx);
+    return false;
+#endif
+}
+
+QSize DkTiffReader::size() const
+{
+    return mSize;
+}
+
+/**
+ * Returns true if the current page is large & can be decoded by this reader.
+ * Smaller tiffs (and tiffs with more than 8 bits per sample) are better decoded by Qt.
+ **/
+bool DkTiffReader::isLarge() const
+{
+#ifdef WITH_LIBTIFF
+    if (!mTiff || (qint64)mSize.width() * mSize.height() < mLargeImageSize)
+        return false;
+
+    uint16_t bitsPerSample = 8;
+    TIFFGetFieldDefaulted(mTiff, TIFFTAG_BITSPERSAMPLE, &bitsPerSample);
+
+    // strips & tiles are placed top-left (see decode)
+    uint16_t orientation = ORIENTATION_TOPLEFT;
+    TIFFGetFieldDefaulted(mTiff, TIFFTAG_ORIENTATION, &orientation);
+
+    char emsg[1024];
+    return bitsPerSample <= 8 && orientation == ORIENTATION_TOPLEFT && TIFFRGBAImageOK(mTiff, emsg);
+#else
+    return false;
+#endif
+}
+
+bool DkTiffReader::isLarge(const QString &filePath, QSharedPointer<QByteArray> ba)
+{
+    DkTiffReader reader(filePath, ba);
+    return reader.isLarge();
+}
+
+/**
+ * Sets a callback that receives previews while the image is decoded.
+ * The callback is called from worker threads.
+ * @param callback receives a downsampled copy of the strips/tiles decoded so far
+ **/
+void DkTiffReader::setPreviewCallback(std::function<void(const QImage &)> callback)
+{
+    mPreviewCallback = callback;
+}
+
+/**
+ * Decodes the current page in full resolution.
+ * @param img the decoded image
+ * @return bool true if the image could be decoded
+ **/
+bool DkTiffReader::read(QImage &img)
+{
+    return decode(mDirOffset, mSize, img);
+}
+
+/**
+ * Decodes the smallest reduced-resolution image of the current page that is at least minSize.
+ * @param img the decoded image
+ * @param minSize the minimum size of the preview
+ * @return bool false if the tiff has no reduced-resolution image that is large enough
+ **/
+bool DkTiffReader::readPreview(QImage &img, const QSize &minSize)
+{
+#ifdef WITH_LIBTIFF
+    if (!mTiff)
+        return false;
+
+    // SubIFDs of the current page
+    QVector<toff_t> subIfds;
+    uint16_t numSubIfds = 0;
+    toff_t *subIfdOffsets = 0;
+
+    if (TIFFGetField(mTiff, TIFFTAG_SUBIFD, &numSubIfds, &subIfdOffsets) && subIfdOffsets) {
+        for (int idx = 0; idx < numSubIfds; idx++)
+            subIfds << subIfdOffsets[idx];
+    }
+
+    quint64 bestOffset = 0;
+    QSize bestSize = mSize;
+
+    auto check = [&]() {
+        QSize s = imageSize(mTiff);
+        char emsg[1024];
+
+        if (s.width() >= minSize.width() && s.height() >= minSize.height() && s.width() < bestSize.width() && TIFFRGBAImageOK(mTiff, emsg)) {
+            bestOffset = TIFFCurrentDirOffset(mTiff);
+            bestSize = s;
+        }
+    };
+
+    // pyramids: the next IFDs are flagged as reduced images of this page
+    while (TIFFReadDirectory(mTiff)) {
+        uint32_t subFileType = 0;
+        TIFFGetField(mTiff, TIFFTAG_SUBFILETYPE, &subFileType);
+
+        if (!(subFileType & FILETYPE_REDUCEDIMAGE))
+            break;
+
+        check();
+    }
+
+    for (toff_t o : subIfds) {
+        if (TIFFSetSubDirectory(mTiff, o))
+            check();
+    }
+
+    TIFFSetSubDirectory(mTiff, mDirOffset);
+
+    if (!bestOffset)
+        return false;
+
+    qDebug() << "[DkTiffReader] using reduced image" << bestSize << "instead of" << mSize;
+
+    return decode(bestOffset, bestSize, img);
+#else
+    Q_UNUSED(img);
+    Q_UNUSED(minSize);
+    return false;
+#endif
+}
+
+bool DkTiffReader::decode(quint64 dirOffset, const QSize &size, QImage &img)
+{
+#ifdef WITH_LIBTIFF
+    if (!mTiff || size.isEmpty())
+        return false;
+
+    DkTimer dt;
+
+    if (!TIFFSetSubDirectory(mTiff, dirOffset))
+        return false;
+
+    char emsg[1024];
+    if (!TIFFRGBAImageOK(mTiff, emsg)) {
+        qWarning() << "[DkTiffReader] cannot decode" << mFilePath << ":" << emsg;
+        return false;
+    }
+
+    // chunk geometry
+    bool tiled = TIFFIsTiled(mTiff) != 0;
+    uint32_t chunkWidth = size.width();
+    uint32_t chunkHeight = size.height();
+
+    if (tiled) {
+        TIFFGetField(mTiff, TIFFTAG_TILEWIDTH, &chunkWidth);
+        TIFFGetField(mTiff, TIFFTAG_TILELENGTH, &chunkHeight);
+    } else {
+        TIFFGetFieldDefaulted(mTiff, TIFFTAG_ROWSPERSTRIP, &chunkHeight);
+        chunkHeight = qMin(chunkHeight, (uint32_t)size.height());
+    }
+
+    if (chunkWidth == 0 || chunkHeight == 0)
+        return false;
+
+    int cols = (size.width() + chunkWidth - 1) / chunkWidth;
+    int rows = (size.height() + chunkHeight - 1) / chunkHeight;
+    int numChunks = cols * rows;
+
+    img = QImage(size, QImage::Format_ARGB32);
+
+    if (img.isNull()) {
+        qWarning() << "[DkTiffReader] not enough memory to decode" << size;
+        return false;
+    }
+
+    // TIFFReadRGBAStrip/Tile flip each chunk according to the orientation tag
+    // so chunks can only be placed if the image is stored top-left
+    uint16_t orientation = ORIENTATION_TOPLEFT;
+    TIFFGetFieldDefaulted(mTiff, TIFFTAG_ORIENTATION, &orientation);
+
+    // single strip tiffs cannot be split - decode them directly into the image
+    if ((numChunks == 1 && !tiled) || orientation != ORIENTATION_TOPLEFT) {
+        const int stopOnError = 1;
+        if (!TIFFReadRGBAImageOriented(mTiff, size.width(), size.height(), reinterpret_cast<uint32_t *>(img.bits()), ORIENTATION_TOPLEFT, stopOnError)) {
+            img = QImage();
+            return false;
+        }
+
+        for (int y = 0; y < size.height(); y++) {
+            uint32_t *line = reinterpret_cast<uint32_t *>(img.scanLine(y));
+            for (int x = 0; x < size.width(); x++)
+                line[x] = abgrToArgb(line[x]);
+        }
+
+        qInfo() << "[DkTiffReader]" << size << "decoded in" << dt << "(single pass)";
+        return true;
+    }
+
+    // workers write to disjoint regions of the image
+    uchar *bits = img.bits();
+    size_t bpl = img.bytesPerLine();
+
+    if (mPreviewCallback) {
+        mPreviewFactor = qMax((qMax(size.width(), size.height()) + mMaxPreviewSize - 1) / mMaxPreviewSize, 1);
+        mPreview = QImage((size.width() + mPreviewFactor - 1) / mPreviewFactor, (size.height() + mPreviewFactor - 1) / mPreviewFactor, QImage::Format_ARGB32);
+        mPreview.fill(Qt::transparent);
+        mPreviewTimer.start();
+    }
+
+    // each job decodes consecutive chunks with its own handle
+    int numJobs = qMin(numChunks, qMax(QThreadPool::globalInstance()->maxThreadCount(), 1) * 4);
+    QVector<int> jobs;
+    for (int idx = 0; idx < numJobs; idx++)
+        jobs << idx;
+
+    QAtomicInt failed(0);
+
+    QtConcurrent::blockingMap(jobs, [&](int &job) {
+        DkTiffHandle handle(mFilePath, mBuffer);
+
+        if (!handle.tiff() || !TIFFSetSubDirectory(handle.tiff(), dirOffset)) {
+            failed.storeRelease(1);
+            return;
+        }
+
+        QVector<uint32_t> raster((int)(chunkWidth * chunkHeight));
+
+        for (int c = job * numChunks / numJobs; c < (job + 1) * numChunks / numJobs && !failed.loadAcquire(); c++) {
+            int x = (c % cols) * chunkWidth;
+            int y = (c / cols) * chunkHeight;
+            int w = qMin((int)chunkWidth, size.width() - x);
+            int h = qMin((int)chunkHeight, size.height() - y);
+
+            bool ok = tiled ? TIFFReadRGBATile(handle.tiff(), x, y, raster.data()) != 0 : TIFFReadRGBAStrip(handle.tiff(), y, raster.data()) != 0;
+
+            if (!ok) {
+                failed.storeRelease(1);
+                return;
+            }
+
+            // the raster's origin is bottom-left
+            // tiles are always chunkHeight rows high, strips only have the rows decoded
+            int bottom = tiled ? chunkHeight - 1 : h - 1;
+
+            for (int ry = 0; ry < h; ry++) {
+                const uint32_t *src = raster.constData() + (size_t)(bottom - ry) * chunkWidth;
+                uint32_t *dst = reinterpret_cast<uint32_t *>(bits + (y + ry) * bpl) + x;
+
+                for (int rx = 0; rx < w; rx++)
+                    dst[rx] = abgrToArgb(src[rx]);
+            }
+
+            if (mPreviewCallback)
+                updatePreview(img, QRect(x, y, w, h));
+        }
+    });
+
+    if (failed.loadAcquire()) {
+        qWarning() << "[DkTiffReader] could not decode" << mFilePath;
+        img = QImage();
+        return false;
+    }
+
+    qInfo() << "[DkTiffReader]" << size << "decoded in" << dt << "(" << numChunks << (tiled ? "tiles" : "strips") << "on" << numJobs << "jobs)";
+
+    return true;
+#else
+    Q_UNUSED(dirOffset);
+    Q_UNUSED(size);
+    Q_UNUSED(img);
+    return false;
+#endif
+}
+
+void DkTiffReader::updatePreview(const QImage &img, const QRect &r)
+{
+    QMutexLocker lock(&mPreviewMutex);
+
+    int f = mPreviewFactor;
+    int y0 = (r.top() + f - 1) / f * f;
+    int x0 = (r.left() + f - 1) / f * f;
+
+    // nearest neighbor is good enough here
+    for (int y = y0; y <= r.bottom(); y += f) {
+        const QRgb *src = reinterpret_cast<const QRgb *>(img.constScanLine(y));
+        QRgb *dst = reinterpret_cast<QRgb *>(mPreview.scanLine(y / f));
+
+        for (int x = x0; x <= r.right(); x += f)
+            dst[x / f] = src[x];
+    }
+
+    if (mPreviewTimer.elapsed() > mPreviewInterval) {
+        mPreviewCallback(mPreview.copy());
+        mPreviewTimer.restart();
+    }
+}
+
+}
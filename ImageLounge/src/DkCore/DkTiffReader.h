@@ -0,0 +1,112 @@
+/*******************************************************************************************************
+ DkTiffReader.h
+ Created on:	19.10.2026
+
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+
+ Copyright (C) 2011-2016 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2016 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2016 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ *******************************************************************************************************/
+
+#pragma once
+
+#pragma warning(push, 0) // no warnings from includes - begin
+#include <QElapsedTimer>
+#include <QImage>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QSize>
+#include <QString>
+#pragma warning(pop) // no warnings from includes - end
+
+#include <functional>
+
+#pragma warning(disable : 4251) // TODO: remove
+
+#ifndef DllCoreExport
+#ifdef DK_CORE_DLL_EXPORT
+#define DllCoreExport Q_DECL_EXPORT
+#elif DK_DLL_IMPORT
+#define DllCoreExport Q_DECL_IMPORT
+#else
+#define DllCoreExport Q_DECL_IMPORT
+#endif
+#endif
+
+struct tiff;
+
+namespace nmc
+{
+
+/**
+ * Decodes tiffs with libtiff - strips and tiles are decoded concurrently.
+ * Each worker opens its own libtiff handle (on the file buffer if there is one)
+ * and writes its strips/tiles directly into the preallocated image.
+ * While decoding, a downsampled preview of the strips/tiles decoded so far
+ * can be streamed to a callback. For previews (e.g. thumbnails), reduced-resolution
+ * images (SubIFDs or IFDs flagged as reduced image) are used if the tiff has any.
+ * NOTE: the functions are no-ops if nomacs is built without libtiff.
+ **/
+class DllCoreExport DkTiffReader
+{
+public:
+    DkTiffReader(const QString &filePath, QSharedPointer<QByteArray> ba = QSharedPointer<QByteArray>());
+    ~DkTiffReader();
+
+    DkTiffReader(DkTiffReader const &) = delete;
+    void operator=(DkTiffReader const &) = delete;
+
+    bool isOpen() const;
+    bool setDirectory(int idx);
+    QSize size() const;
+    bool isLarge() const;
+
+    bool read(QImage &img);
+    bool readPreview(QImage &img, const QSize &minSize);
+
+    void setPreviewCallback(std::function<void(const QImage &)> callback);
+
+    static bool isLarge(const QString &filePath, QSharedPointer<QByteArray> ba = QSharedPointer<QByteArray>());
+
+private:
+    bool decode(quint64 dirOffset, const QSize &size, QImage &img);
+    void updatePreview(const QImage &img, const QRect &r);
+
+    QString mFilePath;
+    QSharedPointer<QByteArray> mBuffer;
+
+    struct tiff *mTiff = 0;
+    void *mClientData = 0;
+    quint64 mDirOffset = 0;
+    QSize mSize;
+
+    // progressive preview
+    std::function<void(const QImage &)> mPreviewCallback;
+    QMutex mPreviewMutex;
+    QImage mPreview;
+    int mPreviewFactor = 1;
+    QElapsedTimer mPreviewTimer;
+
+    static const int mLargeImageSize = 4096 * 4096; // pixels - smaller tiffs are decoded by Qt
+    static const int mMaxPreviewSize = 2048; // pixels
+    static const int mPreviewInterval = 250; // ms
+};
+
+}
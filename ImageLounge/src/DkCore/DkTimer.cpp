@@ -32,8 +32,13 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "DkUtils.h"
 
 #pragma warning(push, 0) // no warnings from includes - begin
+#include <QCoreApplication>
 #include <QDebug>
+#include <QFile>
+#include <QMutexLocker>
 #include <QString>
+#include <QTextStream>
+#include <QThread>
 #include <qmath.h>
 #pragma warning(pop) // no warnings from includes - end
 
@@ -130,4 +135,235 @@ int DkTimer::elapsed() const
 {
     return mTimer.elapsed();
 }
-}
\ No newline at end of file
+
+// DkTracer --------------------------------------------------------------------
+DkTracer::DkTracer()
+{
+    mClock.start();
+}
+
+DkTracer &DkTracer::instance()
+{
+    static DkTracer inst;
+    return inst;
+}
+
+void DkTracer::setEnabled(bool enabled)
+{
+    mEnabled.storeRelease(enabled ? 1 : 0);
+}
+
+bool DkTracer::isEnabled() const
+{
+    return mEnabled.loadAcquire() != 0;
+}
+
+void DkTracer::setFilePath(const QString &filePath)
+{
+    QMutexLocker locker(&mMutex);
+    mFilePath = filePath;
+}
+
+QString DkTracer::filePath() const
+{
+    QMutexLocker locker(&mMutex);
+
+    if (mFilePath.isEmpty())
+        return DkUtils::getTraceFilePath();
+
+    return mFilePath;
+}
+
+/**
+ * Returns the tracer's clock.
+ * @return qint64 microseconds since the tracer was created
+ **/
+qint64 DkTracer::now() const
+{
+    return mClock.nsecsElapsed() / 1000;
+}
+
+void DkTracer::addZone(const char *name, qint64 startUs, qint64 durationUs)
+{
+    if (!isEnabled())
+        return;
+
+    QMutexLocker locker(&mMutex);
+
+    if (mEvents.size() >= mMaxEvents)
+        return;
+
+    mEvents << Event{name, 'X', startUs, durationUs, threadIdx()};
+}
+
+/**
+ * Adds delta to the counter name.
+ * Counters are cumulative (e.g. cache hits, bytes decoded).
+ * @param name a string literal
+ * @param delta the increment
+ **/
+void DkTracer::addCounter(const char *name, qint64 delta)
+{
+    if (!isEnabled())
+        return;
+
+    qint64 ts = now();
+    QMutexLocker locker(&mMutex);
+
+    if (mEvents.size() >= mMaxEvents)
+        return;
+
+    qint64 &val = mCounters[QByteArray::fromRawData(name, (int)qstrlen(name))];
+    val += delta;
+
+    mEvents << Event{name, 'C', ts, val, threadIdx()};
+}
+
+// must be called with a locked mutex
+int DkTracer::threadIdx()
+{
+    Qt::HANDLE id = QThread::currentThreadId();
+
+    auto it = mThreads.find(id);
+    if (it != mThreads.end())
+        return it.value();
+
+    int idx = mThreads.size() + 1;
+    mThreads.insert(id, idx);
+
+    return idx;
+}
+
+/**
+ * Writes all events in the Chrome trace event format.
+ * @return bool true if the file was written
+ **/
+bool DkTracer::save() const
+{
+    QString fp = filePath();
+    QMutexLocker locker(&mMutex);
+
+    QFile file(fp);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "[Trace] I could not open" << fp << "for writing";
+        return false;
+    }
+
+    qint64 pid = QCoreApplication::applicationPid();
+
+    QTextStream ts(&file);
+    ts << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+    // name the threads (1 is the first thread that traced - typically the GUI thread)
+    bool first = true;
+    for (int tid : mThreads) {
+        if (!first)
+            ts << ",\n";
+        ts << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << tid << ",\"args\":{\"name\":\"thread " << tid << "\"}}";
+        first = false;
+    }
+
+    for (const Event &e : mEvents) {
+        if (!first)
+            ts << ",\n";
+
+        ts << "{\"name\":\"" << e.name << "\",\"cat\":\"nomacs\",\"ph\":\"" << e.phase << "\",\"ts\":" << e.ts << ",\"pid\":" << pid
+           << ",\"tid\":" << e.tid;
+
+        if (e.phase == 'X')
+            ts << ",\"dur\":" << e.value << "}";
+        else
+            ts << ",\"args\":{\"value\":" << e.value << "}}";
+
+        first = false;
+    }
+
+    ts << "\n]}\n";
+    ts.flush();
+
+    qInfo() << "[Trace]" << mEvents.size() << "events written to" << fp;
+
+    return file.error() == QFile::NoError;
+}
+
+void DkTracer::clear()
+{
+    QMutexLocker locker(&mMutex);
+    mEvents.clear();
+    mCounters.clear();
+}
+
+// DkTraceZone --------------------------------------------------------------------
+DkTraceZone::DkTraceZone(const char *name)
+    : mName(name)
+{
+    if (DkTracer::instance().isEnabled())
+        mStart = DkTracer::instance().now();
+}
+
+DkTraceZone::~DkTraceZone()
+{
+    if (mStart != -1) {
+        DkTracer &t = DkTracer::instance();
+        t.addZone(mName, mStart, t.now() - mStart);
+    }
+}
+
+// DkStartupTimeline --------------------------------------------------------------------
+DkStartupTimeline::DkStartupTimeline()
+{
+    mClock.start();
+    mTraceStart = DkTracer::instance().now();
+}
+
+DkStartupTimeline &DkStartupTimeline::instance()
+{
+    static DkStartupTimeline inst;
+    return inst;
+}
+
+/**
+ * Ends the current start-up phase.
+ * Each phase is added as zone to the trace. Milestones after the
+ * start-up finished (deferred initialization) are logged directly.
+ * @param milestone a string literal naming the phase that just ended
+ **/
+void DkStartupTimeline::mark(const char *milestone)
+{
+    qint64 us = mClock.nsecsElapsed() / 1000;
+    qint64 lastUs = mMilestones.empty() ? 0 : mMilestones.last().us;
+
+    mMilestones << Milestone{milestone, us};
+    DkTracer::instance().addZone(milestone, mTraceStart + lastUs, us - lastUs);
+
+    if (mFinished)
+        qInfo().nospace() << "[Startup] " << milestone << " at " << us / 1000 << " ms (+" << (us - lastUs) / 1000 << " ms)";
+}
+
+bool DkStartupTimeline::isFinished() const
+{
+    return mFinished;
+}
+
+/**
+ * Marks the end of the critical start-up path and logs the timeline.
+ * Subsequent calls are ignored.
+ * @param milestone the last milestone e.g. "first image painted"
+ **/
+void DkStartupTimeline::finish(const char *milestone)
+{
+    if (mFinished)
+        return;
+
+    mark(milestone);
+    mFinished = true;
+
+    qint64 lastUs = 0;
+    for (const Milestone &m : mMilestones) {
+        qInfo().nospace() << "[Startup] " << m.name << " at " << m.us / 1000 << " ms (+" << (m.us - lastUs) / 1000 << " ms)";
+        lastUs = m.us;
+    }
+
+    emit finished();
+}
+}
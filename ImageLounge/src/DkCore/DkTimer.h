@@ -29,8 +29,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <time.h>
 
 #pragma warning(push, 0) // no warnings from includes - begin
+#include <QAtomicInt>
 #include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
 #include <QObject>
+#include <QVector>
 #pragma warning(pop) // no warnings from includes - end
 
 #ifndef DllCoreExport
@@ -77,4 +81,112 @@ protected:
     QElapsedTimer mTimer;
 };
 
+/**
+ * Collects timing zones and counters of the hot paths (load, decode, cache, paint).
+ * The events are exported as Chrome trace JSON which can be opened
+ * with chrome://tracing or https://ui.perfetto.dev.
+ * If tracing is disabled, a zone costs a single atomic load.
+ **/
+class DllCoreExport DkTracer
+{
+public:
+    static DkTracer &instance();
+
+    // singleton
+    DkTracer(DkTracer const &) = delete;
+    void operator=(DkTracer const &) = delete;
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const;
+
+    void setFilePath(const QString &filePath);
+    QString filePath() const;
+
+    qint64 now() const;
+    void addZone(const char *name, qint64 startUs, qint64 durationUs);
+    void addCounter(const char *name, qint64 delta = 1);
+
+    bool save() const;
+    void clear();
+
+private:
+    DkTracer();
+
+    struct Event {
+        const char *name;
+        char phase;
+        qint64 ts;
+        qint64 value; // duration for zones, current value for counters
+        int tid;
+    };
+
+    int threadIdx();
+
+    QAtomicInt mEnabled = 0;
+    QElapsedTimer mClock;
+    QString mFilePath;
+
+    mutable QMutex mMutex;
+    QVector<Event> mEvents;
+    QHash<QByteArray, qint64> mCounters;
+    QHash<Qt::HANDLE, int> mThreads;
+
+    int mMaxEvents = 2000000; // ~80 MB
+};
+
+/**
+ * Measures the lifetime of the object and reports it to the DkTracer.
+ * name must be a string literal since it is only copied when the trace is saved.
+ **/
+class DllCoreExport DkTraceZone
+{
+public:
+    DkTraceZone(const char *name);
+    ~DkTraceZone();
+
+private:
+    const char *mName;
+    qint64 mStart = -1;
+};
+
+/**
+ * Records the milestones of the application start.
+ * The start-up is finished when the first image is painted (or nothing is
+ * left to load). The timeline is logged then and work that is not needed for
+ * the first image can be started.
+ **/
+class DllCoreExport DkStartupTimeline : public QObject
+{
+    Q_OBJECT
+
+public:
+    static DkStartupTimeline &instance();
+
+    // singleton
+    DkStartupTimeline(DkStartupTimeline const &) = delete;
+    void operator=(DkStartupTimeline const &) = delete;
+
+    void mark(const char *milestone);
+    bool isFinished() const;
+
+public slots:
+    void finish(const char *milestone = "idle");
+
+signals:
+    void finished() const;
+
+private:
+    DkStartupTimeline();
+
+    struct Milestone {
+        const char *name;
+        qint64 us;
+    };
+
+    QElapsedTimer mClock;
+    qint64 mTraceStart = 0;
+    QVector<Milestone> mMilestones;
+    bool mFinished = false;
+};
+
 }
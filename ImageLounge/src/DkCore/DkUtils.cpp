@@ -26,6 +26,7 @@
  *******************************************************************************************************/
 
 #include "DkUtils.h"
+#include "DkFormatRegistry.h"
 #include "DkMath.h"
 #include "DkNoMacs.h"
 #include "DkSettings.h"
@@ -456,6 +457,16 @@ QString DkUtils::getLogFilePath()
     return fileInfo.absoluteFilePath();
 }
 
+QString DkUtils::getTraceFilePath()
+{
+    QString tracePath = QStandardPaths::writableLocation(QStandardPaths::TempLocation);
+    QString now = QDateTime::currentDateTime().toString("yyyy-MM-dd HH-mm-ss");
+
+    static QFileInfo fileInfo(tracePath, "nomacs-" + now + "-trace.json");
+
+    return fileInfo.absoluteFilePath();
+}
+
 QString DkUtils::getAppDataPath()
 {
     QString appPath;
@@ -607,15 +618,18 @@ bool isValidByContent(const QFileInfo &file)
     if (!file.isFile())
         return false;
 
+    // fast path: identify the file by its magic number
+    const DkFormatRegistry &registry = DkFormatRegistry::instance();
+    QString suffix = registry.sniff(file);
+    if (!suffix.isEmpty())
+        return registry.suffixCapabilities(suffix).testFlag(DkFormatRegistry::cap_decode);
+
     QMimeDatabase mimeDb;
     QMimeType fileMimeType = mimeDb.mimeTypeForFile(file, QMimeDatabase::MatchContent);
 
-    for (QString sfx : fileMimeType.suffixes()) {
-        QString tryFilename = file.fileName() + QString(".") + sfx;
-
-        if (DkUtils::hasValidSuffix(tryFilename)) {
+    for (const QString &sfx : fileMimeType.suffixes()) {
+        if (registry.suffixCapabilities(sfx).testFlag(DkFormatRegistry::cap_decode))
             return true;
-        }
     }
     return false;
 }
@@ -646,30 +660,12 @@ bool DkUtils::isValid(const QFileInfo &fileInfo)
 
 bool DkUtils::isSavable(const QString &fileName)
 {
-    QStringList cleanSaveFilters = suffixOnly(DkSettingsManager::param().app().saveFilters);
-
-    for (const QString &cFilter : cleanSaveFilters) {
-        QRegularExpression exp = QRegularExpression(QRegularExpression::wildcardToRegularExpression(cFilter), QRegularExpression::CaseInsensitiveOption);
-
-        qDebug() << "checking extension: " << exp;
-
-        if (exp.match(fileName).hasMatch())
-            return true;
-    }
-
-    return false;
+    return DkFormatRegistry::instance().hasCapability(fileName, DkFormatRegistry::cap_save);
 }
 
 bool DkUtils::hasValidSuffix(const QString &fileName)
 {
-    for (int idx = 0; idx < DkSettingsManager::param().app().fileFilters.size(); idx++) {
-        QRegularExpression exp = QRegularExpression(QRegularExpression::wildcardToRegularExpression(DkSettingsManager::param().app().fileFilters.at(idx)),
-                                                    QRegularExpression::CaseInsensitiveOption);
-        if (exp.match(fileName).hasMatch())
-            return true;
-    }
-
-    return false;
+    return DkFormatRegistry::instance().hasCapability(fileName, DkFormatRegistry::cap_decode);
 }
 
 QStringList DkUtils::suffixOnly(const QStringList &fileFilters)
@@ -161,6 +161,7 @@ public:
     static void logToFile(QtMsgType type, const QString &msg);
 
     static QString getLogFilePath();
+    static QString getTraceFilePath();
 
     static QString getAppDataPath();
 
@@ -29,6 +29,7 @@
 #include "DkActionManager.h"
 #include "DkBasicWidgets.h"
 #include "DkDialog.h"
+#include "DkImageEncoder.h"
 #include "DkImageLoader.h"
 #include "DkImageStorage.h"
 #include "DkManipulatorWidgets.h"
@@ -787,6 +788,12 @@ void DkBatchOutput::createLayout()
     mCbDeleteOriginal = new QCheckBox(tr("Delete Input Files"));
     mCbDeleteOriginal->setToolTip(tr("If checked, the original file will be deleted if the conversion was successful.\n So be careful!"));
 
+    // incremental
+    mCbIncremental = new QCheckBox(tr("Skip Unchanged Files"));
+    mCbIncremental->setToolTip(tr("If checked, files that were already processed with the same settings and did not change since are skipped.\n"
+                                  "Interrupted batches resume where they stopped."));
+    connect(mCbIncremental, SIGNAL(clicked()), this, SIGNAL(changed()));
+
     QWidget *cbWidget = new QWidget(this);
     QVBoxLayout *cbLayout = new QVBoxLayout(cbWidget);
     cbLayout->setContentsMargins(0, 0, 0, 0);
@@ -794,6 +801,7 @@ void DkBatchOutput::createLayout()
     cbLayout->addWidget(mCbOverwriteExisting);
     cbLayout->addWidget(mCbDoNotSave);
     cbLayout->addWidget(mCbDeleteOriginal);
+    cbLayout->addWidget(mCbIncremental);
 
     QWidget *outDirWidget = new QWidget(this);
     QGridLayout *outDirLayout = new QGridLayout(outDirWidget);
@@ -838,9 +846,17 @@ void DkBatchOutput::createLayout()
     updateCBCompression();
     mCbCompression->setEnabled(false);
 
+    mCbSavePreset = new QComboBox(this);
+    mCbSavePreset->addItem(tr("Default Encoding"), DkImageEncoder::preset_default);
+    mCbSavePreset->addItem(tr("Fastest Encoding"), DkImageEncoder::preset_fast);
+    mCbSavePreset->addItem(tr("Smallest Files"), DkImageEncoder::preset_small);
+    mCbSavePreset->setToolTip(tr("Trade file size for encoding speed (PNG, JPG and TIF)."));
+    connect(mCbSavePreset, SIGNAL(currentIndexChanged(int)), this, SIGNAL(changed()));
+
     extensionLayout->addWidget(mCbExtension);
     extensionLayout->addWidget(mCbNewExtension);
     extensionLayout->addWidget(mCbCompression);
+    extensionLayout->addWidget(mCbSavePreset);
     // extensionLayout->addStretch();
     mFilenameVBLayout->addWidget(extensionWidget);
 
@@ -1122,11 +1138,13 @@ void DkBatchOutput::applyDefault()
 {
     mCbUseInput->setChecked(false);
     mCbDeleteOriginal->setChecked(false);
+    mCbIncremental->setChecked(false);
     mCbOverwriteExisting->setChecked(false);
     mCbDoNotSave->setChecked(false);
     mCbExtension->setCurrentIndex(0);
     mCbNewExtension->setCurrentIndex(0);
     mCbCompression->setCurrentIndex(0);
+    mCbSavePreset->setCurrentIndex(0);
     mOutputDirectory = "";
     mInputDirectory = "";
     mHUserInput = false;
@@ -1152,6 +1170,7 @@ void DkBatchOutput::loadProperties(const DkBatchConfig &config)
     mCbOverwriteExisting->setChecked((si.mode() & DkSaveInfo::mode_overwrite) != 0);
     mCbDoNotSave->setChecked((si.mode() & DkSaveInfo::mode_do_not_save_output) != 0);
     mCbDeleteOriginal->setChecked(si.isDeleteOriginal());
+    mCbIncremental->setChecked(si.isIncremental());
     mCbUseInput->setChecked(si.isInputDirOutputDir());
     mOutputlineEdit->setText(config.getOutputDirPath());
 
@@ -1164,6 +1183,9 @@ void DkBatchOutput::loadProperties(const DkBatchConfig &config)
         }
     }
 
+    int pIdx = mCbSavePreset->findData(si.savePreset());
+    mCbSavePreset->setCurrentIndex(pIdx != -1 ? pIdx : 0);
+
     loadFilePattern(config.getFileNamePattern());
 
     parameterChanged();
@@ -1191,6 +1213,16 @@ bool DkBatchOutput::deleteOriginal() const
     return mCbDeleteOriginal->isChecked();
 }
 
+bool DkBatchOutput::incremental() const
+{
+    return mCbIncremental->isChecked();
+}
+
+int DkBatchOutput::savePreset() const
+{
+    return mCbSavePreset->currentData().toInt();
+}
+
 void DkBatchOutput::setExampleFilename(const QString &exampleName)
 {
     mExampleName = exampleName;
@@ -1670,7 +1702,8 @@ void DkBatchPluginWidget::addPlugins(QStandardItemModel *model) const
         mPluginItem->setData(p->pluginName(), Qt::UserRole);
         mModel->appendRow(mPluginItem);
 
-        QList<QAction *> actions = p->plugin()->pluginActions();
+        // the manifest's actions are listed if the plugin is not loaded yet
+        QList<QAction *> actions = p->actions();
 
         for (const QAction *a : actions) {
             QStandardItem *item = new QStandardItem(a->icon(), a->text());
@@ -1687,7 +1720,7 @@ void DkBatchPluginWidget::selectPlugin(const QString &pluginName)
     mCurrentPlugin = 0; // unset
     QSharedPointer<DkPluginContainer> plugin = DkPluginManager::instance().getPluginByName(pluginName);
 
-    if (!plugin || !plugin->batchPlugin()) {
+    if (!plugin || plugin->type() != DkPluginContainer::type_batch || !plugin->ensureLoaded() || !plugin->batchPlugin()) {
         mSettingsTitle->setText("");
         mSettingsTitle->hide();
         mSettingsEditor->hide();
@@ -2715,8 +2748,10 @@ DkBatchConfig DkBatchWidget::createBatchConfig(bool strict) const
     DkSaveInfo si;
     si.setMode(outputWidget()->overwriteMode());
     si.setDeleteOriginal(outputWidget()->deleteOriginal());
+    si.setIncremental(outputWidget()->incremental());
     si.setInputDirIsOutputDir(outputWidget()->useInputDir());
     si.setCompression(outputWidget()->getCompression());
+    si.setSavePreset(outputWidget()->savePreset());
 
     DkBatchConfig config(inputWidget()->getSelectedFilesBatch(), outputWidget()->getOutputDirectory(), outputWidget()->getFilePattern());
     config.setSaveInfo(si);
@@ -2855,10 +2890,15 @@ void DkBatchWidget::stopProcessing()
 
     int numFailures = mBatchProcessing->getNumFailures();
     int numProcessed = mBatchProcessing->getNumProcessed();
+    int numSkipped = mBatchProcessing->getNumSkipped();
     int numItems = mBatchProcessing->getNumItems();
 
+    QString msg = tr("%1/%2 files processed... %3 failed.").arg(numProcessed).arg(numItems).arg(numFailures);
+    if (numSkipped > 0)
+        msg += " " + tr("%1 up to date.").arg(numSkipped);
+
     DkBatchInfoWidget::InfoMode im = (numFailures > 0) ? DkBatchInfoWidget::InfoMode::info_warning : DkBatchInfoWidget::InfoMode::info_message;
-    mInfoWidget->setInfo(tr("%1/%2 files processed... %3 failed.").arg(numProcessed).arg(numItems).arg(numFailures), im);
+    mInfoWidget->setInfo(msg, im);
 
     mLogNeedsUpdate = false;
     mLogUpdateTimer.stop();
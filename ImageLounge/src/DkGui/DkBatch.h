@@ -319,6 +319,8 @@ public:
     int getCompression() const;
     bool useInputDir() const;
     bool deleteOriginal() const;
+    bool incremental() const;
+    int savePreset() const;
     QString getOutputDirectory();
     QString getFilePattern();
     void loadFilePattern(const QString &pattern);
@@ -359,11 +361,13 @@ private:
     QCheckBox *mCbDoNotSave = 0;
     QCheckBox *mCbUseInput = 0;
     QCheckBox *mCbDeleteOriginal = 0;
+    QCheckBox *mCbIncremental = 0;
     QPushButton *mOutputBrowseButton = 0;
 
     QComboBox *mCbExtension = 0;
     QComboBox *mCbNewExtension = 0;
     QComboBox *mCbCompression = 0;
+    QComboBox *mCbSavePreset = 0;
     QLabel *mOldFileNameLabel = 0;
     QLabel *mNewFileNameLabel = 0;
     QString mExampleName = 0;
@@ -35,11 +35,36 @@
 #include <QHostInfo>
 #include <QThread>
 #include <QTimer>
+#include <QtEndian>
 #pragma warning(pop) // no warnings from includes - end
 
 namespace nmc
 {
 
+// world transform, image transform & canvas size as flat vector
+static const int NumTransformValues = 20;
+
+static QVector<double> transformToValues(const QTransform &transform, const QTransform &imgTransform, const QPointF &canvasSize)
+{
+    return {transform.m11(),    transform.m12(),    transform.m13(),    transform.m21(),    transform.m22(),
+            transform.m23(),    transform.m31(),    transform.m32(),    transform.m33(),    imgTransform.m11(),
+            imgTransform.m12(), imgTransform.m13(), imgTransform.m21(), imgTransform.m22(), imgTransform.m23(),
+            imgTransform.m31(), imgTransform.m32(), imgTransform.m33(), canvasSize.x(),     canvasSize.y()};
+}
+
+static void valuesToTransform(const QVector<double> &v, QTransform &transform, QTransform &imgTransform, QPointF &canvasSize)
+{
+    transform.setMatrix(v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7], v[8]);
+    imgTransform.setMatrix(v[9], v[10], v[11], v[12], v[13], v[14], v[15], v[16], v[17]);
+    canvasSize = QPointF(v[18], v[19]);
+}
+
+// relative transforms (increments, see DkViewPort::tcpSetTransforms) have no canvas size
+static bool isRelativeTransform(const QVector<double> &v)
+{
+    return QPointF(v[18], v[19]).isNull();
+}
+
 // DkConnection --------------------------------------------------------------------
 
 DkConnection::DkConnection(QObject *parent)
@@ -51,7 +76,19 @@ DkConnection::DkConnection(QObject *parent)
     connectionCreated = false;
     mSynchronizedTimer = new QTimer(this);
 
+    mTransformTimer = new QTimer(this);
+    mTransformTimer->setInterval(SyncTransformInterval);
+    mTransformTimer->setTimerType(Qt::PreciseTimer);
+
+    mInterpolationTimer = new QTimer(this);
+    mInterpolationTimer->setInterval(SyncTransformInterval / 2);
+    mInterpolationTimer->setTimerType(Qt::PreciseTimer);
+
+    mReceivedTransform = transformToValues(QTransform(), QTransform(), QPointF());
+
     connect(mSynchronizedTimer, SIGNAL(timeout()), this, SLOT(synchronizedTimerTimeout()));
+    connect(mTransformTimer, SIGNAL(timeout()), this, SLOT(transformTimerTimeout()));
+    connect(mInterpolationTimer, SIGNAL(timeout()), this, SLOT(interpolationTimerTimeout()));
     connect(this, SIGNAL(readyRead()), this, SLOT(processReadyRead()));
 
     setReadBufferSize(MaxBufferSize);
@@ -94,6 +131,7 @@ void DkConnection::sendStopSynchronizeMessage()
         if (write(data) == data.size())
             mIsSynchronizeMessageSent = false;
         mState = ReadyForUse;
+        mInterpolationTimer->stop();
     }
 }
 
@@ -126,16 +164,95 @@ void DkConnection::sendNewPositionMessage(QRect position, bool opacity, bool ove
 
 void DkConnection::sendNewTransformMessage(QTransform transform, QTransform imgTransform, QPointF canvasSize)
 {
-    // qDebug() << "sending new Transform Message to " << this->peerName() << ":" << this->peerPort();
-    QByteArray ba;
-    QDataStream ds(&ba, QIODevice::ReadWrite);
-    ds << transform;
-    ds << imgTransform;
-    ds << canvasSize;
+    QVector<double> values = transformToValues(transform, imgTransform, canvasSize);
 
-    // QByteArray data = "NEWTRANSFORM" + SeparatorToken + QByteArray::number(ba.size()) + SeparatorToken + ba;
-    QByteArray data = "NEWTRANSFORM";
-    data.append(SeparatorToken).append(QByteArray::number(ba.size())).append(SeparatorToken).append(ba);
+    // relative transforms are increments - each of them is sent
+    if (isRelativeTransform(values)) {
+        if (mTransformPending)
+            flushTransform();
+
+        mPendingTransform = values;
+        flushTransform();
+        return;
+    }
+
+    // absolute transforms are coalesced (latest wins): the first update of a gesture is sent
+    // immediately, the following ones at most every SyncTransformInterval ms
+    mPendingTransform = values;
+    mTransformPending = true;
+
+    if (!mTransformTimer->isActive()) {
+        flushTransform();
+        mTransformTimer->start();
+    }
+}
+
+void DkConnection::transformTimerTimeout()
+{
+    if (mTransformPending)
+        flushTransform();
+    else
+        mTransformTimer->stop();
+}
+
+void DkConnection::flushTransform()
+{
+    mTransformPending = false;
+
+    // peers that do not know binary frames get the full text message
+    if (!mBinaryFraming) {
+        QTransform transform;
+        QTransform imgTransform;
+        QPointF canvasSize;
+        valuesToTransform(mPendingTransform, transform, imgTransform, canvasSize);
+
+        QByteArray ba;
+        QDataStream ds(&ba, QIODevice::ReadWrite);
+        ds << transform;
+        ds << imgTransform;
+        ds << canvasSize;
+
+        // QByteArray data = "NEWTRANSFORM" + SeparatorToken + QByteArray::number(ba.size()) + SeparatorToken + ba;
+        QByteArray data = "NEWTRANSFORM";
+        data.append(SeparatorToken).append(QByteArray::number(ba.size())).append(SeparatorToken).append(ba);
+        write(data);
+        return;
+    }
+
+    // delta: a bit mask followed by the values that changed since the last frame
+    quint32 mask = 0;
+    for (int idx = 0; idx < NumTransformValues; idx++) {
+        if (mSentTransform.size() != NumTransformValues || mSentTransform[idx] != mPendingTransform[idx])
+            mask |= 1u << idx;
+    }
+
+    // repeated increments are sent although nothing changed
+    if (mask == 0 && !isRelativeTransform(mPendingTransform))
+        return;
+
+    QByteArray payload;
+    QDataStream ds(&payload, QIODevice::WriteOnly);
+    ds << mask;
+
+    for (int idx = 0; idx < NumTransformValues; idx++) {
+        if (mask & (1u << idx))
+            ds << mPendingTransform[idx];
+    }
+
+    writeBinaryFrame(binaryTransform, payload);
+    mSentTransform = mPendingTransform;
+}
+
+void DkConnection::writeBinaryFrame(quint8 type, const QByteArray &payload)
+{
+    // token | type | payload length (big endian) | payload
+    uchar length[4];
+    qToBigEndian<quint32>((quint32)payload.size(), length);
+
+    QByteArray data(1, BinaryFrameToken);
+    data.append((char)type);
+    data.append(reinterpret_cast<const char *>(length), 4);
+    data.append(payload);
     write(data);
 }
 
@@ -216,6 +333,125 @@ bool DkConnection::readProtocolHeader()
     return true;
 }
 
+/**
+ * Reads all complete binary frames at the current position.
+ * @return bool false if a frame is not yet complete
+ **/
+bool DkConnection::readBinaryFrames()
+{
+    const int headerSize = 6;
+
+    while (mCurrentDataType == Undefined && mBuffer.isEmpty() && bytesAvailable() > 0) {
+        QByteArray header = peek(headerSize);
+
+        if (header.at(0) != BinaryFrameToken)
+            return true;
+
+        if (header.size() < headerSize)
+            return false;
+
+        quint32 length = qFromBigEndian<quint32>(reinterpret_cast<const uchar *>(header.constData()) + 2);
+        if (length > (quint32)MaxBufferSize) {
+            qDebug() << "DkConnection::readBinaryFrames: frame too large - connection aborted";
+            abort();
+            return false;
+        }
+
+        if (bytesAvailable() < headerSize + (qint64)length)
+            return false;
+
+        read(headerSize);
+        processBinaryFrame((quint8)header.at(1), read(length));
+    }
+
+    return true;
+}
+
+void DkConnection::processBinaryFrame(quint8 type, const QByteArray &payload)
+{
+    // unknown frames are skipped - newer peers might send them
+    if (type != binaryTransform)
+        return;
+
+    QDataStream ds(payload);
+    quint32 mask = 0;
+    ds >> mask;
+
+    // deltas are applied even if we are not synchronized - the sender's base changed
+    QVector<double> values = mReceivedTransform;
+    for (int idx = 0; idx < NumTransformValues; idx++) {
+        if (mask & (1u << idx))
+            ds >> values[idx];
+    }
+
+    if (ds.status() != QDataStream::Ok)
+        return;
+
+    mReceivedTransform = values;
+
+    if (mState == Synchronized)
+        setTargetTransform(values);
+}
+
+/**
+ * Moves the view towards the transform received.
+ * If the peer is idle, the transform is applied immediately. While updates
+ * keep coming, we interpolate between them so that the view moves smoothly
+ * although the sender's update rate is capped.
+ * Relative transforms are increments and therefore always applied as they are.
+ **/
+void DkConnection::setTargetTransform(const QVector<double> &values)
+{
+    if (isRelativeTransform(values)) {
+        emitTransform(values);
+        return;
+    }
+
+    mTargetTransform = values;
+
+    if (!mInterpolationTimer->isActive() || mShownTransform.size() != NumTransformValues) {
+        mInterpolationStart = values;
+        mShownTransform = values;
+        emitTransform(values);
+    } else
+        mInterpolationStart = mShownTransform;
+
+    mInterpolationClock.start();
+    mInterpolationTimer->start();
+}
+
+void DkConnection::interpolationTimerTimeout()
+{
+    qint64 elapsed = mInterpolationClock.elapsed();
+    double t = qMin(1.0, (double)elapsed / SyncTransformInterval);
+
+    QVector<double> values = mTargetTransform;
+
+    if (t < 1.0) {
+        for (int idx = 0; idx < NumTransformValues; idx++)
+            values[idx] = mInterpolationStart[idx] + (mTargetTransform[idx] - mInterpolationStart[idx]) * t;
+    }
+
+    if (values != mShownTransform) {
+        mShownTransform = values;
+        emitTransform(values);
+    }
+
+    // keep ticking for a while so that the next update is interpolated too
+    if (elapsed > 4 * SyncTransformInterval)
+        mInterpolationTimer->stop();
+}
+
+void DkConnection::emitTransform(const QVector<double> &values)
+{
+    QTransform transform;
+    QTransform imgTransform;
+    QPointF canvasSize;
+    valuesToTransform(values, transform, imgTransform, canvasSize);
+
+    emit connectionNewTransform(this, transform, imgTransform, canvasSize);
+}
+
 int DkConnection::readDataIntoBuffer(int maxSize)
 {
     if (maxSize > MaxBufferSize)
@@ -267,6 +503,8 @@ int DkConnection::dataLengthForCurrentDataType()
 
 void DkConnection::processReadyRead()
 {
+    if (!readBinaryFrames())
+        return;
     if (readDataIntoBuffer() <= 0)
         return;
     if (!readProtocolHeader())
@@ -384,6 +622,8 @@ void DkConnection::readWhileBytesAvailable()
 {
     do {
         if (mCurrentDataType == Undefined) {
+            if (!readBinaryFrames())
+                return;
             if (readDataIntoBuffer() <= 0)
                 return;
             if (!readProtocolHeader())
@@ -442,7 +682,7 @@ void DkConnection::processData()
             dsTransform >> transform;
             dsTransform >> imgTransform;
             dsTransform >> canvasSize;
-            emit connectionNewTransform(this, transform, imgTransform, canvasSize);
+            setTargetTransform(transformToValues(transform, imgTransform, canvasSize));
         }
         break;
     }
@@ -525,6 +765,7 @@ void DkLocalConnection::sendGreetingMessage(const QString &currentTitle)
     QDataStream ds(&ba, QIODevice::ReadWrite);
     ds << mLocalTcpServerPort;
     ds << mCurrentTitle;
+    ds << SyncProtocolVersion; // older peers ignore it
 
     // qDebug() << "title: " << mCurrentTitle;
     // qDebug() << "local tcp: " << mLocalTcpServerPort;
@@ -550,6 +791,11 @@ void DkLocalConnection::readGreetingMessage()
     ds >> this->mPeerServerPort;
     ds >> title;
 
+    quint16 version = 1;
+    if (!ds.atEnd())
+        ds >> version;
+    mBinaryFraming = version >= SyncProtocolVersion;
+
     // qDebug() << "emitting readyForUse";
     emit connectionReadyForUse(mPeerServerPort, title, this);
 }
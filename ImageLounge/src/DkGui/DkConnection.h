@@ -28,11 +28,13 @@
 #pragma once
 
 #pragma warning(push, 0) // no warnings from includes - begin
+#include <QElapsedTimer>
 #include <QHostAddress>
 #include <QImage>
 #include <QRect>
 #include <QTcpSocket>
 #include <QTransform>
+#include <QVector>
 #pragma warning(pop) // no warnings from includes - end
 
 #pragma warning(disable : 4251)
@@ -59,6 +61,9 @@ namespace nmc
 
 static const int MaxBufferSize = 102400000;
 static const char SeparatorToken = '<';
+static const char BinaryFrameToken = '\x01'; // text headers always start with a letter
+static const int SyncTransformInterval = 16; // ms between two transform updates (~60 fps)
+static const quint16 SyncProtocolVersion = 2; // 2: binary frames (transform deltas & shared images)
 
 class DllCoreExport DkConnection : public QTcpSocket
 {
@@ -116,8 +121,15 @@ public slots:
 protected:
     enum ConnectionState { WaitingForGreeting, ReadyForUse, Synchronized };
     enum DataType { Greeting, startSynchronize, stopSynchronize, newTitle, newPosition, newTransform, newFile, GoodBye, Undefined };
+    enum BinaryDataType { binaryTransform = 1 };
 
     virtual bool readProtocolHeader();
+    bool readBinaryFrames();
+    void writeBinaryFrame(quint8 type, const QByteArray &payload);
+    void processBinaryFrame(quint8 type, const QByteArray &payload);
+    void flushTransform();
+    void setTargetTransform(const QVector<double> &values);
+    void emitTransform(const QVector<double> &values);
     virtual void checkState();
     int readDataIntoBuffer(int maxSize = MaxBufferSize);
     bool readDataTypeIntoBuffer();
@@ -140,12 +152,29 @@ protected:
     quint16 mPeerServerPort = 0;
     bool mIsGreetingMessageSent = false;
     bool mIsSynchronizeMessageSent = false;
+    bool mBinaryFraming = false; // the peer understands binary frames (see SyncProtocolVersion)
+
+    // outgoing absolute transforms: latest wins, only changed values are sent
+    QTimer *mTransformTimer = 0;
+    bool mTransformPending = false;
+    QVector<double> mPendingTransform;
+    QVector<double> mSentTransform;
+
+    // incoming absolute transforms are interpolated between two updates
+    QTimer *mInterpolationTimer = 0;
+    QElapsedTimer mInterpolationClock;
+    QVector<double> mReceivedTransform;
+    QVector<double> mInterpolationStart;
+    QVector<double> mTargetTransform;
+    QVector<double> mShownTransform;
 
 protected slots:
     virtual void processReadyRead();
 
 private slots:
     void synchronizedTimerTimeout();
+    void transformTimerTimeout();
+    void interpolationTimerTimeout();
 
 protected:
     QTimer *mSynchronizedTimer;
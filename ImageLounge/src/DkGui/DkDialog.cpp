@@ -31,7 +31,9 @@
 #include "DkBaseViewPort.h"
 #include "DkBasicWidgets.h"
 #include "DkCentralWidget.h"
+#include "DkFormatRegistry.h"
 #include "DkImageStorage.h"
+#include "DkMetaDataCatalog.h"
 #include "DkPluginManager.h"
 #include "DkSettings.h"
 #include "DkThumbs.h"
@@ -420,7 +422,7 @@ void DkTrainDialog::loadFile(const QString &filePath)
         return;
     }
 
-    if (DkSettingsManager::param().app().fileFilters.join(" ").contains(fileInfo.suffix(), Qt::CaseInsensitive)) {
+    if (DkUtils::hasValidSuffix(fileInfo.fileName())) {
         userFeedback(tr("*.%1 is already supported.").arg(fileInfo.suffix()), false);
         imgLoaded = false;
     } else
@@ -439,7 +441,7 @@ void DkTrainDialog::accept()
     QFileInfo acceptedFileInfo(mAcceptedFile);
 
     // add the extension to user filters
-    if (!DkSettingsManager::param().app().fileFilters.join(" ").contains(acceptedFileInfo.suffix(), Qt::CaseInsensitive)) {
+    if (!DkUtils::hasValidSuffix(acceptedFileInfo.fileName())) {
         QString name = QInputDialog::getText(this, "Format Name", tr("Please name the new format:"), QLineEdit::Normal, "Your File Format");
         QString tag = name + " (*." + acceptedFileInfo.suffix() + ")";
 
@@ -451,6 +453,7 @@ void DkTrainDialog::accept()
         DkSettingsManager::param().app().openFilters.append(tag);
         DkSettingsManager::param().app().fileFilters.append("*." + acceptedFileInfo.suffix());
         DkSettingsManager::param().app().browseFilters += acceptedFileInfo.suffix();
+        DkFormatRegistry::instance().addFilters({"*." + acceptedFileInfo.suffix()}, DkFormatRegistry::cap_decode);
     }
 
     QDialog::accept();
@@ -644,7 +647,7 @@ void DkSearchDialog::init()
     history->setCompletionMode(QCompleter::InlineCompletion);
     mSearchBar = new QLineEdit();
     mSearchBar->setObjectName("searchBar");
-    mSearchBar->setToolTip(tr("Type search words or a regular expression"));
+    mSearchBar->setToolTip(tr("Type search words, a regular expression or a metadata query (e.g. rating >= 4 and camera = nikon order by date)"));
     mSearchBar->setCompleter(history);
 
     mProxyModel.setSourceModel(&mSourceModel);
@@ -666,6 +669,7 @@ void DkSearchDialog::init()
 
     connect(mButtons, SIGNAL(accepted()), this, SLOT(accept()));
     connect(mButtons, SIGNAL(rejected()), this, SLOT(reject()));
+    connect(&mCatalogWatcher, SIGNAL(finished()), this, SLOT(catalogUpdated()));
 
     layout->addWidget(mSearchBar);
     layout->addWidget(mResultListView);
@@ -683,6 +687,7 @@ void DkSearchDialog::setFiles(const QStringList &fileList)
         QStandardItem *item = new QStandardItem(fileInfo.fileName());
         item->setData(fileInfo.absoluteFilePath());
         mSourceModel.appendRow(item);
+        mFiles << fileInfo;
     }
 }
 
@@ -698,11 +703,24 @@ void DkSearchDialog::on_searchBar_textChanged(const QString &text)
     if (text == mCurrentSearch)
         return;
 
-    mProxyModel.setFilterFixedString(text);
+    if (DkCatalogQuery::isQuery(text))
+        filterMetaData(text);
+    else {
+        mProxyModel.setFilterRole(Qt::DisplayRole);
+        mProxyModel.sort(-1);
+        mProxyModel.setFilterFixedString(text);
+    }
 
     qDebug() << "searching [" << text << "] takes: " << dt;
     mCurrentSearch = text;
 
+    updateButtons();
+
+    qDebug() << "searching takes (total): " << dt;
+}
+
+void DkSearchDialog::updateButtons()
+{
     if (mProxyModel.rowCount() == 0) {
         mFilterButton->setEnabled(false);
         mButtons->button(QDialogButtonBox::Ok)->setEnabled(false);
@@ -711,8 +729,58 @@ void DkSearchDialog::on_searchBar_textChanged(const QString &text)
         mButtons->button(QDialogButtonBox::Ok)->setEnabled(true);
         mResultListView->setCurrentIndex(mProxyModel.index(0, 0));
     }
+}
 
-    qDebug() << "searching takes (total): " << dt;
+/**
+ * Filters the files by a metadata query (e.g. rating >= 4).
+ * Each query runs in memory on the files that are indexed already.
+ * The folder's catalog is updated in the background and the results
+ * are refreshed once it is done (see catalogUpdated).
+ * @param text the metadata query
+ **/
+void DkSearchDialog::filterMetaData(const QString &text)
+{
+    DkCatalogQuery query(text);
+
+    // keep the last results while the user is typing
+    if (!query.isValid()) {
+        qDebug() << "[Search]" << query.error();
+        return;
+    }
+
+    if (!mCatalogUpdated) {
+        mCatalogWatcher.setFuture(DkMetaDataCatalog::updateAsync(mFiles));
+        mCatalogUpdated = true;
+    }
+
+    QStringList results = DkMetaDataCatalog::query(mFiles, query);
+
+    QHash<QString, int> ranks;
+    for (int idx = 0; idx < results.size(); idx++)
+        ranks.insert(results[idx], idx);
+
+    // don't let the proxy update for each item
+    mSourceModel.blockSignals(true);
+    for (int idx = 0; idx < mSourceModel.rowCount(); idx++) {
+        QStandardItem *item = mSourceModel.item(idx);
+        item->setData(ranks.value(item->data().toString(), -1), rank_role);
+    }
+    mSourceModel.blockSignals(false);
+
+    mProxyModel.setFilterRole(rank_role);
+    mProxyModel.setSortRole(rank_role);
+    mProxyModel.setFilterRegularExpression(QRegularExpression("^\\d+$"));
+    mProxyModel.invalidate();
+    mProxyModel.sort(0);
+}
+
+void DkSearchDialog::catalogUpdated()
+{
+    // new files were indexed: run the current query again
+    if (mCatalogWatcher.result() > 0 && DkCatalogQuery::isQuery(mCurrentSearch)) {
+        filterMetaData(mCurrentSearch);
+        updateButtons();
+    }
 }
 
 void DkSearchDialog::on_resultListView_doubleClicked(const QModelIndex &modelIndex)
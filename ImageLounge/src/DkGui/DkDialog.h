@@ -255,6 +255,7 @@ public slots:
     void on_searchBar_textChanged(const QString &text);
     void on_filterButton_pressed();
     void on_resultListView_doubleClicked(const QModelIndex &modelIndex);
+    void catalogUpdated();
     virtual void accept() override;
 
 signals:
@@ -262,8 +263,18 @@ signals:
     void filterSignal(const QString &) const;
 
 protected:
+    enum {
+        rank_role = Qt::UserRole + 2, // position of metadata query matches
+    };
+
     void updateHistory();
     void init();
+    void filterMetaData(const QString &text);
+    void updateButtons();
+
+    QFileInfoList mFiles;
+    bool mCatalogUpdated = false;
+    QFutureWatcher<int> mCatalogWatcher;
 
     QStandardItemModel mSourceModel;
     QSortFilterProxyModel mProxyModel;
@@ -28,10 +28,12 @@ related links:
 
 #include "DkLogWidget.h"
 
+#include "DkCacheManager.h"
 #include "DkUtils.h"
 
 #pragma warning(push, 0) // no warnings from includes
 #include <QAction>
+#include <QLabel>
 #include <QPushButton>
 #include <QTextEdit>
 #include <QVBoxLayout>
@@ -54,6 +56,9 @@ DkLogWidget::DkLogWidget(QWidget *parent)
 
     connect(msgQueuer.data(), SIGNAL(message(const QString &)), this, SLOT(log(const QString &)), Qt::QueuedConnection);
 
+    // live memory statistics of all tabs
+    connect(&DkCacheManager::instance(), SIGNAL(statsChanged(const QString &)), mCacheLabel, SLOT(setText(const QString &)));
+
     qInstallMessageHandler(widgetMessageHandler);
     QMetaObject::connectSlotsByName(this);
 }
@@ -78,10 +83,15 @@ void DkLogWidget::createLayout()
     clearButton->setObjectName("clearButton");
     clearButton->setFixedSize(QSize(32, 32));
 
+    mCacheLabel = new QLabel(DkCacheManager::instance().stats().toString(), this);
+    mCacheLabel->setObjectName("cacheLabel");
+    mCacheLabel->setWordWrap(true);
+
     QGridLayout *layout = new QGridLayout(this);
     layout->setContentsMargins(0, 0, 0, 0);
     layout->addWidget(mTextEdit, 1, 1);
     layout->addWidget(clearButton, 1, 1, Qt::AlignRight | Qt::AlignTop);
+    layout->addWidget(mCacheLabel, 2, 1);
 }
 
 /// <summary>
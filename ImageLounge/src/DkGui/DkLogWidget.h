@@ -43,6 +43,7 @@
 #endif
 #endif
 
+class QLabel;
 class QTextEdit;
 
 namespace nmc
@@ -89,6 +90,7 @@ protected:
     void createLayout();
 
     QTextEdit *mTextEdit;
+    QLabel *mCacheLabel;
 };
 
 }
\ No newline at end of file
@@ -29,6 +29,7 @@
 #include "DkActionManager.h"
 #include "DkControlWidget.h" // needed for a connection
 #include "DkSettings.h"
+#include "DkSharedImage.h"
 #include "DkTimer.h"
 #include "DkUtils.h"
 
@@ -182,15 +183,8 @@ void DkClientManager::sendTransform(QTransform transform, QTransform imgTransfor
         if (!peer)
             continue;
 
-        connect(this,
-                SIGNAL(sendNewTransformMessage(QTransform, QTransform, QPointF)),
-                peer->connection,
-                SLOT(sendNewTransformMessage(QTransform, QTransform, QPointF)));
-        emit sendNewTransformMessage(transform, imgTransform, canvasSize);
-        disconnect(this,
-                   SIGNAL(sendNewTransformMessage(QTransform, QTransform, QPointF)),
-                   peer->connection,
-                   SLOT(sendNewTransformMessage(QTransform, QTransform, QPointF)));
+        // called for every mouse move: skip the connect/disconnect round trip
+        peer->connection->sendNewTransformMessage(transform, imgTransform, canvasSize);
     }
 }
 
@@ -308,6 +302,9 @@ DkLocalClientManager::DkLocalClientManager(const QString &title, QObject *parent
     : DkClientManager(title, parent)
 {
     startServer();
+
+    // local peers share decoded images while synchronized
+    connect(this, SIGNAL(synchronizedPeersListChanged(QList<quint16>)), this, SLOT(updateSharedImages()));
 }
 
 QList<DkPeer *> DkLocalClientManager::getPeerList()
@@ -521,6 +518,11 @@ void DkLocalClientManager::connectToNomacs()
     }
 }
 
+void DkLocalClientManager::updateSharedImages()
+{
+    DkSharedImage::instance().setEnabled(!mPeerList.getSynchronizedPeers().isEmpty());
+}
+
 void DkLocalClientManager::connectionReceivedQuit()
 {
     emit receivedQuit();
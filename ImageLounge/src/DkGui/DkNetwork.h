@@ -148,7 +148,6 @@ signals:
     void sendDisableSynchronizeMessage();
     void sendNewTitleMessage(const QString &newtitle);
     void sendNewPositionMessage(QRect position, bool opacity, bool overlaid);
-    void sendNewTransformMessage(QTransform transform, QTransform imgTransform, QPointF canvasSize);
     void sendNewFileMessage(qint16 op, const QString &filename);
     void sendNewImageMessage(QImage image, const QString &title);
     void sendNewUpcomingImageMessage(const QString &imageTitle);
@@ -226,6 +225,7 @@ private slots:
     void connectionSynchronized(QList<quint16> synchronizedPeersOfOtherClient, DkConnection *connection);
     virtual void connectionStopSynchronized(DkConnection *connection);
     void connectionReceivedQuit();
+    void updateSharedImages();
 
 private:
     DkLocalConnection *createConnection();
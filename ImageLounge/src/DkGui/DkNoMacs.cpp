@@ -34,6 +34,8 @@
 #include "DkControlWidget.h"
 #include "DkDialog.h"
 #include "DkDockWidgets.h"
+#include "DkDuplicateFinder.h"
+#include "DkIconCache.h"
 #include "DkImageContainer.h"
 #include "DkImageLoader.h"
 #include "DkLogWidget.h"
@@ -316,6 +318,7 @@ void DkNoMacs::createActions()
     connect(am.action(DkActionManager::menu_view_lock_window), SIGNAL(triggered(bool)), this, SLOT(lockWindow(bool)));
 
     connect(am.action(DkActionManager::menu_tools_thumbs), SIGNAL(triggered()), this, SLOT(computeThumbsBatch()));
+    connect(am.action(DkActionManager::menu_tools_find_duplicates), SIGNAL(triggered()), this, SLOT(findDuplicates()));
     connect(am.action(DkActionManager::menu_tools_filter), SIGNAL(triggered(bool)), this, SLOT(find(bool)));
     connect(am.action(DkActionManager::menu_tools_export_tiff), SIGNAL(triggered()), this, SLOT(exportTiff()));
     connect(am.action(DkActionManager::menu_tools_extract_archive), SIGNAL(triggered()), this, SLOT(extractImagesFromArchive()));
@@ -405,6 +408,7 @@ void DkNoMacs::closeEvent(QCloseEvent *event)
             settings.setValue(mThumbsDock->objectName(), QMainWindow::dockWidgetArea(mThumbsDock));
 
         nmc::DkSettingsManager::param().save();
+        DkIconCache::instance().save();
     }
 
     DkThumbsFetchController::instance().release();
@@ -1434,6 +1438,76 @@ void DkNoMacs::computeThumbsBatch()
         mThumbSaver->processDir(getTabWidget()->getCurrentImageLoader()->getImages(), mForceDialog->forceSave());
 }
 
+void DkNoMacs::findDuplicates()
+{
+    QSharedPointer<DkImageLoader> loader = getTabWidget()->getCurrentImageLoader();
+
+    if (!loader || loader->getImages().empty())
+        return;
+
+    if (!mDuplicateFinder) {
+        mDuplicateFinder = new DkDuplicateFinder(this);
+        connect(mDuplicateFinder, SIGNAL(finishedSignal(const QVector<QStringList> &)), this, SLOT(showDuplicates(const QVector<QStringList> &)));
+    }
+
+    if (mDuplicateFinder->isRunning())
+        return;
+
+    QFileInfoList files;
+    for (auto img : loader->getImages())
+        files << img->fileInfo();
+
+    QProgressDialog *pd = new QProgressDialog(tr("\nFinding duplicates...\n") + getTabWidget()->getCurrentDir(), tr("Cancel"), 0, (int)files.size(), this);
+    pd->setWindowTitle(tr("Duplicates"));
+
+    connect(mDuplicateFinder, SIGNAL(progressSignal(int, int)), pd, SLOT(setValue(int)));
+    connect(mDuplicateFinder, SIGNAL(finishedSignal(const QVector<QStringList> &)), pd, SLOT(deleteLater()));
+    connect(pd, SIGNAL(canceled()), mDuplicateFinder, SLOT(cancel()));
+    connect(pd, SIGNAL(canceled()), pd, SLOT(deleteLater()));
+
+    pd->show();
+
+    mDuplicateFinder->find(files);
+}
+
+/**
+ * Shows the duplicates grouped in the thumbnail view.
+ * Reloading the folder shows all images again.
+ * @param clusters the clusters of duplicates
+ **/
+void DkNoMacs::showDuplicates(const QVector<QStringList> &clusters)
+{
+    QSharedPointer<DkImageLoader> loader = getTabWidget()->getCurrentImageLoader();
+
+    if (!loader)
+        return;
+
+    if (clusters.empty()) {
+        getTabWidget()->setInfo(tr("No duplicates found"));
+        return;
+    }
+
+    QHash<QString, QSharedPointer<DkImageContainerT>> images;
+    for (auto img : loader->getImages())
+        images.insert(img->filePath(), img);
+
+    QVector<QSharedPointer<DkImageContainerT>> duplicates;
+    for (const QStringList &c : clusters) {
+        for (const QString &filePath : c) {
+            if (auto img = images.value(filePath))
+                duplicates << img;
+        }
+    }
+
+    getTabWidget()->showThumbView(true);
+
+    if (auto tw = getTabWidget()->getThumbScrollWidget())
+        tw->getThumbWidget()->setGroups(clusters);
+
+    loader->setImages(duplicates);
+    getTabWidget()->setInfo(tr("%1 duplicates found in %2 groups").arg(duplicates.size()).arg(clusters.size()));
+}
+
 void DkNoMacs::aboutDialog()
 {
     DkSplashScreen *spScreen = new DkSplashScreen(this);
@@ -1533,16 +1607,12 @@ void DkNoMacs::onWindowLoaded()
     DefaultSettings settings;
     bool firstTime = settings.value("AppSettings/firstTime.nomacs.3", true).toBool();
 
-    if (DkDockWidget::testDisplaySettings(DkSettingsManager::param().app().showExplorer))
-        showExplorer(true);
-    if (DkDockWidget::testDisplaySettings(DkSettingsManager::param().app().showMetaDataDock))
-        showMetaDataDock(true);
-    if (DkDockWidget::testDisplaySettings(DkSettingsManager::param().app().showEditDock))
-        showEditDock(true);
-    if (DkDockWidget::testDisplaySettings(DkSettingsManager::param().app().showHistoryDock))
-        showHistoryDock(true);
-    if (DkDockWidget::testDisplaySettings(DkSettingsManager::param().app().showLogDock))
-        showLogDock(true);
+    // docks, update checks & plugins are not needed for the first image
+    DkStartupTimeline &timeline = DkStartupTimeline::instance();
+    if (timeline.isFinished())
+        QTimer::singleShot(0, this, SLOT(onStartupFinished()));
+    else
+        connect(&timeline, SIGNAL(finished()), this, SLOT(onStartupFinished()), Qt::QueuedConnection);
 
     if (firstTime) {
         // here are some first time requests
@@ -1556,8 +1626,6 @@ void DkNoMacs::onWindowLoaded()
         }
     }
 
-    checkForUpdate(true);
-
     // load settings AFTER everything is initialized
     getTabWidget()->loadSettings();
 
@@ -1568,8 +1636,35 @@ void DkNoMacs::onWindowLoaded()
 
     DkGlobalProgress::instance().setProgressBar(button->progress());
 #endif
+}
+
+/**
+ * Initializes everything that is not needed to show the first image.
+ * It is called once the first image is painted (see DkStartupTimeline).
+ **/
+void DkNoMacs::onStartupFinished()
+{
+    if (DkDockWidget::testDisplaySettings(DkSettingsManager::param().app().showExplorer))
+        showExplorer(true);
+    if (DkDockWidget::testDisplaySettings(DkSettingsManager::param().app().showMetaDataDock))
+        showMetaDataDock(true);
+    if (DkDockWidget::testDisplaySettings(DkSettingsManager::param().app().showEditDock))
+        showEditDock(true);
+    if (DkDockWidget::testDisplaySettings(DkSettingsManager::param().app().showHistoryDock))
+        showHistoryDock(true);
+    if (DkDockWidget::testDisplaySettings(DkSettingsManager::param().app().showLogDock))
+        showLogDock(true);
 
     toggleDocks(DkSettingsManager::param().app().hideAllPanels);
+    DkStartupTimeline::instance().mark("docks");
+
+#ifdef WITH_PLUGINS
+    // plugins are discovered now so that the menu opens instantly
+    DkPluginManager::instance().loadPlugins();
+    DkStartupTimeline::instance().mark("plugin discovery");
+#endif
+
+    checkForUpdate(true);
 }
 
 void DkNoMacs::keyPressEvent(QKeyEvent *event)
@@ -81,6 +81,7 @@ class DkInstallUpdater;
 class DkTranslationUpdater;
 class DkPluginManagerDialog;
 class DkThumbsSaver;
+class DkDuplicateFinder;
 class DkPrintPreviewDialog;
 class DkBatchContainer;
 class DkCentralWidget;
@@ -205,7 +206,10 @@ public slots:
 
     // batch actions
     void computeThumbsBatch();
+    void findDuplicates();
+    void showDuplicates(const QVector<QStringList> &clusters);
     void onWindowLoaded();
+    void onStartupFinished();
 
 protected:
     // mouse events
@@ -264,6 +268,7 @@ protected:
     DkDockWidget *mThumbsDock = 0;
     DkExportTiffDialog *mExportTiffDialog = 0;
     DkThumbsSaver *mThumbSaver = 0;
+    DkDuplicateFinder *mDuplicateFinder = 0;
 
     DkPrintPreviewDialog *mPrintPreviewDialog = 0;
 
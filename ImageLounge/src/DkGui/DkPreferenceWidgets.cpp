@@ -30,10 +30,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "DkActionManager.h"
 #include "DkBasicWidgets.h"
 #include "DkDialog.h"
+#include "DkIconCache.h"
 #include "DkImageStorage.h"
 #include "DkNoMacs.h"
 #include "DkSettings.h"
 #include "DkSettingsWidget.h"
+#include "DkTimer.h"
 #include "DkUtils.h"
 #include "DkWidgets.h"
 
@@ -506,6 +508,9 @@ void DkGeneralPreference::on_themeBox_currentIndexChanged(const QString &text) c
         DkSettingsManager::param().display().themeName = tn;
         DkThemeManager tm;
         tm.loadTheme(tn);
+
+        // icons of the old theme must not end up in the atlas
+        DkIconCache::instance().clear();
     }
 }
 
@@ -1044,9 +1049,21 @@ void DkFilePreference::createLayout()
     QLabel *cLabel =
         new QLabel(tr("We recommend to set a moderate cache value around 100 MB. [%1-%2 MB]").arg(cacheBox->minimum()).arg(cacheBox->maximum()), this);
 
+    QCheckBox *cbCompressPrefetched = new QCheckBox(tr("Compress Prefetched Files"), this);
+    cbCompressPrefetched->setObjectName("compressPrefetched");
+    cbCompressPrefetched->setToolTip(tr("If checked, uncompressed files (e.g. TIFF, BMP, RAW) are compressed in memory so that more of them are cached"));
+    cbCompressPrefetched->setChecked(DkSettingsManager::param().resources().compressPrefetched);
+
+    QCheckBox *cbProgressiveLoading = new QCheckBox(tr("Show Previews While Loading"), this);
+    cbProgressiveLoading->setObjectName("progressiveLoading");
+    cbProgressiveLoading->setToolTip(tr("If checked, a reduced preview of large images is shown until the full image is loaded"));
+    cbProgressiveLoading->setChecked(DkSettingsManager::param().resources().progressiveLoading);
+
     DkGroupWidget *cacheGroup = new DkGroupWidget(tr("Maximal Cache Size"), this);
     cacheGroup->addWidget(cacheBox);
     cacheGroup->addWidget(cLabel);
+    cacheGroup->addWidget(cbCompressPrefetched);
+    cacheGroup->addWidget(cbProgressiveLoading);
 
     // history size
     // cache size
@@ -1166,6 +1183,18 @@ void DkFilePreference::on_cacheBox_valueChanged(int value) const
     }
 }
 
+void DkFilePreference::on_compressPrefetched_toggled(bool checked) const
+{
+    if (DkSettingsManager::param().resources().compressPrefetched != checked)
+        DkSettingsManager::param().resources().compressPrefetched = checked;
+}
+
+void DkFilePreference::on_progressiveLoading_toggled(bool checked) const
+{
+    if (DkSettingsManager::param().resources().progressiveLoading != checked)
+        DkSettingsManager::param().resources().progressiveLoading = checked;
+}
+
 void DkFilePreference::on_historyBox_valueChanged(int value) const
 {
     if (DkSettingsManager::param().resources().historyMemory != value) {
@@ -1446,9 +1475,15 @@ void DkAdvancedPreference::createLayout()
     pbLog->setVisible(false);
 #endif
 
+    QCheckBox *cbUseTrace = new QCheckBox(tr("Save Performance Trace"), this);
+    cbUseTrace->setObjectName("useTrace");
+    cbUseTrace->setToolTip(tr("If checked, loading and rendering times are saved to %1 when nomacs is closed.").arg(DkUtils::getTraceFilePath()));
+    cbUseTrace->setChecked(DkSettingsManager::param().app().useTraceFile);
+
     DkGroupWidget *useLogGroup = new DkGroupWidget(tr("Logging"), this);
     useLogGroup->addWidget(cbUseLog);
     useLogGroup->addWidget(pbLog);
+    useLogGroup->addWidget(cbUseTrace);
 
     QVBoxLayout *layout = new QVBoxLayout(this);
     layout->setAlignment(Qt::AlignTop);
@@ -1497,6 +1532,14 @@ void DkAdvancedPreference::on_useLog_toggled(bool checked) const
     }
 }
 
+void DkAdvancedPreference::on_useTrace_toggled(bool checked) const
+{
+    if (DkSettingsManager::param().app().useTraceFile != checked) {
+        DkSettingsManager::param().app().useTraceFile = checked;
+        DkTracer::instance().setEnabled(checked);
+    }
+}
+
 void DkAdvancedPreference::on_useNative_toggled(bool checked) const
 {
     if (DkSettingsManager::param().resources().nativeDialog != checked) {
@@ -230,6 +230,8 @@ public slots:
     void on_loadGroup_buttonClicked(int buttonId) const;
     void on_skipBox_valueChanged(int value) const;
     void on_cacheBox_valueChanged(int value) const;
+    void on_compressPrefetched_toggled(bool checked) const;
+    void on_progressiveLoading_toggled(bool checked) const;
     void on_historyBox_valueChanged(int value) const;
     void on_saveGroup_buttonClicked(int buttonId) const;
 
@@ -282,6 +284,7 @@ public slots:
     void on_ignoreExif_toggled(bool checked) const;
     //void on_saveExif_toggled(bool checked) const;
     void on_useLog_toggled(bool checked) const;
+    void on_useTrace_toggled(bool checked) const;
     void on_useNative_toggled(bool checked) const;
     void on_logFolder_clicked() const;
     void on_numThreads_valueChanged(int val) const;
@@ -67,6 +67,83 @@
 namespace nmc
 {
 
+// DkThumbLayoutIndex --------------------------------------------------------------------
+void DkThumbLayoutIndex::reset(int size, int extent)
+{
+    mExtents.fill(extent, size);
+    mTree.fill(0, size + 1);
+
+    // linear time construction
+    for (int idx = 1; idx <= size; idx++) {
+        mTree[idx] += extent;
+
+        int parent = idx + (idx & -idx);
+        if (parent <= size)
+            mTree[parent] += mTree[idx];
+    }
+}
+
+int DkThumbLayoutIndex::size() const
+{
+    return mExtents.size();
+}
+
+int DkThumbLayoutIndex::extent(int idx) const
+{
+    return mExtents[idx];
+}
+
+void DkThumbLayoutIndex::setExtent(int idx, int extent)
+{
+    qint64 delta = extent - mExtents[idx];
+    mExtents[idx] = extent;
+
+    for (int tIdx = idx + 1; tIdx < mTree.size(); tIdx += tIdx & -tIdx)
+        mTree[tIdx] += delta;
+}
+
+/**
+ * Returns the sum of all extents before idx.
+ **/
+qint64 DkThumbLayoutIndex::start(int idx) const
+{
+    qint64 sum = 0;
+
+    for (int tIdx = idx; tIdx > 0; tIdx -= tIdx & -tIdx)
+        sum += mTree[tIdx];
+
+    return sum;
+}
+
+qint64 DkThumbLayoutIndex::total() const
+{
+    return start(size());
+}
+
+/**
+ * Returns the index of the thumbnail that covers pos.
+ * @return int the index or size() if pos is beyond the last thumbnail
+ **/
+int DkThumbLayoutIndex::indexAt(qint64 pos) const
+{
+    if (pos < 0)
+        return 0;
+
+    int idx = 0;
+    int step = 1;
+    while (step * 2 <= size())
+        step *= 2;
+
+    for (; step > 0; step /= 2) {
+        if (idx + step <= size() && mTree[idx + step] <= pos) {
+            idx += step;
+            pos -= mTree[idx];
+        }
+    }
+
+    return idx;
+}
+
 // DkFilePreview --------------------------------------------------------------------
 DkFilePreview::DkFilePreview(QWidget *parent, Qt::WindowFlags flags)
     : DkFadeWidget(parent, flags)
@@ -272,88 +349,76 @@ void DkFilePreview::drawThumbs(QPainter *painter)
 {
     // qDebug() << "drawing thumbs: " << worldMatrix.dx();
 
-    bufferDim = (orientation == Qt::Horizontal) ? QRectF(QPointF(0, yOffset / 2), QSize(xOffset, 0)) : QRectF(QPointF(yOffset / 2, 0), QSize(0, xOffset));
-    thumbRects.clear();
+    updateLayout();
 
-    DkTimer dt;
+    bool horizontal = orientation == Qt::Horizontal;
+    bufferDim = horizontal ? QRectF(QPointF(0, yOffset / 2), QSizeF(xOffset + mLayout.total(), 0))
+                           : QRectF(QPointF(yOffset / 2, 0), QSizeF(0, xOffset + mLayout.total()));
+    thumbRects.clear();
 
     // mouse over effect
     QPoint p = worldMatrix.inverted().map(mapFromGlobal(QCursor::pos()));
 
-    for (int idx = 0; idx < mThumbs.size(); idx++) {
+    // thumbnails that were requested before we scrolled are dropped if they are not requested again
+    if (mFetchMatrix != worldMatrix) {
+        mFetchToken.newGeneration();
+        mFetchMatrix = worldMatrix;
+    }
+
+    // update file rect for move to current file timer
+    if (scrollToCurrentImage && currentFileIdx >= 0 && currentFileIdx < mThumbs.size()) {
+        QImage img;
+        newFileRect = worldMatrix.mapRect(thumbRect(currentFileIdx, xOffset + mLayout.start(currentFileIdx), img));
+    }
+
+    // binary search the first visible thumbnail - only the visible ones are touched
+    qint64 viewStart = -qRound64(horizontal ? worldMatrix.dx() : worldMatrix.dy());
+    mThumbRectsOffset = mLayout.indexAt(viewStart - xOffset);
+
+    for (int idx = mThumbRectsOffset; idx < mThumbs.size(); idx++) {
         QSharedPointer<DkThumbNailT> thumb = mThumbs.at(idx)->getThumb();
         QImage img;
+        QRectF r = thumbRect(idx, xOffset + mLayout.start(idx), img);
 
-        // if the image is loaded draw that (it might be edited)
-        if (mThumbs.at(idx)->hasImage()) {
-            img = mThumbs.at(idx)->imageScaledToHeight(DkSettingsManager::param().effectiveThumbSize(this));
-        } else {
-            if (thumb->hasImage() == DkThumbNail::exists_not) {
-                thumbRects.push_back(QRectF());
-                continue;
-            }
+        // the thumbnail (or the image) was loaded since we measured it - this shifts all subsequent thumbs
+        int extent = thumbExtent(r);
+        if (extent != mLayout.extent(idx)) {
+            mLayout.setExtent(idx, extent);
 
-            if (thumb->hasImage() == DkThumbNail::loaded)
-                img = thumb->getImage();
+            if (horizontal)
+                bufferDim.setRight(xOffset + mLayout.total());
+            else
+                bufferDim.setBottom(xOffset + mLayout.total());
         }
 
-        // if (img.width() > max_thumb_size * DkSettingsManager::param().dpiScaleFactor())
-        //	qDebug() << thumb->getFilePath() << "size:" << img.size();
-
-        QPointF anchor = orientation == Qt::Horizontal ? bufferDim.topRight() : bufferDim.bottomLeft();
-        QRectF r = !img.isNull()
-            ? QRectF(anchor, img.size())
-            : QRectF(anchor, QSize(DkSettingsManager::param().effectiveThumbSize(this), DkSettingsManager::param().effectiveThumbSize(this)));
-        if (orientation == Qt::Horizontal && height() - yOffset < r.height() * 2)
-            r.setSize(QSizeF(qFloor(r.width() * (float)(height() - yOffset) / r.height()), height() - yOffset));
-        else if (orientation == Qt::Vertical && width() - yOffset < r.width() * 2)
-            r.setSize(QSizeF(width() - yOffset, qFloor(r.height() * (float)(width() - yOffset) / r.width())));
+        thumbRects.push_back(r);
 
         // check if the size is still valid
-        if (r.width() < 1 || r.height() < 1)
+        if (r.isEmpty())
             continue; // this brings us in serious problems with the selection
 
-        // center vertically
-        if (orientation == Qt::Horizontal)
-            r.moveCenter(QPoint(qFloor(r.center().x()), height() / 2));
-        else
-            r.moveCenter(QPoint(width() / 2, qFloor(r.center().y())));
-
-        // update the buffer dim
-        if (orientation == Qt::Horizontal)
-            bufferDim.setRight(qFloor(bufferDim.right() + r.width()) + qCeil(xOffset / 2.0f));
-        else
-            bufferDim.setBottom(qFloor(bufferDim.bottom() + r.height()) + qCeil(xOffset / 2.0f));
-        thumbRects.push_back(r);
-
         QRectF imgWorldRect = worldMatrix.mapRect(r);
 
-        // update file rect for move to current file timer
-        if (scrollToCurrentImage && idx == currentFileIdx)
-            newFileRect = imgWorldRect;
-
         // is the current image within the canvas?
-        if ((orientation == Qt::Horizontal && imgWorldRect.right() < 0) || (orientation == Qt::Vertical && imgWorldRect.bottom() < 0)) {
+        if ((horizontal && imgWorldRect.right() < 0) || (!horizontal && imgWorldRect.bottom() < 0)) {
             continue;
         }
 
-        if (((orientation == Qt::Horizontal && imgWorldRect.left() > width()) || (orientation == Qt::Vertical && imgWorldRect.top() > height()))
-            && scrollToCurrentImage) {
-            continue;
-        } else if ((orientation == Qt::Horizontal && imgWorldRect.left() > width()) || (orientation == Qt::Vertical && imgWorldRect.top() > height())) {
+        if ((horizontal && imgWorldRect.left() > width()) || (!horizontal && imgWorldRect.top() > height())) {
+            // prefetch the next thumbnails
+            for (int nIdx = idx; nIdx < qMin(idx + 10, mThumbs.size()) && fabs(currentDx) < 40; nIdx++)
+                fetchThumb(mThumbs.at(nIdx)->getThumb(), DkThumbNailT::fetch_neighbour);
             break;
         }
 
         // only fetch thumbs if we are not moving too fast...
-        if (thumb->hasImage() == DkThumbNail::not_loaded && fabs(currentDx) < 40) {
-            thumb->fetchThumb();
-            connect(thumb.data(), SIGNAL(thumbLoadedSignal()), this, SLOT(update()));
-        }
+        if (fabs(currentDx) < 40)
+            fetchThumb(thumb, DkThumbNailT::fetch_visible);
 
-        bool isLeftGradient = (orientation == Qt::Horizontal && worldMatrix.dx() < 0 && imgWorldRect.left() < leftGradient.finalStop().x())
-            || (orientation == Qt::Vertical && worldMatrix.dy() < 0 && imgWorldRect.top() < leftGradient.finalStop().y());
-        bool isRightGradient = (orientation == Qt::Horizontal && imgWorldRect.right() > rightGradient.start().x())
-            || (orientation == Qt::Vertical && imgWorldRect.bottom() > rightGradient.start().y());
+        bool isLeftGradient = (horizontal && worldMatrix.dx() < 0 && imgWorldRect.left() < leftGradient.finalStop().x())
+            || (!horizontal && worldMatrix.dy() < 0 && imgWorldRect.top() < leftGradient.finalStop().y());
+        bool isRightGradient = (horizontal && imgWorldRect.right() > rightGradient.start().x())
+            || (!horizontal && imgWorldRect.bottom() > rightGradient.start().y());
         // show that there are more images...
         if (isLeftGradient && !img.isNull())
             drawFadeOut(leftGradient, imgWorldRect, &img);
@@ -374,6 +439,95 @@ void DkFilePreview::drawThumbs(QPainter *painter)
     }
 }
 
+/**
+ * Resets the layout index if the thumbnails or the geometry changed.
+ * Thumbnails that were not painted yet are assumed to be squares.
+ **/
+void DkFilePreview::updateLayout()
+{
+    int ts = DkSettingsManager::param().effectiveThumbSize(this);
+    QVector<int> key = {ts, orientation == Qt::Horizontal ? height() : width(), orientation, xOffset, yOffset};
+
+    if (key == mLayoutKey && mLayout.size() == mThumbs.size())
+        return;
+
+    mLayoutKey = key;
+    mLayout.reset(mThumbs.size(), thumbExtent(fitThumbRect(QSize(ts, ts), xOffset)));
+}
+
+/**
+ * Computes the rect of a thumbnail.
+ * @param idx the thumbnail's index
+ * @param pos the thumbnail's start along the filmstrip
+ * @param img returns the image to draw (null if there is none yet)
+ * @return QRectF the rect - empty if the thumbnail is not shown
+ **/
+QRectF DkFilePreview::thumbRect(int idx, qint64 pos, QImage &img) const
+{
+    QSharedPointer<DkImageContainerT> imgC = mThumbs.at(idx);
+    QSharedPointer<DkThumbNailT> thumb = imgC->getThumb();
+    int ts = DkSettingsManager::param().effectiveThumbSize(this);
+
+    // if the image is loaded draw that (it might be edited)
+    if (imgC->hasImage()) {
+        img = imgC->imageScaledToHeight(ts);
+    } else {
+        if (thumb->hasImage() == DkThumbNail::exists_not)
+            return QRectF();
+
+        if (thumb->hasImage() == DkThumbNail::loaded)
+            img = thumb->getImage();
+    }
+
+    // if (img.width() > max_thumb_size * DkSettingsManager::param().dpiScaleFactor())
+    //	qDebug() << thumb->getFilePath() << "size:" << img.size();
+
+    return fitThumbRect(!img.isNull() ? img.size() : QSize(ts, ts), pos);
+}
+
+QRectF DkFilePreview::fitThumbRect(const QSize &size, qint64 pos) const
+{
+    QPointF anchor = orientation == Qt::Horizontal ? QPointF(pos, yOffset / 2) : QPointF(yOffset / 2, pos);
+    QRectF r = QRectF(anchor, size);
+
+    if (orientation == Qt::Horizontal && height() - yOffset < r.height() * 2)
+        r.setSize(QSizeF(qFloor(r.width() * (float)(height() - yOffset) / r.height()), height() - yOffset));
+    else if (orientation == Qt::Vertical && width() - yOffset < r.width() * 2)
+        r.setSize(QSizeF(width() - yOffset, qFloor(r.height() * (float)(width() - yOffset) / r.width())));
+
+    // check if the size is still valid
+    if (r.width() < 1 || r.height() < 1)
+        return QRectF();
+
+    // center vertically
+    if (orientation == Qt::Horizontal)
+        r.moveCenter(QPoint(qFloor(r.center().x()), height() / 2));
+    else
+        r.moveCenter(QPoint(width() / 2, qFloor(r.center().y())));
+
+    return r;
+}
+
+int DkFilePreview::thumbExtent(const QRectF &r) const
+{
+    if (r.isEmpty())
+        return 0;
+
+    qreal e = orientation == Qt::Horizontal ? r.width() : r.height();
+    return qFloor(e) + qCeil(xOffset / 2.0f);
+}
+
+void DkFilePreview::fetchThumb(QSharedPointer<DkThumbNailT> thumb, int priority)
+{
+    // loading thumbs are requested again so that they are kept in the current generation
+    if (thumb->hasImage() == DkThumbNail::not_loaded || thumb->hasImage() == DkThumbNail::loading) {
+        thumb->fetchThumb(DkThumbNail::do_not_force, QSharedPointer<QByteArray>(), priority, mFetchToken);
+        connect(thumb.data(), SIGNAL(thumbLoadedSignal()), this, SLOT(update()), Qt::UniqueConnection);
+        // dropped requests are fetched again when repainting
+        connect(thumb.data(), SIGNAL(thumbCancelledSignal()), this, SLOT(update()), Qt::UniqueConnection);
+    }
+}
+
 void DkFilePreview::drawNoImgEffect(QPainter *painter, const QRectF &r)
 {
     QBrush oldBrush = painter->brush();
@@ -555,7 +709,7 @@ void DkFilePreview::mouseMoveEvent(QMouseEvent *event)
         // find out where the mouse is
         for (int idx = 0; idx < thumbRects.size(); idx++) {
             if (worldMatrix.mapRect(thumbRects.at(idx)).contains(event->pos())) {
-                selected = idx;
+                selected = mThumbRectsOffset + idx;
 
                 if (selected <= mThumbs.size() && selected >= 0) {
                     QSharedPointer<DkThumbNailT> thumb = mThumbs.at(selected)->getThumb();
@@ -613,8 +767,10 @@ void DkFilePreview::mouseReleaseEvent(QMouseEvent *event)
 
     if (mouseTrace < 20) {
         // find out where the mouse did click
-        for (int idx = 0; idx < thumbRects.size(); idx++) {
-            if (idx < mThumbs.size() && worldMatrix.mapRect(thumbRects.at(idx)).contains(event->pos())) {
+        for (int rIdx = 0; rIdx < thumbRects.size(); rIdx++) {
+            int idx = mThumbRectsOffset + rIdx;
+
+            if (idx < mThumbs.size() && worldMatrix.mapRect(thumbRects.at(rIdx)).contains(event->pos())) {
                 if (mThumbs.at(idx)->isFromZip())
                     emit changeFileSignal(idx - currentFileIdx);
                 else
@@ -811,6 +967,8 @@ void DkFilePreview::setFileInfo(QSharedPointer<DkImageContainerT> cImage)
 void DkFilePreview::updateThumbs(QVector<QSharedPointer<DkImageContainerT>> thumbs)
 {
     mThumbs = thumbs;
+    mFetchToken.newGeneration();
+    mLayoutKey.clear(); // re-layout
 
     for (int idx = 0; idx < thumbs.size(); idx++) {
         if (thumbs.at(idx)->isSelected()) {
@@ -856,7 +1014,7 @@ DkThumbLabel::DkThumbLabel(const QString &dirPath, const QVector<QSharedPointer<
     for (QSharedPointer<DkThumbNailT> fileThumb : fileThumbs) {
         connect(fileThumb.data(), SIGNAL(thumbLoadedSignal()),
                 this, SLOT(updateFolderLabel()));
-        fileThumb->fetchThumb();
+        fileThumb->fetchThumb(DkThumbNail::do_not_force, QSharedPointer<QByteArray>(), DkThumbNailT::fetch_background);
     }
 
     updateLabel();
@@ -872,6 +1030,7 @@ void DkThumbLabel::setThumb(QSharedPointer<DkThumbNailT> thumb)
         this->mThumb = thumb;
 
         connect(thumb.data(), SIGNAL(thumbLoadedSignal()), this, SLOT(updateLabel()));
+        connect(thumb.data(), SIGNAL(thumbCancelledSignal()), this, SLOT(cancelLoading()));
         QFileInfo fileInfo(thumb->getFilePath());
         QString toolTipInfo = tr("Name: ") + fileInfo.fileName() + "\n" + tr("Size: ") + DkUtils::readableByte((float)fileInfo.size()) + "\n" + tr("Created: ")
             + fileInfo.birthTime().toString();
@@ -907,6 +1066,9 @@ QPixmap DkThumbLabel::pixmap() const
 void DkThumbLabel::cancelLoading()
 {
     mFetchingThumb = false;
+
+    // request it again if we are still visible
+    update();
 }
 
 QRectF DkThumbLabel::boundingRect() const
@@ -1090,7 +1252,11 @@ void DkThumbLabel::paint(QPainter *painter, const QStyleOptionGraphicsItem *opti
 {
     if (!mThumb.isNull()) {
         if (!mFetchingThumb && mThumb->hasImage() == DkThumbNail::not_loaded) {
-            mThumb->fetchThumb();
+            DkThumbScene *s = qobject_cast<DkThumbScene *>(scene());
+            mThumb->fetchThumb(DkThumbNail::do_not_force,
+                               QSharedPointer<QByteArray>(),
+                               DkThumbNailT::fetch_visible,
+                               s ? s->fetchToken() : DkThumbsFetchToken());
             mFetchingThumb = true;
         } else if (!mThumbInitialized && (mThumb->hasImage() == DkThumbNail::loaded || mThumb->hasImage() == DkThumbNail::exists_not)) {
             updateLabel();
@@ -1206,36 +1372,43 @@ void DkThumbScene::updateLayout()
     mXOffset = 2; // qCeil(psz*0.1f);
     mNumCols = qMax(qFloor(((float)pSize.width() - mXOffset) / (psz + mXOffset)), 1);
     mNumCols = qMin(mThumbLabels.size(), mNumCols);
-    mNumRows = qCeil((float)mThumbLabels.size() / mNumCols);
 
-    // reset the scroll bar position before changing the scene rect
-    // (it could be unintentionally adjusted by Qt)
-    views().at(0)->verticalScrollBar()->setValue(0);
+    // assign the grid cells - groups (e.g. duplicates) start in a new row
+    QVector<QPoint> cells(mThumbLabels.size());
+    int cIdx = 0;
+    int rIdx = 0;
+    int lastGroup = -1;
 
-    int tso = psz + mXOffset;
-    setSceneRect(0, 0, mNumCols * tso + mXOffset, mNumRows * tso + mXOffset);
+    for (int tIdx = 0; tIdx < mThumbLabels.size(); tIdx++) {
+        DkThumbLabel *cLabel = mThumbLabels.at(tIdx);
+        int group = -1;
 
-    DkTimer dt;
-    int cYOffset = mXOffset;
+        if (!mGroups.empty() && !cLabel->isFolder() && cLabel->getThumb())
+            group = mGroups.value(cLabel->getThumb()->getFilePath(), -1);
 
-    for (int rIdx = 0; rIdx < mNumRows; rIdx++) {
-        int cXOffset = mXOffset;
+        if (cIdx > 0 && (cIdx >= mNumCols || group != lastGroup)) {
+            cIdx = 0;
+            rIdx++;
+        }
 
-        for (int cIdx = 0; cIdx < mNumCols; cIdx++) {
-            int tIdx = rIdx * mNumCols + cIdx;
+        cells[tIdx] = QPoint(cIdx, rIdx);
+        lastGroup = group;
+        cIdx++;
+    }
 
-            if (tIdx < 0 || tIdx >= mThumbLabels.size())
-                break;
+    mNumRows = rIdx + 1;
 
-            DkThumbLabel *cLabel = mThumbLabels.at(tIdx);
-            cLabel->setPos(cXOffset, cYOffset);
-            cLabel->updateSize();
+    // reset the scroll bar position before changing the scene rect
+    // (it could be unintentionally adjusted by Qt)
+    views().at(0)->verticalScrollBar()->setValue(0);
 
-            cXOffset += psz + mXOffset;
-        }
+    int tso = psz + mXOffset;
+    setSceneRect(0, 0, mNumCols * tso + mXOffset, mNumRows * tso + mXOffset);
 
-        // update ypos
-        cYOffset += psz + mXOffset; // 20 for label
+    for (int tIdx = 0; tIdx < mThumbLabels.size(); tIdx++) {
+        DkThumbLabel *cLabel = mThumbLabels.at(tIdx);
+        cLabel->setPos(mXOffset + cells[tIdx].x() * tso, mXOffset + cells[tIdx].y() * tso);
+        cLabel->updateSize();
     }
 
     for (int idx = 0; idx < mThumbLabels.size(); idx++) {
@@ -1255,9 +1428,32 @@ void DkThumbScene::setSubFolderContainers(
 void DkThumbScene::updateThumbs(QVector<QSharedPointer<DkImageContainerT>> thumbs)
 {
     this->mThumbs = thumbs;
+
+    // the groups are outdated if an image is not part of them (e.g. the folder was reloaded)
+    for (auto t : thumbs) {
+        if (!mGroups.contains(t->filePath())) {
+            mGroups.clear();
+            break;
+        }
+    }
+
     updateThumbLabels();
 }
 
+/**
+ * Groups the thumbnails - each group starts in a new row.
+ * @param groups the file paths of each group
+ **/
+void DkThumbScene::setGroups(const QVector<QStringList> &groups)
+{
+    mGroups.clear();
+
+    for (int idx = 0; idx < groups.size(); idx++) {
+        for (const QString &filePath : groups[idx])
+            mGroups.insert(filePath, idx);
+    }
+}
+
 void DkThumbScene::updateThumbLabels()
 {
     blockSignals(true); // do not emit selection changed while clearing!
@@ -1265,6 +1461,7 @@ void DkThumbScene::updateThumbLabels()
     blockSignals(false);
 
     mThumbLabels.clear();
+    newFetchGeneration();
 
     // add subfolder thumbnails
     if (DkSettingsManager::param().display().showSubFolderThumbs && mLoader) {
@@ -1484,11 +1681,22 @@ void DkThumbScene::resizeThumbs(float dx)
 void DkThumbScene::cancelLoading()
 {
     DkThumbsThreadPool::clear();
+    newFetchGeneration();
 
     for (auto t : mThumbLabels)
         t->cancelLoading();
 }
 
+void DkThumbScene::newFetchGeneration()
+{
+    mFetchToken.newGeneration();
+}
+
+DkThumbsFetchToken DkThumbScene::fetchToken() const
+{
+    return mFetchToken;
+}
+
 void DkThumbScene::selectAllThumbs(bool selected)
 {
     selectThumbs(selected);
@@ -1778,6 +1986,7 @@ DkThumbsView::DkThumbsView(DkThumbScene *scene, QWidget *parent /* = 0 */)
     setObjectName("DkThumbsView");
     this->scene = scene;
     connect(scene, SIGNAL(thumbLoadedSignal()), this, SLOT(fetchThumbs()));
+    connect(verticalScrollBar(), SIGNAL(valueChanged(int)), scene, SLOT(newFetchGeneration()));
 
     setResizeAnchor(QGraphicsView::AnchorUnderMouse);
     setAcceptDrops(true);
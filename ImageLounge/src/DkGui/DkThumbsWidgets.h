@@ -35,6 +35,7 @@
 #include <QGraphicsObject>
 #include <QGraphicsScene>
 #include <QGraphicsView>
+#include <QHash>
 #include <QPen>
 #include <QProcess>
 #include <QSharedPointer>
@@ -65,6 +66,29 @@ namespace nmc
 class DkImageLoader;
 class DkSubFolderContainer;
 
+/**
+ * Prefix sums of the thumbnail extents (Fenwick tree).
+ * Updating an extent and finding the thumbnail at a position are O(log n)
+ * so that the filmstrip only touches the visible thumbnails.
+ **/
+class DkThumbLayoutIndex
+{
+public:
+    void reset(int size, int extent);
+
+    int size() const;
+    int extent(int idx) const;
+    void setExtent(int idx, int extent);
+
+    qint64 start(int idx) const;
+    qint64 total() const;
+    int indexAt(qint64 pos) const;
+
+private:
+    QVector<int> mExtents;
+    QVector<qint64> mTree;
+};
+
 class DkFilePreview : public DkFadeWidget
 {
     Q_OBJECT
@@ -147,7 +171,11 @@ private:
     QTimer *moveImageTimer;
 
     QRectF bufferDim;
-    QVector<QRectF> thumbRects;
+    QVector<QRectF> thumbRects; // rects of the painted thumbs - starting at mThumbRectsOffset
+    int mThumbRectsOffset = 0;
+
+    DkThumbLayoutIndex mLayout;
+    QVector<int> mLayoutKey;
 
     QLinearGradient leftGradient;
     QLinearGradient rightGradient;
@@ -178,9 +206,17 @@ private:
     QMenu *contextMenu;
     QVector<QAction *> contextMenuActions;
 
+    DkThumbsFetchToken mFetchToken = DkThumbsFetchToken::create();
+    QTransform mFetchMatrix;
+
     void init();
     void initOrientations();
     void drawThumbs(QPainter *painter);
+    void updateLayout();
+    QRectF thumbRect(int idx, qint64 pos, QImage &img) const;
+    QRectF fitThumbRect(const QSize &size, qint64 pos) const;
+    int thumbExtent(const QRectF &r) const;
+    void fetchThumb(QSharedPointer<DkThumbNailT> thumb, int priority);
     void drawFadeOut(QLinearGradient gradient, QRectF imgRect, QImage *img);
     void drawSelectedEffect(QPainter *painter, const QRectF &r);
     void drawCurrentImgEffect(QPainter *painter, const QRectF &r);
@@ -211,9 +247,9 @@ public:
     void updateSize();
     void setVisible(bool visible);
     QPixmap pixmap() const;
-    void cancelLoading();
 
 public slots:
+    void cancelLoading();
     void updateLabel();
     void updateFolderLabel();
 
@@ -266,10 +302,13 @@ public:
     void ensureVisible(QSharedPointer<DkImageContainerT> img) const;
     void ensureVisible(QSharedPointer<DkSubFolderContainer> subFolderContainer) const;
     QString currentDir() const;
+    DkThumbsFetchToken fetchToken() const;
+    void setGroups(const QVector<QStringList> &groups);
 
 public slots:
     void updateThumbLabels();
     void cancelLoading();
+    void newFetchGeneration();
     void increaseThumbs();
     void decreaseThumbs();
     void toggleSubFolderThumbs(bool show);
@@ -306,6 +345,8 @@ protected:
     QSharedPointer<DkImageLoader> mLoader;
     QVector<QSharedPointer<DkImageContainerT>> mThumbs;
     QVector<QSharedPointer<DkSubFolderContainer>> mSubFolderContainers;
+    DkThumbsFetchToken mFetchToken = DkThumbsFetchToken::create();
+    QHash<QString, int> mGroups; // file path -> group, each group starts a new row
 };
 
 class DkThumbsView : public QGraphicsView
@@ -32,6 +32,7 @@
 #include "DkControlWidget.h"
 #include "DkDialog.h"
 #include "DkImageLoader.h"
+#include "DkJpegTransform.h"
 #include "DkMessageBox.h"
 #include "DkMetaData.h"
 #include "DkMetaDataWidgets.h"
@@ -251,6 +252,10 @@ void DkViewPort::updateImage(QSharedPointer<DkImageContainerT> image, bool loade
 {
     // things todo if a file was not loaded...
     if (!loaded) {
+        // do not keep the preview of a broken file
+        if (mImgStorage.isPreview())
+            setImage(QImage());
+
         mController->getPlayer()->startTimer();
         return;
     }
@@ -261,6 +266,10 @@ void DkViewPort::updateImage(QSharedPointer<DkImageContainerT> image, bool loade
 
     if (mLoader->hasImage()) {
         setImage(mLoader->getPixmap()); // modified image (for view), may differ from lastImage after rotate
+
+        // slides are downsampled to the display size ahead of time
+        if (image)
+            mImgStorage.setScaledImage(image->prescaledImage());
     }
 
     emit imageUpdatedSignal();
@@ -317,6 +326,9 @@ void DkViewPort::setImage(QImage newImg)
 
     mController->getOverview()->setImage(QImage()); // clear overview
 
+    // the full image replaces its preview in place (zoom & position are kept)
+    bool refine = mImgStorage.isPreview() && mImgStorage.size() == newImg.size();
+
     mImgStorage.setImage(newImg);
 
     if (mLoader->hasMovie() && !mLoader->isEdited())
@@ -329,35 +341,17 @@ void DkViewPort::setImage(QImage newImg)
     DkActionManager::instance().enableImageActions(!newImg.isNull());
     mController->imageLoaded(!newImg.isNull());
 
-    double oldZoom = mWorldMatrix.m11(); // *mImgMatrix.m11();
-
-    if (!(DkSettingsManager::param().display().keepZoom == DkSettings::zoom_keep_same_size && mOldImgRect == mImgRect))
-        mWorldMatrix.reset();
-
-    updateImageMatrix();
-
-    // if image is not inside, we'll align it at the top left border
-    if (!mViewportRect.intersects(mWorldMatrix.mapRect(mImgViewRect))) {
-        mWorldMatrix.translate(-mWorldMatrix.dx(), -mWorldMatrix.dy());
-        centerImage();
-    }
-
-    if (DkSettingsManager::param().display().keepZoom == DkSettings::zoom_always_keep) {
-        zoomToPoint(oldZoom, mImgViewRect.center().toPoint(), mWorldMatrix);
-    }
+    if (!refine)
+        initImageMatrix();
 
     mController->getPlayer()->startTimer();
     mController->getOverview()->setImage(newImg); // TODO: maybe we could make use of the image pyramid here
 
     mOldImgRect = mImgRect;
 
-    // init fading
-    if (DkSettingsManager::param().display().animationDuration && DkSettingsManager::param().display().transition != DkSettingsManager::param().trans_appear
-        && (mController->getPlayer()->isPlaying() || DkUtils::getMainWindow()->isFullScreen() || DkSettingsManager::param().display().alwaysAnimate)) {
-        mAnimationTimer->start();
-        mAnimationTime.start();
-    } else
-        mAnimationValue = 0.0f;
+    // the preview faded in already
+    if (!refine)
+        startFading();
 
     // set/clear crop rect
     if (mLoader->getCurrentImage())
@@ -392,6 +386,72 @@ void DkViewPort::setImage(QImage newImg)
     }
 }
 
+/**
+ * Shows a preview of the image that is currently loading (progressive display).
+ * The preview is painted with the geometry of the full image so that
+ * zoom and position are kept when setImage() swaps in the full image.
+ * @param imgC the image that is loading
+ * @param img the preview
+ * @param fullSize the size of the full image (previews are ignored if it is unknown)
+ **/
+void DkViewPort::setPreview(QSharedPointer<DkImageContainerT> imgC, const QImage &img, const QSize &fullSize)
+{
+    // previews are painted with the geometry of the full image - otherwise we would zoom & fade twice
+    if (!mLoader || mLoader->getCurrentImage() != imgC || img.isNull() || fullSize.isEmpty())
+        return;
+
+    bool refine = mImgStorage.isPreview() && mImgStorage.size() == fullSize;
+
+    // keep the better preview (e.g. a reduced decode rather than the thumbnail)
+    if (refine && img.width() < mImgStorage.imageConst().width())
+        return;
+
+    show();
+    stopMovie();
+
+    mImgStorage.setPreview(img, fullSize);
+    mController->getOverview()->setImage(img);
+
+    if (!refine) {
+        mImgRect = QRectF(QPoint(), fullSize);
+        initImageMatrix();
+        mOldImgRect = mImgRect;
+        startFading();
+    }
+
+    update();
+}
+
+void DkViewPort::initImageMatrix()
+{
+    double oldZoom = mWorldMatrix.m11(); // *mImgMatrix.m11();
+
+    if (!(DkSettingsManager::param().display().keepZoom == DkSettings::zoom_keep_same_size && mOldImgRect == mImgRect))
+        mWorldMatrix.reset();
+
+    updateImageMatrix();
+
+    // if image is not inside, we'll align it at the top left border
+    if (!mViewportRect.intersects(mWorldMatrix.mapRect(mImgViewRect))) {
+        mWorldMatrix.translate(-mWorldMatrix.dx(), -mWorldMatrix.dy());
+        centerImage();
+    }
+
+    if (DkSettingsManager::param().display().keepZoom == DkSettings::zoom_always_keep) {
+        zoomToPoint(oldZoom, mImgViewRect.center().toPoint(), mWorldMatrix);
+    }
+}
+
+void DkViewPort::startFading()
+{
+    if (DkSettingsManager::param().display().animationDuration && DkSettingsManager::param().display().transition != DkSettingsManager::param().trans_appear
+        && (mController->getPlayer()->isPlaying() || DkUtils::getMainWindow()->isFullScreen() || DkSettingsManager::param().display().alwaysAnimate)) {
+        mAnimationTimer->start();
+        mAnimationTime.start();
+    } else
+        mAnimationValue = 0.0f;
+}
+
 void DkViewPort::zoom(double factor, const QPointF &center, bool force)
 {
     if (mImgStorage.isEmpty() || mBlockZooming)
@@ -951,6 +1011,11 @@ void DkViewPort::manipulatorApplied()
             if (imageContainer()) {
                 auto l = imageContainer()->getLoader();
                 l->invalidateReferenceImage();
+
+                // rotations & flips are saved without re-encoding jpgs
+                DkJpegTransform transform;
+                if (mActiveManipulator->losslessTransform(transform))
+                    l->setLosslessEdit(img, transform);
             }
         }
     } else
@@ -967,6 +1032,7 @@ void DkViewPort::manipulatorApplied()
 
 void DkViewPort::paintEvent(QPaintEvent *event)
 {
+    DkTraceZone tz("DkViewPort::paintEvent");
     QPainter painter(viewport());
 
     if (!mImgStorage.isEmpty()) {
@@ -1009,7 +1075,7 @@ void DkViewPort::paintEvent(QPaintEvent *event)
                 painter.setTransform(swipeTransform);
             }
 
-            painter.drawImage(mFadeImgViewRect, mAnimationBuffer, mAnimationBuffer.rect());
+            painter.drawPixmap(mFadeImgViewRect, mAnimationBuffer, mAnimationBuffer.rect());
             painter.setOpacity(oldOp);
         }
 
@@ -1040,6 +1106,9 @@ void DkViewPort::paintEvent(QPaintEvent *event)
 
     // propagate
     QGraphicsView::paintEvent(event);
+
+    if (!mImgStorage.isEmpty() && !DkStartupTimeline::instance().isFinished())
+        DkStartupTimeline::instance().finish("first image painted");
 }
 
 void DkViewPort::leaveEvent(QEvent *event)
@@ -1170,6 +1239,7 @@ void DkViewPort::resizeEvent(QResizeEvent *event)
 
     mController->getOverview()->setViewPortRect(geometry());
     mController->resize(width(), height());
+    mController->getPlayer()->setDisplaySize(size());
 
     return QGraphicsView::resizeEvent(event);
 }
@@ -1445,7 +1515,7 @@ QPoint DkViewPort::mapToImage(const QPoint &windowPos) const
 
 void DkViewPort::getPixelInfo(const QPoint &pos)
 {
-    if (mImgStorage.isEmpty())
+    if (mImgStorage.isEmpty() || mImgStorage.isPreview())
         return;
 
     QPoint xy = mapToImage(pos);
@@ -1468,7 +1538,7 @@ void DkViewPort::getPixelInfo(const QPoint &pos)
 
 QString DkViewPort::getCurrentPixelHexValue()
 {
-    if (mImgStorage.isEmpty() || mCurrentPixelPos.isNull())
+    if (mImgStorage.isEmpty() || mImgStorage.isPreview() || mCurrentPixelPos.isNull())
         return QString();
 
     QPointF imgPos = mWorldMatrix.inverted().map(QPointF(mCurrentPixelPos));
@@ -1554,7 +1624,7 @@ void DkViewPort::animateFade()
     mAnimationValue += (float)speed;
 
     if (mAnimationValue <= 0) {
-        mAnimationBuffer = QImage();
+        mAnimationBuffer = QPixmap();
         mAnimationTimer->stop();
         mAnimationValue = 0;
     }
@@ -1659,7 +1729,11 @@ bool DkViewPort::unloadImage(bool fileChange)
     if (DkSettingsManager::param().display().animationDuration > 0
         && (mController->getPlayer()->isPlaying() || DkUtils::getMainWindow()->isFullScreen() || DkSettingsManager::param().display().alwaysAnimate)) {
         QRect dr = mWorldMatrix.mapRect(mImgViewRect).toRect();
-        mAnimationBuffer = mImgStorage.image(dr.size());
+        mAnimationBuffer = mImgStorage.pixmap(dr.size());
+
+        // convert once here - the transition then only blits
+        if (mAnimationBuffer.isNull())
+            mAnimationBuffer = QPixmap::fromImage(mImgStorage.displayImage(dr.size()));
         mFadeImgViewRect = mImgViewRect;
         mFadeImgRect = mImgRect;
         mAnimationValue = 1.0f;
@@ -1897,11 +1971,18 @@ void DkViewPort::connectLoader(QSharedPointer<DkImageLoader> loader, bool connec
         return;
 
     if (connectSignals) {
+        mController->getPlayer()->setImageLoader(loader);
+
         connect(loader.data(),
                 SIGNAL(imageLoadedSignal(QSharedPointer<DkImageContainerT>, bool)),
                 this,
                 SLOT(updateImage(QSharedPointer<DkImageContainerT>, bool)),
                 Qt::UniqueConnection);
+        connect(loader.data(),
+                SIGNAL(imagePreviewSignal(QSharedPointer<DkImageContainerT>, const QImage &, const QSize &)),
+                this,
+                SLOT(setPreview(QSharedPointer<DkImageContainerT>, const QImage &, const QSize &)),
+                Qt::UniqueConnection);
         connect(loader.data(),
                 SIGNAL(imageLoadedSignal(QSharedPointer<DkImageContainerT>)),
                 mController->getMetaDataWidget(),
@@ -1942,10 +2023,16 @@ void DkViewPort::connectLoader(QSharedPointer<DkImageLoader> loader, bool connec
         connect(loader.data(), SIGNAL(imageUpdatedSignal(int)), mController->getScroller(), SLOT(updateFile(int)), Qt::UniqueConnection);
         connect(mController->getScroller(), SIGNAL(valueChanged(int)), loader.data(), SLOT(loadFileAt(int)));
     } else {
+        mController->getPlayer()->setImageLoader(QSharedPointer<DkImageLoader>());
+
         disconnect(loader.data(),
                    SIGNAL(imageLoadedSignal(QSharedPointer<DkImageContainerT>, bool)),
                    this,
                    SLOT(updateImage(QSharedPointer<DkImageContainerT>, bool)));
+        disconnect(loader.data(),
+                   SIGNAL(imagePreviewSignal(QSharedPointer<DkImageContainerT>, const QImage &, const QSize &)),
+                   this,
+                   SLOT(setPreview(QSharedPointer<DkImageContainerT>, const QImage &, const QSize &)));
         disconnect(loader.data(),
                    SIGNAL(imageLoadedSignal(QSharedPointer<DkImageContainerT>)),
                    mController->getMetaDataWidget(),
@@ -2104,13 +2191,18 @@ void DkViewPortFrameless::draw(QPainter &painter, double)
         painter.drawPixmap(mImgViewRect, mMovie->currentPixmap(), mMovie->frameRect());
     } else {
         QRect displayRect = mWorldMatrix.mapRect(mImgViewRect).toRect();
-        QImage img = mImgStorage.image(displayRect.size());
+        QPixmap pm = mImgStorage.pixmap(displayRect.size());
 
         // opacity == 1.0f -> do not show pattern if we crossfade two images
-        if (DkSettingsManager::param().display().tpPattern && img.hasAlphaChannel())
+        if (DkSettingsManager::param().display().tpPattern && mImgStorage.imageConst().hasAlphaChannel())
             drawPattern(painter);
 
-        painter.drawImage(mImgViewRect, img, QRect(QPoint(), img.size()));
+        if (!pm.isNull()) {
+            painter.drawPixmap(mImgViewRect, pm, QRect(QPoint(), pm.size()));
+        } else {
+            QImage img = mImgStorage.displayImage(displayRect.size());
+            painter.drawImage(mImgViewRect, img, QRect(QPoint(), img.size()));
+        }
     }
 }
 
@@ -2427,11 +2519,8 @@ void DkViewPortContrast::draw(QPainter &painter, double opacity)
     if (DkUtils::getMainWindow()->isFullScreen())
         painter.setBackground(DkSettingsManager::param().slideShow().backgroundColor);
 
-    QRect dr = mWorldMatrix.mapRect(mImgViewRect).toRect();
-    QImage img = mImgStorage.image(dr.size());
-
     // opacity == 1.0f -> do not show pattern if we crossfade two images
-    if (DkSettingsManager::param().display().tpPattern && img.hasAlphaChannel() && opacity == 1.0)
+    if (DkSettingsManager::param().display().tpPattern && mImgStorage.imageConst().hasAlphaChannel() && opacity == 1.0)
         drawPattern(painter);
 
     if (mDrawFalseColorImg)
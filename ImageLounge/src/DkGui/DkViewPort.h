@@ -195,6 +195,7 @@ public slots:
     virtual void setEditedImage(const QImage &newImg, const QString &editName);
     virtual void setEditedImage(QSharedPointer<DkImageContainerT> img);
     virtual void setImage(QImage newImg) override;
+    void setPreview(QSharedPointer<DkImageContainerT> imgC, const QImage &img, const QSize &fullSize);
 
     void settingsChanged();
     void pauseMovie(bool paused);
@@ -227,7 +228,7 @@ protected:
     // fading stuff
     QTimer *mAnimationTimer;
     DkTimer mAnimationTime;
-    QImage mAnimationBuffer;
+    QPixmap mAnimationBuffer;
     double mAnimationValue;
     QRectF mFadeImgViewRect;
     QRectF mFadeImgRect;
@@ -259,6 +260,8 @@ protected:
     void drawPolygon(QPainter &painter, const QPolygon &polygon);
     virtual void drawBackground(QPainter &painter);
     virtual void updateImageMatrix() override;
+    void initImageMatrix();
+    void startFading();
     void showZoom();
     void toggleLena(bool fullscreen);
     void getPixelInfo(const QPoint &pos);
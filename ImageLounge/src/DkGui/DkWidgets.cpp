@@ -32,6 +32,7 @@
 #include "DkImageContainer.h"
 #include "DkImageStorage.h"
 #include "DkSettings.h"
+#include "DkSlideShow.h"
 #include "DkStatusBar.h"
 #include "DkThumbs.h"
 #include "DkTimer.h"
@@ -336,7 +337,7 @@ void DkThumbsSaver::loadNext()
 
     for (int idx = 0; idx < mImages.size(); idx++) {
         connect(mImages.at(idx)->getThumb().data(), SIGNAL(thumbLoadedSignal(bool)), this, SLOT(thumbLoaded(bool)));
-        mImages.at(idx)->getThumb()->fetchThumb(force);
+        mImages.at(idx)->getThumb()->fetchThumb(force, QSharedPointer<QByteArray>(), DkThumbNailT::fetch_background);
     }
 }
 
@@ -1398,10 +1399,9 @@ void DkPlayer::init()
     int timeToDisplayPlayer = 3000;
     timeToDisplay = qRound(DkSettingsManager::param().slideShow().time * 1000);
     playing = false;
-    displayTimer = new QTimer(this);
-    displayTimer->setInterval(timeToDisplay);
-    displayTimer->setSingleShot(true);
-    connect(displayTimer, SIGNAL(timeout()), this, SLOT(autoNext()));
+    scheduler = new DkSlideShowScheduler(this);
+    scheduler->setInterval(timeToDisplay);
+    connect(scheduler, SIGNAL(nextSignal()), this, SLOT(autoNext()));
 
     hideTimer = new QTimer(this);
     hideTimer->setInterval(timeToDisplayPlayer);
@@ -1419,10 +1419,11 @@ void DkPlayer::play(bool play)
     playing = play;
 
     if (play) {
-        displayTimer->start();
+        scheduler->setInterval(qRound(DkSettingsManager::param().slideShow().time * 1000)); // if it was updated...
+        scheduler->start();
         hideTimer->start();
     } else
-        displayTimer->stop();
+        scheduler->stop();
 }
 
 void DkPlayer::togglePlay()
@@ -1435,8 +1436,8 @@ void DkPlayer::togglePlay()
 void DkPlayer::startTimer()
 {
     if (playing) {
-        displayTimer->setInterval(qRound(DkSettingsManager::param().slideShow().time * 1000)); // if it was updated...
-        displayTimer->start();
+        scheduler->setInterval(qRound(DkSettingsManager::param().slideShow().time * 1000)); // if it was updated...
+        scheduler->slideShown();
     }
 }
 
@@ -1465,7 +1466,17 @@ bool DkPlayer::isPlaying() const
 void DkPlayer::setTimeToDisplay(int ms)
 {
     timeToDisplay = ms;
-    displayTimer->setInterval(ms);
+    scheduler->setInterval(ms);
+}
+
+void DkPlayer::setImageLoader(QSharedPointer<DkImageLoader> loader)
+{
+    scheduler->setImageLoader(loader);
+}
+
+void DkPlayer::setDisplaySize(const QSize &size)
+{
+    scheduler->setDisplaySize(size);
 }
 
 void DkPlayer::show(int ms)
@@ -69,6 +69,8 @@ namespace nmc
 {
 // nomacs defines
 class DkCropToolBar;
+class DkImageLoader;
+class DkSlideShowScheduler;
 
 class DkButton : public QPushButton
 {
@@ -247,6 +249,8 @@ public:
     ~DkPlayer(){};
 
     void setTimeToDisplay(int ms = 1000);
+    void setImageLoader(QSharedPointer<DkImageLoader> loader);
+    void setDisplaySize(const QSize &size);
 
 signals:
     void nextSignal();
@@ -269,7 +273,7 @@ protected:
     bool playing = false;
 
     int timeToDisplay;
-    QTimer *displayTimer;
+    DkSlideShowScheduler *scheduler;
     QTimer *hideTimer;
 
     QPushButton *previousButton;
@@ -0,0 +1,439 @@
+/*******************************************************************************************************
+ DkBenchmark.cpp
+ Created on:	19.10.2026
+
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+
+ Copyright (C) 2011-2016 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2016 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2016 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ *******************************************************************************************************/
+
+#include "DkBenchmark.h"
+
+#include "DkBasicLoader.h"
+#include "DkImageEncoder.h"
+#include "DkImageLoader.h"
+#include "DkImageStorage.h"
+#include "DkManipulators.h"
+#include "DkMetaData.h"
+#include "DkThumbs.h"
+#include "DkVersion.h"
+
+#pragma warning(push, 0) // no warnings from includes - begin
+#include <QBuffer>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QPainter>
+#include <QRandomGenerator>
+#include <QSysInfo>
+#include <QTextStream>
+#include <QThreadPool>
+#pragma warning(pop) // no warnings from includes - end
+
+#include <algorithm>
+#include <iostream>
+
+namespace nmc
+{
+
+// DkBenchmark --------------------------------------------------------------------
+DkBenchmark::DkBenchmark(const Config &config)
+    : mConfig(config)
+{
+}
+
+bool DkBenchmark::run()
+{
+    if (!QDir().mkpath(mConfig.workDir)) {
+        qCritical() << "[Benchmark] cannot create" << mConfig.workDir;
+        return false;
+    }
+
+    generateData();
+
+    benchLoad();
+    benchSave();
+    benchResize();
+    benchThumbnails();
+    benchManipulators();
+    benchMetaData();
+    benchDirectory();
+
+    QJsonObject config;
+    config.insert("seed", (qint64)mConfig.seed);
+    config.insert("iterations", mConfig.iterations);
+    config.insert("numFiles", mConfig.numFiles);
+    config.insert("formats", QJsonArray::fromStringList(mConfig.formats));
+
+    QJsonObject system;
+    system.insert("version", NOMACS_VERSION_STR);
+    system.insert("os", QSysInfo::prettyProductName());
+    system.insert("cpu", QSysInfo::currentCpuArchitecture());
+    system.insert("threads", QThreadPool::globalInstance()->maxThreadCount());
+
+    QJsonObject report;
+    report.insert("date", QDateTime::currentDateTime().toString(Qt::ISODate));
+    report.insert("system", system);
+    report.insert("config", config);
+    report.insert("results", mResults);
+
+    QByteArray json = QJsonDocument(report).toJson(QJsonDocument::Indented);
+
+    if (mConfig.outputPath.isEmpty()) {
+        std::cout << json.toStdString() << std::endl;
+        return true;
+    }
+
+    QFile file(mConfig.outputPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qCritical() << "[Benchmark] cannot write" << mConfig.outputPath;
+        return false;
+    }
+
+    file.write(json);
+    qInfo() << "[Benchmark] report written to" << mConfig.outputPath;
+
+    return true;
+}
+
+/**
+ * Creates a deterministic test image.
+ * Smooth gradients and shapes are mixed with noise so that
+ * encoders behave similar to photographs (not too compressible).
+ * @param size the image size
+ * @param seed the random seed
+ * @return QImage an RGB888 image
+ **/
+QImage DkBenchmark::syntheticImage(const QSize &size, quint32 seed)
+{
+    QRandomGenerator rng(seed);
+
+    QImage img(size, QImage::Format_RGB888);
+
+    for (int y = 0; y < img.height(); y++) {
+        uchar *ptr = img.scanLine(y);
+        int gy = y * 255 / qMax(img.height() - 1, 1);
+
+        for (int x = 0; x < img.width(); x++) {
+            int gx = x * 255 / qMax(img.width() - 1, 1);
+            int n = (int)(rng.generate() & 0x1f) - 16;
+
+            *ptr++ = (uchar)qBound(0, gx + n, 255);
+            *ptr++ = (uchar)qBound(0, gy + n, 255);
+            *ptr++ = (uchar)qBound(0, ((gx + gy) >> 1) + n, 255);
+        }
+    }
+
+    QPainter p(&img);
+    p.setRenderHint(QPainter::Antialiasing);
+
+    for (int idx = 0; idx < 32; idx++) {
+        QColor c(rng.bounded(256), rng.bounded(256), rng.bounded(256), 160);
+        QRect r(rng.bounded(img.width()), rng.bounded(img.height()), rng.bounded(img.width() / 4 + 1), rng.bounded(img.height() / 4 + 1));
+
+        p.setPen(Qt::NoPen);
+        p.setBrush(c);
+        idx % 2 ? p.drawEllipse(r) : p.drawRect(r);
+    }
+
+    return img;
+}
+
+void DkBenchmark::generateData()
+{
+    // test images
+    for (const QSize &s : mConfig.sizes) {
+        QImage img;
+
+        for (const QString &fmt : mConfig.formats) {
+            QString fp = imagePath(s, fmt);
+
+            if (QFileInfo(fp).exists())
+                continue;
+
+            if (img.isNull())
+                img = syntheticImage(s, mConfig.seed ^ (quint32)(s.width() * 31 + s.height()));
+
+            DkBasicLoader loader;
+            loader.save(fp, img, 90);
+        }
+    }
+
+    // a folder for indexing: the files are tiny - we want to measure the file system & filter code
+    QDir dir(folderPath());
+    if (dir.exists() && (int)dir.count() - 2 == mConfig.numFiles)
+        return;
+
+    dir.removeRecursively();
+    dir.mkpath(".");
+
+    QImage small = syntheticImage(QSize(16, 16), mConfig.seed);
+    QByteArray ba;
+    QBuffer buffer(&ba);
+    buffer.open(QIODevice::WriteOnly);
+    small.save(&buffer, "PNG");
+
+    QRandomGenerator rng(mConfig.seed);
+    for (int idx = 0; idx < mConfig.numFiles; idx++) {
+        QString ext = mConfig.formats[rng.bounded(mConfig.formats.size())];
+        QFile f(dir.absoluteFilePath(QString("IMG_%1.%2").arg(idx, 6, 10, QChar('0')).arg(ext)));
+
+        if (f.open(QIODevice::WriteOnly))
+            f.write(ba);
+    }
+}
+
+QString DkBenchmark::imagePath(const QSize &size, const QString &format) const
+{
+    return QDir(mConfig.workDir).absoluteFilePath(QString("bench-%1x%2-%3.%4").arg(size.width()).arg(size.height()).arg(mConfig.seed).arg(format));
+}
+
+QString DkBenchmark::folderPath() const
+{
+    return QDir(mConfig.workDir).absoluteFilePath(QString("folder-%1").arg(mConfig.seed));
+}
+
+bool DkBenchmark::isSelected(const QString &name) const
+{
+    if (mConfig.filters.isEmpty())
+        return true;
+
+    for (const QString &f : mConfig.filters) {
+        if (name.contains(f, Qt::CaseInsensitive))
+            return true;
+    }
+
+    return false;
+}
+
+void DkBenchmark::measure(Stats &stats, const std::function<void()> &fnc)
+{
+    if (!isSelected(stats.name))
+        return;
+
+    // warm up (file cache, lazy initialization)
+    fnc();
+
+    QElapsedTimer t;
+    for (int idx = 0; idx < mConfig.iterations; idx++) {
+        t.start();
+        fnc();
+        stats.samples << t.nsecsElapsed();
+    }
+
+    QJsonObject r = toJson(stats);
+    mResults << r;
+
+    qInfo().noquote() << "[Benchmark]" << stats.name << QJsonDocument(stats.params).toJson(QJsonDocument::Compact) << "p50:" << r.value("p50_ms").toDouble()
+                      << "ms";
+}
+
+QJsonObject DkBenchmark::toJson(const Stats &stats) const
+{
+    QVector<qint64> s = stats.samples;
+    std::sort(s.begin(), s.end());
+
+    auto percentile = [&](double p) {
+        if (s.isEmpty())
+            return 0.0;
+        int idx = qBound(0, qRound(p * (s.size() - 1)), s.size() - 1);
+        return s[idx] / 1e6;
+    };
+
+    double sum = 0.0;
+    for (qint64 v : s)
+        sum += v;
+    double mean = s.isEmpty() ? 0.0 : sum / s.size() / 1e6;
+
+    QJsonObject o;
+    o.insert("name", stats.name);
+    o.insert("params", stats.params);
+    o.insert("iterations", s.size());
+    o.insert("mean_ms", mean);
+    o.insert("min_ms", percentile(0.0));
+    o.insert("p50_ms", percentile(0.5));
+    o.insert("p90_ms", percentile(0.9));
+    o.insert("p99_ms", percentile(0.99));
+    o.insert("max_ms", percentile(1.0));
+
+    if (!stats.unitName.isEmpty() && mean > 0)
+        o.insert("throughput", QJsonObject{{"value", stats.units / (mean / 1000.0)}, {"unit", stats.unitName + "/s"}});
+
+    return o;
+}
+
+void DkBenchmark::benchLoad()
+{
+    for (const QSize &s : mConfig.sizes) {
+        for (const QString &fmt : mConfig.formats) {
+            Stats stats;
+            stats.name = "DkBasicLoader::loadGeneral";
+            stats.params = QJsonObject{{"format", fmt}, {"width", s.width()}, {"height", s.height()}};
+            stats.units = s.width() * s.height() / 1e6;
+            stats.unitName = "MPixel";
+
+            QString fp = imagePath(s, fmt);
+            measure(stats, [&]() {
+                DkBasicLoader loader;
+                loader.loadGeneral(fp, false, true);
+            });
+        }
+    }
+}
+
+void DkBenchmark::benchSave()
+{
+    if (!isSelected("DkBasicLoader::saveToBuffer"))
+        return;
+
+    for (const QSize &s : mConfig.sizes) {
+        QImage img = syntheticImage(s, mConfig.seed);
+
+        for (const QString &fmt : mConfig.formats) {
+            for (int preset = DkImageEncoder::preset_default; preset < DkImageEncoder::preset_end; preset++) {
+                DkBasicLoader loader;
+                loader.setSavePreset(preset);
+                QString fp = imagePath(s, fmt);
+
+                // the output size is part of the result: presets trade size for time
+                QSharedPointer<QByteArray> ba(new QByteArray());
+                loader.saveToBuffer(fp, img, ba);
+
+                Stats stats;
+                stats.name = "DkBasicLoader::saveToBuffer";
+                stats.params = QJsonObject{{"format", fmt},
+                                           {"preset", DkImageEncoder::presetName(preset)},
+                                           {"width", s.width()},
+                                           {"height", s.height()},
+                                           {"bytes", ba->size()}};
+                stats.units = s.width() * s.height() / 1e6;
+                stats.unitName = "MPixel";
+
+                measure(stats, [&]() {
+                    QSharedPointer<QByteArray> b(new QByteArray());
+                    loader.saveToBuffer(fp, img, b);
+                });
+            }
+        }
+    }
+}
+
+void DkBenchmark::benchResize()
+{
+    const QVector<int> ipls = {DkImage::ipl_nearest, DkImage::ipl_area, DkImage::ipl_linear, DkImage::ipl_cubic, DkImage::ipl_lanczos};
+    const QStringList iplNames = {"nearest", "area", "linear", "cubic", "lanczos"};
+
+    for (const QSize &s : mConfig.sizes) {
+        QImage img = syntheticImage(s, mConfig.seed);
+
+        for (int idx = 0; idx < ipls.size(); idx++) {
+            Stats stats;
+            stats.name = "DkImage::resizeImage";
+            stats.params = QJsonObject{{"interpolation", iplNames[idx]}, {"factor", 0.5}, {"width", s.width()}, {"height", s.height()}};
+            stats.units = s.width() * s.height() / 1e6;
+            stats.unitName = "MPixel";
+
+            measure(stats, [&]() {
+                DkImage::resizeImage(img, QSize(), 0.5, ipls[idx]);
+            });
+        }
+    }
+}
+
+void DkBenchmark::benchThumbnails()
+{
+    for (const QSize &s : mConfig.sizes) {
+        for (const QString &fmt : mConfig.formats) {
+            Stats stats;
+            stats.name = "DkThumbNail::computeIntern";
+            stats.params = QJsonObject{{"format", fmt}, {"width", s.width()}, {"height", s.height()}};
+            stats.units = 1;
+            stats.unitName = "thumbnails";
+
+            QString fp = imagePath(s, fmt);
+            measure(stats, [&]() {
+                DkThumbNail thumb(fp);
+                thumb.compute();
+            });
+        }
+    }
+}
+
+void DkBenchmark::benchManipulators()
+{
+    DkManipulatorManager mm;
+    mm.createManipulators(0);
+
+    for (const QSize &s : mConfig.sizes) {
+        QImage img = syntheticImage(s, mConfig.seed);
+
+        for (const QSharedPointer<DkBaseManipulator> &m : mm.manipulators()) {
+            Stats stats;
+            stats.name = "DkManipulatorsIpl::" + m->name();
+            stats.params = QJsonObject{{"width", s.width()}, {"height", s.height()}};
+            stats.units = s.width() * s.height() / 1e6;
+            stats.unitName = "MPixel";
+
+            measure(stats, [&]() {
+                m->apply(img);
+            });
+        }
+    }
+}
+
+void DkBenchmark::benchMetaData()
+{
+    for (const QString &fmt : mConfig.formats) {
+        Stats stats;
+        stats.name = "DkMetaDataT::readMetaData";
+        stats.params = QJsonObject{{"format", fmt}};
+        stats.units = 1;
+        stats.unitName = "files";
+
+        QString fp = imagePath(mConfig.sizes.first(), fmt);
+        measure(stats, [&]() {
+            DkMetaDataT md;
+            md.readMetaData(fp);
+        });
+    }
+}
+
+void DkBenchmark::benchDirectory()
+{
+    Stats stats;
+    stats.name = "DkImageLoader::getFilteredFileInfoList";
+    stats.params = QJsonObject{{"files", mConfig.numFiles}};
+    stats.units = mConfig.numFiles;
+    stats.unitName = "files";
+
+    DkImageLoader loader;
+    QString dirPath = folderPath();
+
+    measure(stats, [&]() {
+        loader.getFilteredFileInfoList(dirPath);
+    });
+}
+
+}
@@ -0,0 +1,99 @@
+/*******************************************************************************************************
+ DkBenchmark.h
+ Created on:	19.10.2026
+
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+
+ Copyright (C) 2011-2016 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2016 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2016 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ *******************************************************************************************************/
+
+#pragma once
+
+#pragma warning(push, 0) // no warnings from includes - begin
+#include <QImage>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QSize>
+#include <QStringList>
+#include <QVector>
+#pragma warning(pop) // no warnings from includes - end
+
+#include <functional>
+
+namespace nmc
+{
+
+/**
+ * Benchmarks the core image engine (loading, saving, resizing, thumbnails,
+ * manipulators, metadata and directory indexing) on synthetic data.
+ * All test images are generated from a seed so that successive builds
+ * measure exactly the same input. Results are reported as JSON.
+ **/
+class DkBenchmark
+{
+public:
+    struct Config {
+        QString workDir; // synthetic data is written here
+        QString outputPath; // JSON report (stdout if empty)
+        QVector<QSize> sizes = {QSize(1920, 1080), QSize(6000, 4000)};
+        QStringList formats = {"jpg", "png", "tif"};
+        QStringList filters; // only run benchmarks whose name contains one of these
+        int iterations = 10;
+        int numFiles = 1000; // files of the directory indexing benchmark
+        quint32 seed = 42;
+    };
+
+    DkBenchmark(const Config &config);
+
+    bool run();
+
+    static QImage syntheticImage(const QSize &size, quint32 seed);
+
+protected:
+    struct Stats {
+        QString name;
+        QJsonObject params;
+        QVector<qint64> samples; // nanoseconds
+        double units = 0.0; // processed units per iteration (e.g. MPixels)
+        QString unitName;
+    };
+
+    void generateData();
+    QString imagePath(const QSize &size, const QString &format) const;
+    QString folderPath() const;
+
+    bool isSelected(const QString &name) const;
+    void measure(Stats &stats, const std::function<void()> &fnc);
+    QJsonObject toJson(const Stats &stats) const;
+
+    void benchLoad();
+    void benchSave();
+    void benchResize();
+    void benchThumbnails();
+    void benchManipulators();
+    void benchMetaData();
+    void benchDirectory();
+
+    Config mConfig;
+    QJsonArray mResults;
+};
+
+}
@@ -0,0 +1,136 @@
+/*******************************************************************************************************
+ main.cpp (nomacsBench)
+ Created on:	19.10.2026
+
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+
+ Copyright (C) 2011-2016 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2016 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2016 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ *******************************************************************************************************/
+
+#pragma warning(push, 0) // no warnings from includes - begin
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QDir>
+#include <QStandardPaths>
+#pragma warning(pop) // no warnings from includes - end
+
+#include "DkBenchmark.h"
+#include "DkMetaData.h"
+#include "DkSettings.h"
+#include "DkVersion.h"
+
+int main(int argc, char *argv[])
+{
+    // the core creates widgets & actions - we don't want to see them
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QCoreApplication::setOrganizationName("nomacs");
+    QCoreApplication::setApplicationName("nomacsBench");
+    QCoreApplication::setApplicationVersion(NOMACS_VERSION_STR);
+
+    QApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmarks the nomacs core on synthetic images and reports JSON.");
+    parser.addHelpOption();
+    parser.addVersionOption();
+
+    QCommandLineOption outOpt(QStringList() << "o"
+                                            << "output",
+                              "Write the JSON report to <path> (default: stdout).",
+                              "path");
+    parser.addOption(outOpt);
+
+    QCommandLineOption workOpt(QStringList() << "w"
+                                             << "work-dir",
+                               "Directory for the generated test data (reused if it exists).",
+                               "dir");
+    parser.addOption(workOpt);
+
+    QCommandLineOption sizesOpt(QStringList() << "sizes", "Comma separated image sizes, e.g. 1920x1080,6000x4000.", "sizes");
+    parser.addOption(sizesOpt);
+
+    QCommandLineOption formatsOpt(QStringList() << "formats", "Comma separated formats, e.g. jpg,png,tif.", "formats");
+    parser.addOption(formatsOpt);
+
+    QCommandLineOption filesOpt(QStringList() << "files", "Number of files in the indexing folder.", "n");
+    parser.addOption(filesOpt);
+
+    QCommandLineOption iterOpt(QStringList() << "i"
+                                             << "iterations",
+                               "Iterations per benchmark.",
+                               "n");
+    parser.addOption(iterOpt);
+
+    QCommandLineOption seedOpt(QStringList() << "seed", "Random seed of the synthetic data.", "seed");
+    parser.addOption(seedOpt);
+
+    QCommandLineOption filterOpt(QStringList() << "f"
+                                               << "filter",
+                                 "Only run benchmarks whose name contains <name> (can be repeated).",
+                                 "name");
+    parser.addOption(filterOpt);
+
+    parser.process(app);
+
+    // we use the default settings so that user settings do not influence the results
+    nmc::DkSettingsManager::param().initFileFilters();
+    nmc::DkMetaDataHelper::initialize();
+
+    nmc::DkBenchmark::Config config;
+    config.workDir = QDir(QStandardPaths::writableLocation(QStandardPaths::TempLocation)).absoluteFilePath("nomacs-bench");
+    config.outputPath = parser.value(outOpt);
+    config.filters = parser.values(filterOpt);
+
+    if (parser.isSet(workOpt))
+        config.workDir = parser.value(workOpt);
+    if (parser.isSet(iterOpt))
+        config.iterations = qMax(1, parser.value(iterOpt).toInt());
+    if (parser.isSet(filesOpt))
+        config.numFiles = qMax(1, parser.value(filesOpt).toInt());
+    if (parser.isSet(seedOpt))
+        config.seed = parser.value(seedOpt).toUInt();
+    if (parser.isSet(formatsOpt))
+        config.formats = parser.value(formatsOpt).split(",", Qt::SkipEmptyParts);
+
+    if (parser.isSet(sizesOpt)) {
+        config.sizes.clear();
+
+        for (const QString &s : parser.value(sizesOpt).split(",", Qt::SkipEmptyParts)) {
+            QStringList wh = s.split("x");
+            if (wh.size() == 2 && wh[0].toInt() > 0 && wh[1].toInt() > 0)
+                config.sizes << QSize(wh[0].toInt(), wh[1].toInt());
+            else
+                qWarning() << "illegal size:" << s << "use <width>x<height>";
+        }
+    }
+
+    if (config.sizes.isEmpty() || config.formats.isEmpty()) {
+        qCritical() << "nothing to benchmark...";
+        return 1;
+    }
+
+    nmc::DkBenchmark bench(config);
+
+    return bench.run() ? 0 : 1;
+}
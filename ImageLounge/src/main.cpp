@@ -36,6 +36,7 @@
 #include <QObject>
 #include <QProcess>
 #include <QTextStream>
+#include <QTimer>
 #include <QTranslator>
 
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
@@ -88,6 +89,9 @@ int main(int argc, char *argv[])
 {
 #endif
 
+    // starts the start-up clock
+    nmc::DkStartupTimeline &timeline = nmc::DkStartupTimeline::instance();
+
     QCoreApplication::setOrganizationName("nomacs");
     QCoreApplication::setOrganizationDomain("https://nomacs.org");
     QCoreApplication::setApplicationName("Image Lounge");
@@ -96,6 +100,7 @@ int main(int argc, char *argv[])
     QApplication::setAttribute(Qt::AA_DisableHighDpiScaling, true);
 
     QApplication app(argc, (char **)argv);
+    timeline.mark("QApplication");
 
 #ifdef Q_OS_LINUX
     app.setDesktopFileName("org.nomacs.ImageLounge");
@@ -108,6 +113,7 @@ int main(int argc, char *argv[])
     // init settings
     nmc::DkSettingsManager::instance().init();
     nmc::DkMetaDataHelper::initialize(); // this line makes the XmpParser thread-save - so don't delete it even if you seem to know what you do
+    timeline.mark("settings");
 
     nmc::DefaultSettings settings;
     int mode = settings.value("AppSettings/appMode", nmc::DkSettingsManager::param().app().appMode).toInt();
@@ -177,8 +183,17 @@ int main(int argc, char *argv[])
     QCommandLineOption registerFilesOpt(QStringList() << "register-files", QObject::tr("Register file associations (Windows only)."));
     parser.addOption(registerFilesOpt);
 
+    QCommandLineOption traceOpt(QStringList() << "trace", QObject::tr("Saves a performance trace to <trace-path.json>."), QObject::tr("trace-path.json"));
+    parser.addOption(traceOpt);
+
     parser.process(app);
 
+    // enable performance tracing (chrome://tracing or ui.perfetto.dev can open the file)
+    if (!parser.value(traceOpt).isEmpty()) {
+        nmc::DkTracer::instance().setFilePath(parser.value(traceOpt));
+        nmc::DkTracer::instance().setEnabled(true);
+    }
+
     // CMD parser --------------------------------------------------------------------
     nmc::DkPluginManager::createPluginsPath();
 
@@ -191,6 +206,9 @@ int main(int argc, char *argv[])
         QString batchSettingsPath = parser.value(batchOpt);
         nmc::DkBatchProcessing::computeBatch(batchSettingsPath, logPath);
 
+        if (nmc::DkTracer::instance().isEnabled())
+            nmc::DkTracer::instance().save();
+
         return 0;
     }
 
@@ -223,6 +241,7 @@ int main(int argc, char *argv[])
     QTranslator translatorQt;
     nmc::DkSettingsManager::param().loadTranslation(translationNameQt, translatorQt);
     app.installTranslator(&translatorQt);
+    timeline.mark("translations");
 
     nmc::DkNoMacs *w = 0;
     nmc::DkPong *pw = 0; // pong
@@ -248,8 +267,6 @@ int main(int argc, char *argv[])
         nmc::DkSettingsManager::param().app().currentAppMode = mode;
     }
 
-    nmc::DkTimer dt;
-
     // initialize nomacs
     if (mode == nmc::DkSettingsManager::param().mode_frameless) {
         w = new nmc::DkNoMacsFrameless();
@@ -264,6 +281,8 @@ int main(int argc, char *argv[])
     } else
         w = new nmc::DkNoMacsIpl();
 
+    timeline.mark("main window");
+
     // show what we got...
     w->show();
 
@@ -273,7 +292,7 @@ int main(int argc, char *argv[])
     if (w)
         w->onWindowLoaded();
 
-    qInfo() << "Initialization takes: " << dt;
+    timeline.mark("window shown");
 
     nmc::DkCentralWidget *cw = w->getTabWidget();
 
@@ -313,6 +332,12 @@ int main(int argc, char *argv[])
         w->showRecentFilesOnStartUp();
     }
 
+    // the start-up ends with the first image painted (see DkViewPort::paintEvent)
+    if (!loading)
+        timeline.finish("no image to load");
+    else
+        QTimer::singleShot(5000, &timeline, SLOT(finish())); // do not wait forever if the image cannot be loaded
+
     int fullScreenMode = settings.value("AppSettings/currentAppMode", nmc::DkSettingsManager::param().app().currentAppMode).toInt();
 
     if (fullScreenMode == nmc::DkSettingsManager::param().mode_default_fullscreen || fullScreenMode == nmc::DkSettingsManager::param().mode_frameless_fullscreen
@@ -338,6 +363,9 @@ int main(int argc, char *argv[])
         QMessageBox::critical(0, QObject::tr("Critical Error"), QObject::tr("Sorry, nomacs ran out of memory..."), QMessageBox::Ok);
     }
 
+    if (nmc::DkTracer::instance().isEnabled())
+        nmc::DkTracer::instance().save();
+
     // restore message handler, workaround for: https://github.com/nomacs/nomacs/issues/874
     qInstallMessageHandler(0);
 